@@ -28,6 +28,7 @@
 
 #include <nidas/core/FileSet.h>
 #include <nidas/core/Socket.h>
+#include <nidas/core/ShmRingIOChannel.h>
 #include <nidas/core/IOChannel.h>
 #include <nidas/dynld/RawSampleInputStream.h>
 #include <nidas/core/Project.h>
@@ -736,6 +737,11 @@ DataDump::run() throw()
                 nidas::core::FileSet::getFileSet(app.dataFileNames());
             iochan = fset->connect();
         }
+        else if (!app.shmRingName().empty())
+        {
+            ShmRingIOChannel* ring = new ShmRingIOChannel(app.shmRingName());
+            iochan = ring->connect();
+        }
         else
         {
             // We know a default socket address was provided, so it's safe
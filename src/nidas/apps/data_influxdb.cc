@@ -30,6 +30,7 @@
 
 #include <nidas/core/FileSet.h>
 #include <nidas/core/Socket.h>
+#include <nidas/core/ShmRingIOChannel.h>
 #include <nidas/dynld/RawSampleInputStream.h>
 #include <nidas/core/Project.h>
 #include <nidas/core/XMLParser.h>
@@ -1349,6 +1350,11 @@ int DataInfluxdb::run() throw()
                 nidas::core::FileSet::getFileSet(app.dataFileNames());
             iochan = fset->connect();
         }
+        else if (!app.shmRingName().empty())
+        {
+            ShmRingIOChannel* ring = new ShmRingIOChannel(app.shmRingName());
+            iochan = ring->connect();
+        }
         else
         {
             n_u::Socket *sock = new n_u::Socket(*app.socketAddress());
@@ -30,6 +30,7 @@
 
 #include <nidas/core/FileSet.h>
 #include <nidas/core/Socket.h>
+#include <nidas/core/ShmRingIOChannel.h>
 #include <nidas/dynld/RawSampleInputStream.h>
 #include <nidas/core/Project.h>
 #include <nidas/core/XMLParser.h>
@@ -1896,6 +1897,12 @@ int DataStats::run()
             nidas::core::FileSet::getFileSet(_app.dataFileNames());
         iochan = fset->connect();
     }
+    else if (!_app.shmRingName().empty())
+    {
+        ShmRingIOChannel* ring = new ShmRingIOChannel(_app.shmRingName());
+        iochan = ring->connect();
+        _realtime = true;
+    }
     else
     {
         n_u::Socket* sock = new n_u::Socket(*_app.socketAddress());
@@ -39,9 +39,13 @@
 
 #include <nidas/dynld/raf/TwoD64_USB.h>
 #include <nidas/dynld/raf/TwoD32_USB.h>
+#include <nidas/util/Thread.h>
 
+#include <deque>
 #include <fstream>
+#include <sstream>
 #include <sys/stat.h>
+#include <ctime>
 
 #include <unistd.h>
 #include <getopt.h>
@@ -80,16 +84,114 @@ namespace n_u = nidas::util;
 const n_u::EndianConverter * bigEndian = n_u::EndianConverter::getConverter(n_u::EndianConverter::EC_BIG_ENDIAN);
 
 
+/**
+ * A 2D sample on its way through the extraction pipeline, and
+ * the OAP record which is formatted from it.
+ */
+struct RecordJob
+{
+    RecordJob(Sample* s, Probe* p):
+        samp(s), probe(p), record(), output(0), length(0), done(false)
+    {}
+
+    Sample* samp;
+
+    Probe* probe;
+
+    P2d_rec record;
+
+    /// What to write, either the record or the sample data.
+    const char* output;
+
+    /// Bytes to write, 0 if the record is rejected.
+    size_t length;
+
+    bool done;
+
+private:
+    RecordJob(const RecordJob&);
+    RecordJob& operator=(const RecordJob&);
+};
+
+
+/**
+ * Queue of RecordJobs between the stages of the pipeline, which
+ * blocks put() when full and get() when empty.
+ */
+class JobQueue
+{
+public:
+    JobQueue(size_t maxSize): _cond(), _jobs(), _maxSize(maxSize), _closed(false)
+    {}
+
+    void put(RecordJob* job)
+    {
+        n_u::Autolock al(_cond);
+        while (_jobs.size() >= _maxSize) _cond.wait();
+        _jobs.push_back(job);
+        _cond.broadcast();
+    }
+
+    /**
+     * @returns 0 once the queue is closed and empty.
+     */
+    RecordJob* get()
+    {
+        n_u::Autolock al(_cond);
+        while (_jobs.empty() && !_closed) _cond.wait();
+        if (_jobs.empty()) return 0;
+        RecordJob* job = _jobs.front();
+        _jobs.pop_front();
+        _cond.broadcast();
+        return job;
+    }
+
+    void close()
+    {
+        n_u::Autolock al(_cond);
+        _closed = true;
+        _cond.broadcast();
+    }
+
+private:
+    n_u::Cond _cond;
+    std::deque<RecordJob*> _jobs;
+    size_t _maxSize;
+    bool _closed;
+
+    JobQueue(const JobQueue&);
+    JobQueue& operator=(const JobQueue&);
+};
+
+
 class ExtractFast2D : public Extract2D
 {
 public:
 
-    ExtractFast2D() { };
+    ExtractFast2D(): _doneCond(), _coutLock() { };
 
     int run() throw();
 
     static int main(int argc, char** argv) throw();
 
+    /**
+     * Decode a 2D sample into the OAP record of a job, count its
+     * particles and diodes, and decide whether it is written.
+     * A probe's jobs are formatted by one thread, which owns its
+     * statistics.
+     */
+    void formatRecord(RecordJob& job);
+
+    /**
+     * Mark a job as formatted, for the writer.
+     */
+    void jobDone(RecordJob& job);
+
+    /**
+     * Wait until a job has been formatted.
+     */
+    void waitForJob(RecordJob& job);
+
 private:
 
     /**
@@ -104,6 +206,84 @@ private:
      */
     size_t computeDiodeCount(Probe * probe, const unsigned char * record);
 
+    n_u::Cond _doneCond;
+
+    n_u::Mutex _coutLock;
+};
+
+
+/**
+ * Formats the records of one probe.
+ */
+class ProbeFormatter : public n_u::Thread
+{
+public:
+    ProbeFormatter(ExtractFast2D& extract, const string& name):
+        n_u::Thread(name), _extract(extract), queue(64)
+    {}
+
+    int run() throw()
+    {
+        RecordJob* job;
+        while ((job = queue.get())) {
+            _extract.formatRecord(*job);
+            _extract.jobDone(*job);
+        }
+        return RUN_OK;
+    }
+
+private:
+    ExtractFast2D& _extract;
+
+public:
+    JobQueue queue;
+};
+
+
+/**
+ * Writes the formatted records in the order the samples were read,
+ * so the output is the same as that of one thread.
+ */
+class RecordWriter : public n_u::Thread
+{
+public:
+    RecordWriter(ExtractFast2D& extract, ofstream& outFile):
+        n_u::Thread("RecordWriter"), _extract(extract), _outFile(outFile),
+        queue(1024), nrecords(0), nbytes(0)
+    {}
+
+    int run() throw()
+    {
+        RecordJob* job;
+        while ((job = queue.get())) {
+            _extract.waitForJob(*job);
+            write(job);
+        }
+        return RUN_OK;
+    }
+
+    /**
+     * Write the record of a formatted job, and delete the job.
+     */
+    void write(RecordJob* job)
+    {
+        if (job->length > 0) {
+            _outFile.write(job->output, job->length);
+            nrecords++;
+            nbytes += job->length;
+        }
+        job->samp->freeReference();
+        delete job;
+    }
+
+private:
+    ExtractFast2D& _extract;
+    ofstream& _outFile;
+
+public:
+    JobQueue queue;
+    size_t nrecords;
+    size_t nbytes;
 };
 
 
@@ -303,98 +483,112 @@ int ExtractFast2D::run() throw()
             return 0;
         }
 
+        // Reading and filtering samples, formatting the records of each
+        // probe, and writing the output run in separate threads,
+        // unless singleThread.
+        RecordWriter writer(*this, outFile);
+        map<dsm_sample_id_t, ProbeFormatter*> formatters;
+        map<dsm_sample_id_t, Probe *>::iterator pit;
+        for (pit = probeList.begin(); pit != probeList.end(); ++pit)
+        {
+            Probe * probe = pit->second;
+            formatters[pit->first] = new ProbeFormatter(*this,
+                probe->sensor->getCatalogName() + probe->sensor->getSuffix());
+        }
+        map<dsm_sample_id_t, ProbeFormatter*>::iterator fit;
+        if (!singleThread) {
+            for (fit = formatters.begin(); fit != formatters.end(); ++fit)
+                fit->second->start();
+            writer.start();
+        }
+
+        bool readError = false;
+        size_t nsamples = 0;
+        size_t njobs = 0;
+        long long inputBytes = 0;
+        struct timespec tstart, tlast;
+        ::clock_gettime(CLOCK_MONOTONIC, &tstart);
+        tlast = tstart;
+
         try {
             for (;;) {
 
                 Sample *samp = input.readSample();
-                if (interrupted) break;
+                if (interrupted) {
+                    samp->freeReference();
+                    break;
+                }
                 dsm_sample_id_t id = samp->getId();
+                // the sample may be freed by the writer once queued
+                dsm_time_t tt = samp->getTimeTag();
+                nsamples++;
+                inputBytes += samp->getDataByteLength();
+
+                fit = formatters.find(id);
+                if (fit != formatters.end() &&
+                    (samp->getDataByteLength() == 4104 ||
+                     samp->getDataByteLength() == 4121))
+                {
+                    RecordJob* job = new RecordJob(samp, probeList[id]);
+                    if (singleThread) {
+                        formatRecord(*job);
+                        writer.write(job);
+                    }
+                    else {
+                        writer.queue.put(job);
+                        fit->second->queue.put(job);
+                    }
+                    njobs++;
+                }
+                else
+                    samp->freeReference();
 
-		if (includeIds.size() > 0) {
-		    if (includeIds.find(id) != includeIds.end()) {
-//cout << "length=" << samp->getDataByteLength() << "\n";
-                        if (samp->getDataByteLength() == 4104) {
-                            const int * dp = (const int *) samp->getConstVoidDataPtr();
-                            int stype = bigEndian->int32Value(*dp++);
-
-                            P2d_rec record;
-                            Probe *probe = probeList[id];
-                            record.id = probe->id;
-                            setTimeStamp(record, samp);
-
-                            // Decode true airpseed.
-                            float tas = 0.0;
-                            if (stype == TWOD_IMG_TYPE) {
-                                unsigned char *cp = (unsigned char *)dp;
-                                tas = (1.0e6 / (1.0 - ((float)cp[0] / 255))) * probe->resolutionM;
-                            }
-                            if (stype == TWOD_IMGv2_TYPE) {
-                                Tap2D *t2d = (Tap2D *)dp;
-                            // Note: TASToTap2D() has a PotFudgeFactor which multiplies by 1.01.
-                            //        Seems we should multiply by 0.99...
-                                tas = 1.0e11 / (511.0 - (float)t2d->ntap) * 511.0 / 25000.0 / 2.0 * probe->resolutionM;
-                                if (t2d->div10 == 1)
-                                    tas /= 10.0;
-                            }
-                            if (stype == TWOD_IMGv3_TYPE) {
-                                unsigned short *sp = (unsigned short *)dp;
-                                tas = (float)*sp / 10.0;
-                            }
-
-                            // Encode true airspeed to the ADS1 / ADS2 format for
-                            // backwards compatability.
-                            record.tas = htons((short)tas);
-
-                            record.overld = htons(0);
-                            dp++;      // skip over tas field
-                            ::memcpy(record.data, dp, P2D_DATA);
-
-                            // For old 2D probes, not Fast 2DC.
-                            if (::memcmp(record.data, overLoadSync, 2) == 0)
-                            {
-                                unsigned long * lp = (unsigned long *)record.data;
-                                record.overld = htons((ntohl(*lp) & 0x0000ffff) / 2000);
-                                probe->hasOverloadCount++;
-                            }
-
-                            ++probe->recordCount;
-                            size_t partCnt = countParticles(probe, (const unsigned char *)&record);
-                            size_t diodeCnt = computeDiodeCount(probe, record.data);
-                            if (partCnt < minNumberParticlesRequired)
-                                ++probe->rejectTooFewParticleCount;
-                            if (diodeCnt < probe->nDiodes / 2)
-                                ++probe->rejectTooFewDiodesCount;
-
-                            /* Output record if:
-                             *   1) copying all records (-a).
-                             *   2) we meet minimum number particles in the record (default 5)
-                             *   3) at least 50% of the diodes had a count in them
-                             */
-                            if (copyAllRecords ||
-                               (partCnt >= minNumberParticlesRequired && diodeCnt >= probe->nDiodes / 2))
-                                outFile.write((char *)&record, sizeof(record));
-                            else
-                                ++probe->rejectRecordCount;
-                        }
-                        if (samp->getDataByteLength() == 4121) {    // SPEC compressed data.
-                            const int * dp = (const int *) samp->getConstVoidDataPtr();
-                            P2d_rec record;
-                            Probe *probe = probeList[id];
-
-                            record.id = probe->id;
-                            setTimeStamp(record, samp);
-
-                            ++probe->recordCount;
-                            outFile.write((char *)dp, 4121);
-                        }
-		    }
-		}
-                samp->freeReference();
+                if ((nsamples % 4096) == 0)
+                {
+                    struct timespec tnow;
+                    ::clock_gettime(CLOCK_MONOTONIC, &tnow);
+                    if (tnow.tv_sec - tlast.tv_sec >= 10)
+                    {
+                        double secs = (tnow.tv_sec - tstart.tv_sec) +
+                            (tnow.tv_nsec - tstart.tv_nsec) * 1.e-9;
+                        cerr << n_u::UTime(tt).format(true, "%H:%M:%S")
+                             << ": " << nsamples << " samples, " << njobs
+                             << " 2D records, " << fixed << setprecision(1)
+                             << inputBytes / secs / 1.e6 << " MB/s" << endl;
+                        tlast = tnow;
+                    }
+                }
             }
         }
         catch (n_u::EOFException& ioe) {
 ; //            cerr << ioe.what() << endl;
         }
+        catch (n_u::IOException& ioe) {
+            cerr << ioe.what() << endl;
+            readError = true;
+        }
+
+        for (fit = formatters.begin(); fit != formatters.end(); ++fit)
+            fit->second->queue.close();
+        writer.queue.close();
+        for (fit = formatters.begin(); fit != formatters.end(); ++fit)
+        {
+            if (!singleThread) fit->second->join();
+            delete fit->second;
+        }
+        if (!singleThread) writer.join();
+
+        struct timespec tend;
+        ::clock_gettime(CLOCK_MONOTONIC, &tend);
+        double secs = (tend.tv_sec - tstart.tv_sec) +
+            (tend.tv_nsec - tstart.tv_nsec) * 1.e-9;
+        cerr << nsamples << " samples, " << writer.nrecords
+             << " records written in " << fixed << setprecision(1) << secs
+             << " s, " << inputBytes / secs / 1.e6 << " MB/s in, "
+             << writer.nbytes / secs / 1.e6 << " MB/s out" << endl;
+        cerr.unsetf(ios_base::floatfield);
+        if (readError)
+            return 1;
 
         outFile.close();
 
@@ -489,6 +683,96 @@ int ExtractFast2D::run() throw()
     return 0;
 }
 
+void ExtractFast2D::formatRecord(RecordJob& job)
+{
+    Sample *samp = job.samp;
+    Probe *probe = job.probe;
+    P2d_rec& record = job.record;
+
+    if (samp->getDataByteLength() == 4104) {
+        const int * dp = (const int *) samp->getConstVoidDataPtr();
+        int stype = bigEndian->int32Value(*dp++);
+
+        record.id = probe->id;
+        setTimeStamp(record, samp);
+
+        // Decode true airpseed.
+        float tas = 0.0;
+        if (stype == TWOD_IMG_TYPE) {
+            unsigned char *cp = (unsigned char *)dp;
+            tas = (1.0e6 / (1.0 - ((float)cp[0] / 255))) * probe->resolutionM;
+        }
+        if (stype == TWOD_IMGv2_TYPE) {
+            Tap2D *t2d = (Tap2D *)dp;
+        // Note: TASToTap2D() has a PotFudgeFactor which multiplies by 1.01.
+        //        Seems we should multiply by 0.99...
+            tas = 1.0e11 / (511.0 - (float)t2d->ntap) * 511.0 / 25000.0 / 2.0 * probe->resolutionM;
+            if (t2d->div10 == 1)
+                tas /= 10.0;
+        }
+        if (stype == TWOD_IMGv3_TYPE) {
+            unsigned short *sp = (unsigned short *)dp;
+            tas = (float)*sp / 10.0;
+        }
+
+        // Encode true airspeed to the ADS1 / ADS2 format for
+        // backwards compatability.
+        record.tas = htons((short)tas);
+
+        record.overld = htons(0);
+        dp++;      // skip over tas field
+        ::memcpy(record.data, dp, P2D_DATA);
+
+        // For old 2D probes, not Fast 2DC.
+        if (::memcmp(record.data, overLoadSync, 2) == 0)
+        {
+            unsigned long * lp = (unsigned long *)record.data;
+            record.overld = htons((ntohl(*lp) & 0x0000ffff) / 2000);
+            probe->hasOverloadCount++;
+        }
+
+        ++probe->recordCount;
+        size_t partCnt = countParticles(probe, (const unsigned char *)&record);
+        size_t diodeCnt = computeDiodeCount(probe, record.data);
+        if (partCnt < minNumberParticlesRequired)
+            ++probe->rejectTooFewParticleCount;
+        if (diodeCnt < probe->nDiodes / 2)
+            ++probe->rejectTooFewDiodesCount;
+
+        /* Output record if:
+         *   1) copying all records (-a).
+         *   2) we meet minimum number particles in the record (default 5)
+         *   3) at least 50% of the diodes had a count in them
+         */
+        if (copyAllRecords ||
+           (partCnt >= minNumberParticlesRequired && diodeCnt >= probe->nDiodes / 2))
+        {
+            job.output = (const char *)&record;
+            job.length = sizeof(record);
+        }
+        else
+            ++probe->rejectRecordCount;
+    }
+    if (samp->getDataByteLength() == 4121) {    // SPEC compressed data.
+        ++probe->recordCount;
+        job.output = (const char *)samp->getConstVoidDataPtr();
+        job.length = 4121;
+    }
+}
+
+void ExtractFast2D::jobDone(RecordJob& job)
+{
+    n_u::Autolock al(_doneCond);
+    job.done = true;
+    _doneCond.broadcast();
+}
+
+void ExtractFast2D::waitForJob(RecordJob& job)
+{
+    n_u::Autolock al(_doneCond);
+    while (!job.done) _doneCond.wait();
+}
+
 size_t ExtractFast2D::computeDiodeCount(Probe * probe, const unsigned char * record)
 {
     size_t nSlices = P2D_DATA / (probe->nDiodes / 8);
@@ -584,6 +868,7 @@ size_t ExtractFast2D::countParticles(Probe * probe, const unsigned char * record
 		" miss-aligned data, %02d:%02d:%02d.%03d, rec #%zd, total sync=%zd, missAligned count=%zd",
 		ntohs(rec->hour), ntohs(rec->minute), ntohs(rec->second),
 		ntohs(rec->msec), probe->recordCount, totalCnt, missCnt);
+        n_u::Autolock al(_coutLock);
         cout << probe->sensor->getCatalogName() << probe->sensor->getSuffix() << msg << endl;
     }
 
@@ -36,6 +36,7 @@
 #include <nidas/core/Socket.h>
 #include <nidas/dynld/SampleInputStream.h>
 #include <nidas/dynld/raf/SyncRecordReader.h>
+#include <nidas/dynld/raf/SyncRecordFile.h>
 
 #include <iostream>
 #include <iomanip>
@@ -91,13 +92,16 @@ private:
     string _dumpHeader;
 
     string _dumpJSON;
+
+    string _indexedFile;
 };
 
 SyncDumper::SyncDumper(): _dataFileName(),_sockAddr(),
 			  _varnames(),
 			  _vars(),
 			  _dumpHeader(),
-			  _dumpJSON()
+			  _dumpJSON(),
+			  _indexedFile()
 {
 }
 
@@ -107,7 +111,7 @@ int SyncDumper::parseRunstring(int argc, char** argv)
     extern int optind;       /* "  "     "     */
     int opt_char;     /* option character */
 
-    while ((opt_char = getopt(argc, argv, "h:j:")) != -1) {
+    while ((opt_char = getopt(argc, argv, "h:j:o:")) != -1) {
 	switch (opt_char) {
 	case 'h':
 	    _dumpHeader = string(optarg);
@@ -115,6 +119,9 @@ int SyncDumper::parseRunstring(int argc, char** argv)
 	case 'j':
 	    _dumpJSON = string(optarg);
 	    break;
+	case 'o':
+	    _indexedFile = string(optarg);
+	    break;
 	case '?':
 	    return usage(argv[0]);
 	}
@@ -166,10 +173,12 @@ int SyncDumper::parseRunstring(int argc, char** argv)
 int SyncDumper::usage(const char* argv0)
 {
     cerr << "\
-Usage: " << argv0 << " [-h <file>] [-j <file>] [<variable> ...] inputURL\n\
+Usage: " << argv0 << " [-h <file>] [-j <file>] [-o <file>] [<variable> ...] inputURL\n\
     <variable>: A variable name.  If none specified, then all variables.\n\
     -h <file>  Print the header to <file>, where <file> can be - for stdout.\n\
     -j <file>  Dump all sync samples as JSON to the given <file>.\n\
+    -o <file>  Convert the sync records to an indexed sync record file,\n\
+               which can be memory mapped for random access by time.\n\
     inputURL: data input (required). One of the following:\n\
         sock:host[:port]          (Default port is " << DEFAULT_PORT << ")\n\
         unix:sockpath             unix socket name\n\
@@ -284,6 +293,19 @@ int SyncDumper::run()
     const list<const SyncRecordVariable*>& vars = reader.getVariables();
     cerr << "num of variables=" << vars.size() << endl;
 
+    if (_indexedFile.length())
+    {
+        try {
+            size_t nrecs = SyncRecordFileWriter::convert(reader, _indexedFile);
+            cerr << "wrote " << nrecs << " records to " << _indexedFile << endl;
+        }
+        catch (const n_u::IOException& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
     // Traverse in record order so they will be printed in that order.
     list<const SyncRecordVariable*>::const_iterator vi;
     for (vi = vars.begin(); vi != vars.end(); ++vi)
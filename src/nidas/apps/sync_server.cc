@@ -25,6 +25,7 @@
 */
 
 #include <nidas/dynld/raf/SyncServer.h>
+#include <nidas/dynld/raf/ParallelSyncServer.h>
 #include <nidas/core/NidasApp.h>
 #include <nidas/util/Logger.h>
 #include <nidas/core/Project.h>
@@ -42,6 +43,7 @@ using nidas::core::NidasAppException;
 namespace n_u = nidas::util;
 
 using nidas::dynld::raf::SyncServer;
+using nidas::dynld::raf::ParallelSyncServer;
 using nidas::util::Logger;
 
 int usage(const std::string& argv0)
@@ -58,6 +60,15 @@ int usage(const std::string& argv0)
         " -p <port>\n"
         "   sync record output socket port number: default="
                   << SyncServer::DEFAULT_PORT << "\n"
+        " -o|--output <file>\n"
+        "   write the sync records to a file instead of a socket\n"
+        " -j|--parallel <nchunks>\n"
+        "   split the time window into nchunks, processed in parallel,\n"
+        "   and merge their sync records into the --output file\n"
+        " -w|--warmup <secs>\n"
+        "   seconds of data processed before the first record of a\n"
+        "   parallel chunk, default=" <<
+        ParallelSyncServer::DEFAULT_WARMUP_SECS << "\n"
         " <raw_data_file> ...\n"
         "   names of one or more raw data files, separated by spaces\n"
                   << std::endl;
@@ -68,7 +79,8 @@ int usage(const std::string& argv0)
 }
 
 
-int parseRunstring(SyncServer& sync, ArgVector& args)
+int parseRunstring(SyncServer& sync, ParallelSyncServer& psync,
+                   int& nchunks, ArgVector& args)
 {
     NidasApp& app = *NidasApp::getApplicationInstance();
 
@@ -80,6 +92,7 @@ int parseRunstring(SyncServer& sync, ArgVector& args)
     args = app.parseArgs(args);
 
     std::list<std::string> dataFileNames;
+    std::string outputFile;
 
     unsigned int i = 1;
     while (i < args.size())
@@ -97,6 +110,7 @@ int parseRunstring(SyncServer& sync, ArgVector& args)
             if (ist.fail()) 
                 return usage(args[0]);
             sync.setSorterLengthSeconds(sorter_secs);
+            psync.setSorterLengthSeconds(sorter_secs);
             ++i;
         }
         else if ((arg == "-r" || arg == "--rawsorterlength") && !optarg.empty())
@@ -107,6 +121,7 @@ int parseRunstring(SyncServer& sync, ArgVector& args)
             if (ist.fail()) 
                 return usage(args[0]);
             sync.setRawSorterLengthSeconds(sorter_secs);
+            psync.setRawSorterLengthSeconds(sorter_secs);
             ++i;
         }
         else if (arg == "-p" && !optarg.empty())
@@ -120,6 +135,32 @@ int parseRunstring(SyncServer& sync, ArgVector& args)
                 sync.resetAddress(new n_u::Inet4SocketAddress(port));
             ++i;
         }
+        else if ((arg == "-o" || arg == "--output") && !optarg.empty())
+        {
+            outputFile = optarg;
+            sync.setOutputFileName(outputFile);
+            psync.setOutputFileName(outputFile);
+            ++i;
+        }
+        else if ((arg == "-j" || arg == "--parallel") && !optarg.empty())
+        {
+            std::istringstream ist(optarg);
+            ist >> nchunks;
+            if (ist.fail() || nchunks < 1)
+                return usage(args[0]);
+            psync.setNumChunks(nchunks);
+            ++i;
+        }
+        else if ((arg == "-w" || arg == "--warmup") && !optarg.empty())
+        {
+            std::istringstream ist(optarg);
+            int warmup_secs;
+            ist >> warmup_secs;
+            if (ist.fail() || warmup_secs < 0)
+                return usage(args[0]);
+            psync.setWarmupSeconds(warmup_secs);
+            ++i;
+        }
         else if (arg[0] == '-')
         {
 	    return usage(args[0]);
@@ -132,10 +173,21 @@ int parseRunstring(SyncServer& sync, ArgVector& args)
     }
 
     if (app.xmlHeaderFile().length())
+    {
         sync.setXMLFileName(app.xmlHeaderFile());
+        psync.setXMLFileName(app.xmlHeaderFile());
+    }
     if (dataFileNames.size() == 0)
         return usage(args[0]);
+    if (nchunks > 0 && outputFile.empty())
+    {
+        std::cerr << "--parallel requires an --output file" << std::endl;
+        return usage(args[0]);
+    }
     sync.setDataFileNames(dataFileNames);
+    psync.setDataFileNames(dataFileNames);
+    sync.setTimeWindow(app.getStartTime(), app.getEndTime());
+    psync.setTimeWindow(app.getStartTime(), app.getEndTime());
     return 0;
 }
 
@@ -162,19 +214,22 @@ void setupSignals(SyncServer& sync)
 int main(int argc, char** argv)
 {
     NidasApp app("sync_server");
-    app.enableArguments(app.XmlHeaderFile | app.loggingArgs() | app.Help);
+    app.enableArguments(app.XmlHeaderFile | app.StartTime | app.EndTime |
+                        app.loggingArgs() | app.Help);
     // Because -l is overloaded for sorter seconds.
     app.requireLongFlag(app.LogConfig);
     app.setApplicationInstance();
 
     SyncServer sync;
+    ParallelSyncServer psync;
+    int nchunks = 0;
     setupSignals(sync);
 
     ArgVector args(argv, argv+argc);
 
     int res;
     try {
-        if ((res = parseRunstring(sync, args)) != 0)
+        if ((res = parseRunstring(sync, psync, nchunks, args)) != 0)
             return res;
     }
     catch (NidasAppException& appx)
@@ -184,6 +239,16 @@ int main(int argc, char** argv)
     }
 
     try {
+        if (nchunks > 0)
+        {
+            // The chunks are run in child processes, which are
+            // terminated by an interrupt.
+            signal_target = 0;
+            int result = psync.run();
+            nidas::core::Project::destroyInstance();
+            nidas::core::XMLImplementation::terminate();
+            return result;
+        }
         sync.init();
         int result = sync.run();
 
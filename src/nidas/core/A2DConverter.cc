@@ -40,7 +40,7 @@ A2DConverter::A2DConverter(int nchan, int ncoefs):
     _maxNumChannels(nchan),
     _numConfigChannels(0),
     _ncoefs(ncoefs),
-    _gain(new int[nchan]), _bipolar(new int[nchan])
+    _gain(new int[nchan]), _bipolar(new int[nchan]),_changeCount(0)
 {
     for (int i = 0; i < nchan; i++) {
         _gain[i] = 0;
@@ -90,6 +90,7 @@ int A2DConverter::getGain(int ichan) const
 void A2DConverter::setGain(int ichan, int val)
 {
     if (ichan >= 0 && ichan < _maxNumChannels) _gain[ichan] = val;
+    _changeCount++;
     if (val > 0)
         _numConfigChannels = ichan + 1;
 }
@@ -103,6 +104,7 @@ int A2DConverter::getBipolar(int ichan) const
 void A2DConverter::setBipolar(int ichan, int val)
 {
     if (ichan >= 0 && ichan < _maxNumChannels) _bipolar[ichan] = val;
+    _changeCount++;
 }
 
 LinearA2DConverter::LinearA2DConverter(int nchan):
@@ -163,6 +165,7 @@ void LinearA2DConverter::set(int ichan, const float* d, int nd)
     assert(nd == 2);
     _b[ichan] = d[0];
     _mx[ichan] = d[1];
+    _changeCount++;
 }
 
 void LinearA2DConverter::get(int ichan, float* d, int nd) const
@@ -178,6 +181,15 @@ void LinearA2DConverter::setNAN(int ichan)
 {
     _b[ichan] = floatNAN;
     _mx[ichan] = floatNAN;
+    _changeCount++;
+}
+
+bool LinearA2DConverter::getLinear(int ichan, float& intercept, float& slope) const
+{
+    assert(ichan >= 0 && ichan < _maxNumChannels);
+    intercept = _b[ichan];
+    slope = _mx[ichan];
+    return true;
 }
 
 void LinearA2DConverter::setNAN()
@@ -245,6 +257,7 @@ void PolyA2DConverter::set(int ichan, const float* d, int nd)
         _d[ichan][i] = d[i];
     for (; i < _ncoefs; i++)
         _d[ichan][i] = 0.0;
+    _changeCount++;
 }
 
 void PolyA2DConverter::get(int ichan, float* d, int nd) const
@@ -260,6 +273,17 @@ void PolyA2DConverter::setNAN(int ichan)
 {
     for (int i = 0; i < _ncoefs; i++)
         _d[ichan][i] = floatNAN;
+    _changeCount++;
+}
+
+bool PolyA2DConverter::getLinear(int ichan, float& intercept, float& slope) const
+{
+    assert(ichan >= 0 && ichan < _maxNumChannels);
+    for (int i = 2; i < _ncoefs; i++)
+        if (_d[ichan][i] != 0.0) return false;
+    intercept = _ncoefs > 0 ? _d[ichan][0] : 0.0;
+    slope = _ncoefs > 1 ? _d[ichan][1] : (_ncoefs > 0 ? 0.0 : 1.0);
+    return true;
 }
 
 void PolyA2DConverter::setNAN()
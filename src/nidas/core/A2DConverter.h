@@ -106,6 +106,21 @@ public:
 
     virtual void setNAN() = 0;
 
+    /**
+     * If the conversion of a channel is linear, return its intercept
+     * and slope, so that it can be combined with other linear
+     * conversions.
+     * @return false if the conversion is not linear.
+     */
+    virtual bool getLinear(int ichan, float& intercept, float& slope) const = 0;
+
+    /**
+     * A count of the changes to the conversions, gains and polarities,
+     * for users of getLinear() to know that what they got may have
+     * changed.
+     */
+    unsigned int getChangeCount() const { return _changeCount; }
+
     /**
      * Read records from a CalFile for calibration coefficients
      * with time tags less than or equal to tt, assuming they
@@ -159,6 +174,8 @@ protected:
      */
     int *_bipolar;
 
+    unsigned int _changeCount;
+
 private:
     /**
      * No copy
@@ -192,6 +209,8 @@ public:
 
     void setNAN();
 
+    bool getLinear(int ichan, float& intercept, float& slope) const;
+
 private:
 
     /**
@@ -235,6 +254,13 @@ public:
     void setNAN(int ichan);
 
     void setNAN();
+
+    /**
+     * A polynomial is linear if its coefficients of order
+     * two and higher are zero.
+     */
+    bool getLinear(int ichan, float& intercept, float& slope) const;
+
 private:
 
     float** _d;
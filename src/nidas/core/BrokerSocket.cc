@@ -0,0 +1,207 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "BrokerSocket.h"
+#include "Socket.h"
+#include "SocketAddrs.h"
+#include <nidas/util/Process.h>
+#include <nidas/util/Logger.h>
+
+#include <sstream>
+
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+BrokerSocket::BrokerSocket(): IOChannel(),
+    _iochanRequester(0),_name("BrokerSocket"),_amRequester(true),
+    _requestType(UNKNOWN_REQUEST),
+    _sockAddr(NIDAS_BROKER_PORT_TCP),_nonBlocking(false)
+{
+}
+
+BrokerSocket::BrokerSocket(const BrokerSocket& x): IOChannel(x),
+    BrokerStreamRequester(),
+    _iochanRequester(0),_name(x._name),_amRequester(x._amRequester),
+    _requestType(x._requestType),
+    _sockAddr(x._sockAddr),_nonBlocking(x._nonBlocking)
+{
+}
+
+BrokerSocket::~BrokerSocket()
+{
+    close();
+}
+
+BrokerSocket* BrokerSocket::clone() const
+{
+    return new BrokerSocket(*this);
+}
+
+n_u::Inet4SocketAddress BrokerSocket::getServerAddress() const
+{
+    if (_sockAddr.getInet4Address() != n_u::Inet4Address())
+        return _sockAddr;
+    n_u::Inet4SocketAddress server =
+        ConnectionBroker::getInstance()->getDefaultServerAddress();
+    return n_u::Inet4SocketAddress(server.getInet4Address(),
+        _sockAddr.getPort());
+}
+
+void BrokerSocket::requestConnection(IOChannelRequester* requester)
+{
+    _iochanRequester = requester;
+    ConnectionBroker* broker = ConnectionBroker::getInstance();
+
+    if (isRequester()) {
+        n_u::Inet4SocketAddress server = getServerAddress();
+        if (server.getInet4Address() == n_u::Inet4Address())
+            throw n_u::IOException(getName(), "requestConnection",
+                "no server address");
+        broker->request(server, getRequestType(), this);
+    }
+    else {
+        broker->addAcceptor(getRequestType(), this);
+        broker->listen(_sockAddr.getPort());
+    }
+}
+
+IOChannel* BrokerSocket::connect()
+{
+    if (!isRequester())
+        throw n_u::IOException(getName(), "connect",
+            "not supported on a brokeraccept socket");
+    n_u::Inet4SocketAddress server = getServerAddress();
+    n_u::Socket* sock =
+        ConnectionBroker::getInstance()->connect(server, getRequestType());
+
+    ConnectionInfo info(server, n_u::Inet4Address(),
+        n_u::Inet4NetworkInterface());
+    return createChannel(sock, info, server.toAddressString());
+}
+
+IOChannel* BrokerSocket::createChannel(n_u::Socket* sock,
+        const ConnectionInfo& info, const string& name)
+{
+    sock->setNonBlocking(isNonBlocking());
+    nidas::core::Socket* ncSock = new nidas::core::Socket(sock);
+    ncSock->setConnectionInfo(info);
+    ncSock->setRequestType(getRequestType());
+    ncSock->setName(name);
+    return ncSock;
+}
+
+void BrokerSocket::streamOpened(n_u::Socket* sock, const ConnectionInfo& info,
+        const string& name)
+{
+    IOChannel* ioc = createChannel(sock, info, name);
+    assert(_iochanRequester);
+    _iochanRequester->connected(ioc);
+}
+
+void BrokerSocket::close()
+{
+    ConnectionBroker* broker = ConnectionBroker::getInstance();
+    if (isRequester()) broker->cancel(this);
+    else broker->removeAcceptor(this);
+}
+
+void BrokerSocket::fromDOMElement(const xercesc::DOMElement* node)
+{
+    string saddr;
+    int port = NIDAS_BROKER_PORT_TCP;
+
+    XDOMElement xnode(node);
+    if(node->hasAttributes()) {
+        // get all the attributes of the node
+        xercesc::DOMNamedNodeMap *pAttributes = node->getAttributes();
+        int nSize = pAttributes->getLength();
+        for(int i=0;i<nSize;++i) {
+            XDOMAttr attr((xercesc::DOMAttr*) pAttributes->item(i));
+            // get attribute name
+            const std::string& aname = attr.getName();
+            const std::string& aval = attr.getValue();
+            if (aname == "address")
+                saddr = n_u::Process::expandEnvVars(aval);
+            else if (aname == "port") {
+                istringstream ist(n_u::Process::expandEnvVars(aval));
+                ist >> port;
+                if (ist.fail())
+                    throw n_u::InvalidParameterException(
+                        getName(),aname,aval);
+            }
+            else if (aname == "requestType") {
+                int i;
+                istringstream ist(aval);
+                ist >> i;
+                if (ist.fail())
+                    throw n_u::InvalidParameterException(
+                        getName(),aname,aval);
+                setRequestType((enum McSocketRequest)i);
+            }
+            else if (aname == "type") {
+                if (aval == "brokeraccept") setRequester(false);
+                else if (aval == "brokerrequest") setRequester(true);
+                else throw n_u::InvalidParameterException(
+                    getName(),"type",aval);
+            }
+            else if (aname == "sendTimeout") {
+                int secs;
+                istringstream ist(n_u::Process::expandEnvVars(aval));
+                ist >> secs;
+                if (ist.fail() || secs < 1)
+                    throw n_u::InvalidParameterException(
+                        getName(),aname,aval);
+                ConnectionBroker::getInstance()->setSendTimeoutSecs(secs);
+            }
+            else if (aname == "block") {
+                std::istringstream ist(aval);
+                ist >> boolalpha;
+                bool val;
+                ist >> val;
+                if (ist.fail())
+                    throw n_u::InvalidParameterException(
+                        "socket","block",aval);
+                setNonBlocking(!val);
+            }
+            else
+                throw n_u::InvalidParameterException
+                    (string("unrecognized socket attribute: ") + aname);
+        }
+    }
+
+    n_u::Inet4Address iaddr;
+    if (saddr.length() > 0) {
+        try {
+            iaddr = n_u::Inet4Address::getByName(saddr);
+        }
+        catch(const n_u::UnknownHostException& e) {
+            throw n_u::InvalidParameterException(getName(),"address",saddr);
+        }
+    }
+    setSocketAddress(n_u::Inet4SocketAddress(iaddr,port));
+}
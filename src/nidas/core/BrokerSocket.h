@@ -0,0 +1,216 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_CORE_BROKERSOCKET_H
+#define NIDAS_CORE_BROKERSOCKET_H
+
+#include "IOChannel.h"
+#include "ConnectionBroker.h"
+
+#include <string>
+
+namespace nidas { namespace core {
+
+/**
+ * Implementation of an IOChannel which establishes its connections
+ * as streams of a ConnectionBroker, a drop-in replacement for
+ * McSocket. On a DSM:
+ * @code
+ * <socket type="brokerrequest" address="server" port="30008"/>
+ * @endcode
+ * and in the services of dsm_server:
+ * @code
+ * <socket type="brokeraccept" port="30008"/>
+ * @endcode
+ * All the brokerrequest sockets of a DSM to the same server share one
+ * TCP connection. If the address of a brokerrequest is not given,
+ * it is the server from which the configuration was requested.
+ * The port defaults to NIDAS_BROKER_PORT_TCP.
+ * A sendTimeout attribute sets the seconds that a send over
+ * the broker connections may make no progress before the
+ * connection is dropped, ConnectionBroker::setSendTimeoutSecs().
+ *
+ * Connections are requested again immediately after they are lost,
+ * and are made as soon as the broker connection is up.
+ */
+class BrokerSocket: public IOChannel, public BrokerStreamRequester
+{
+public:
+
+    BrokerSocket();
+
+    ~BrokerSocket();
+
+    BrokerSocket* clone() const;
+
+    void setRequestType(enum McSocketRequest val) { _requestType = val; }
+
+    enum McSocketRequest getRequestType() const { return _requestType; }
+
+    /**
+     * Does this BrokerSocket request connections, or does it
+     * accept them.
+     */
+    bool isRequester() const { return _amRequester; }
+
+    void setRequester(bool val) { _amRequester = val; }
+
+    void setName(const std::string& val) { _name = val; }
+
+    const std::string& getName() const { return _name; }
+
+    /**
+     * Address of the server for a requester, or just the port
+     * to listen on for an acceptor. An address of INADDR_ANY on
+     * a requester means the default server of the ConnectionBroker.
+     */
+    void setSocketAddress(const nidas::util::Inet4SocketAddress& val)
+    {
+        _sockAddr = val;
+    }
+
+    const nidas::util::Inet4SocketAddress& getSocketAddress() const
+    {
+        return _sockAddr;
+    }
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void requestConnection(IOChannelRequester* service);
+
+    /**
+     * Request a stream and wait for it. Only supported
+     * on a requester.
+     *
+     * @throws nidas::util::IOException
+     **/
+    IOChannel* connect();
+
+    void streamOpened(nidas::util::Socket* sock, const ConnectionInfo& info,
+        const std::string& name);
+
+    /**
+     * Reconnect as soon as possible, the broker connection
+     * is made, or kept up, by the ConnectionBroker.
+     */
+    int getReconnectDelaySecs() const { return 0; }
+
+    bool isNewInput() const { return true; }
+
+    void setNonBlocking(bool val) { _nonBlocking = val; }
+
+    bool isNonBlocking() const { return _nonBlocking; }
+
+    /**
+     * A BrokerSocket shouldn't be used to do any actual reads or writes,
+     * it just sets up the connection. Calling this method will fail
+     * with an assert.
+     *
+     * @throws nidas::util::IOException
+     **/
+    size_t read(void*, size_t)
+    {
+        assert(false);
+        return 0;
+    }
+
+    /**
+     * @see read().
+     *
+     * @throws nidas::util::IOException
+     **/
+    size_t write(const void*, size_t)
+    {
+        assert(false);
+        return 0;
+    }
+
+    /**
+     * @see read().
+     *
+     * @throws nidas::util::IOException
+     **/
+    size_t write(const struct iovec*, int)
+    {
+        assert(false);
+        return 0;
+    }
+
+    /**
+     * Withdraw the connection request, or stop accepting.
+     *
+     * @throws nidas::util::IOException
+     **/
+    void close();
+
+    int getFd() const { return -1; }
+
+    /**
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void fromDOMElement(const xercesc::DOMElement*);
+
+protected:
+
+    /**
+     * Copy constructor. Should only be called before a connection
+     * is requested.
+     */
+    BrokerSocket(const BrokerSocket&);
+
+private:
+
+    /**
+     * Server address of a requester.
+     */
+    nidas::util::Inet4SocketAddress getServerAddress() const;
+
+    /**
+     * Wrap a stream in a connected nidas::core::Socket.
+     */
+    IOChannel* createChannel(nidas::util::Socket* sock,
+        const ConnectionInfo& info, const std::string& name);
+
+    IOChannelRequester* _iochanRequester;
+
+    std::string _name;
+
+    bool _amRequester;
+
+    enum McSocketRequest _requestType;
+
+    nidas::util::Inet4SocketAddress _sockAddr;
+
+    bool _nonBlocking;
+
+    /** No assignment. */
+    BrokerSocket& operator=(const BrokerSocket&);
+};
+
+}}	// namespace nidas namespace core
+
+#endif
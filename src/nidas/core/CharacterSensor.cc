@@ -63,6 +63,8 @@ CharacterSensor::CharacterSensor():
     _scanfFailures(0),
     _scanfPartials(0),
     _prompted(false),
+    _scanBuffer(),
+    _scratchSample(),
     _initString(),_emptyString()
 {
 }
@@ -196,6 +198,7 @@ void CharacterSensor::init()
     }
 
     if (!_sscanfers.empty()) _nextSscanfer = _sscanfers.begin();
+    _scratchSample.allocateData(std::max(_maxScanfFields, 1));
     validateSscanfs();
 }
 
@@ -356,10 +359,12 @@ scanSample(AsciiSscanf* sscanf, const char* inputstr, float* data_ptr)
 
 
 
-SampleT<float>*
+SampleTag*
 CharacterSensor::
-searchSampleScanners(const Sample* samp, SampleTag** stag_out) throw()
+scanSampleScanners(const Sample* samp, float* data, int& nparsed) throw()
 {
+    nparsed = 0;
+
     // Note: sscanfers can be empty here, if a CharacterSensor was configured
     // with no samples, and hence no scanf strings.  For example,
     // a differential GPS, where nidas is supposed to take the
@@ -373,39 +378,27 @@ searchSampleScanners(const Sample* samp, SampleTag** stag_out) throw()
     const char* inputstr = (const char*)samp->getConstVoidDataPtr();
     int slen = samp->getDataByteLength();
 
-    // if sample is not null terminated, create a new null-terminated sample
-    if (inputstr[slen-1] != '\0')
+    // if sample is not null terminated, scan a null-terminated copy
+    if (slen == 0 || inputstr[slen-1] != '\0')
     {
-        SampleT<char>* newsamp = getSample<char>(slen+1);
-        newsamp->setTimeTag(samp->getTimeTag());
-        newsamp->setId(samp->getId());
-        char* newstr = (char*)newsamp->getConstVoidDataPtr();
-        ::memcpy(newstr,inputstr,slen);
-        newstr[slen] = '\0';
-
-        SampleT<float>* res = searchSampleScanners(newsamp, stag_out);
-        newsamp->freeReference();
-        return res;
+        _scanBuffer.resize(slen + 1);
+        ::memcpy(&_scanBuffer.front(), inputstr, slen);
+        _scanBuffer[slen] = '\0';
+        inputstr = &_scanBuffer.front();
     }
 
-    SampleT<float>* outs = getSample<float>(_maxScanfFields);
-    // Output sample always defaults to time of raw sample.
-    outs->setTimeTag(samp->getTimeTag());
-
     SampleTag* stag = 0;
-    int nparsed = 0;
     unsigned int ntry = 0;
     AsciiSscanf* sscanf = 0;
     list<AsciiSscanf*>::const_iterator checkdone = _nextSscanfer;
     for ( ; ; ntry++)
     {
         sscanf = *_nextSscanfer;
-        nparsed = scanSample(sscanf, inputstr, outs->getDataPtr());
+        nparsed = scanSample(sscanf, inputstr, data);
         if (++_nextSscanfer == _sscanfers.end())
             _nextSscanfer = _sscanfers.begin();
         if (nparsed > 0) {
             stag = sscanf->getSampleTag();
-            outs->setId(stag->getId());
             if (nparsed != sscanf->getNumberOfFields()) _scanfPartials++;
             break;
         }
@@ -431,9 +424,32 @@ searchSampleScanners(const Sample* samp, SampleTag** stag_out) throw()
     if (!nparsed)
     {
         _scanfFailures++;
+        return 0;
+    }
+    return stag;
+}
+
+SampleT<float>*
+CharacterSensor::
+searchSampleScanners(const Sample* samp, SampleTag** stag_out) throw()
+{
+    if (_sscanfers.empty())
+    {
+        return 0;
+    }
+
+    SampleT<float>* outs = getSample<float>(_maxScanfFields);
+    // Output sample always defaults to time of raw sample.
+    outs->setTimeTag(samp->getTimeTag());
+
+    int nparsed;
+    SampleTag* stag = scanSampleScanners(samp, outs->getDataPtr(), nparsed);
+    if (!stag)
+    {
         outs->freeReference();  // remember!
         return 0;               // no sample
     }
+    outs->setId(stag->getId());
 
     // Fill and trim for unparsed values.
     trimUnparsed(stag, outs, nparsed);
@@ -442,25 +458,44 @@ searchSampleScanners(const Sample* samp, SampleTag** stag_out) throw()
     return outs;
 }
 
+SampleTag*
+CharacterSensor::
+parseSample(const Sample* samp, SampleT<float>* outs) throw()
+{
+    int nparsed;
+    SampleTag* stag = scanSampleScanners(samp, outs->getDataPtr(), nparsed);
+    if (!stag) return 0;
+
+    outs->setTimeTag(samp->getTimeTag());
+    outs->setId(stag->getId());
+    trimUnparsed(stag, outs, nparsed);
+
+    // Apply any time tag adjustments, then any variable conversions.
+    // The conversions have to happen after the time is adjusted, since
+    // the calibrations are keyed by time.
+    adjustTimeTag(stag, outs);
+    applyConversions(stag, outs);
+    return stag;
+}
+
 bool
 CharacterSensor::
 process(const Sample* samp, list<const Sample*>& results)
 {
-    // Try to scan the variables of a sample tag from the raw sensor
-    // message.
-    SampleTag* stag = 0;
-    SampleT<float>* outs = searchSampleScanners(samp, &stag);
-    if (!outs)
+    if (_sscanfers.empty())
     {
         return false;
     }
 
-    // Apply any time tag adjustments.
-    adjustTimeTag(stag, outs);
-
-    // Apply any variable conversions.  Note this has to happen after the
-    // time is adjusted, since the calibrations are keyed by time.
-    applyConversions(stag, outs);
+    // Try to scan the variables of a sample tag from the raw sensor
+    // message, then apply any time tag adjustments and variable
+    // conversions.
+    SampleT<float>* outs = getSample<float>(_maxScanfFields);
+    if (!parseSample(samp, outs))
+    {
+        outs->freeReference();
+        return false;
+    }
 
     results.push_back(outs);
     return true;
@@ -31,6 +31,8 @@
 #include "Prompt.h"
 #include <nidas/util/util.h>
 
+#include <vector>
+
 namespace nidas { namespace core {
 
 class AsciiSscanf;
@@ -333,6 +335,28 @@ protected:
     SampleT<float>*
     searchSampleScanners(const Sample* samp, SampleTag** stag_out=0) throw();
 
+    /**
+     * Parse a raw sample into @p outs, without allocating an intermediate
+     * Sample.  This does what process() does, into a sample provided by
+     * the caller: the values scanned from @p samp are written to the data
+     * of @p outs, unparsed values are filled with NaN, the length of
+     * @p outs is trimmed to the variables of the matching SampleTag, its
+     * id and time tag are set, and the time tag adjustments and variable
+     * conversions are applied.  The data of @p outs must have room for
+     * getMaxScanfFields() values.
+     *
+     * @return The SampleTag which matched, or null if nothing was parsed.
+     **/
+    SampleTag* parseSample(const Sample* samp, SampleT<float>* outs) throw();
+
+    /**
+     * A sample owned by this sensor, with room for getMaxScanfFields()
+     * values, which can be passed to parseSample() by subclasses whose
+     * output is not the parsed sample.  It is reused for each raw sample,
+     * and must not be freed or passed on.
+     */
+    SampleT<float>* getScratchSample() { return &_scratchSample; }
+
     /**
      * Apply TimetagAdjuster and lag adjustments to the timetag of the
      * given sample.
@@ -344,6 +368,13 @@ protected:
 
 private:
 
+    /**
+     * Scan a raw sample into @p data, trying each AsciiSscanf in turn.
+     * @return The SampleTag of the AsciiSscanf which matched, or null.
+     */
+    SampleTag* scanSampleScanners(const Sample* samp, float* data,
+                                  int& nparsed) throw();
+
     std::string _messageSeparator;
 
     bool _separatorAtEOM;
@@ -370,6 +401,13 @@ private:
 
     bool _prompted;
 
+    /**
+     * Copy of a raw message which is not null terminated.
+     */
+    std::vector<char> _scanBuffer;
+
+    SampleT<float> _scratchSample;
+
     /**
      * String that is sent once after sensor is opened.
      */
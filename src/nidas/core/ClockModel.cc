@@ -0,0 +1,202 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "ClockModel.h"
+
+#include <nidas/util/Logger.h>
+#include <nidas/util/UTime.h>
+
+#include <cmath>
+
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+/* static */
+map<unsigned int, ClockModel*> ClockModel::_instances;
+
+/* static */
+n_u::Mutex ClockModel::_instanceLock;
+
+/* static */
+ClockModel* ClockModel::getInstance(unsigned int dsmid)
+{
+    n_u::Synchronized autolock(_instanceLock);
+    ClockModel*& model = _instances[dsmid];
+    if (!model) model = new ClockModel();
+    return model;
+}
+
+/* static */
+void ClockModel::deleteInstances()
+{
+    n_u::Synchronized autolock(_instanceLock);
+    map<unsigned int, ClockModel*>::const_iterator mi = _instances.begin();
+    for ( ; mi != _instances.end(); ++mi) delete mi->second;
+    _instances.clear();
+}
+
+ClockModel::ClockModel():
+    _obs(),_fit(),_maxObs(60),_maxResidualUsecs(10 * USECS_PER_MSEC),
+    _nrejected(0),_nconsecutiveRejects(0),_mutex()
+{
+}
+
+void ClockModel::setMaxObservations(unsigned int val)
+{
+    n_u::Autolock autolock(_mutex);
+    _maxObs = val < MIN_OBSERVATIONS ? MIN_OBSERVATIONS : val;
+    while (_obs.size() > _maxObs) _obs.pop_front();
+    fit();
+}
+
+void ClockModel::reset()
+{
+    n_u::Autolock autolock(_mutex);
+    _obs.clear();
+    _nconsecutiveRejects = 0;
+    _fit = Fit();
+}
+
+void ClockModel::addObservation(dsm_time_t systemTime, dsm_time_t refTime)
+{
+    long long offset = refTime - systemTime;
+
+    n_u::Autolock autolock(_mutex);
+
+    if (!_obs.empty() && systemTime <= _obs.back().first) {
+        // system clock went backwards, start over
+        WLOG(("ClockModel: backwards system time: ") <<
+            n_u::UTime(systemTime).format(true, "%Y %m %d %H:%M:%S.%3f") <<
+            ", restarting");
+        _obs.clear();
+        _fit = Fit();
+    }
+
+    if (_fit.valid) {
+        double resid = (double)offset -
+            (_fit.offset + _fit.drift * (double)(systemTime - _fit.t0));
+        if (fabs(resid) > _maxResidualUsecs) {
+            _nrejected++;
+            if (++_nconsecutiveRejects < MAX_CONSECUTIVE_REJECTS) return;
+            WLOG(("ClockModel: %u consecutive offsets differ from model by "
+                  "more than %.3f sec, offset=%.6f sec, restarting",
+                  _nconsecutiveRejects, (double)_maxResidualUsecs / USECS_PER_SEC,
+                  (double)offset / USECS_PER_SEC));
+            _obs.clear();
+        }
+    }
+    _nconsecutiveRejects = 0;
+
+    _obs.push_back(make_pair(systemTime, offset));
+    if (_obs.size() > _maxObs) _obs.pop_front();
+    fit();
+}
+
+void ClockModel::fit()
+{
+    unsigned int n = _obs.size();
+    if (n < MIN_OBSERVATIONS) {
+        _fit = Fit();
+        return;
+    }
+
+    // Least squares line of the offsets versus the system times,
+    // relative to the latest observation to preserve precision.
+    dsm_time_t t0 = _obs.back().first;
+    long long y0 = _obs.back().second;
+
+    double xsum = 0.0, ysum = 0.0;
+    deque<pair<dsm_time_t, long long> >::const_iterator oi = _obs.begin();
+    for ( ; oi != _obs.end(); ++oi) {
+        xsum += (double)(oi->first - t0);
+        ysum += (double)(oi->second - y0);
+    }
+    double xmean = xsum / n;
+    double ymean = ysum / n;
+
+    double sxx = 0.0, sxy = 0.0;
+    for (oi = _obs.begin(); oi != _obs.end(); ++oi) {
+        double dx = (double)(oi->first - t0) - xmean;
+        double dy = (double)(oi->second - y0) - ymean;
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+    double drift = sxx > 0.0 ? sxy / sxx : 0.0;
+
+    _fit.t0 = t0;
+    _fit.offset = (double)y0 + ymean - drift * xmean;
+    _fit.drift = drift;
+    _fit.valid = true;
+}
+
+bool ClockModel::isValid() const
+{
+    n_u::Autolock autolock(_mutex);
+    return _fit.valid;
+}
+
+void ClockModel::correct(dsm_time_t* tt, unsigned int n) const
+{
+    _mutex.lock();
+    Fit f = _fit;
+    _mutex.unlock();
+
+    if (!f.valid) return;
+
+    // No branches or calls in the loop, so that the compiler
+    // can vectorize it.
+    const double offset = f.offset + 0.5;
+    const double drift = f.drift;
+    const dsm_time_t t0 = f.t0;
+    for (unsigned int i = 0; i < n; i++)
+        tt[i] += (dsm_time_t)::floor(offset + drift * (double)(tt[i] - t0));
+}
+
+double ClockModel::getOffsetSecs() const
+{
+    n_u::Autolock autolock(_mutex);
+    return _fit.offset / USECS_PER_SEC;
+}
+
+double ClockModel::getDriftPPM() const
+{
+    n_u::Autolock autolock(_mutex);
+    return _fit.drift * USECS_PER_SEC;
+}
+
+unsigned int ClockModel::getNumObservations() const
+{
+    n_u::Autolock autolock(_mutex);
+    return _obs.size();
+}
+
+unsigned int ClockModel::getNumRejected() const
+{
+    n_u::Autolock autolock(_mutex);
+    return _nrejected;
+}
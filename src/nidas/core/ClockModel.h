@@ -0,0 +1,195 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_CORE_CLOCKMODEL_H
+#define NIDAS_CORE_CLOCKMODEL_H
+
+#include "Sample.h"
+
+#include <nidas/util/ThreadSupport.h>
+
+#include <deque>
+#include <map>
+
+namespace nidas { namespace core {
+
+/**
+ * Model of the offset of the system clock of a DSM from a reference
+ * clock, such as an IRIG/PPS card, shared by the sensors of the DSM.
+ *
+ * The model is fed with observations of the system time and the
+ * reference time at the same instant, and fits a line, an offset and
+ * a drift, to the differences of the most recent observations.
+ * Time tags from the system clock can then be corrected to the
+ * reference clock, one at a time or in batches, without each sensor
+ * deriving the relationship itself.
+ *
+ * Until the model has enough observations it is not valid, and the
+ * corrections leave the time tags unchanged.
+ */
+class ClockModel {
+public:
+
+    /**
+     * Get the shared ClockModel of a DSM, creating it if necessary.
+     */
+    static ClockModel* getInstance(unsigned int dsmid);
+
+    /**
+     * Delete all the shared instances.
+     */
+    static void deleteInstances();
+
+    ClockModel();
+
+    /**
+     * Number of recent observations that are fit, default 60.
+     */
+    void setMaxObservations(unsigned int val);
+
+    unsigned int getMaxObservations() const { return _maxObs; }
+
+    /**
+     * An observation whose offset differs from the current fit by more
+     * than this is rejected, unless it is one of several in a row,
+     * in which case the clock is assumed to have been stepped and
+     * the model is restarted. Default is 10 milliseconds.
+     */
+    void setMaxResidualUsecs(int val) { _maxResidualUsecs = val; }
+
+    int getMaxResidualUsecs() const { return _maxResidualUsecs; }
+
+    /**
+     * Add an observation of the system time and the reference time.
+     */
+    void addObservation(dsm_time_t systemTime, dsm_time_t refTime);
+
+    /**
+     * Discard all observations.
+     */
+    void reset();
+
+    bool isValid() const;
+
+    /**
+     * Correct a system time tag to the reference clock.
+     */
+    dsm_time_t correct(dsm_time_t tt) const
+    {
+        correct(&tt, 1);
+        return tt;
+    }
+
+    /**
+     * Correct an array of system time tags to the reference clock,
+     * in one pass with a single copy of the current fit.
+     */
+    void correct(dsm_time_t* tt, unsigned int n) const;
+
+    /**
+     * Reference time minus system time at the latest observation,
+     * in seconds.
+     */
+    double getOffsetSecs() const;
+
+    /**
+     * Drift of the system clock relative to the reference,
+     * in microseconds per second.
+     */
+    double getDriftPPM() const;
+
+    /**
+     * Number of observations in the current fit.
+     */
+    unsigned int getNumObservations() const;
+
+    /**
+     * Number of observations rejected as outliers.
+     */
+    unsigned int getNumRejected() const;
+
+    /**
+     * Minimum number of observations for a valid model.
+     */
+    static const unsigned int MIN_OBSERVATIONS = 3;
+
+    /**
+     * Number of consecutive outliers that restart the model.
+     */
+    static const unsigned int MAX_CONSECUTIVE_REJECTS = 3;
+
+private:
+
+    /**
+     * A line, offset + drift * (tt - t0), where offset is in
+     * microseconds and drift in microseconds per microsecond.
+     */
+    struct Fit
+    {
+        Fit(): t0(0), offset(0.0), drift(0.0), valid(false) {}
+        dsm_time_t t0;
+        double offset;
+        double drift;
+        bool valid;
+    };
+
+    /**
+     * Fit the observations. _mutex must be locked.
+     */
+    void fit();
+
+    static std::map<unsigned int, ClockModel*> _instances;
+
+    static nidas::util::Mutex _instanceLock;
+
+    /**
+     * System times and their offsets, reference minus system time,
+     * in microseconds.
+     */
+    std::deque<std::pair<dsm_time_t, long long> > _obs;
+
+    Fit _fit;
+
+    unsigned int _maxObs;
+
+    int _maxResidualUsecs;
+
+    unsigned int _nrejected;
+
+    unsigned int _nconsecutiveRejects;
+
+    mutable nidas::util::Mutex _mutex;
+
+    /** No copying. */
+    ClockModel(const ClockModel&);
+
+    /** No assignment. */
+    ClockModel& operator=(const ClockModel&);
+};
+
+}}	// namespace nidas namespace core
+
+#endif
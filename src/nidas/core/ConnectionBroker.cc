@@ -0,0 +1,1088 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "ConnectionBroker.h"
+
+#include <nidas/util/Thread.h>
+#include <nidas/util/IOException.h>
+#include <nidas/util/Logger.h>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+namespace {
+
+/**
+ * Exchanged at the start of a connection by both ends.
+ */
+const char BROKER_MAGIC[] = "NIDAS-BROKER 1";
+
+/**
+ * Frame types.
+ */
+enum frameType {
+    FRAME_HELLO = 1,    // payload: BROKER_MAGIC
+    FRAME_OPEN,         // payload: uint32 request type, name of requester
+    FRAME_DATA,         // payload: stream data
+    FRAME_CLOSE,        // no payload
+    FRAME_KEEPALIVE     // no payload
+};
+
+/**
+ * Frame header: uint8 type, uint8 flags (unused), uint16 stream id,
+ * uint32 payload length, in network byte order.
+ */
+const size_t FRAME_HEADER_LEN = 8;
+
+/**
+ * Frames longer than this are a protocol error.
+ */
+const size_t MAX_FRAME_LEN = 1048576;
+
+/**
+ * Maximum size of a DATA frame read from a stream.
+ */
+const size_t RELAY_CHUNK = 65536;
+
+const int MAX_RECONNECT_SECS = 10;
+
+/**
+ * Send timeout of a broker TCP socket. A send which is blocked
+ * checks this often whether it has waited too long.
+ */
+const int SEND_WAIT_SECS = 1;
+
+/**
+ * Connection information of a connected TCP socket.
+ */
+ConnectionInfo connectionInfo(n_u::Socket* sock)
+{
+    n_u::Inet4SocketAddress remote;
+    const n_u::SocketAddress& rsaddr = sock->getRemoteSocketAddress();
+    if (rsaddr.getFamily() == AF_INET)
+        remote = n_u::Inet4SocketAddress((const struct sockaddr_in*)
+                    rsaddr.getConstSockAddrPtr());
+
+    n_u::Inet4Address local;
+    const n_u::SocketAddress& lsaddr = sock->getLocalSocketAddress();
+    if (lsaddr.getFamily() == AF_INET)
+        local = n_u::Inet4SocketAddress((const struct sockaddr_in*)
+                    lsaddr.getConstSockAddrPtr()).getInet4Address();
+
+    n_u::Inet4NetworkInterface iface;
+    list<n_u::Inet4NetworkInterface> ifaces = sock->getInterfaces();
+    if (!ifaces.empty()) iface = ifaces.front();
+
+    return ConnectionInfo(remote, local, iface);
+}
+
+void setSendTimeout(int fd, int secs)
+{
+    struct timeval tv = { secs, 0 };
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+/**
+ * Requester of ConnectionBroker::connect(), which signals the
+ * waiting thread through a pipe.
+ */
+class BrokerWaiter: public BrokerStreamRequester
+{
+public:
+    BrokerWaiter(): _mutex(), _sock(0)
+    {
+        if (::pipe(_fds) < 0)
+            throw n_u::IOException("ConnectionBroker", "pipe", errno);
+    }
+
+    ~BrokerWaiter()
+    {
+        delete _sock;
+        ::close(_fds[0]);
+        ::close(_fds[1]);
+    }
+
+    void streamOpened(n_u::Socket* sock, const ConnectionInfo&,
+        const string&)
+    {
+        n_u::Synchronized autosync(_mutex);
+        _sock = sock;
+        char c = 0;
+        if (::write(_fds[1], &c, 1) < 0) {}
+    }
+
+    int getFd() const { return _fds[0]; }
+
+    n_u::Socket* release()
+    {
+        n_u::Synchronized autosync(_mutex);
+        n_u::Socket* sock = _sock;
+        _sock = 0;
+        return sock;
+    }
+
+private:
+    n_u::Mutex _mutex;
+    n_u::Socket* _sock;
+    int _fds[2];
+
+    BrokerWaiter(const BrokerWaiter&);
+    BrokerWaiter& operator=(const BrokerWaiter&);
+};
+
+}
+
+namespace nidas { namespace core {
+
+/**
+ * A TCP connection of a ConnectionBroker and the streams over it.
+ * A requesting connection connects to the server and reconnects
+ * when the connection is lost, an accepted connection ends when
+ * the connection is lost.
+ */
+class BrokerConnection: public n_u::Thread
+{
+public:
+
+    /**
+     * Accepted connection.
+     */
+    BrokerConnection(ConnectionBroker* broker, n_u::Socket* sock);
+
+    /**
+     * Requesting connection to a server.
+     */
+    BrokerConnection(ConnectionBroker* broker,
+        const n_u::Inet4SocketAddress& server);
+
+    ~BrokerConnection();
+
+    int run();
+
+    void interrupt();
+
+    void request(enum McSocketRequest type, BrokerStreamRequester* rqstr);
+
+    void cancel(BrokerStreamRequester* rqstr);
+
+private:
+
+    struct Request {
+        Request(enum McSocketRequest t, BrokerStreamRequester* r):
+            type(t), rqstr(r) {}
+        enum McSocketRequest type;
+        BrokerStreamRequester* rqstr;
+    };
+
+    void init();
+
+    /**
+     * Wait, unless interrupted.
+     * @return false if interrupted.
+     */
+    bool pause(int secs);
+
+    void wakeup();
+
+    void drainWakeup();
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void connectServer();
+
+    /**
+     * Relay frames until the connection is lost or the thread is
+     * interrupted.
+     *
+     * @throws nidas::util::IOException
+     **/
+    void relay();
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void openRequested();
+
+    /**
+     * Read from the TCP socket and handle the complete frames.
+     * @return false on end of file or a protocol error.
+     *
+     * @throws nidas::util::IOException
+     **/
+    bool readTcp();
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    bool handleFrame(int type, unsigned int id, const char* data, size_t len);
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void handleOpen(unsigned int id, const char* data, size_t len);
+
+    /**
+     * Write data to the local end of a stream.
+     *
+     * @throws nidas::util::IOException
+     **/
+    void deliver(unsigned int id, const char* data, size_t len);
+
+    /**
+     * Read from the local end of a stream and send it.
+     *
+     * @throws nidas::util::IOException
+     **/
+    void relayStream(unsigned int id);
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void sendFrame(int type, unsigned int id, const void* data, size_t len);
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void closeStream(unsigned int id, bool notifyPeer);
+
+    void closeStreams();
+
+    void closeTcp();
+
+    unsigned int nextStreamId();
+
+    ConnectionBroker* _broker;
+
+    bool _requesting;
+
+    n_u::Inet4SocketAddress _server;
+
+    n_u::Socket* _tcp;
+
+    ConnectionInfo _info;
+
+    /**
+     * Local ends of the stream socket pairs, by stream id.
+     */
+    map<unsigned int, n_u::Socket*> _streams;
+
+    n_u::Mutex _requestMutex;
+
+    list<Request> _requests;
+
+    int _wakeFds[2];
+
+    vector<char> _inbuf;
+
+    vector<char> _outbuf;
+
+    time_t _lastRecv;
+
+    time_t _lastSend;
+
+    int _keepAliveSecs;
+
+    int _sendTimeoutSecs;
+
+    bool _helloReceived;
+
+    unsigned int _nextId;
+
+    /** No copying. */
+    BrokerConnection(const BrokerConnection&);
+
+    /** No assignment. */
+    BrokerConnection& operator=(const BrokerConnection&);
+};
+
+/**
+ * Thread accepting broker connections on a port.
+ */
+class BrokerListener: public n_u::Thread
+{
+public:
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    BrokerListener(ConnectionBroker* broker, int port);
+
+    ~BrokerListener();
+
+    int run();
+
+private:
+
+    /**
+     * Delete the connections which have ended.
+     */
+    void reap();
+
+    ConnectionBroker* _broker;
+
+    n_u::ServerSocket* _server;
+
+    list<BrokerConnection*> _connections;
+
+    /** No copying. */
+    BrokerListener(const BrokerListener&);
+
+    /** No assignment. */
+    BrokerListener& operator=(const BrokerListener&);
+};
+
+}}	// namespace nidas namespace core
+
+BrokerConnection::BrokerConnection(ConnectionBroker* broker,
+        n_u::Socket* sock):
+    n_u::Thread("BrokerConnection " +
+        sock->getRemoteSocketAddress().toAddressString()),
+    _broker(broker),_requesting(false),
+    _server(),_tcp(sock),_info(connectionInfo(sock)),_streams(),
+    _requestMutex(PTHREAD_MUTEX_RECURSIVE),_requests(),_inbuf(),_outbuf(),
+    _lastRecv(0),_lastSend(0),_keepAliveSecs(5),_sendTimeoutSecs(60),
+    _helloReceived(false),_nextId(1)
+{
+    init();
+}
+
+BrokerConnection::BrokerConnection(ConnectionBroker* broker,
+        const n_u::Inet4SocketAddress& server):
+    n_u::Thread("BrokerConnection " + server.toAddressString()),
+    _broker(broker),_requesting(true),
+    _server(server),_tcp(0),_info(),_streams(),
+    _requestMutex(PTHREAD_MUTEX_RECURSIVE),_requests(),_inbuf(),_outbuf(),
+    _lastRecv(0),_lastSend(0),_keepAliveSecs(5),_sendTimeoutSecs(60),
+    _helloReceived(false),_nextId(1)
+{
+    init();
+}
+
+void BrokerConnection::init()
+{
+    if (::pipe(_wakeFds) < 0)
+        throw n_u::IOException(getName(), "pipe", errno);
+    ::fcntl(_wakeFds[0], F_SETFL, O_NONBLOCK);
+    ::fcntl(_wakeFds[1], F_SETFL, O_NONBLOCK);
+}
+
+BrokerConnection::~BrokerConnection()
+{
+    closeStreams();
+    closeTcp();
+    ::close(_wakeFds[0]);
+    ::close(_wakeFds[1]);
+}
+
+void BrokerConnection::interrupt()
+{
+    n_u::Thread::interrupt();
+    wakeup();
+}
+
+void BrokerConnection::wakeup()
+{
+    char c = 0;
+    if (::write(_wakeFds[1], &c, 1) < 0) {}
+}
+
+void BrokerConnection::drainWakeup()
+{
+    char buf[64];
+    while (::read(_wakeFds[0], buf, sizeof(buf)) > 0);
+}
+
+bool BrokerConnection::pause(int secs)
+{
+    struct pollfd fds;
+    fds.fd = _wakeFds[0];
+    fds.events = POLLIN;
+    if (::poll(&fds, 1, secs * 1000) > 0) drainWakeup();
+    return !isInterrupted();
+}
+
+void BrokerConnection::request(enum McSocketRequest type,
+        BrokerStreamRequester* rqstr)
+{
+    n_u::Synchronized autosync(_requestMutex);
+    _requests.push_back(Request(type, rqstr));
+    wakeup();
+}
+
+void BrokerConnection::cancel(BrokerStreamRequester* rqstr)
+{
+    n_u::Synchronized autosync(_requestMutex);
+    list<Request>::iterator ri = _requests.begin();
+    while (ri != _requests.end()) {
+        if (ri->rqstr == rqstr) ri = _requests.erase(ri);
+        else ++ri;
+    }
+}
+
+void BrokerConnection::connectServer()
+{
+    n_u::Socket* sock = new n_u::Socket();
+    try {
+        sock->connect(_server);
+    }
+    catch (const n_u::IOException& e) {
+        delete sock;
+        throw;
+    }
+    _tcp = sock;
+    _info = connectionInfo(sock);
+}
+
+void BrokerConnection::closeTcp()
+{
+    if (_tcp) {
+        try {
+            _tcp->close();
+        }
+        catch (const n_u::IOException& e) {
+        }
+        delete _tcp;
+        _tcp = 0;
+    }
+}
+
+void BrokerConnection::closeStreams()
+{
+    // The users of the other ends see an EOF or EPIPE.
+    map<unsigned int, n_u::Socket*>::iterator si = _streams.begin();
+    for ( ; si != _streams.end(); ++si) {
+        try {
+            si->second->close();
+        }
+        catch (const n_u::IOException& e) {
+        }
+        delete si->second;
+    }
+    _streams.clear();
+}
+
+void BrokerConnection::closeStream(unsigned int id, bool notifyPeer)
+{
+    map<unsigned int, n_u::Socket*>::iterator si = _streams.find(id);
+    if (si == _streams.end()) return;
+    try {
+        si->second->close();
+    }
+    catch (const n_u::IOException& e) {
+    }
+    delete si->second;
+    _streams.erase(si);
+    DLOG(("%s: stream %u closed", getName().c_str(), id));
+    if (notifyPeer) sendFrame(FRAME_CLOSE, id, 0, 0);
+}
+
+unsigned int BrokerConnection::nextStreamId()
+{
+    for (;;) {
+        unsigned int id = _nextId++;
+        if (_nextId > 0xffff) _nextId = 1;
+        if (_streams.find(id) == _streams.end()) return id;
+    }
+}
+
+void BrokerConnection::sendFrame(int type, unsigned int id,
+        const void* data, size_t len)
+{
+    _outbuf.resize(FRAME_HEADER_LEN + len);
+    char* bp = &_outbuf[0];
+    bp[0] = (char) type;
+    bp[1] = 0;
+    uint16_t sid = htons((uint16_t) id);
+    memcpy(bp + 2, &sid, 2);
+    uint32_t plen = htonl((uint32_t) len);
+    memcpy(bp + 4, &plen, 4);
+    if (len > 0) memcpy(bp + FRAME_HEADER_LEN, data, len);
+
+    // On a slow link a send may block for a while, which is fine as
+    // long as the peer is still taking the data.
+    size_t left = _outbuf.size();
+    time_t tprogress = ::time(0);
+    bool waited = false;
+    while (left > 0) {
+        ssize_t l = ::send(_tcp->getFd(), bp, left, MSG_NOSIGNAL);
+        if (l < 0) {
+            if (errno == EINTR) continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) &&
+                    !isInterrupted() &&
+                    ::time(0) - tprogress < _sendTimeoutSecs) {
+                waited = true;
+                continue;
+            }
+            throw n_u::IOException(getName(), "send", errno);
+        }
+        bp += l;
+        left -= l;
+        tprogress = ::time(0);
+    }
+    _lastSend = ::time(0);
+    // Data acknowledged by the peer after waiting shows that it is
+    // alive, while its frames wait to be read.
+    if (waited) _lastRecv = _lastSend;
+}
+
+int BrokerConnection::run()
+{
+    int delay = 0;
+
+    while (!isInterrupted()) {
+        if (!_tcp) {
+            if (delay > 0 && !pause(delay)) break;
+            try {
+                connectServer();
+                ILOG(("%s: connected", getName().c_str()));
+            }
+            catch (const n_u::IOException& e) {
+                if (delay == 0 || delay == MAX_RECONNECT_SECS)
+                    WLOG(("%s: %s, retrying", getName().c_str(), e.what()));
+                delay = std::min(std::max(delay * 2, 1), MAX_RECONNECT_SECS);
+                continue;
+            }
+        }
+        try {
+            relay();
+        }
+        catch (const n_u::IOException& e) {
+            WLOG(("%s: %s", getName().c_str(), e.what()));
+        }
+        closeStreams();
+        closeTcp();
+        if (!_requesting) break;
+        if (!isInterrupted())
+            ILOG(("%s: connection lost, reconnecting", getName().c_str()));
+        // first attempt is immediate
+        delay = 0;
+    }
+    closeStreams();
+    closeTcp();
+    return RUN_OK;
+}
+
+void BrokerConnection::relay()
+{
+    _keepAliveSecs = std::max(_broker->getKeepAliveSecs(), 1);
+    _sendTimeoutSecs = std::max(_broker->getSendTimeoutSecs(), 1);
+    _lastRecv = _lastSend = ::time(0);
+    _inbuf.clear();
+    _helloReceived = false;
+
+    _tcp->setTcpNoDelay(true);
+    setSendTimeout(_tcp->getFd(), SEND_WAIT_SECS);
+
+    if (_requesting)
+        sendFrame(FRAME_HELLO, 0, BROKER_MAGIC, sizeof(BROKER_MAGIC) - 1);
+
+    vector<struct pollfd> fds;
+    vector<unsigned int> ids;
+
+    while (!isInterrupted()) {
+        if (_requesting) openRequested();
+
+        fds.resize(2 + _streams.size());
+        ids.resize(_streams.size());
+        fds[0].fd = _wakeFds[0];
+        fds[1].fd = _tcp->getFd();
+        map<unsigned int, n_u::Socket*>::const_iterator si = _streams.begin();
+        for (int i = 0; si != _streams.end(); ++si, i++) {
+            fds[i + 2].fd = si->second->getFd();
+            ids[i] = si->first;
+        }
+        for (unsigned int i = 0; i < fds.size(); i++) {
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        int n = ::poll(&fds[0], fds.size(), 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw n_u::IOException(getName(), "poll", errno);
+        }
+
+        if (fds[0].revents & POLLIN) drainWakeup();
+
+        if (fds[1].revents) {
+            if (!readTcp()) return;
+        }
+
+        for (unsigned int i = 0; i < ids.size(); i++)
+            if (fds[i + 2].revents) relayStream(ids[i]);
+
+        time_t now = ::time(0);
+        if (now - _lastRecv > _keepAliveSecs * 3) {
+            WLOG(("%s: nothing received in %d seconds, closing connection",
+                  getName().c_str(), (int)(now - _lastRecv)));
+            return;
+        }
+        if (now - _lastSend >= _keepAliveSecs)
+            sendFrame(FRAME_KEEPALIVE, 0, 0, 0);
+    }
+}
+
+void BrokerConnection::openRequested()
+{
+    // The mutex is held while calling back, so that a requester
+    // isn't called after cancel() returns. It is recursive, so that
+    // the requester can make another request from the call back.
+    n_u::Synchronized autosync(_requestMutex);
+    while (!_requests.empty()) {
+        Request req = _requests.front();
+        _requests.pop_front();
+
+        unsigned int id = nextStreamId();
+        vector<n_u::Socket*> pair = n_u::Socket::createSocketPair();
+        setSendTimeout(pair[0]->getFd(), _keepAliveSecs * 3);
+        _streams[id] = pair[0];
+
+        char host[256];
+        if (::gethostname(host, sizeof(host)) < 0) host[0] = 0;
+        host[sizeof(host) - 1] = 0;
+        size_t hlen = strlen(host);
+        vector<char> payload(4 + hlen);
+        uint32_t rtype = htonl((uint32_t) req.type);
+        memcpy(&payload[0], &rtype, 4);
+        memcpy(&payload[4], host, hlen);
+        sendFrame(FRAME_OPEN, id, &payload[0], payload.size());
+
+        DLOG(("%s: stream %u opened, request type %d",
+              getName().c_str(), id, req.type));
+        req.rqstr->streamOpened(pair[1], _info,
+            _server.toAddressString());
+    }
+}
+
+bool BrokerConnection::readTcp()
+{
+    size_t len0 = _inbuf.size();
+    _inbuf.resize(len0 + RELAY_CHUNK);
+    ssize_t l = ::recv(_tcp->getFd(), &_inbuf[len0], RELAY_CHUNK,
+        MSG_DONTWAIT);
+    if (l < 0) {
+        _inbuf.resize(len0);
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return true;
+        throw n_u::IOException(getName(), "recv", errno);
+    }
+    _inbuf.resize(len0 + l);
+    if (l == 0) {
+        ILOG(("%s: connection closed by peer", getName().c_str()));
+        return false;
+    }
+    _lastRecv = ::time(0);
+
+    size_t off = 0;
+    for (;;) {
+        size_t avail = _inbuf.size() - off;
+        if (avail < FRAME_HEADER_LEN) break;
+        const char* bp = &_inbuf[off];
+        uint16_t sid;
+        memcpy(&sid, bp + 2, 2);
+        uint32_t plen;
+        memcpy(&plen, bp + 4, 4);
+        plen = ntohl(plen);
+        if (plen > MAX_FRAME_LEN) {
+            WLOG(("%s: frame length %u too large, closing connection",
+                  getName().c_str(), plen));
+            return false;
+        }
+        if (avail < FRAME_HEADER_LEN + plen) break;
+        if (!handleFrame((unsigned char) bp[0], ntohs(sid),
+                bp + FRAME_HEADER_LEN, plen)) return false;
+        off += FRAME_HEADER_LEN + plen;
+    }
+    _inbuf.erase(_inbuf.begin(), _inbuf.begin() + off);
+    return true;
+}
+
+bool BrokerConnection::handleFrame(int type, unsigned int id,
+        const char* data, size_t len)
+{
+    if (type == FRAME_HELLO) {
+        if (len != sizeof(BROKER_MAGIC) - 1 ||
+                memcmp(data, BROKER_MAGIC, len)) {
+            WLOG(("%s: bad hello, closing connection", getName().c_str()));
+            return false;
+        }
+        if (!_requesting && !_helloReceived)
+            sendFrame(FRAME_HELLO, 0, BROKER_MAGIC, sizeof(BROKER_MAGIC) - 1);
+        _helloReceived = true;
+        return true;
+    }
+    if (!_helloReceived) {
+        WLOG(("%s: frame type %d before hello, closing connection",
+              getName().c_str(), type));
+        return false;
+    }
+
+    switch (type) {
+    case FRAME_OPEN:
+        if (_requesting || len < 4) {
+            WLOG(("%s: unexpected open, closing connection",
+                  getName().c_str()));
+            return false;
+        }
+        handleOpen(id, data, len);
+        break;
+    case FRAME_DATA:
+        deliver(id, data, len);
+        break;
+    case FRAME_CLOSE:
+        closeStream(id, false);
+        break;
+    case FRAME_KEEPALIVE:
+        break;
+    default:
+        WLOG(("%s: unknown frame type %d ignored", getName().c_str(), type));
+        break;
+    }
+    return true;
+}
+
+void BrokerConnection::handleOpen(unsigned int id, const char* data,
+        size_t len)
+{
+    uint32_t rtype;
+    memcpy(&rtype, data, 4);
+    rtype = ntohl(rtype);
+    string name(data + 4, len - 4);
+
+    // stale stream with the same id
+    closeStream(id, false);
+
+    BrokerStreamRequester* acceptor = _broker->getAcceptor(rtype);
+    if (!acceptor) {
+        WLOG(("%s: no acceptor of request type %u from %s",
+              getName().c_str(), rtype, name.c_str()));
+        sendFrame(FRAME_CLOSE, id, 0, 0);
+        return;
+    }
+
+    vector<n_u::Socket*> pair;
+    try {
+        pair = n_u::Socket::createSocketPair();
+    }
+    catch (const n_u::IOException& e) {
+        WLOG(("%s: %s", getName().c_str(), e.what()));
+        sendFrame(FRAME_CLOSE, id, 0, 0);
+        return;
+    }
+    setSendTimeout(pair[0]->getFd(), _keepAliveSecs * 3);
+    _streams[id] = pair[0];
+
+    ILOG(("%s: stream %u, request type %u from %s",
+          getName().c_str(), id, rtype, name.c_str()));
+    acceptor->streamOpened(pair[1], _info, name);
+}
+
+void BrokerConnection::deliver(unsigned int id, const char* data, size_t len)
+{
+    map<unsigned int, n_u::Socket*>::iterator si = _streams.find(id);
+    if (si == _streams.end()) return;
+    int fd = si->second->getFd();
+
+    while (len > 0) {
+        ssize_t l = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (l < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                WLOG(("%s: stream %u not being read, closing it",
+                      getName().c_str(), id));
+            closeStream(id, true);
+            return;
+        }
+        data += l;
+        len -= l;
+    }
+}
+
+void BrokerConnection::relayStream(unsigned int id)
+{
+    map<unsigned int, n_u::Socket*>::iterator si = _streams.find(id);
+    if (si == _streams.end()) return;
+
+    char buf[RELAY_CHUNK];
+    ssize_t l = ::recv(si->second->getFd(), buf, sizeof(buf), MSG_DONTWAIT);
+    if (l > 0) sendFrame(FRAME_DATA, id, buf, l);
+    else if (l == 0 ||
+            (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        closeStream(id, true);
+}
+
+BrokerListener::BrokerListener(ConnectionBroker* broker, int port):
+    n_u::Thread("BrokerListener"),_broker(broker),
+    _server(new n_u::ServerSocket(port)),_connections()
+{
+    blockSignal(SIGUSR1);
+}
+
+BrokerListener::~BrokerListener()
+{
+    list<BrokerConnection*>::iterator ci = _connections.begin();
+    for ( ; ci != _connections.end(); ++ci) {
+        BrokerConnection* conn = *ci;
+        if (conn->isRunning()) conn->interrupt();
+        try {
+            if (!conn->isJoined()) conn->join();
+        }
+        catch (const n_u::Exception& e) {
+            WLOG(("%s: %s", conn->getName().c_str(), e.what()));
+        }
+        delete conn;
+    }
+    try {
+        _server->close();
+    }
+    catch (const n_u::IOException& e) {
+    }
+    delete _server;
+}
+
+void BrokerListener::reap()
+{
+    list<BrokerConnection*>::iterator ci = _connections.begin();
+    while (ci != _connections.end()) {
+        BrokerConnection* conn = *ci;
+        if (!conn->isRunning()) {
+            try {
+                conn->join();
+            }
+            catch (const n_u::Exception& e) {
+                WLOG(("%s: %s", conn->getName().c_str(), e.what()));
+            }
+            delete conn;
+            ci = _connections.erase(ci);
+        }
+        else ++ci;
+    }
+}
+
+int BrokerListener::run()
+{
+    ILOG(("ConnectionBroker listening on port %d", _server->getLocalPort()));
+    while (!isInterrupted()) {
+        n_u::Socket* sock;
+        try {
+            sock = _server->accept();
+        }
+        catch (const n_u::IOException& e) {
+            if (isInterrupted()) break;
+            WLOG(("BrokerListener: %s", e.what()));
+            if (e.getErrno() != EINTR) ::sleep(1);
+            continue;
+        }
+        reap();
+        BrokerConnection* conn = new BrokerConnection(_broker, sock);
+        _connections.push_back(conn);
+        conn->start();
+    }
+    return RUN_OK;
+}
+
+/* static */
+ConnectionBroker* ConnectionBroker::_instance = 0;
+
+/* static */
+n_u::Mutex ConnectionBroker::_instanceLock;
+
+/* static */
+ConnectionBroker* ConnectionBroker::getInstance()
+{
+    if (!_instance) {
+        n_u::Synchronized autosync(_instanceLock);
+        if (!_instance) _instance = new ConnectionBroker();
+    }
+    return _instance;
+}
+
+/* static */
+void ConnectionBroker::destroyInstance()
+{
+    if (_instance) {
+        n_u::Synchronized autosync(_instanceLock);
+        delete _instance;
+        _instance = 0;
+    }
+}
+
+ConnectionBroker::ConnectionBroker():
+    _mutex(),_listeners(),_acceptors(),_connections(),
+    _defaultServer(),_keepAliveSecs(5),_sendTimeoutSecs(60)
+{
+}
+
+ConnectionBroker::~ConnectionBroker()
+{
+    map<string, BrokerConnection*>::iterator ci = _connections.begin();
+    for ( ; ci != _connections.end(); ++ci) {
+        BrokerConnection* conn = ci->second;
+        if (conn->isRunning()) conn->interrupt();
+        try {
+            if (!conn->isJoined()) conn->join();
+        }
+        catch (const n_u::Exception& e) {
+            WLOG(("%s: %s", conn->getName().c_str(), e.what()));
+        }
+        delete conn;
+    }
+
+    map<int, BrokerListener*>::iterator li = _listeners.begin();
+    for ( ; li != _listeners.end(); ++li) {
+        BrokerListener* lsnr = li->second;
+        if (lsnr->isRunning()) {
+            lsnr->interrupt();
+            lsnr->kill(SIGUSR1);
+        }
+        try {
+            if (!lsnr->isJoined()) lsnr->join();
+        }
+        catch (const n_u::Exception& e) {
+            WLOG(("%s: %s", lsnr->getName().c_str(), e.what()));
+        }
+        delete lsnr;
+    }
+}
+
+void ConnectionBroker::listen(int port)
+{
+    n_u::Synchronized autosync(_mutex);
+    if (_listeners.find(port) != _listeners.end()) return;
+    BrokerListener* lsnr = new BrokerListener(this, port);
+    _listeners[port] = lsnr;
+    lsnr->start();
+}
+
+void ConnectionBroker::addAcceptor(enum McSocketRequest type,
+        BrokerStreamRequester* rqstr)
+{
+    n_u::Synchronized autosync(_mutex);
+    map<int, BrokerStreamRequester*>::iterator ai = _acceptors.find(type);
+    if (ai != _acceptors.end() && ai->second != rqstr)
+        WLOG(("ConnectionBroker: acceptor of request type %d replaced",
+              type));
+    _acceptors[type] = rqstr;
+}
+
+void ConnectionBroker::removeAcceptor(BrokerStreamRequester* rqstr)
+{
+    n_u::Synchronized autosync(_mutex);
+    map<int, BrokerStreamRequester*>::iterator ai = _acceptors.begin();
+    while (ai != _acceptors.end()) {
+        if (ai->second == rqstr) _acceptors.erase(ai++);
+        else ++ai;
+    }
+}
+
+BrokerStreamRequester* ConnectionBroker::getAcceptor(int type)
+{
+    n_u::Synchronized autosync(_mutex);
+    map<int, BrokerStreamRequester*>::const_iterator ai =
+        _acceptors.find(type);
+    return ai == _acceptors.end() ? 0 : ai->second;
+}
+
+void ConnectionBroker::request(const n_u::Inet4SocketAddress& server,
+        enum McSocketRequest type, BrokerStreamRequester* rqstr)
+{
+    BrokerConnection* conn;
+    {
+        n_u::Synchronized autosync(_mutex);
+        string key = server.toAddressString();
+        map<string, BrokerConnection*>::iterator ci = _connections.find(key);
+        if (ci == _connections.end()) {
+            conn = new BrokerConnection(this, server);
+            _connections[key] = conn;
+            conn->start();
+        }
+        else conn = ci->second;
+    }
+    // Connections are not deleted until destroyInstance(). The
+    // broker mutex is not held here, since the connection calls
+    // back with its own mutex held.
+    conn->request(type, rqstr);
+}
+
+void ConnectionBroker::cancel(BrokerStreamRequester* rqstr)
+{
+    list<BrokerConnection*> conns;
+    {
+        n_u::Synchronized autosync(_mutex);
+        map<string, BrokerConnection*>::iterator ci = _connections.begin();
+        for ( ; ci != _connections.end(); ++ci) conns.push_back(ci->second);
+    }
+    list<BrokerConnection*>::iterator ci = conns.begin();
+    for ( ; ci != conns.end(); ++ci) (*ci)->cancel(rqstr);
+}
+
+n_u::Socket* ConnectionBroker::connect(const n_u::Inet4SocketAddress& server,
+        enum McSocketRequest type, const sigset_t* sigmask)
+{
+    BrokerWaiter waiter;
+    request(server, type, &waiter);
+
+    struct pollfd fds;
+    fds.fd = waiter.getFd();
+    fds.events = POLLIN;
+    for (;;) {
+        int n = ::ppoll(&fds, 1, 0, sigmask);
+        if (n > 0) break;
+        if (n < 0) {
+            int ierr = errno;
+            cancel(&waiter);
+            throw n_u::IOException(server.toAddressString(), "connect", ierr);
+        }
+    }
+    return waiter.release();
+}
+
+void ConnectionBroker::setDefaultServerAddress(
+        const n_u::Inet4SocketAddress& val)
+{
+    n_u::Synchronized autosync(_mutex);
+    _defaultServer = val;
+}
+
+n_u::Inet4SocketAddress ConnectionBroker::getDefaultServerAddress() const
+{
+    n_u::Synchronized autosync(_mutex);
+    return _defaultServer;
+}
@@ -0,0 +1,214 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_CORE_CONNECTIONBROKER_H
+#define NIDAS_CORE_CONNECTIONBROKER_H
+
+#include "ConnectionInfo.h"
+#include "Datagrams.h"
+
+#include <nidas/util/Socket.h>
+#include <nidas/util/Inet4SocketAddress.h>
+#include <nidas/util/ThreadSupport.h>
+
+#include <signal.h>
+
+#include <string>
+#include <map>
+#include <list>
+
+namespace nidas { namespace core {
+
+class BrokerConnection;
+class BrokerListener;
+
+/**
+ * Interface of an object which is notified of streams opened
+ * through a ConnectionBroker.
+ */
+class BrokerStreamRequester
+{
+public:
+    virtual ~BrokerStreamRequester() {}
+
+    /**
+     * A stream has been opened.
+     * @param sock One end of a local socket pair, whose other end is
+     *      relayed over the broker connection. The requester owns it.
+     * @param info Addresses of the TCP connection which carries
+     *      the stream, the remote address being the peer.
+     * @param name Name given by the peer, typically its host name.
+     */
+    virtual void streamOpened(nidas::util::Socket* sock,
+        const ConnectionInfo& info, const std::string& name) = 0;
+};
+
+/**
+ * Multiplexes the socket connections between DSMs and the server
+ * over a single TCP connection per DSM, to one well-known port,
+ * NIDAS_BROKER_PORT_TCP.
+ *
+ * Unlike McSocket, which multicasts a request and waits for the
+ * server to connect back for every stream, a DSM keeps one TCP
+ * connection to the server, and opens the raw sample, processed
+ * sample and XML configuration streams over it as logical streams,
+ * each with the McSocketRequest type of the service which accepts it.
+ * Both ends send keepalive frames when idle, so that a dead connection
+ * is detected in a few seconds rather than after the TCP keepalive
+ * time. The requesting side reconnects immediately when a connection
+ * is lost, then with an increasing delay up to 10 seconds.
+ *
+ * Each logical stream is handed to its user as one end of a local
+ * socket pair, so that the existing readers and writers, which poll
+ * and read file descriptors, are unchanged. When the TCP connection
+ * is lost, the local ends of its streams are closed, and their users
+ * see an end of file or a broken pipe, as they would on a direct
+ * socket, and request a new connection.
+ *
+ * Since the streams share a connection, a reader of one stream
+ * which does not keep up holds up the others.
+ */
+class ConnectionBroker
+{
+public:
+
+    static ConnectionBroker* getInstance();
+
+    /**
+     * Stop all listener and connection threads and delete the instance.
+     */
+    static void destroyInstance();
+
+    /**
+     * Start accepting broker connections on a TCP port, if not
+     * already doing so.
+     *
+     * @throws nidas::util::IOException
+     **/
+    void listen(int port);
+
+    /**
+     * Register the acceptor of streams of a request type,
+     * arriving on any of the listened ports.
+     */
+    void addAcceptor(enum McSocketRequest type, BrokerStreamRequester* rqstr);
+
+    void removeAcceptor(BrokerStreamRequester* rqstr);
+
+    /**
+     * Acceptor of a request type, or NULL.
+     */
+    BrokerStreamRequester* getAcceptor(int type);
+
+    /**
+     * Request a stream of a type from a server, but don't wait for it.
+     * A connection to the server is made if there isn't one, and
+     * BrokerStreamRequester::streamOpened() is called once the
+     * stream is open. Each request results in at most one stream.
+     */
+    void request(const nidas::util::Inet4SocketAddress& server,
+        enum McSocketRequest type, BrokerStreamRequester* rqstr);
+
+    /**
+     * Withdraw the requests of a requester which haven't been
+     * opened yet.
+     */
+    void cancel(BrokerStreamRequester* rqstr);
+
+    /**
+     * Request a stream, and wait until it is open.
+     * @param sigmask If non-NULL, the signal mask while waiting.
+     *      A signal which is caught while waiting results in an
+     *      IOException with an errno of EINTR.
+     *
+     * @throws nidas::util::IOException
+     **/
+    nidas::util::Socket* connect(const nidas::util::Inet4SocketAddress& server,
+        enum McSocketRequest type, const sigset_t* sigmask = 0);
+
+    /**
+     * Server address of requests which do not specify one, such
+     * as the address from which the configuration was requested.
+     */
+    void setDefaultServerAddress(const nidas::util::Inet4SocketAddress& val);
+
+    nidas::util::Inet4SocketAddress getDefaultServerAddress() const;
+
+    /**
+     * Seconds between keepalive frames on an idle connection.
+     * A connection with nothing received in three times this
+     * period is dropped.
+     */
+    void setKeepAliveSecs(int val) { _keepAliveSecs = val; }
+
+    int getKeepAliveSecs() const { return _keepAliveSecs; }
+
+    /**
+     * Seconds that a send on a connection may make no progress
+     * before the connection is dropped, by default 60. A send which
+     * is only slow, on a radio link for example, is not dropped.
+     */
+    void setSendTimeoutSecs(int val) { _sendTimeoutSecs = val; }
+
+    int getSendTimeoutSecs() const { return _sendTimeoutSecs; }
+
+private:
+
+    ConnectionBroker();
+
+    ~ConnectionBroker();
+
+    static ConnectionBroker* _instance;
+
+    static nidas::util::Mutex _instanceLock;
+
+    mutable nidas::util::Mutex _mutex;
+
+    std::map<int, BrokerListener*> _listeners;
+
+    std::map<int, BrokerStreamRequester*> _acceptors;
+
+    /**
+     * Requesting connections, by server address.
+     */
+    std::map<std::string, BrokerConnection*> _connections;
+
+    nidas::util::Inet4SocketAddress _defaultServer;
+
+    int _keepAliveSecs;
+
+    int _sendTimeoutSecs;
+
+    /** No copying. */
+    ConnectionBroker(const ConnectionBroker&);
+
+    /** No assignment. */
+    ConnectionBroker& operator=(const ConnectionBroker&);
+};
+
+}}	// namespace nidas namespace core
+
+#endif
@@ -47,6 +47,7 @@
 #include "SampleIOProcessor.h"
 #include "NidsIterators.h"
 #include "SampleOutputRequestThread.h"
+#include "ConnectionBroker.h"
 #include <nidas/util/Process.h>
 #include <nidas/util/FileSet.h>
 
@@ -83,6 +84,7 @@ DSMEngine* DSMEngine::_instance = 0;
 DSMEngine::DSMEngine():
     _externalControl(false),_disableAutoconfig(true),_runState(DSM_RUNNING),
     _command(DSM_RUN),_syslogit(true),_configFile(),_configSockAddr(),
+    _configBroker(false),
     _project(0), _dsmConfig(0),_selector(0),_pipeline(0),
     _statusThread(0),_xmlrpcThread(0),
     _outputSet(),_outputMutex(),
@@ -115,6 +117,7 @@ DSMEngine::~DSMEngine()
     SampleOutputRequestThread::destroyInstance();
     delete _project;
     _project = 0;
+    ConnectionBroker::destroyInstance();
     SamplePools::deleteInstance();
 }
 
@@ -236,12 +239,15 @@ int DSMEngine::parseRunstring(int argc, char** argv)
         string type = "file";
         string::size_type ic = url.find(':');
         if (ic != string::npos) type = url.substr(0,ic);
-        if (type == "sock" || type == "inet" || type == "mcsock") {
+        if (type == "sock" || type == "inet" || type == "mcsock" ||
+            type == "broker") {
 	    url = url.substr(ic+1);
 	    ic = url.find(':');
 	    string addr = url.substr(0,ic);
             if (addr.length() == 0 && type == "mcsock") addr = NIDAS_MULTICAST_ADDR;
-	    int port = NIDAS_SVC_REQUEST_PORT_UDP;
+            _configBroker = (type == "broker");
+	    int port = _configBroker ? NIDAS_BROKER_PORT_TCP :
+                NIDAS_SVC_REQUEST_PORT_UDP;
 	    if (ic != string::npos) {
 		istringstream ist(url.substr(ic+1));
 		ist >> port;
@@ -285,6 +291,10 @@ void DSMEngine::usage()
         "config:\n"
         "  The name of a local DSM configuration XML file\n"
         "  to be read, or a socket address in the form \"sock:addr:port\".\n"
+        "  With \"broker:addr[:port]\" the configuration is requested over\n"
+        "  a ConnectionBroker connection to the server at addr, default port "
+        << NIDAS_BROKER_PORT_TCP << ",\n"
+        "  which is then used for the brokerrequest sockets of the outputs.\n"
         "  The default config is "
         "\"sock:" <<
         NIDAS_MULTICAST_ADDR << ":" <<
@@ -362,7 +372,11 @@ int DSMEngine::run() throw()
         try {
             if (_configFile.length() == 0) {
                 // fetch from XMLConfigService on server
-                projectDoc = n_c::requestXMLConfig(false,_configSockAddr, &_signalMask);
+                if (_configBroker)
+                    projectDoc = n_c::requestXMLConfigBroker(false,
+                        _configSockAddr, &_signalMask);
+                else
+                    projectDoc = n_c::requestXMLConfig(false,_configSockAddr, &_signalMask);
             }
             else {
                 // expand environment variables in name
@@ -736,6 +750,8 @@ void DSMEngine::connectOutputs()
         if (output->isRaw()) src = _pipeline->getRawSampleSource();
         else src = _pipeline->getProcessedSampleSource();
         output->addSourceSampleTags(src->getSampleTags());
+        // a spooling output saves samples until it is connected
+        if (output->isSpooling()) src->addSampleClient(output);
         SampleOutputRequestThread::getInstance()->addConnectRequest(output,this,0);
     }
 }
@@ -750,8 +766,15 @@ void DSMEngine::connect(SampleOutput* output) throw()
     _outputSet.insert(output);
     _outputMutex.unlock();
 
-    if (output->isRaw()) _pipeline->getRawSampleSource()->addSampleClient(output);
-    else  _pipeline->getProcessedSampleSource()->addSampleClient(output);
+    SampleSource* src;
+    if (output->isRaw()) src = _pipeline->getRawSampleSource();
+    else src = _pipeline->getProcessedSampleSource();
+    src->addSampleClient(output);
+
+    // Samples now go to the connected output rather than the spool
+    // of the original.
+    SampleOutput* orig = output->getOriginal();
+    if (orig != output && orig->isSpooling()) src->removeSampleClient(orig);
 }
 
 /*
@@ -760,8 +783,18 @@ void DSMEngine::connect(SampleOutput* output) throw()
  */
 void DSMEngine::disconnect(SampleOutput* output) throw()
 {
-    if (output->isRaw()) _pipeline->getRawSampleSource()->removeSampleClient(output);
-    else  _pipeline->getProcessedSampleSource()->removeSampleClient(output);
+    SampleSource* src;
+    if (output->isRaw()) src = _pipeline->getRawSampleSource();
+    else src = _pipeline->getProcessedSampleSource();
+
+    // The connected output is removed before a spooling original takes
+    // over, otherwise a sample which the connected output fails to
+    // write, and spools, could be spooled again by the original.
+    // If the original was the connected output, it stays a client
+    // and spools once it is closed.
+    SampleOutput* orig = output->getOriginal();
+    if (output != orig || !orig->isSpooling()) src->removeSampleClient(output);
+    if (orig->isSpooling()) src->addSampleClient(orig);
 
     _outputMutex.lock();
     _outputSet.erase(output);
@@ -777,8 +810,6 @@ void DSMEngine::disconnect(SampleOutput* output) throw()
                 output->getName().c_str(),ioe.what());
     }
 
-    SampleOutput* orig = output->getOriginal();
-
     if (output != orig)
        SampleOutputRequestThread::getInstance()->addDeleteRequest(output);
 
@@ -816,6 +847,12 @@ void DSMEngine::closeOutputs() throw()
 	list<SampleOutput*>::const_iterator oi = outputs.begin();
 	for ( ; oi != outputs.end(); ++oi) {
 	    SampleOutput* output = *oi;
+            if (output->isSpooling()) {
+                if (output->isRaw())
+                    _pipeline->getRawSampleSource()->removeSampleClient(output);
+                else
+                    _pipeline->getProcessedSampleSource()->removeSampleClient(output);
+            }
             output->flush();
 	    try {
 		output->close();	// DSMConfig will delete
@@ -240,6 +240,12 @@ private:
      */
     nidas::util::Inet4SocketAddress _configSockAddr;
 
+    /**
+     * Request the XML configuration from _configSockAddr through
+     * the ConnectionBroker, rather than with a McSocket request.
+     */
+    bool _configBroker;
+
     Project*         _project;
 
     DSMConfig*       _dsmConfig;
@@ -29,7 +29,7 @@
 #include "DSMEngine.h"
 #include "DSMSensor.h"
 #include "SensorHandler.h"
-#include "SocketAddrs.h" // defines DSM_XMLRPC_PORT_TCP
+#include "SocketAddrs.h" // defines DSM_XMLRPC_PORT_TCP, DSM_JSONRPC_PORT_TCP
 #include "SocketIODevice.h"
 
 #include <nidas/util/Logger.h>
@@ -42,10 +42,9 @@ using namespace std;
 namespace n_u = nidas::util;
 
 DSMEngineIntf::DSMEngineIntf(): XmlRpcThread("DSMEngineIntf"),
-    _xmlrpc_server(new XmlRpc::XmlRpcServer),
-    // These constructors register themselves with the XmlRpcServer
-    _dsmAction(_xmlrpc_server),
-    _sensorAction(_xmlrpc_server)
+    // These are registered by addMethod() in run()
+    _dsmAction(0),
+    _sensorAction(0)
 {
 }
 
@@ -84,7 +83,18 @@ void DSMEngineIntf::SensorAction::execute(XmlRpc::XmlRpcValue& params, XmlRpc::X
     else if (params.getType() == XmlRpc::XmlRpcValue::TypeArray)
         devname = string(params[0]["device"]);
 
-    DSMSensor* sensor = _nameToSensor[devname];
+    DSMSensor* sensor = 0;
+    {
+        n_u::Synchronized autosync(_mutex);
+        map<string,DSMSensor*>::const_iterator si = _nameToSensor.find(devname);
+        if (si != _nameToSensor.end()) sensor = si->second;
+        if (sensor && !_busy.insert(sensor).second) {
+            string errmsg = "sensor " + devname + " is busy";
+            PLOG(("XmlRpc error: ") << errmsg);
+            result = errmsg;
+            return;
+        }
+    }
 
     if (!sensor) {
         string errmsg = "sensor " + devname + " not found";
@@ -93,6 +103,9 @@ void DSMEngineIntf::SensorAction::execute(XmlRpc::XmlRpcValue& params, XmlRpc::X
         return;
     }
     sensor->executeXmlRpc(params,result);
+
+    n_u::Synchronized autosync(_mutex);
+    _busy.erase(sensor);
 }
 
 int DSMEngineIntf::run()
@@ -101,15 +114,23 @@ int DSMEngineIntf::run()
     // DEBUG - set verbosity of the xmlrpc server
     XmlRpc::setVerbosity(1);
 
+    // A sensor action may do serial I/O, so allow it more time.
+    addMethod(&_dsmAction, 5.0);
+    addMethod(&_sensorAction, 10.0);
+
     // Create the server socket on the specified port
     _xmlrpc_server->bindAndListen(DSM_XMLRPC_PORT_TCP);
 
     // Enable introspection
     _xmlrpc_server->enableIntrospection(true);
 
+    startDispatching(DSM_JSONRPC_PORT_TCP);
+
     // Wait for requests indefinitely
     // This can be interrupted with a Thread::kill(SIGUSR1);
     _xmlrpc_server->work(-1.0);
 
+    stopDispatching();
+
     return RUN_OK;
 }
@@ -29,9 +29,12 @@
 
 #include "XmlRpcThread.h"
 #include <nidas/util/IOException.h>
+#include <nidas/util/ThreadSupport.h>
 #include <xmlrpcpp/XmlRpcException.h>
 
 #include <iostream>
+#include <map>
+#include <set>
 
 namespace nidas { namespace core {
 
@@ -81,25 +84,29 @@ private:
      * The SensorAction::execute() method will look for a DSMSensor
      * which has registered with DSMEngineIntf, with a name
      * (typically a device name) matching the value of params["device"].
+     * Calls for one sensor are not concurrent: a call for a sensor
+     * which is still busy with an earlier call is refused.
      */
     class SensorAction : public XmlRpc::XmlRpcServerMethod
     {
     public:
-        SensorAction(XmlRpc::XmlRpcServer* s) : XmlRpc::XmlRpcServerMethod("SensorAction", s),_nameToSensor() {}
+        SensorAction(XmlRpc::XmlRpcServer* s) : XmlRpc::XmlRpcServerMethod("SensorAction", s),_mutex(),_nameToSensor(),_busy() {}
         void execute(XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result) throw();
 
         std::string help() { return std::string("parameter \"device\" should match a device name for a DSMSensor that has registered itself with DSMEngineIntf"); }
 
         void registerSensor(const std::string& devname, DSMSensor* sensor)
         {
+            nidas::util::Synchronized autosync(_mutex);
             _nameToSensor[devname] = sensor;
         }
 
     private:
+        nidas::util::Mutex _mutex;
         std::map<std::string,DSMSensor*> _nameToSensor;
+        std::set<DSMSensor*> _busy;
     };
 
-    XmlRpc::XmlRpcServer* _xmlrpc_server;
     DSMAction _dsmAction;
     SensorAction _sensorAction;
 
@@ -34,6 +34,7 @@
 #include "Site.h"
 #include "ProjectConfigs.h"
 #include "SampleOutputRequestThread.h"
+#include "ConnectionBroker.h"
 #include "XMLParser.h"
 #include "Version.h"
 
@@ -82,6 +83,7 @@ DSMServerApp::DSMServerApp():
 DSMServerApp::~DSMServerApp()
 {
     SampleOutputRequestThread::destroyInstance();
+    ConnectionBroker::destroyInstance();
     SamplePools::deleteInstance();
 }
 
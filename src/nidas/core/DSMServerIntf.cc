@@ -35,7 +35,7 @@
 #include "Variable.h"
 #include "DSMServer.h"
 #include "CalFile.h"
-#include "SocketAddrs.h" // defines DSM_SERVER_XMLRPC_PORT_TCP
+#include "SocketAddrs.h" // defines DSM_SERVER_XMLRPC_PORT_TCP, DSM_SERVER_JSONRPC_PORT_TCP
 
 // #include <nidas/util/Logger.h>
 
@@ -93,12 +93,11 @@ void GetAdsFileName::execute(XmlRpcValue&, XmlRpcValue& result)
 
 int DSMServerIntf::run()
 {
-    // Create an XMLRPC server
-    _xmlrpc_server = new XmlRpcServer;
+    GetDsmList       getdsmlist       (0,this);
+    GetAdsFileName   getadsfilename   (0,this);
 
-    // This constructor registers a method with the XMLRPC server
-    GetDsmList       getdsmlist       (_xmlrpc_server,this);
-    GetAdsFileName   getadsfilename   (_xmlrpc_server,this);
+    addMethod(&getdsmlist);
+    addMethod(&getadsfilename);
 
     // DEBUG - set verbosity of the xmlrpc server HIGH...
     XmlRpc::setVerbosity(1);
@@ -110,8 +109,13 @@ int DSMServerIntf::run()
     // Enable introspection
     _xmlrpc_server->enableIntrospection(true);
 
+    startDispatching(DSM_SERVER_JSONRPC_PORT_TCP);
+
     // Wait for requests indefinitely
     // This can be interrupted with a Thread::kill(SIGUSR1);
     _xmlrpc_server->work(-1.0);
+
+    // the methods are local to this function
+    stopDispatching();
     return RUN_OK;
 }
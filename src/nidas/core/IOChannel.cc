@@ -28,6 +28,7 @@
 
 #include "IOChannel.h"
 #include "Socket.h"
+#include "ShmRingIOChannel.h"
 #include <nidas/util/Process.h>
 #include "SampleTag.h"
 
@@ -66,6 +67,8 @@ IOChannel* IOChannel::createIOChannel(const xercesc::DOMElement* node)
         }
     	domable = DOMObjectFactory::createObject(classAttr);
     }
+    else if (elname == "shmring")
+        domable = new ShmRingIOChannel();
     else throw n_u::InvalidParameterException(
         "IOChannel::createIOChannel", "unknown element", elname);
 
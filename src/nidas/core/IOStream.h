@@ -223,6 +223,16 @@ public:
         _nbytesOut += val;
     }
 
+    /**
+     * Current length of the internal buffer. On output, a physical
+     * write is done when more than half of it is filled, so
+     * available() remains above half of this length only when
+     * the IOChannel is not keeping up.
+     */
+    size_t getBufferLength() const {
+        return _buflen;
+    }
+
 protected:
 
     IOChannel& _iochannel;
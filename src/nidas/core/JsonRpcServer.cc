@@ -0,0 +1,726 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "JsonRpcServer.h"
+
+#include <nidas/util/Logger.h>
+#include <nidas/util/IOException.h>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+namespace {
+
+/**
+ * Requests larger than this are refused.
+ */
+const size_t MAX_REQUEST_LEN = 1048576;
+
+const unsigned int MAX_CLIENTS = 64;
+
+string jsonString(const string& str)
+{
+    string res = "\"";
+    for (string::const_iterator si = str.begin(); si != str.end(); ++si) {
+        unsigned char c = *si;
+        switch (c) {
+        case '"': res += "\\\""; break;
+        case '\\': res += "\\\\"; break;
+        case '\n': res += "\\n"; break;
+        case '\r': res += "\\r"; break;
+        case '\t': res += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                res += buf;
+            }
+            else res += c;
+        }
+    }
+    return res + "\"";
+}
+
+string xmlUnescape(const string& str)
+{
+    static const char* entities[][2] = {
+        {"&lt;", "<"}, {"&gt;", ">"}, {"&quot;", "\""},
+        {"&apos;", "'"}, {"&amp;", "&"}
+    };
+    string res = str;
+    for (unsigned int i = 0; i < sizeof(entities) / sizeof(entities[0]); i++) {
+        string::size_type p = 0;
+        while ((p = res.find(entities[i][0], p)) != string::npos) {
+            res.replace(p, strlen(entities[i][0]), entities[i][1]);
+            p += strlen(entities[i][1]);
+        }
+    }
+    return res;
+}
+
+/**
+ * Member names of a struct, taken from its XML, since XmlRpcValue
+ * does not provide a way to iterate over them.
+ */
+list<string> structMemberNames(const XmlRpc::XmlRpcValue& val)
+{
+    list<string> names;
+    string xml = val.toXml();
+    int depth = 0;
+    string::size_type p = 0;
+    while ((p = xml.find('<', p)) != string::npos) {
+        if (!xml.compare(p, 8, "<struct>")) depth++;
+        else if (!xml.compare(p, 9, "</struct>")) depth--;
+        else if (depth == 1 && !xml.compare(p, 6, "<name>")) {
+            string::size_type e = xml.find("</name>", p);
+            if (e == string::npos) break;
+            names.push_back(xmlUnescape(xml.substr(p + 6, e - p - 6)));
+            p = e;
+        }
+        p++;
+    }
+    return names;
+}
+
+/**
+ * Recursive descent parser of JSON into an XmlRpcValue.
+ */
+class JSONParser
+{
+public:
+    JSONParser(const string& json): _json(json), _pos(0) {}
+
+    void parse(XmlRpc::XmlRpcValue& val)
+    {
+        value(val);
+        skipSpace();
+        if (_pos != _json.length()) error("trailing characters");
+    }
+
+private:
+
+    void error(const string& msg)
+    {
+        ostringstream ost;
+        ost << msg << " at offset " << _pos;
+        throw n_u::ParseException("JSON", ost.str());
+    }
+
+    void skipSpace()
+    {
+        while (_pos < _json.length() && isspace(_json[_pos])) _pos++;
+    }
+
+    char peek()
+    {
+        skipSpace();
+        if (_pos >= _json.length()) error("unexpected end");
+        return _json[_pos];
+    }
+
+    void expect(char c)
+    {
+        if (peek() != c) error(string("expected '") + c + "'");
+        _pos++;
+    }
+
+    bool literal(const char* word)
+    {
+        size_t len = strlen(word);
+        if (_json.compare(_pos, len, word)) return false;
+        _pos += len;
+        return true;
+    }
+
+    void value(XmlRpc::XmlRpcValue& val)
+    {
+        char c = peek();
+        if (c == '{') object(val);
+        else if (c == '[') array(val);
+        else if (c == '"') val = str();
+        else if (literal("true")) val = true;
+        else if (literal("false")) val = false;
+        else if (literal("null")) val = XmlRpc::XmlRpcValue();
+        else number(val);
+    }
+
+    void object(XmlRpc::XmlRpcValue& val)
+    {
+        expect('{');
+        if (peek() == '}') {
+            _pos++;
+            return;
+        }
+        for (;;) {
+            if (peek() != '"') error("expected a member name");
+            string name = str();
+            expect(':');
+            value(val[name]);
+            if (peek() == ',') {
+                _pos++;
+                continue;
+            }
+            expect('}');
+            break;
+        }
+    }
+
+    void array(XmlRpc::XmlRpcValue& val)
+    {
+        expect('[');
+        val.setSize(0);
+        if (peek() == ']') {
+            _pos++;
+            return;
+        }
+        for (int i = 0; ; i++) {
+            value(val[i]);
+            if (peek() == ',') {
+                _pos++;
+                continue;
+            }
+            expect(']');
+            break;
+        }
+    }
+
+    string str()
+    {
+        expect('"');
+        string res;
+        for (;;) {
+            if (_pos >= _json.length()) error("unterminated string");
+            char c = _json[_pos++];
+            if (c == '"') break;
+            if (c != '\\') {
+                res += c;
+                continue;
+            }
+            if (_pos >= _json.length()) error("unterminated string");
+            c = _json[_pos++];
+            switch (c) {
+            case 'n': res += '\n'; break;
+            case 'r': res += '\r'; break;
+            case 't': res += '\t'; break;
+            case 'b': res += '\b'; break;
+            case 'f': res += '\f'; break;
+            case 'u':
+                {
+                    if (_pos + 4 > _json.length()) error("bad \\u escape");
+                    unsigned int u = strtoul(_json.substr(_pos, 4).c_str(),
+                        0, 16);
+                    _pos += 4;
+                    // UTF-8, without surrogate pairs
+                    if (u < 0x80) res += (char) u;
+                    else if (u < 0x800) {
+                        res += (char)(0xc0 | (u >> 6));
+                        res += (char)(0x80 | (u & 0x3f));
+                    }
+                    else {
+                        res += (char)(0xe0 | (u >> 12));
+                        res += (char)(0x80 | ((u >> 6) & 0x3f));
+                        res += (char)(0x80 | (u & 0x3f));
+                    }
+                }
+                break;
+            default: res += c; break;
+            }
+        }
+        return res;
+    }
+
+    void number(XmlRpc::XmlRpcValue& val)
+    {
+        const char* start = _json.c_str() + _pos;
+        char* end;
+        double d = strtod(start, &end);
+        if (end == start) error("unexpected character");
+        string num(start, end - start);
+        _pos += end - start;
+        if (num.find_first_of(".eE") == string::npos &&
+                fabs(d) <= 2147483647.0)
+            val = (int) d;
+        else val = d;
+    }
+
+    const string& _json;
+
+    string::size_type _pos;
+};
+
+/**
+ * Decode %XX and '+' in a URL query component.
+ */
+string urlDecode(const string& str)
+{
+    string res;
+    for (string::size_type i = 0; i < str.length(); i++) {
+        if (str[i] == '+') res += ' ';
+        else if (str[i] == '%' && i + 2 < str.length()) {
+            res += (char) strtol(str.substr(i + 1, 2).c_str(), 0, 16);
+            i += 2;
+        }
+        else res += str[i];
+    }
+    return res;
+}
+
+const char* statusText(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 504: return "Gateway Timeout";
+    default: return "Error";
+    }
+}
+
+string errorBody(const string& msg)
+{
+    return "{\"error\":" + jsonString(msg) + "}";
+}
+
+}
+
+string JsonRpcServer::toJSON(XmlRpc::XmlRpcValue& val)
+{
+    ostringstream ost;
+    switch (val.getType()) {
+    case XmlRpc::XmlRpcValue::TypeBoolean:
+        ost << (static_cast<bool&>(val) ? "true" : "false");
+        break;
+    case XmlRpc::XmlRpcValue::TypeInt:
+        ost << static_cast<int&>(val);
+        break;
+    case XmlRpc::XmlRpcValue::TypeDouble:
+        {
+            double d = static_cast<double&>(val);
+            if (std::isfinite(d)) {
+                ost.precision(10);
+                ost << d;
+            }
+            else ost << "null";
+        }
+        break;
+    case XmlRpc::XmlRpcValue::TypeString:
+        ost << jsonString(static_cast<string&>(val));
+        break;
+    case XmlRpc::XmlRpcValue::TypeDateTime:
+        {
+            struct tm& tm = static_cast<struct tm&>(val);
+            char buf[32];
+            strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+            ost << jsonString(buf);
+        }
+        break;
+    case XmlRpc::XmlRpcValue::TypeArray:
+        ost << '[';
+        for (int i = 0; i < val.size(); i++) {
+            if (i > 0) ost << ',';
+            ost << toJSON(val[i]);
+        }
+        ost << ']';
+        break;
+    case XmlRpc::XmlRpcValue::TypeStruct:
+        {
+            ost << '{';
+            list<string> names = structMemberNames(val);
+            list<string>::const_iterator ni = names.begin();
+            for (int i = 0; ni != names.end(); ++ni, i++) {
+                if (i > 0) ost << ',';
+                ost << jsonString(*ni) << ':' << toJSON(val[*ni]);
+            }
+            ost << '}';
+        }
+        break;
+    default:
+        ost << "null";
+        break;
+    }
+    return ost.str();
+}
+
+void JsonRpcServer::fromJSON(const string& json, XmlRpc::XmlRpcValue& val)
+{
+    JSONParser parser(json);
+    parser.parse(val);
+}
+
+JsonRpcServer::JsonRpcServer(RpcDispatcher* dispatcher,
+        const n_u::Inet4SocketAddress& addr):
+    n_u::Thread("JsonRpcServer"),_dispatcher(dispatcher),
+    _server(new n_u::ServerSocket(addr)),_clients(),_doneMutex(),
+    _doneCalls()
+{
+    if (::pipe(_wakeFds) < 0) {
+        int ierr = errno;
+        delete _server;
+        throw n_u::IOException(getName(), "pipe", ierr);
+    }
+    ::fcntl(_wakeFds[0], F_SETFL, O_NONBLOCK);
+    ::fcntl(_wakeFds[1], F_SETFL, O_NONBLOCK);
+    _server->setNonBlocking(true);
+}
+
+JsonRpcServer::~JsonRpcServer()
+{
+    map<int, Client*>::iterator ci = _clients.begin();
+    for ( ; ci != _clients.end(); ++ci) {
+        delete ci->second->sock;
+        delete ci->second;
+    }
+    try {
+        _server->close();
+    }
+    catch (const n_u::IOException& e) {
+    }
+    delete _server;
+    ::close(_wakeFds[0]);
+    ::close(_wakeFds[1]);
+}
+
+void JsonRpcServer::interrupt()
+{
+    n_u::Thread::interrupt();
+    char c = 0;
+    if (::write(_wakeFds[1], &c, 1) < 0) {}
+}
+
+void JsonRpcServer::rpcDone(shared_ptr<RpcCall> call)
+{
+    n_u::Synchronized autosync(_doneMutex);
+    _doneCalls.push_back(call);
+    char c = 0;
+    if (::write(_wakeFds[1], &c, 1) < 0) {}
+}
+
+int JsonRpcServer::run()
+{
+    ILOG(("%s: listening on port %d", getName().c_str(), getLocalPort()));
+
+    vector<struct pollfd> fds;
+    vector<int> clientFds;
+
+    while (!isInterrupted()) {
+        fds.resize(2 + _clients.size());
+        clientFds.resize(_clients.size());
+        fds[0].fd = _wakeFds[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = _server->getFd();
+        fds[1].events = POLLIN;
+        map<int, Client*>::const_iterator ci = _clients.begin();
+        for (int i = 0; ci != _clients.end(); ++ci, i++) {
+            Client* client = ci->second;
+            fds[i + 2].fd = ci->first;
+            fds[i + 2].events = POLLIN;
+            if (!client->outbuf.empty()) fds[i + 2].events |= POLLOUT;
+            clientFds[i] = ci->first;
+        }
+        for (unsigned int i = 0; i < fds.size(); i++) fds[i].revents = 0;
+
+        int n = ::poll(&fds[0], fds.size(), 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw n_u::IOException(getName(), "poll", errno);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char buf[64];
+            while (::read(_wakeFds[0], buf, sizeof(buf)) > 0);
+        }
+
+        // results of calls
+        list<shared_ptr<RpcCall> > done;
+        {
+            n_u::Synchronized autosync(_doneMutex);
+            done.swap(_doneCalls);
+        }
+        for ( ; !done.empty(); done.pop_front()) {
+            map<int, Client*>::iterator ci = _clients.begin();
+            for ( ; ci != _clients.end(); ++ci) {
+                // a client which timed out or disconnected no
+                // longer refers to the call
+                if (ci->second->call == done.front()) {
+                    respondCall(ci->second);
+                    break;
+                }
+            }
+        }
+
+        for (unsigned int i = 0; i < clientFds.size(); i++) {
+            short revents = fds[i + 2].revents;
+            if (!revents) continue;
+            map<int, Client*>::iterator ci = _clients.find(clientFds[i]);
+            if (ci == _clients.end()) continue;
+            Client* client = ci->second;
+            bool ok = true;
+            if (revents & (POLLIN | POLLHUP | POLLERR))
+                ok = readClient(client);
+            if (ok && (revents & POLLOUT)) ok = writeClient(client);
+            if (!ok) closeClient(clientFds[i]);
+        }
+
+        if (fds[1].revents & POLLIN) acceptClient();
+
+        checkTimeouts();
+    }
+    return RUN_OK;
+}
+
+void JsonRpcServer::acceptClient()
+{
+    n_u::Socket* sock;
+    try {
+        sock = _server->accept();
+    }
+    catch (const n_u::IOException& e) {
+        if (e.getErrno() != EAGAIN && e.getErrno() != EWOULDBLOCK)
+            WLOG(("%s: %s", getName().c_str(), e.what()));
+        return;
+    }
+    if (_clients.size() >= MAX_CLIENTS) {
+        WLOG(("%s: too many clients", getName().c_str()));
+        delete sock;
+        return;
+    }
+    sock->setNonBlocking(true);
+    _clients[sock->getFd()] = new Client(sock);
+}
+
+void JsonRpcServer::closeClient(int fd)
+{
+    map<int, Client*>::iterator ci = _clients.find(fd);
+    if (ci == _clients.end()) return;
+    try {
+        ci->second->sock->close();
+    }
+    catch (const n_u::IOException& e) {
+    }
+    delete ci->second->sock;
+    delete ci->second;
+    _clients.erase(ci);
+}
+
+bool JsonRpcServer::readClient(Client* client)
+{
+    char buf[8192];
+    ssize_t l = ::recv(client->sock->getFd(), buf, sizeof(buf), 0);
+    if (l == 0) return false;
+    if (l < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    client->inbuf.append(buf, l);
+    if (client->inbuf.length() > MAX_REQUEST_LEN) {
+        client->keepAlive = false;
+        client->inbuf.clear();
+        respond(client, 413, errorBody("request too large"));
+        return true;
+    }
+    handleRequest(client);
+    return true;
+}
+
+bool JsonRpcServer::writeClient(Client* client)
+{
+    if (client->outbuf.empty()) return true;
+    ssize_t l = ::send(client->sock->getFd(), client->outbuf.c_str(),
+        client->outbuf.length(), MSG_NOSIGNAL);
+    if (l < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    client->outbuf.erase(0, l);
+    if (client->outbuf.empty()) {
+        if (!client->keepAlive) return false;
+        // next pipelined request
+        handleRequest(client);
+    }
+    return true;
+}
+
+void JsonRpcServer::handleRequest(Client* client)
+{
+    if (client->call || !client->outbuf.empty()) return;
+
+    string::size_type hend = client->inbuf.find("\r\n\r\n");
+    if (hend == string::npos) return;
+
+    istringstream hdrs(client->inbuf.substr(0, hend));
+    string line;
+    getline(hdrs, line);
+    istringstream rline(line);
+    string method, target, version;
+    rline >> method >> target >> version;
+
+    client->keepAlive = version != "HTTP/1.0";
+    size_t clen = 0;
+    while (getline(hdrs, line)) {
+        string::size_type ic = line.find(':');
+        if (ic == string::npos) continue;
+        string name = line.substr(0, ic);
+        string value = line.substr(ic + 1);
+        for (string::iterator si = name.begin(); si != name.end(); ++si)
+            *si = tolower(*si);
+        string::size_type i0 = value.find_first_not_of(" \t");
+        string::size_type i1 = value.find_last_not_of(" \t\r");
+        value = i0 == string::npos ? "" : value.substr(i0, i1 - i0 + 1);
+        if (name == "content-length") clen = strtoul(value.c_str(), 0, 10);
+        else if (name == "connection") {
+            if (!strcasecmp(value.c_str(), "close")) client->keepAlive = false;
+            else if (!strcasecmp(value.c_str(), "keep-alive"))
+                client->keepAlive = true;
+        }
+        else if (name == "transfer-encoding") {
+            client->keepAlive = false;
+            client->inbuf.clear();
+            respond(client, 501, errorBody("transfer encoding not supported"));
+            return;
+        }
+    }
+    if (client->inbuf.length() < hend + 4 + clen) return;
+
+    string body = client->inbuf.substr(hend + 4, clen);
+    client->inbuf.erase(0, hend + 4 + clen);
+
+    string query;
+    string::size_type iq = target.find('?');
+    if (iq != string::npos) {
+        query = target.substr(iq + 1);
+        target = target.substr(0, iq);
+    }
+
+    string rpcMethod;
+    XmlRpc::XmlRpcValue params;
+
+    if (target == "/rpc" || target == "/rpc/") {
+        if (method == "GET") {
+            list<string> names = _dispatcher->getMethodNames();
+            string res = "{\"methods\":[";
+            list<string>::const_iterator ni = names.begin();
+            for (int i = 0; ni != names.end(); ++ni, i++) {
+                if (i > 0) res += ',';
+                res += jsonString(*ni);
+            }
+            respond(client, 200, res + "]}");
+            return;
+        }
+        if (method != "POST") {
+            respond(client, 405, errorBody("use GET or POST"));
+            return;
+        }
+        XmlRpc::XmlRpcValue req;
+        try {
+            fromJSON(body, req);
+        }
+        catch (const n_u::ParseException& e) {
+            respond(client, 400, errorBody(e.what()));
+            return;
+        }
+        if (req.getType() != XmlRpc::XmlRpcValue::TypeStruct ||
+                !req.hasMember("method") ||
+                req["method"].getType() != XmlRpc::XmlRpcValue::TypeString) {
+            respond(client, 400, errorBody("no method in request"));
+            return;
+        }
+        rpcMethod = static_cast<string&>(req["method"]);
+        if (req.hasMember("params")) params = req["params"];
+    }
+    else if (!target.compare(0, 5, "/rpc/") && method == "GET") {
+        rpcMethod = urlDecode(target.substr(5));
+        istringstream qst(query);
+        string arg;
+        while (getline(qst, arg, '&')) {
+            if (arg.empty()) continue;
+            string::size_type ie = arg.find('=');
+            string name = urlDecode(arg.substr(0, ie));
+            params[name] = ie == string::npos ? "" : urlDecode(arg.substr(ie + 1));
+        }
+    }
+    else {
+        respond(client, 404, errorBody("no such resource: " + target));
+        return;
+    }
+
+    if (!_dispatcher->hasMethod(rpcMethod)) {
+        respond(client, 404, errorBody("unknown method " + rpcMethod));
+        return;
+    }
+
+    shared_ptr<RpcCall> call = _dispatcher->submit(rpcMethod, params, this);
+    client->call = call;
+    client->deadline = ::time(0) + (time_t) ceil(call->getTimeout());
+}
+
+void JsonRpcServer::respondCall(Client* client)
+{
+    shared_ptr<RpcCall> call = client->call;
+    client->call.reset();
+    if (call->isFault())
+        respond(client, 500, errorBody(call->getFaultString()));
+    else
+        respond(client, 200, "{\"result\":" + toJSON(call->getResult()) + "}");
+}
+
+void JsonRpcServer::checkTimeouts()
+{
+    time_t now = ::time(0);
+    map<int, Client*>::iterator ci = _clients.begin();
+    for ( ; ci != _clients.end(); ++ci) {
+        Client* client = ci->second;
+        if (!client->call || now < client->deadline) continue;
+        ostringstream ost;
+        ost << client->call->getMethodName() << " timed out after " <<
+            client->call->getTimeout() << " seconds";
+        WLOG(("%s: %s", getName().c_str(), ost.str().c_str()));
+        client->call.reset();
+        respond(client, 504, errorBody(ost.str()));
+    }
+}
+
+void JsonRpcServer::respond(Client* client, int status, const string& body)
+{
+    ostringstream ost;
+    ost << "HTTP/1.1 " << status << ' ' << statusText(status) << "\r\n" <<
+        "Content-Type: application/json\r\n" <<
+        "Content-Length: " << body.length() + 1 << "\r\n" <<
+        "Connection: " << (client->keepAlive ? "keep-alive" : "close") <<
+        "\r\n\r\n" << body << '\n';
+    client->outbuf += ost.str();
+}
@@ -0,0 +1,162 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_CORE_JSONRPCSERVER_H
+#define NIDAS_CORE_JSONRPCSERVER_H
+
+#include "RpcDispatcher.h"
+
+#include <nidas/util/Socket.h>
+#include <nidas/util/Inet4SocketAddress.h>
+#include <nidas/util/ParseException.h>
+
+#include <ctime>
+
+namespace nidas { namespace core {
+
+/**
+ * A small HTTP/1.1 server of the methods of an RpcDispatcher,
+ * with requests and results in JSON, for scripts and for testing
+ * with curl:
+ * @code
+ * curl -s localhost:30009/rpc
+ * curl -s localhost:30009/rpc/DSMAction?action=restart
+ * curl -s -d '{"method":"SensorAction","params":{"device":"/dev/ttyS5"}}' \
+ *      localhost:30009/rpc
+ * @endcode
+ * A GET of /rpc returns the method names, a GET of /rpc/method calls
+ * the method with the query parameters as string members of a struct,
+ * and a POST to /rpc calls a method with the "params" of the posted
+ * object. The response is an object with a "result" member, or with
+ * an "error" member and an HTTP status of 404 for an unknown method,
+ * 400 for a bad request, 500 for a fault of the method and 504 when
+ * the method does not finish within its timeout.
+ *
+ * All connections are served by one thread without blocking,
+ * while the methods execute in the workers of the RpcDispatcher,
+ * so a slow method does not hold up other requests.
+ */
+class JsonRpcServer: public nidas::util::Thread, public RpcCompletion
+{
+public:
+
+    /**
+     * Bind to an address, usually of the loopback interface.
+     *
+     * @throws nidas::util::IOException
+     **/
+    JsonRpcServer(RpcDispatcher* dispatcher,
+        const nidas::util::Inet4SocketAddress& addr);
+
+    ~JsonRpcServer();
+
+    int run();
+
+    void interrupt();
+
+    void rpcDone(std::shared_ptr<RpcCall> call);
+
+    int getLocalPort() const { return _server->getLocalPort(); }
+
+    /**
+     * JSON representation of an XmlRpcValue. Base64 values, and
+     * non-finite doubles, are written as null.
+     */
+    static std::string toJSON(XmlRpc::XmlRpcValue& val);
+
+    /**
+     * Parse a JSON value into an XmlRpcValue. Objects become structs
+     * and numbers without a fraction or exponent become ints.
+     *
+     * @throws nidas::util::ParseException
+     **/
+    static void fromJSON(const std::string& json, XmlRpc::XmlRpcValue& val);
+
+private:
+
+    struct Client {
+        Client(nidas::util::Socket* s):
+            sock(s), inbuf(), outbuf(), call(), deadline(0),
+            keepAlive(true) {}
+        nidas::util::Socket* sock;
+        std::string inbuf;
+        std::string outbuf;
+        std::shared_ptr<RpcCall> call;
+        time_t deadline;
+        bool keepAlive;
+    private:
+        Client(const Client&);
+        Client& operator=(const Client&);
+    };
+
+    void acceptClient();
+
+    /**
+     * @return false if the client should be closed.
+     */
+    bool readClient(Client* client);
+
+    /**
+     * @return false if the client should be closed.
+     */
+    bool writeClient(Client* client);
+
+    /**
+     * Handle a complete request in the input buffer, if there is one
+     * and no call is in progress.
+     */
+    void handleRequest(Client* client);
+
+    void respond(Client* client, int status, const std::string& body);
+
+    void respondCall(Client* client);
+
+    void closeClient(int fd);
+
+    void checkTimeouts();
+
+    RpcDispatcher* _dispatcher;
+
+    nidas::util::ServerSocket* _server;
+
+    std::map<int, Client*> _clients;
+
+    int _wakeFds[2];
+
+    nidas::util::Mutex _doneMutex;
+
+    std::list<std::shared_ptr<RpcCall> > _doneCalls;
+
+    /** No copying. */
+    JsonRpcServer(const JsonRpcServer&);
+
+    /** No assignment. */
+    JsonRpcServer& operator=(const JsonRpcServer&);
+};
+
+}}	// namespace nidas namespace core
+
+#endif
@@ -0,0 +1,313 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "MultiChannelDespiker.h"
+
+#include <cmath>
+
+using namespace nidas::core;
+using namespace std;
+
+MultiChannelDespiker::MultiChannelDespiker(unsigned int nchan):
+    _nchan(0),_prob(1.e-5),_levelMultiplier(2.5),_maxMissingFreq(2.0),
+    _initLevel(0.0),_maxGapUsecs(0),
+    _u1(),_mean1(),_mean2(),_var1(),_var2(),_corr(),_sdev2(),_sdev12(),_level(),
+    _missfreq(),_msize(),_npts(),_ttlast()
+{
+    _initLevel = AdaptiveDespiker::discrLevel(_prob) * _levelMultiplier;
+    setNumChannels(nchan);
+}
+
+void MultiChannelDespiker::setNumChannels(unsigned int val)
+{
+    _nchan = val;
+    _u1.assign(val, 0.0);
+    _mean1.assign(val, 0.0);
+    _mean2.assign(val, 0.0);
+    _var1.assign(val, 0.0);
+    _var2.assign(val, 0.0);
+    _corr.assign(val, 0.0);
+    _sdev2.assign(val, 0.0);
+    _sdev12.assign(val, 0.0);
+    _level.assign(val, _initLevel);
+    _missfreq.assign(val, 0.0);
+    _msize.assign(val, 0);
+    _npts.assign(val, 0);
+    _ttlast.assign(val, 0);
+}
+
+void MultiChannelDespiker::setOutlierProbability(float val)
+{
+    _prob = val;
+    _initLevel = AdaptiveDespiker::discrLevel(_prob) * _levelMultiplier;
+    _level.assign(_nchan, _initLevel);
+}
+
+void MultiChannelDespiker::setDiscLevelMultiplier(float val)
+{
+    _levelMultiplier = val;
+    _initLevel = AdaptiveDespiker::discrLevel(_prob) * _levelMultiplier;
+    _level.assign(_nchan, _initLevel);
+}
+
+void MultiChannelDespiker::reset()
+{
+    for (unsigned int i = 0; i < _nchan; i++) reset(i);
+}
+
+void MultiChannelDespiker::reset(unsigned int i)
+{
+    _npts[i] = 0;
+    _level[i] = _initLevel;
+    _missfreq[i] = 0;
+}
+
+void MultiChannelDespiker::reset(Channel& c) const
+{
+    c.npts = 0;
+    c.level = _initLevel;
+    c.missfreq = 0;
+}
+
+void MultiChannelDespiker::load(unsigned int i, Channel& c) const
+{
+    c.u1 = _u1[i];
+    c.mean1 = _mean1[i];
+    c.mean2 = _mean2[i];
+    c.var1 = _var1[i];
+    c.var2 = _var2[i];
+    c.corr = _corr[i];
+    c.sdev2 = _sdev2[i];
+    c.sdev12 = _sdev12[i];
+    c.level = _level[i];
+    c.missfreq = _missfreq[i];
+    c.msize = _msize[i];
+    c.npts = _npts[i];
+    c.ttlast = _ttlast[i];
+}
+
+void MultiChannelDespiker::store(unsigned int i, const Channel& c)
+{
+    _u1[i] = c.u1;
+    _mean1[i] = c.mean1;
+    _mean2[i] = c.mean2;
+    _var1[i] = c.var1;
+    _var2[i] = c.var2;
+    _corr[i] = c.corr;
+    _sdev2[i] = c.sdev2;
+    _sdev12[i] = c.sdev12;
+    _level[i] = c.level;
+    _missfreq[i] = c.missfreq;
+    _msize[i] = c.msize;
+    _npts[i] = c.npts;
+    _ttlast[i] = c.ttlast;
+}
+
+void MultiChannelDespiker::despike(dsm_time_t tt, float* vals, bool* spikes,
+        bool replace)
+{
+    for (unsigned int i = 0; i < _nchan; i++) {
+        Channel c;
+        load(i, c);
+
+        /* Restart statistics after data gap. */
+        if (_maxGapUsecs > 0 && tt - c.ttlast > _maxGapUsecs) reset(c);
+
+        bool spike = std::isnan(vals[i]);
+        float u = despikeValue(c, vals[i], &spike);
+        if (!spike) c.ttlast = tt;
+        if (replace) vals[i] = u;
+        if (spikes) spikes[i] = spike;
+
+        store(i, c);
+    }
+}
+
+void MultiChannelDespiker::despike(const dsm_time_t* tt, float* const* data,
+        bool* const* spikes, unsigned int n, bool replace)
+{
+    // Local copies of the statistics, so that they are not reloaded
+    // after every store to the data. The channels of a sample are
+    // independent, and are done together so that their computations,
+    // which are long chains of dependent operations, can overlap.
+    vector<Channel> chans(_nchan);
+    for (unsigned int i = 0; i < _nchan; i++) load(i, chans[i]);
+
+    for (unsigned int j = 0; j < n; j++) {
+        for (unsigned int i = 0; i < _nchan; i++) {
+            Channel& c = chans[i];
+            float* vals = data[i];
+
+            if (tt && _maxGapUsecs > 0 && tt[j] - c.ttlast > _maxGapUsecs)
+                reset(c);
+
+            bool spike = std::isnan(vals[j]);
+            float u = despikeValue(c, vals[j], &spike);
+            if (tt && !spike) c.ttlast = tt[j];
+            if (replace) vals[j] = u;
+            if (spikes) spikes[i][j] = spike;
+        }
+    }
+
+    for (unsigned int i = 0; i < _nchan; i++) store(i, chans[i]);
+}
+
+inline float MultiChannelDespiker::despikeValue(Channel& c, float u,
+        bool* spike) const
+{
+    if (c.npts <= STATISTICS_SIZE) {
+        if (c.npts == 0) initStatistics(c, u);
+        else incrementStatistics(c, u);
+        return u;
+    }
+
+    /*
+     * If more than _maxMissingFreq of the recent 10 data points are
+     * missing data points, don't substitute forecasted data or
+     * update forecast statistics.
+     */
+    if (c.missfreq > _maxMissingFreq) return u;
+
+    float uf = c.u1 * c.corr + (1. - c.corr) * c.mean2;
+
+    /*
+     * Check if current point is within the discrimination
+     * level of the forecasted point.  If it isn't, replace the
+     * data point, but don't update the statistics.
+     */
+    if (isnan(u) || fabs(u - uf) / c.sdev2 > c.level) {
+        u = uf;
+        *spike = true;
+    }
+    else updateStatistics(c, u);
+    return u;
+}
+
+void MultiChannelDespiker::initStatistics(Channel& c, float u) const
+{
+    if (isnan(u)) {
+        c.missfreq = 0.1;
+        return;
+    }
+
+    c.missfreq = 0.0;
+
+    /*
+     * Initialize statistics
+     * First point is repeated to compute mean1, var1 and corr
+     */
+    c.mean2 = c.mean1 = u;
+    c.var2 = c.var1 = c.corr = u * u;
+    c.u1 = u;
+    c.npts++;
+}
+
+void MultiChannelDespiker::incrementStatistics(Channel& c, float u) const
+{
+    if (isnan(u)) {
+        c.missfreq = c.missfreq * 0.9 + 0.1;
+        return;
+    }
+
+    c.missfreq *= 0.9;
+
+    c.corr += u * c.u1;		/* just a sum at this point */
+    c.mean2 += u;
+    c.mean1 += c.u1;
+    c.var2 += u * u;
+    c.var1 += c.u1 * c.u1;
+    c.u1 = u;
+
+    /* Finalize statistics */
+    if (c.npts++ == STATISTICS_SIZE) {
+        c.mean2 /= c.npts;
+        c.mean1 /= c.npts;
+        c.var2 = c.var2 / c.npts - c.mean2 * c.mean2;
+        c.var1 = c.var1 / c.npts - c.mean1 * c.mean1;
+        if (c.var1 < 0) c.var1 = 0.;
+        if (c.var2 < 0) c.var2 = 0.;
+
+        c.sdev12 = sqrt(c.var1 * c.var2);
+        c.sdev2 = sqrt(c.var2);
+        c.corr = (c.corr / c.npts - c.mean2 * c.mean1) / c.sdev12;
+
+        if (c.corr > 0.99) c.corr = 0.99;
+        else if (c.corr < -0.99) c.corr = -0.99;
+
+        if (fabs(c.corr) < 1.e-10 && c.corr != 0.0)
+            c.corr *= 1.e-10 / fabs(c.corr);
+
+        c.msize = STATISTICS_SIZE;
+        c.level = _initLevel * AdaptiveDespiker::adjustLevel(fabs(c.corr));
+    }
+}
+
+void MultiChannelDespiker::updateStatistics(Channel& c, float u) const
+{
+    if (isnan(u)) {
+        c.missfreq = c.missfreq * 0.9 + 0.1;
+        return;
+    }
+    c.missfreq *= 0.9;
+
+    /* Convert correlation back to un-normalized covariance */
+    c.corr *= c.sdev12;
+
+    double mx = (c.msize - 1.) / c.msize;
+    c.mean1 = c.mean2;
+    c.mean2 = c.mean2 * mx + u / c.msize;
+    c.corr = c.corr * mx + (u - c.mean2) * (c.u1 - c.mean1) / c.msize;
+    c.var1 = c.var2;
+    c.var2 = c.var2 * mx + (u - c.mean2) * (u - c.mean2) / c.msize;
+    if (c.var2 < 0.) c.var2 = 0.;
+    double v1v2 = c.var1 * c.var2;
+    c.sdev12 = sqrt(v1v2);
+    c.sdev2 = sqrt(c.var2);
+    c.corr = (v1v2 == 0.0) ? 1.0 : c.corr / c.sdev12;
+
+    /*
+     * Due to the running means approximation:
+     *  m(n) = m(n-1) * (m-1)/m + x(n)/m
+     * the correlation can be wrong, so make sure it at least
+     * is within +-1.
+     */
+    if (c.corr > 0.99) c.corr = 0.99;
+    else if (c.corr < -0.99) c.corr = -0.99;
+    if (fabs(c.corr) < 1.e-10 && c.corr != 0.0)
+        c.corr *= 1.e-10 / fabs(c.corr);
+
+    /* Update memory size */
+    if (fabs(c.corr) < .1) c.msize = 100;
+    else
+        c.msize = std::min((size_t)rint(-230.2585 / log(fabs(c.corr))), c.npts);
+
+    /* Every "so often" adjust discrimination level based on correlation */
+    if (c.npts % 25 == 0)
+        c.level = _initLevel * AdaptiveDespiker::adjustLevel(fabs(c.corr));
+
+    c.npts++;
+    c.u1 = u;			/* save previous point */
+}
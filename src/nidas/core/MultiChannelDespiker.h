@@ -0,0 +1,225 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_CORE_MULTICHANNELDESPIKER_H
+#define NIDAS_CORE_MULTICHANNELDESPIKER_H
+
+#include "AdaptiveDespiker.h"
+#include "Sample.h"
+
+#include <vector>
+
+namespace nidas { namespace core {
+
+/**
+ * Adaptive despiking of several channels of a time series together,
+ * such as the u,v,w,tc of a sonic anemometer, or the channels of a
+ * gas analyzer.  Each channel is despiked with the same algorithm,
+ * and the same arithmetic, as an AdaptiveDespiker, so the results
+ * are identical to those of an AdaptiveDespiker per channel.
+ *
+ * The statistics of the channels are kept in arrays, indexed by
+ * channel, rather than in separate objects, and a sample of all the
+ * channels, or a batch of samples, is despiked in one call.
+ *
+ * If time tags are passed, the statistics of a channel are restarted
+ * when the time since its last valid value exceeds getMaxGapUsecs().
+ */
+class MultiChannelDespiker
+{
+public:
+
+    MultiChannelDespiker(unsigned int nchan = 0);
+
+    /**
+     * Set the number of channels, which resets the statistics.
+     */
+    void setNumChannels(unsigned int val);
+
+    unsigned int getNumChannels() const { return _nchan; }
+
+    /**
+     * @see AdaptiveDespiker::setOutlierProbability().
+     */
+    void setOutlierProbability(float val);
+
+    float getOutlierProbability() const { return _prob; }
+
+    /**
+     * @see AdaptiveDespiker::setDiscLevelMultiplier().
+     */
+    void setDiscLevelMultiplier(float val);
+
+    float getDiscLevelMultiplier() const { return _levelMultiplier; }
+
+    /**
+     * Current discrimination level of a channel.
+     */
+    float getDiscLevel(unsigned int ichan) const { return _level[ichan]; }
+
+    /**
+     * Restart the statistics of a channel if its valid values are
+     * more than this far apart in time.  Zero, the default, disables
+     * the check.
+     */
+    void setMaxGapUsecs(long long val) { _maxGapUsecs = val; }
+
+    long long getMaxGapUsecs() const { return _maxGapUsecs; }
+
+    /**
+     * Reset the statistics of all channels.
+     */
+    void reset();
+
+    /**
+     * Reset the statistics of one channel.
+     */
+    void reset(unsigned int ichan);
+
+    /**
+     * Despike one sample of getNumChannels() values.
+     * @param tt Time tag of the sample, for the data gap check.
+     * @param vals Values of the channels.  If @p replace is true,
+     *      spikes are replaced by their forecasts.
+     * @param spikes For each channel, set to true if the value is
+     *      missing or a spike, false otherwise. May be NULL.
+     */
+    void despike(dsm_time_t tt, float* vals, bool* spikes, bool replace = true);
+
+    /**
+     * Despike @p n samples, with the values of each channel in a
+     * separate array.
+     * @param tt Time tags of the samples, for the data gap check.
+     *      May be NULL, in which case there is no check.
+     * @param data Array of getNumChannels() pointers to the values of
+     *      each channel. If @p replace is true, spikes are replaced by
+     *      their forecasts.
+     * @param spikes NULL, or an array of getNumChannels() pointers to
+     *      arrays of n bools, set to true for missing values or spikes.
+     */
+    void despike(const dsm_time_t* tt, float* const* data,
+        bool* const* spikes, unsigned int n, bool replace = true);
+
+private:
+
+    /**
+     * Statistics of one channel, see AdaptiveDespiker.
+     */
+    struct Channel
+    {
+        float u1;
+        double mean1;
+        double mean2;
+        double var1;
+        double var2;
+        double corr;
+        double sdev2;
+        double sdev12;
+        double level;
+        float missfreq;
+        int msize;
+        size_t npts;
+        dsm_time_t ttlast;
+    };
+
+    /**
+     * Copy the statistics of a channel out of the arrays.
+     */
+    void load(unsigned int i, Channel& c) const;
+
+    /**
+     * Copy the statistics of a channel back into the arrays.
+     */
+    void store(unsigned int i, const Channel& c);
+
+    void reset(Channel& c) const;
+
+    /**
+     * Despike one value of a channel, as AdaptiveDespiker::despike().
+     * Return the value or its forecast.
+     */
+    float despikeValue(Channel& c, float u, bool* spike) const;
+
+    void initStatistics(Channel& c, float u) const;
+
+    void incrementStatistics(Channel& c, float u) const;
+
+    void updateStatistics(Channel& c, float u) const;
+
+    static const size_t STATISTICS_SIZE = 100;
+
+    unsigned int _nchan;
+
+    float _prob;
+
+    float _levelMultiplier;
+
+    float _maxMissingFreq;
+
+    double _initLevel;
+
+    long long _maxGapUsecs;
+
+    /*
+     * Statistics of each channel, see AdaptiveDespiker.
+     */
+    std::vector<float> _u1;
+
+    std::vector<double> _mean1;
+
+    std::vector<double> _mean2;
+
+    std::vector<double> _var1;
+
+    std::vector<double> _var2;
+
+    std::vector<double> _corr;
+
+    /**
+     * sqrt(_var2), and sqrt(_var1 * _var2), which are kept
+     * rather than computed again for each value.
+     */
+    std::vector<double> _sdev2;
+
+    std::vector<double> _sdev12;
+
+    std::vector<double> _level;
+
+    std::vector<float> _missfreq;
+
+    std::vector<int> _msize;
+
+    std::vector<size_t> _npts;
+
+    /**
+     * Time of the last valid value of each channel.
+     */
+    std::vector<dsm_time_t> _ttlast;
+};
+
+}}	// namespace nidas namespace core
+
+#endif
@@ -564,6 +564,7 @@ Examples:
   _endTime(UTime::MAX),
   _dataFileNames(),
   _sockAddr(),
+  _shmRingName(),
   _outputFileName(),
   _outputFileLength(0),
   _help(false),
@@ -1018,6 +1019,9 @@ parseInputs(const std::vector<std::string>& inputs_,
       url = url.substr(5);
       _sockAddr.reset(new nidas::util::UnixSocketAddress(url));
     }
+    else if (url.length() > 4 && !url.compare(0,4,"shm:")) {
+      _shmRingName = url.substr(4);
+    }
     else
     {
       _dataFileNames.push_back(url);
@@ -1032,6 +1036,10 @@ parseInputs(const std::vector<std::string>& inputs_,
     {
       msg << "and socket input " << _sockAddr->toAddressString();
     }
+    else if (!_shmRingName.empty())
+    {
+      msg << "and shared memory ring input " << _shmRingName;
+    }
     else
     {
       msg << "and no socket input set.";
@@ -1277,6 +1285,7 @@ updateUsage()
   if (allowSockets)
   {
     oss << "  unix:sockpath       unix socket name\n";
+    oss << "  shm:name            shared memory sample ring name\n";
   }
   if (allowFiles)
   {
@@ -985,7 +985,8 @@ public:
     bool
     inputsProvided()
     {
-        return _dataFileNames.size() > 0  || _sockAddr.get();
+        return _dataFileNames.size() > 0  || _sockAddr.get() ||
+            !_shmRingName.empty();
     }
 
     /**
@@ -1324,6 +1325,17 @@ public:
         return _sockAddr.get();
     }
 
+    /**
+     * If parseInputs() parsed a shared memory ring specifier, shm:name,
+     * then return the name of the ring, otherwise an empty string.
+     * See ShmRingIOChannel.
+     **/
+    const std::string&
+    shmRingName()
+    {
+        return _shmRingName;
+    }
+
     /**
      * Return the hostname passed to the Hostname argument, if any,
      * otherwise return the current hostname as returned by gethostname().
@@ -1468,6 +1480,8 @@ private:
 
     nidas::util::auto_ptr<nidas::util::SocketAddress> _sockAddr;
 
+    std::string _shmRingName;
+
     std::string _outputFileName;
     int _outputFileLength;
 
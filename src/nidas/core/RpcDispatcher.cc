@@ -0,0 +1,301 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "RpcDispatcher.h"
+
+#include <nidas/util/Logger.h>
+#include <xmlrpcpp/XmlRpcException.h>
+
+#include <sstream>
+#include <ctime>
+#include <cmath>
+#include <unistd.h>
+
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+RpcCall::RpcCall(const string& method, const XmlRpc::XmlRpcValue& params,
+        float timeout):
+    _method(method),_params(params),_result(),_fault(false),
+    _faultString(),_timeout(timeout),_cond(),_done(false),_completion(0)
+{
+}
+
+bool RpcCall::isDone() const
+{
+    _cond.lock();
+    bool done = _done;
+    _cond.unlock();
+    return done;
+}
+
+bool RpcCall::wait()
+{
+    struct timespec abstime;
+    ::clock_gettime(CLOCK_REALTIME, &abstime);
+    double secs = floor(_timeout);
+    abstime.tv_sec += (time_t) secs;
+    abstime.tv_nsec += (long)((_timeout - secs) * 1.e9);
+    if (abstime.tv_nsec >= 1000000000L) {
+        abstime.tv_sec++;
+        abstime.tv_nsec -= 1000000000L;
+    }
+
+    _cond.lock();
+    while (!_done) {
+        if (!_cond.timedWait(abstime)) break;
+    }
+    bool done = _done;
+    _cond.unlock();
+    return done;
+}
+
+void RpcCall::setFault(const string& msg)
+{
+    _fault = true;
+    _faultString = msg;
+    _result = msg;
+}
+
+void RpcCall::setDone()
+{
+    _cond.lock();
+    _done = true;
+    _cond.broadcast();
+    _cond.unlock();
+}
+
+RpcDispatcher::Worker::Worker(RpcDispatcher* dispatcher, const string& name):
+    n_u::Thread(name),_dispatcher(dispatcher)
+{
+}
+
+int RpcDispatcher::Worker::run()
+{
+    for (;;) {
+        XmlRpc::XmlRpcServerMethod* method = 0;
+        shared_ptr<RpcCall> call = _dispatcher->nextCall(this, method);
+        if (!call) break;
+
+        try {
+            method->execute(call->getParams(), call->getResult());
+        }
+        catch (const XmlRpc::XmlRpcException& e) {
+            call->setFault(e.getMessage());
+        }
+        catch (const n_u::Exception& e) {
+            call->setFault(e.what());
+        }
+        catch (const std::exception& e) {
+            call->setFault(e.what());
+        }
+        _dispatcher->finished(call);
+    }
+    return RUN_OK;
+}
+
+RpcDispatcher::RpcDispatcher(const string& name, int nworkers):
+    _name(name),_nworkers(std::max(nworkers, 1)),_workers(),_cond(),
+    _methods(),_queue(),_defaultTimeout(10.0),_maxQueue(100),
+    _stopping(false),_ncalls(0),_ntimeouts(0)
+{
+}
+
+RpcDispatcher::~RpcDispatcher()
+{
+    stop();
+}
+
+void RpcDispatcher::addMethod(XmlRpc::XmlRpcServerMethod* method,
+        float timeout, int maxConcurrent)
+{
+    n_u::Synchronized autosync(_cond);
+    MethodEntry& entry = _methods[method->name()];
+    entry.method = method;
+    entry.timeout = timeout;
+    entry.maxConcurrent = maxConcurrent;
+}
+
+bool RpcDispatcher::hasMethod(const string& name) const
+{
+    n_u::Synchronized autosync(_cond);
+    return _methods.find(name) != _methods.end();
+}
+
+list<string> RpcDispatcher::getMethodNames() const
+{
+    n_u::Synchronized autosync(_cond);
+    list<string> names;
+    map<string, MethodEntry>::const_iterator mi = _methods.begin();
+    for ( ; mi != _methods.end(); ++mi) names.push_back(mi->first);
+    return names;
+}
+
+void RpcDispatcher::start()
+{
+    n_u::Synchronized autosync(_cond);
+    if (!_workers.empty()) return;
+    _stopping = false;
+    for (int i = 0; i < _nworkers; i++) {
+        ostringstream ost;
+        ost << _name << "Worker" << i;
+        Worker* worker = new Worker(this, ost.str());
+        _workers.push_back(worker);
+        worker->start();
+    }
+}
+
+void RpcDispatcher::stop()
+{
+    _cond.lock();
+    _stopping = true;
+    vector<Worker*> workers;
+    workers.swap(_workers);
+    for (unsigned int i = 0; i < workers.size(); i++)
+        workers[i]->interrupt();
+    _cond.broadcast();
+    _cond.unlock();
+
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        Worker* worker = workers[i];
+        // give a worker which is executing a method a moment to finish
+        for (int j = 0; j < 10 && worker->isRunning(); j++) ::usleep(100000);
+        try {
+            if (worker->isRunning()) {
+                WLOG(("%s: cancelling %s, which is blocked in a method",
+                      _name.c_str(), worker->getName().c_str()));
+                worker->cancel();
+            }
+            worker->join();
+        }
+        catch (const n_u::Exception& e) {
+            WLOG(("%s: %s", worker->getName().c_str(), e.what()));
+        }
+        delete worker;
+    }
+
+    // fail the calls which never ran
+    _cond.lock();
+    list<shared_ptr<RpcCall> > queue;
+    queue.swap(_queue);
+    _cond.unlock();
+    list<shared_ptr<RpcCall> >::iterator ci = queue.begin();
+    for ( ; ci != queue.end(); ++ci) {
+        (*ci)->setFault("stopping");
+        (*ci)->setDone();
+        if ((*ci)->_completion) (*ci)->_completion->rpcDone(*ci);
+    }
+}
+
+shared_ptr<RpcCall> RpcDispatcher::submit(const string& method,
+        const XmlRpc::XmlRpcValue& params, RpcCompletion* completion)
+{
+    _cond.lock();
+    float timeout = _defaultTimeout;
+    string fault;
+    map<string, MethodEntry>::const_iterator mi = _methods.find(method);
+    if (mi == _methods.end()) fault = "unknown method " + method;
+    else {
+        if (mi->second.timeout > 0.0) timeout = mi->second.timeout;
+        if (_queue.size() >= _maxQueue) fault = "too many requests";
+        else if (_stopping || _workers.empty()) fault = "not running";
+    }
+
+    shared_ptr<RpcCall> call(new RpcCall(method, params, timeout));
+    call->_completion = completion;
+
+    if (fault.empty()) {
+        _ncalls++;
+        _queue.push_back(call);
+        _cond.broadcast();
+        _cond.unlock();
+        return call;
+    }
+    _cond.unlock();
+
+    WLOG(("%s: %s", _name.c_str(), fault.c_str()));
+    call->setFault(fault);
+    call->setDone();
+    if (completion) completion->rpcDone(call);
+    return call;
+}
+
+bool RpcDispatcher::execute(const string& method,
+        XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result)
+{
+    shared_ptr<RpcCall> call = submit(method, params);
+    if (!call->wait()) {
+        _cond.lock();
+        _ntimeouts++;
+        _cond.unlock();
+        ostringstream ost;
+        ost << method << " timed out after " << call->getTimeout() <<
+            " seconds";
+        WLOG(("%s: %s", _name.c_str(), ost.str().c_str()));
+        result = ost.str();
+        return false;
+    }
+    result = call->getResult();
+    return !call->isFault();
+}
+
+shared_ptr<RpcCall> RpcDispatcher::nextCall(Worker* worker,
+        XmlRpc::XmlRpcServerMethod*& method)
+{
+    n_u::Synchronized autosync(_cond);
+    for (;;) {
+        if (_stopping || worker->isInterrupted())
+            return shared_ptr<RpcCall>();
+
+        list<shared_ptr<RpcCall> >::iterator ci = _queue.begin();
+        for ( ; ci != _queue.end(); ++ci) {
+            MethodEntry& entry = _methods[(*ci)->getMethodName()];
+            int maxc = entry.maxConcurrent > 0 ? entry.maxConcurrent :
+                std::max(_nworkers - 1, 1);
+            if (entry.active < maxc) {
+                entry.active++;
+                method = entry.method;
+                shared_ptr<RpcCall> call = *ci;
+                _queue.erase(ci);
+                return call;
+            }
+        }
+        _cond.wait();
+    }
+}
+
+void RpcDispatcher::finished(shared_ptr<RpcCall> call)
+{
+    call->setDone();
+    if (call->_completion) call->_completion->rpcDone(call);
+
+    n_u::Synchronized autosync(_cond);
+    _methods[call->getMethodName()].active--;
+    // a queued call of this method may now run
+    _cond.broadcast();
+}
@@ -0,0 +1,282 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_CORE_RPCDISPATCHER_H
+#define NIDAS_CORE_RPCDISPATCHER_H
+
+#include <nidas/util/Thread.h>
+#include <nidas/util/ThreadSupport.h>
+#include <xmlrpcpp/XmlRpc.h>
+
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
+#include <memory>
+
+namespace nidas { namespace core {
+
+class RpcCall;
+
+/**
+ * Notified when an RpcCall submitted to an RpcDispatcher is done.
+ */
+class RpcCompletion
+{
+public:
+    virtual ~RpcCompletion() {}
+
+    /**
+     * Called from the worker thread which executed the call.
+     */
+    virtual void rpcDone(std::shared_ptr<RpcCall> call) = 0;
+};
+
+/**
+ * A call of a method by an RpcDispatcher, its parameters and result.
+ */
+class RpcCall
+{
+public:
+
+    RpcCall(const std::string& method, const XmlRpc::XmlRpcValue& params,
+        float timeout);
+
+    const std::string& getMethodName() const { return _method; }
+
+    XmlRpc::XmlRpcValue& getParams() { return _params; }
+
+    /**
+     * Result of the method, which is only valid once isDone().
+     */
+    XmlRpc::XmlRpcValue& getResult() { return _result; }
+
+    /**
+     * The method threw an XmlRpc::XmlRpcException or was not found,
+     * and getFaultString() says why.
+     */
+    bool isFault() const { return _fault; }
+
+    const std::string& getFaultString() const { return _faultString; }
+
+    /**
+     * Seconds that a caller should wait for the result.
+     */
+    float getTimeout() const { return _timeout; }
+
+    bool isDone() const;
+
+    /**
+     * Wait for the method to finish, at most getTimeout() seconds.
+     * @return isDone()
+     */
+    bool wait();
+
+private:
+
+    friend class RpcDispatcher;
+
+    void setFault(const std::string& msg);
+
+    void setDone();
+
+    std::string _method;
+
+    XmlRpc::XmlRpcValue _params;
+
+    XmlRpc::XmlRpcValue _result;
+
+    bool _fault;
+
+    std::string _faultString;
+
+    float _timeout;
+
+    mutable nidas::util::Cond _cond;
+
+    bool _done;
+
+    RpcCompletion* _completion;
+
+    /** No copying. */
+    RpcCall(const RpcCall&);
+
+    /** No assignment. */
+    RpcCall& operator=(const RpcCall&);
+};
+
+/**
+ * Executes the XmlRpc::XmlRpcServerMethods of a control interface in a
+ * pool of worker threads, so that a method which blocks, such as a
+ * DSMSensor::executeXmlRpc() doing serial I/O, does not hold up
+ * requests of other methods.
+ *
+ * Each method has a timeout, the time a caller waits for its result.
+ * A method which takes longer is left to finish in its worker, and
+ * its result is discarded. So that one method cannot occupy all the
+ * workers, the calls of a method in progress are limited, by default
+ * to one less than the number of workers, and later calls of it wait
+ * in the queue while calls of other methods proceed.
+ *
+ * The methods are not owned by the RpcDispatcher.  They should be
+ * constructed with a NULL XmlRpc::XmlRpcServer, and be reached
+ * through XmlRpcThread::addMethod(), which serves them from the
+ * XML-RPC server and the JSON over HTTP server.
+ */
+class RpcDispatcher
+{
+public:
+
+    RpcDispatcher(const std::string& name, int nworkers = 4);
+
+    /**
+     * Stops the workers.
+     */
+    ~RpcDispatcher();
+
+    /**
+     * @param timeout Seconds to wait for a result of the method,
+     *      0 for the default timeout.
+     * @param maxConcurrent Maximum number of calls of the method
+     *      in progress, 0 for one less than the number of workers.
+     */
+    void addMethod(XmlRpc::XmlRpcServerMethod* method, float timeout = 0.0,
+        int maxConcurrent = 0);
+
+    bool hasMethod(const std::string& name) const;
+
+    std::list<std::string> getMethodNames() const;
+
+    void setDefaultTimeout(float val) { _defaultTimeout = val; }
+
+    float getDefaultTimeout() const { return _defaultTimeout; }
+
+    /**
+     * Calls which may wait in the queue, beyond which they are
+     * refused.
+     */
+    void setMaxQueueLength(unsigned int val) { _maxQueue = val; }
+
+    /**
+     * Start the worker threads.
+     */
+    void start();
+
+    /**
+     * Interrupt and join the worker threads. Workers blocked in a
+     * method are cancelled after a second.
+     */
+    void stop();
+
+    /**
+     * Queue a call of a method, and return without waiting for it.
+     * If the method is not known, or the queue is full, the
+     * returned call is done, and a fault.
+     * @param completion If non-NULL, notified when the call is done.
+     */
+    std::shared_ptr<RpcCall> submit(const std::string& method,
+        const XmlRpc::XmlRpcValue& params, RpcCompletion* completion = 0);
+
+    /**
+     * Execute a method and wait up to its timeout for the result.
+     * @return false if the method timed out, or is a fault,
+     *      in which case result is the error message.
+     */
+    bool execute(const std::string& method, XmlRpc::XmlRpcValue& params,
+        XmlRpc::XmlRpcValue& result);
+
+    const std::string& getName() const { return _name; }
+
+    long long getNumCalls() const { return _ncalls; }
+
+    long long getNumTimeouts() const { return _ntimeouts; }
+
+private:
+
+    struct MethodEntry {
+        MethodEntry(): method(0), timeout(0.0), maxConcurrent(0), active(0) {}
+        XmlRpc::XmlRpcServerMethod* method;
+        float timeout;
+        int maxConcurrent;
+        int active;
+    };
+
+    class Worker: public nidas::util::Thread
+    {
+    public:
+        Worker(RpcDispatcher* dispatcher, const std::string& name);
+        int run();
+    private:
+        RpcDispatcher* _dispatcher;
+        Worker(const Worker&);
+        Worker& operator=(const Worker&);
+    };
+
+    /**
+     * Wait for a call which can run.
+     * @return NULL if interrupted.
+     */
+    std::shared_ptr<RpcCall> nextCall(Worker* worker,
+        XmlRpc::XmlRpcServerMethod*& method);
+
+    void finished(std::shared_ptr<RpcCall> call);
+
+    std::string _name;
+
+    int _nworkers;
+
+    std::vector<Worker*> _workers;
+
+    /**
+     * Protects the methods, the queue and the counts, and
+     * signals workers that there is work.
+     */
+    mutable nidas::util::Cond _cond;
+
+    std::map<std::string, MethodEntry> _methods;
+
+    std::list<std::shared_ptr<RpcCall> > _queue;
+
+    float _defaultTimeout;
+
+    unsigned int _maxQueue;
+
+    bool _stopping;
+
+    long long _ncalls;
+
+    long long _ntimeouts;
+
+    /** No copying. */
+    RpcDispatcher(const RpcDispatcher&);
+
+    /** No assignment. */
+    RpcDispatcher& operator=(const RpcDispatcher&);
+};
+
+}}	// namespace nidas namespace core
+
+#endif
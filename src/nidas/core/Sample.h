@@ -356,6 +356,25 @@ public:
      */
     virtual void freeReference() const = 0;
 
+    /**
+     * Current reference count, for a holder of a reference to
+     * know whether it is the only holder.
+     */
+    int getReferenceCount() const {
+#ifdef USE_ATOMIC_REF_COUNT
+        return __sync_add_and_fetch(&_refCount,0);
+#else
+#ifdef MUTEX_PROTECT_REF_COUNTS
+	_refLock.lock();
+#endif
+        int n = _refCount;
+#ifdef MUTEX_PROTECT_REF_COUNTS
+	_refLock.unlock();
+#endif
+        return n;
+#endif
+    }
+
 protected:
 
     SampleHeader _header;
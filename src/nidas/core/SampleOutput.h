@@ -63,6 +63,15 @@ public:
 
     virtual bool isRaw() const = 0;
 
+    /**
+     * Should the original SampleOutput receive samples while it is
+     * not connected, so that it can save them until it is?  If so,
+     * a SampleConnectionRequester such as DSMEngine keeps the original
+     * as a client of the SampleSource until the connection is made,
+     * and again after a connection is lost.
+     */
+    virtual bool isSpooling() const { return false; }
+
     /**
      * Some SampleOutputs don't send out all the Samples that
      * they receive.  At configuration time, one can use
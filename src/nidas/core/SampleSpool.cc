@@ -0,0 +1,431 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "SampleSpool.h"
+
+#include <nidas/util/FileSet.h>
+#include <nidas/util/Logger.h>
+
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+#include <byteswap.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+namespace {
+
+/**
+ * Samples are buffered in memory until this many bytes are waiting,
+ * or a reader catches up to the writer.
+ */
+const size_t WRITE_BUFFER_LEN = 65536;
+
+/**
+ * Save the read position after this many bytes have been popped.
+ */
+const long long SYNC_BYTES = 1000000;
+
+}
+
+SampleSpool::SampleSpool(const string& dir, long long maxBytes,
+        size_t segmentBytes):
+    _mutex(),_dir(dir),_maxBytes(maxBytes),
+    _segmentBytes(segmentBytes),_open(false),_segments(),
+    _wfd(-1),_wbuf(),_rfd(-1),_rseg(0),_roffset(0),
+    _front(0),_frontLen(0),_frontDropped(false),_totalBytes(0),
+    _nappended(0),_npopped(0),_nbytesDropped(0),_unsyncedBytes(0)
+{
+    // Keep at least four segments in the spool, so that dropping
+    // the oldest one doesn't discard too much.
+    if (_maxBytes > 0 && (long long)_segmentBytes * 4 > _maxBytes)
+        _segmentBytes = std::max(_maxBytes / 4, (long long)WRITE_BUFFER_LEN);
+    _wbuf.reserve(WRITE_BUFFER_LEN + 1024);
+}
+
+SampleSpool::~SampleSpool()
+{
+    try {
+        close();
+    }
+    catch (const n_u::IOException& e) {
+        WLOG(("%s", e.what()));
+    }
+}
+
+string SampleSpool::segmentPath(unsigned int num) const
+{
+    char fname[32];
+    snprintf(fname, sizeof(fname), "spool_%08u.dat", num);
+    return _dir + '/' + fname;
+}
+
+string SampleSpool::cursorPath() const
+{
+    return _dir + "/cursor";
+}
+
+void SampleSpool::open()
+{
+    n_u::Autolock autolock(_mutex);
+    if (_open) return;
+
+    n_u::FileSet::createDirectory(_dir, 0775);
+
+    DIR* dirp = ::opendir(_dir.c_str());
+    if (!dirp) throw n_u::IOException(_dir, "opendir", errno);
+
+    vector<unsigned int> nums;
+    struct dirent* dp;
+    while ((dp = ::readdir(dirp))) {
+        unsigned int num;
+        char c;
+        if (sscanf(dp->d_name, "spool_%u.da%c", &num, &c) == 2 && c == 't')
+            nums.push_back(num);
+    }
+    ::closedir(dirp);
+    std::sort(nums.begin(), nums.end());
+
+    unsigned int cseg = 0;
+    long long coffset = 0;
+    ifstream cursor(cursorPath().c_str());
+    if (cursor) {
+        cursor >> cseg >> coffset;
+        if (cursor.fail()) cseg = coffset = 0;
+    }
+
+    _segments.clear();
+    _totalBytes = 0;
+    for (unsigned int i = 0; i < nums.size(); i++) {
+        string path = segmentPath(nums[i]);
+        // segments before the cursor have already been read
+        if (nums[i] < cseg) {
+            ::unlink(path.c_str());
+            continue;
+        }
+        struct stat statbuf;
+        if (::stat(path.c_str(), &statbuf) < 0)
+            throw n_u::IOException(path, "stat", errno);
+        Segment seg = { nums[i], (long long)statbuf.st_size };
+        _segments.push_back(seg);
+        _totalBytes += seg.size;
+    }
+
+    _roffset = 0;
+    if (!_segments.empty()) {
+        _rseg = _segments.front().num;
+        if (_rseg == cseg) {
+            _roffset = std::min(coffset, _segments.front().size);
+            _totalBytes -= _roffset;
+        }
+        ILOG(("%s: resuming with %lld bytes in %zd segments",
+              _dir.c_str(), _totalBytes, _segments.size()));
+    }
+
+    // Always append to a new segment, in case the last one
+    // ended with a partial sample.
+    startSegment();
+    if (_segments.size() == 1) _rseg = _segments.front().num;
+    _open = true;
+}
+
+void SampleSpool::startSegment()
+{
+    if (_wfd >= 0) {
+        flushWrite();
+        ::close(_wfd);
+        _wfd = -1;
+    }
+    Segment seg = { _segments.empty() ? 1 : _segments.back().num + 1, 0 };
+    string path = segmentPath(seg.num);
+    _wfd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    if (_wfd < 0) throw n_u::IOException(path, "open", errno);
+    _segments.push_back(seg);
+}
+
+void SampleSpool::flushWrite()
+{
+    const char* bp = _wbuf.empty() ? 0 : &_wbuf.front();
+    size_t len = _wbuf.size();
+    while (len > 0) {
+        ssize_t l = ::write(_wfd, bp, len);
+        if (l < 0) {
+            if (errno == EINTR) continue;
+            throw n_u::IOException(segmentPath(_segments.back().num),
+                    "write", errno);
+        }
+        bp += l;
+        len -= l;
+    }
+    _wbuf.clear();
+}
+
+void SampleSpool::append(const Sample* samp)
+{
+    n_u::Autolock autolock(_mutex);
+    if (!_open) return;
+
+    size_t dlen = samp->getDataByteLength();
+    size_t len = SampleHeader::getSizeOf() + dlen;
+
+    if (_segments.back().size > 0 &&
+            _segments.back().size + (long long)len > (long long)_segmentBytes)
+        startSegment();
+
+    while (_maxBytes > 0 && _totalBytes + (long long)len > _maxBytes &&
+            _segments.size() > 1)
+        dropOldest();
+
+    SampleHeader header;
+    header.setTimeTag(samp->getTimeTag());
+    header.setDataByteLength(dlen);
+    header.setRawId(samp->getRawId());
+    if (__BYTE_ORDER == __BIG_ENDIAN) {
+        header.setTimeTag(bswap_64(header.getTimeTag()));
+        header.setDataByteLength(bswap_32(header.getDataByteLength()));
+        header.setRawId(bswap_32(header.getRawId()));
+    }
+    const char* hp = (const char*)&header;
+    const char* dp = (const char*)samp->getConstVoidDataPtr();
+    _wbuf.insert(_wbuf.end(), hp, hp + SampleHeader::getSizeOf());
+    _wbuf.insert(_wbuf.end(), dp, dp + dlen);
+
+    _segments.back().size += len;
+    _totalBytes += len;
+    _nappended++;
+
+    if (_wbuf.size() >= WRITE_BUFFER_LEN) flushWrite();
+}
+
+void SampleSpool::dropOldest()
+{
+    Segment seg = _segments.front();
+    long long dropped = seg.size;
+    if (seg.num == _rseg) {
+        dropped -= _roffset;
+        // A reader may still be using the sample returned by front(),
+        // so it is kept, and freed by pop().
+        if (_front) {
+            dropped -= _frontLen;
+            _frontDropped = true;
+        }
+        if (_rfd >= 0) ::close(_rfd);
+        _rfd = -1;
+    }
+    ::unlink(segmentPath(seg.num).c_str());
+    _segments.pop_front();
+    _rseg = _segments.front().num;
+    _roffset = 0;
+    _totalBytes -= dropped;
+    _nbytesDropped += dropped;
+    WLOG(("%s: spool exceeds %lld bytes, %lld bytes of oldest samples "
+          "dropped, %lld total", _dir.c_str(), _maxBytes, dropped,
+          _nbytesDropped));
+}
+
+void SampleSpool::nextReadSegment()
+{
+    if (_rfd >= 0) ::close(_rfd);
+    _rfd = -1;
+    if (_segments.size() < 2) return;
+
+    Segment seg = _segments.front();
+    if (_roffset < seg.size) {
+        WLOG(("%s: skipping %lld bytes at end of segment",
+              segmentPath(seg.num).c_str(), seg.size - _roffset));
+        _totalBytes -= seg.size - _roffset;
+        _nbytesDropped += seg.size - _roffset;
+    }
+    ::unlink(segmentPath(seg.num).c_str());
+    _segments.pop_front();
+    _rseg = _segments.front().num;
+    _roffset = 0;
+}
+
+bool SampleSpool::readBytes(void* buf, size_t n)
+{
+    if (_rfd < 0) {
+        string path = segmentPath(_rseg);
+        _rfd = ::open(path.c_str(), O_RDONLY);
+        if (_rfd < 0) throw n_u::IOException(path, "open", errno);
+    }
+    char* bp = (char*) buf;
+    off_t off = _roffset;
+    while (n > 0) {
+        ssize_t l = ::pread(_rfd, bp, n, off);
+        if (l < 0) {
+            if (errno == EINTR) continue;
+            throw n_u::IOException(segmentPath(_rseg), "read", errno);
+        }
+        if (l == 0) return false;
+        bp += l;
+        off += l;
+        n -= l;
+    }
+    return true;
+}
+
+const Sample* SampleSpool::front()
+{
+    n_u::Autolock autolock(_mutex);
+    if (_front || !_open) return _front;
+
+    for (;;) {
+        bool writing = _segments.size() == 1;
+        if (writing) {
+            if (_roffset >= _segments.front().size) return 0;
+            if (!_wbuf.empty()) flushWrite();
+        }
+
+        SampleHeader header;
+        if (!readBytes(&header, SampleHeader::getSizeOf())) {
+            if (writing) return 0;
+            nextReadSegment();
+            continue;
+        }
+        if (__BYTE_ORDER == __BIG_ENDIAN) {
+            header.setTimeTag(bswap_64(header.getTimeTag()));
+            header.setDataByteLength(bswap_32(header.getDataByteLength()));
+            header.setRawId(bswap_32(header.getRawId()));
+        }
+
+        size_t dlen = header.getDataByteLength();
+        Sample* samp = getSample((sampleType)header.getType(), dlen);
+        if (!samp) {
+            WLOG(("%s: bad sample header at offset %lld, type=%d, len=%zd",
+                  segmentPath(_rseg).c_str(), _roffset,
+                  (int)header.getType(), dlen));
+            if (writing) {
+                _totalBytes -= _segments.front().size - _roffset;
+                _roffset = _segments.front().size;
+                return 0;
+            }
+            nextReadSegment();
+            continue;
+        }
+
+        _roffset += SampleHeader::getSizeOf();
+        bool ok = readBytes(samp->getVoidDataPtr(), dlen);
+        _roffset -= SampleHeader::getSizeOf();
+        if (!ok) {
+            samp->freeReference();
+            if (writing) return 0;
+            nextReadSegment();
+            continue;
+        }
+        samp->setTimeTag(header.getTimeTag());
+        samp->setId(header.getId());
+        _front = samp;
+        _frontLen = SampleHeader::getSizeOf() + dlen;
+        return _front;
+    }
+}
+
+void SampleSpool::pop()
+{
+    n_u::Autolock autolock(_mutex);
+    if (!_front) return;
+
+    _front->freeReference();
+    _front = 0;
+    // if its segment was dropped, the read position is already
+    // at the start of the next one
+    if (!_frontDropped) _roffset += _frontLen;
+    _frontDropped = false;
+    _totalBytes -= _frontLen;
+    _unsyncedBytes += _frontLen;
+    _npopped++;
+
+    if (_segments.size() > 1 && _roffset >= _segments.front().size)
+        nextReadSegment();
+
+    if (_unsyncedBytes >= SYNC_BYTES) syncUnlocked();
+}
+
+bool SampleSpool::empty() const
+{
+    n_u::Autolock autolock(_mutex);
+    return !_front && _totalBytes <= 0;
+}
+
+long long SampleSpool::getPendingBytes() const
+{
+    n_u::Autolock autolock(_mutex);
+    return _totalBytes;
+}
+
+void SampleSpool::sync()
+{
+    n_u::Autolock autolock(_mutex);
+    if (_open) syncUnlocked();
+}
+
+void SampleSpool::syncUnlocked()
+{
+    string path = cursorPath();
+    string tmppath = path + ".tmp";
+    {
+        ofstream cursor(tmppath.c_str(), ios::out | ios::trunc);
+        cursor << _rseg << ' ' << _roffset << endl;
+        if (cursor.fail()) throw n_u::IOException(tmppath, "write", errno);
+    }
+    if (::rename(tmppath.c_str(), path.c_str()) < 0)
+        throw n_u::IOException(path, "rename", errno);
+    _unsyncedBytes = 0;
+}
+
+void SampleSpool::close()
+{
+    n_u::Autolock autolock(_mutex);
+    if (!_open) return;
+    _open = false;
+
+    if (_front) _front->freeReference();
+    _front = 0;
+    _frontDropped = false;
+    if (_rfd >= 0) ::close(_rfd);
+    _rfd = -1;
+
+    flushWrite();
+    ::close(_wfd);
+    _wfd = -1;
+    if (_segments.back().size == 0) {
+        ::unlink(segmentPath(_segments.back().num).c_str());
+        _segments.pop_back();
+    }
+    if (_segments.empty()) ::unlink(cursorPath().c_str());
+    else syncUnlocked();
+    _segments.clear();
+}
@@ -0,0 +1,260 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_CORE_SAMPLESPOOL_H
+#define NIDAS_CORE_SAMPLESPOOL_H
+
+#include "Sample.h"
+
+#include <nidas/util/IOException.h>
+#include <nidas/util/ThreadSupport.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+
+namespace nidas { namespace core {
+
+/**
+ * A bounded first-in, first-out journal of samples on local disk.
+ *
+ * Samples are appended to a sequence of segment files in a directory,
+ * named spool_NNNNNNNN.dat, in the format of a NIDAS archive without
+ * the SampleInputHeader: a little-endian SampleHeader followed by the
+ * sample data.  Samples are read back in the order they were appended
+ * with front() and pop(). A segment file is removed once it has been
+ * completely read.
+ *
+ * The read position is saved in a file named "cursor" in the directory
+ * every so often and when the spool is closed, so that if the process
+ * is restarted, reading resumes close to where it left off. Some samples
+ * may be read again after a restart, but none are skipped.
+ *
+ * If appending a sample would exceed the maximum size of the spool, the
+ * oldest segment is removed, and the number of bytes dropped is counted.
+ *
+ * The methods are synchronized, so one thread can append while another
+ * reads.
+ */
+class SampleSpool
+{
+public:
+
+    /**
+     * @param dir Directory for the segment files, created if necessary.
+     * @param maxBytes Maximum number of bytes in the spool.
+     * @param segmentBytes Size at which a new segment file is started.
+     */
+    SampleSpool(const std::string& dir, long long maxBytes,
+            size_t segmentBytes = 4000000);
+
+    /**
+     * Closes the spool, saving the read position.
+     */
+    ~SampleSpool();
+
+    const std::string& getDirectory() const { return _dir; }
+
+    long long getMaxBytes() const { return _maxBytes; }
+
+    /**
+     * Create the directory if necessary, and resume from any segments
+     * and cursor left in it. Appending always starts a new segment.
+     *
+     * @throws nidas::util::IOException
+     */
+    void open();
+
+    /**
+     * Write out buffered samples, save the read position
+     * and close the segment files.
+     *
+     * @throws nidas::util::IOException
+     */
+    void close();
+
+    bool isOpen() const { return _open; }
+
+    /**
+     * Append a sample to the spool.
+     *
+     * @throws nidas::util::IOException
+     */
+    void append(const Sample* samp);
+
+    /**
+     * The oldest sample in the spool, or NULL if it is empty.  The
+     * spool holds a reference to the sample until pop() is called,
+     * so a client should call holdReference() if it needs the sample
+     * after that.  The sample stays valid until pop(), even if
+     * append() in another thread drops its segment.
+     *
+     * @throws nidas::util::IOException
+     */
+    const Sample* front();
+
+    /**
+     * Remove the sample returned by front().
+     *
+     * @throws nidas::util::IOException
+     */
+    void pop();
+
+    /**
+     * Nothing left to read.
+     */
+    bool empty() const;
+
+    /**
+     * Number of bytes that have been appended and not yet popped,
+     * approximately the disk space used by the spool.
+     */
+    long long getPendingBytes() const;
+
+    long long getNumSamplesAppended() const { return _nappended; }
+
+    long long getNumSamplesPopped() const { return _npopped; }
+
+    /**
+     * Number of bytes removed because the spool exceeded its maximum size.
+     */
+    long long getNumBytesDropped() const { return _nbytesDropped; }
+
+    /**
+     * Save the read position to the cursor file.
+     *
+     * @throws nidas::util::IOException
+     */
+    void sync();
+
+private:
+
+    struct Segment {
+        unsigned int num;
+        long long size;
+    };
+
+    std::string segmentPath(unsigned int num) const;
+
+    std::string cursorPath() const;
+
+    /**
+     * @throws nidas::util::IOException
+     */
+    void flushWrite();
+
+    /**
+     * @throws nidas::util::IOException
+     */
+    void startSegment();
+
+    /**
+     * Remove the oldest segment.
+     * @throws nidas::util::IOException
+     */
+    void dropOldest();
+
+    /**
+     * Move the read position to the beginning of the next segment.
+     * @throws nidas::util::IOException
+     */
+    void nextReadSegment();
+
+    /**
+     * Read n bytes at the read position.
+     * @return false if fewer than n bytes are available in the segment.
+     * @throws nidas::util::IOException
+     */
+    bool readBytes(void* buf, size_t n);
+
+    /**
+     * @throws nidas::util::IOException
+     */
+    void syncUnlocked();
+
+    mutable nidas::util::Mutex _mutex;
+
+    std::string _dir;
+
+    long long _maxBytes;
+
+    size_t _segmentBytes;
+
+    bool _open;
+
+    /**
+     * Segments on disk, oldest first. The last one is being written.
+     */
+    std::deque<Segment> _segments;
+
+    int _wfd;
+
+    /**
+     * Samples not yet written to the current segment.
+     */
+    std::vector<char> _wbuf;
+
+    int _rfd;
+
+    /**
+     * Segment number and offset of the next sample to read.
+     */
+    unsigned int _rseg;
+
+    long long _roffset;
+
+    /**
+     * Sample returned by front(), and its length in the spool.
+     */
+    Sample* _front;
+
+    size_t _frontLen;
+
+    /**
+     * The segment of _front was dropped while a reader held it.
+     */
+    bool _frontDropped;
+
+    long long _totalBytes;
+
+    long long _nappended;
+
+    long long _npopped;
+
+    long long _nbytesDropped;
+
+    long long _unsyncedBytes;
+
+    /** No copying. */
+    SampleSpool(const SampleSpool&);
+
+    /** No assignment. */
+    SampleSpool& operator=(const SampleSpool&);
+};
+
+}}	// namespace nidas namespace core
+
+#endif
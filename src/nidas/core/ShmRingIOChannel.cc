@@ -0,0 +1,252 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "ShmRingIOChannel.h"
+#include "ShmSampleRing.h"
+
+#include <nidas/util/Logger.h>
+#include <nidas/util/Process.h>
+#include <nidas/util/InvalidParameterException.h>
+
+#include <cstring>
+#include <sstream>
+
+#include <time.h>
+
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+ShmRingIOChannel::ShmRingIOChannel():
+    IOChannel(),_name("shmring"),_ringName(),_ringSize(16000000),
+    _writer(false),_nonBlocking(false),_newInput(false),_needHeader(true),
+    _ring(0),_header(),_pending(),_pendingOffset(0),_lastOverruns(0)
+{
+}
+
+ShmRingIOChannel::ShmRingIOChannel(const string& ringName, bool writer):
+    IOChannel(),_name(),_ringName(),_ringSize(16000000),
+    _writer(writer),_nonBlocking(false),_newInput(false),_needHeader(true),
+    _ring(0),_header(),_pending(),_pendingOffset(0),_lastOverruns(0)
+{
+    setRingName(ringName);
+}
+
+ShmRingIOChannel::~ShmRingIOChannel()
+{
+    delete _ring;
+}
+
+ShmRingIOChannel* ShmRingIOChannel::clone() const
+{
+    ShmRingIOChannel* ioc = new ShmRingIOChannel(_ringName, _writer);
+    ioc->setRingSize(_ringSize);
+    ioc->setNonBlocking(_nonBlocking);
+    ioc->setDSMConfig(getDSMConfig());
+    return ioc;
+}
+
+void ShmRingIOChannel::setRingName(const string& val)
+{
+    _ringName = val;
+    _name = "shmring:" + val;
+}
+
+void ShmRingIOChannel::requestConnection(IOChannelRequester* rqstr)
+{
+    connect();
+    rqstr->connected(this);
+}
+
+IOChannel* ShmRingIOChannel::connect()
+{
+    if (_ringName.empty())
+        throw n_u::IOException(getName(), "connect", "no ring name");
+    delete _ring;
+    _ring = 0;
+    if (_writer) _ring = ShmSampleRing::create(_ringName, _ringSize);
+    else _ring = ShmSampleRing::attach(_ringName);
+    _needHeader = true;
+    _header.clear();
+    _pending.clear();
+    _pendingOffset = 0;
+    _lastOverruns = 0;
+    return this;
+}
+
+void ShmRingIOChannel::reattach()
+{
+    NLOG(("%s: writer has replaced the ring, attaching again",
+          getName().c_str()));
+    delete _ring;
+    _ring = 0;
+    _ring = ShmSampleRing::attach(_ringName);
+    _needHeader = true;
+    _pending.clear();
+    _pendingOffset = 0;
+    _lastOverruns = 0;
+}
+
+void ShmRingIOChannel::logOverruns()
+{
+    size_t nover = _ring->getNumOverruns();
+    if (nover != _lastOverruns) {
+        WLOG(("%s: reader overrun by writer, %zu overruns, %lld bytes lost",
+              getName().c_str(), nover, _ring->getNumBytesLost()));
+        _lastOverruns = nover;
+    }
+}
+
+size_t ShmRingIOChannel::read(void* buf, size_t len)
+{
+    if (!_ring) throw n_u::IOException(getName(), "read", "not connected");
+    _newInput = false;
+
+    if (_pendingOffset == _pending.size()) {
+        if (_ring->isStale()) reattach();
+
+        if (_needHeader) {
+            string hdr = _ring->getHeader();
+            if (hdr.empty()) {
+                // writer has not sent a header yet
+                if (!_nonBlocking) {
+                    struct timespec ts = { 0, NSECS_PER_SEC / 10 };
+                    ::nanosleep(&ts, 0);
+                }
+                return 0;
+            }
+            _pending.assign(hdr.begin(), hdr.end());
+            _pendingOffset = 0;
+            _needHeader = false;
+            _newInput = true;
+        }
+        else {
+            size_t l = _ring->read(buf, len);
+            if (l == 0 && !_nonBlocking && _ring->wait(MSECS_PER_SEC / 4))
+                l = _ring->read(buf, len);
+            if (l == 0) {
+                // The next sample may be bigger than the caller's buffer,
+                // in which case save it to be returned in pieces.
+                // A smaller one was published after the read, and is
+                // left in the ring for the next read.
+                size_t rlen;
+                const char* rec = (const char*) _ring->peek(rlen);
+                if (rec && rlen > len) {
+                    _pending.assign(rec, rec + rlen);
+                    _pendingOffset = 0;
+                    if (!_ring->consume()) _pending.clear();
+                }
+            }
+            logOverruns();
+            if (l > 0) return l;
+        }
+    }
+
+    size_t l = std::min(len, _pending.size() - _pendingOffset);
+    if (l > 0) ::memcpy(buf, &_pending[_pendingOffset], l);
+    _pendingOffset += l;
+    if (_pendingOffset == _pending.size()) {
+        _pending.clear();
+        _pendingOffset = 0;
+    }
+    return l;
+}
+
+size_t ShmRingIOChannel::write(const void* buf, size_t len)
+{
+    if (!_ring) throw n_u::IOException(getName(), "write", "not connected");
+    _header.append((const char*)buf, len);
+    _ring->setHeader(_header);
+    return len;
+}
+
+size_t ShmRingIOChannel::write(const struct iovec* iov, int iovcnt)
+{
+    if (!_ring) throw n_u::IOException(getName(), "write", "not connected");
+    bool ok;
+    size_t len = iov[0].iov_len;
+    if (iovcnt == 1)
+        ok = _ring->publish(iov[0].iov_base, iov[0].iov_len, 0, 0);
+    else if (iovcnt == 2) {
+        ok = _ring->publish(iov[0].iov_base, iov[0].iov_len,
+                iov[1].iov_base, iov[1].iov_len);
+        len += iov[1].iov_len;
+    }
+    else throw n_u::IOException(getName(), "write",
+            "only a sample header and data can be written to a ring");
+    return ok ? len : 0;
+}
+
+dsm_time_t ShmRingIOChannel::createFile(dsm_time_t, bool)
+{
+    _header.clear();
+    return LONG_LONG_MAX;
+}
+
+void ShmRingIOChannel::close()
+{
+    delete _ring;
+    _ring = 0;
+}
+
+void ShmRingIOChannel::fromDOMElement(const xercesc::DOMElement* node)
+{
+    XDOMElement xnode(node);
+    if(node->hasAttributes()) {
+        // get all the attributes of the node
+        xercesc::DOMNamedNodeMap *pAttributes = node->getAttributes();
+        int nSize = pAttributes->getLength();
+        for(int i=0;i<nSize;++i) {
+            XDOMAttr attr((xercesc::DOMAttr*) pAttributes->item(i));
+            // get attribute name
+            const std::string& aname = attr.getName();
+            const std::string& aval = attr.getValue();
+            if (aname == "name")
+                setRingName(n_u::Process::expandEnvVars(aval));
+            else if (aname == "size") {
+                istringstream ist(aval);
+                size_t val;
+                ist >> val;
+                if (ist.fail())
+                    throw n_u::InvalidParameterException("shmring", aname, aval);
+                string smult;
+                ist >> smult;
+                size_t mult = 1;
+                if (smult.length() > 0) {
+                    if (smult[0] == 'K') mult = 1000;
+                    else if (smult[0] == 'M') mult = 1000000;
+                    else if (smult[0] == 'G') mult = 1000000000;
+                }
+                setRingSize(val * mult);
+            }
+            else throw n_u::InvalidParameterException
+                     (string("unrecognized shmring attribute: ") + aname);
+        }
+    }
+    if (_ringName.empty())
+        throw n_u::InvalidParameterException("shmring", "name", "missing");
+}
@@ -0,0 +1,216 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_CORE_SHMRINGIOCHANNEL_H
+#define NIDAS_CORE_SHMRINGIOCHANNEL_H
+
+#include "IOChannel.h"
+
+#include <string>
+#include <vector>
+
+namespace nidas { namespace core {
+
+class ShmSampleRing;
+
+/**
+ * IOChannel to a ShmSampleRing, a ring buffer of samples in shared
+ * memory. Configured in XML with a \<shmring\> element:
+ * @code
+ *   <output class="RawShmSampleOutput">
+ *       <shmring name="dsm_raw" size="16M"/>
+ *   </output>
+ * @endcode
+ *
+ * As an input, the channel attaches to an existing ring and read()
+ * returns the SampleInputHeader saved by the writer, followed by whole
+ * samples, so that it can be used by a SampleInputStream just like a
+ * socket or a file. If the reader falls more than a ring length behind
+ * the writer, the skipped samples are lost and a warning is logged.
+ *
+ * As an output, typically of a ShmSampleOutput, the channel creates the
+ * ring. write(const void*, size_t) saves the SampleInputHeader, and
+ * write(const struct iovec*, int) publishes one sample, consisting of a
+ * SampleHeader and the sample data.  The writer is never blocked by
+ * readers.
+ */
+class ShmRingIOChannel: public IOChannel {
+
+public:
+
+    ShmRingIOChannel();
+
+    /**
+     * Construct a channel to the ring of the given name.
+     */
+    ShmRingIOChannel(const std::string& ringName, bool writer = false);
+
+    ~ShmRingIOChannel();
+
+    ShmRingIOChannel* clone() const;
+
+    void setName(const std::string& val) { _name = val; }
+
+    const std::string& getName() const { return _name; }
+
+    /**
+     * Name of the shared memory segment.
+     */
+    void setRingName(const std::string& val);
+
+    const std::string& getRingName() const { return _ringName; }
+
+    /**
+     * Bytes of sample data in the ring, used when the ring is created.
+     */
+    void setRingSize(size_t val) { _ringSize = val; }
+
+    size_t getRingSize() const { return _ringSize; }
+
+    /**
+     * Whether this channel creates and writes to the ring,
+     * or attaches to it as a reader. A reader by default.
+     */
+    void setWriter(bool val) { _writer = val; }
+
+    bool isWriter() const { return _writer; }
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void requestConnection(IOChannelRequester* rqstr);
+
+    /**
+     * Create the ring as a writer, or attach to it as a reader.
+     *
+     * @throws nidas::util::IOException
+     **/
+    IOChannel* connect();
+
+    void setNonBlocking(bool val) { _nonBlocking = val; }
+
+    bool isNonBlocking() const { return _nonBlocking; }
+
+    bool isNewInput() const { return _newInput; }
+
+    size_t getBufferSize() const { return 65536; }
+
+    /**
+     * Reader: copy the header and then whole samples into buf.  A
+     * blocking read waits a limited time for a sample, and returns 0
+     * if none arrive.
+     *
+     * @throws nidas::util::IOException
+     **/
+    size_t read(void* buf, size_t len);
+
+    /**
+     * Writer: save a SampleInputHeader in the ring.
+     *
+     * @throws nidas::util::IOException
+     **/
+    size_t write(const void* buf, size_t len);
+
+    /**
+     * Writer: publish one sample, as a SampleHeader and data.
+     *
+     * @throws nidas::util::IOException
+     **/
+    size_t write(const struct iovec* iov, int iovcnt);
+
+    /**
+     * Start a new SampleInputHeader, the next write(const void*,size_t)
+     * replaces the one in the ring.
+     */
+    dsm_time_t createFile(dsm_time_t, bool);
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void close();
+
+    /**
+     * There is no file descriptor for a ring, returns -1.
+     */
+    int getFd() const { return -1; }
+
+    ShmSampleRing* getRing() { return _ring; }
+
+    /**
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void fromDOMElement(const xercesc::DOMElement*);
+
+private:
+
+    ShmRingIOChannel(const ShmRingIOChannel&);
+
+    ShmRingIOChannel& operator=(const ShmRingIOChannel&);
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void reattach();
+
+    void logOverruns();
+
+    std::string _name;
+
+    std::string _ringName;
+
+    size_t _ringSize;
+
+    bool _writer;
+
+    bool _nonBlocking;
+
+    bool _newInput;
+
+    /**
+     * Reader: the header from the writer has yet to be returned by read().
+     */
+    bool _needHeader;
+
+    ShmSampleRing* _ring;
+
+    /**
+     * Header text being written by the writer.
+     */
+    std::string _header;
+
+    /**
+     * Reader: header or sample not yet completely returned by read().
+     */
+    std::vector<char> _pending;
+
+    size_t _pendingOffset;
+
+    size_t _lastOverruns;
+};
+
+}}	// namespace nidas namespace core
+
+#endif
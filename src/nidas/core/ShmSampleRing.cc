@@ -0,0 +1,420 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "ShmSampleRing.h"
+
+#include <nidas/util/Logger.h>
+#include <nidas/util/time_constants.h>
+
+#include <cstring>
+#include <climits>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+/*
+ * The writer reserves space in the ring by advancing reservePos before
+ * copying a record, and then publishes the record by advancing writePos.
+ * A reader checks reservePos after it has looked at a record, in the
+ * manner of a seqlock, to determine whether the writer may have
+ * overwritten the record in the meantime.
+ */
+struct ShmSampleRing::Control
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long dataSize;
+    std::atomic<unsigned int> state;
+    std::atomic<unsigned int> headerLen;
+    std::atomic<unsigned long long> reservePos;
+    std::atomic<unsigned long long> writePos;
+    std::atomic<long long> nsamples;
+    /**
+     * Futex word, incremented after each record, and number of
+     * readers waiting on it.
+     */
+    std::atomic<unsigned int> wakeSeq;
+    std::atomic<unsigned int> waiters;
+    char header[MAX_HEADER_LEN];
+};
+
+const size_t ShmSampleRing::PREFIX_LEN;
+const size_t ShmSampleRing::MAX_HEADER_LEN;
+
+namespace {
+
+int futex(std::atomic<unsigned int>* addr, int op, unsigned int val,
+        const struct timespec* timeout)
+{
+    return ::syscall(SYS_futex, reinterpret_cast<unsigned int*>(addr),
+            op, val, timeout, 0, 0);
+}
+
+}
+
+ShmSampleRing::ShmSampleRing(const string& name, bool writer):
+    _name(shmName(name)),_writer(writer),
+    _segment(0),_segmentLen(0),_ctl(0),_data(0),_dataSize(0),
+    _readPos(0),_peekLen(0),_noverruns(0),_nbytesLost(0),_ndiscarded(0)
+{
+}
+
+ShmSampleRing::~ShmSampleRing()
+{
+    if (_ctl && _writer) {
+        _ctl->state.store(RING_WRITER_CLOSED, std::memory_order_release);
+        _ctl->wakeSeq.fetch_add(1, std::memory_order_release);
+        futex(&_ctl->wakeSeq, FUTEX_WAKE, INT_MAX, 0);
+    }
+    if (_segment) ::munmap(_segment, _segmentLen);
+}
+
+/* static */
+string ShmSampleRing::shmName(const string& name)
+{
+    if (name.length() > 0 && name[0] == '/') return name;
+    return "/" + name;
+}
+
+/* static */
+size_t ShmSampleRing::controlLength()
+{
+    // Start the records on a page boundary.
+    size_t pagesize = ::sysconf(_SC_PAGESIZE);
+    return ((sizeof(Control) + pagesize - 1) / pagesize) * pagesize;
+}
+
+void ShmSampleRing::map(int fd, size_t len)
+{
+    void* seg = ::mmap(0, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (seg == MAP_FAILED) throw n_u::IOException(_name, "mmap", errno);
+    _segment = seg;
+    _segmentLen = len;
+    _ctl = static_cast<Control*>(seg);
+    _data = static_cast<char*>(seg) + controlLength();
+}
+
+/* static */
+ShmSampleRing* ShmSampleRing::create(const string& name, size_t size)
+{
+    ShmSampleRing* ring = new ShmSampleRing(name, true);
+    const char* sname = ring->_name.c_str();
+
+    size_t dsize = (std::max(size, (size_t)65536) + PREFIX_LEN - 1) &
+        ~(PREFIX_LEN - 1);
+    size_t len = controlLength() + dsize;
+
+    int fd = ::shm_open(sname, O_RDWR | O_CREAT, 0664);
+    if (fd < 0) {
+        int ierr = errno;
+        delete ring;
+        throw n_u::IOException(shmName(name), "shm_open", ierr);
+    }
+
+    try {
+        struct stat statbuf;
+        if (::fstat(fd, &statbuf) < 0)
+            throw n_u::IOException(ring->_name, "fstat", errno);
+
+        if ((size_t)statbuf.st_size == len) {
+            ring->map(fd, len);
+            Control* ctl = ring->_ctl;
+            if (ctl->magic == RING_MAGIC && ctl->version == RING_VERSION &&
+                ctl->dataSize == dsize) {
+                // Carry on with the existing ring, so that attached
+                // readers continue with this writer.
+                ILOG(("%s: re-using existing shared memory ring, %zu bytes",
+                      sname, dsize));
+                ring->_dataSize = dsize;
+                ctl->state.store(RING_WRITER_OPEN, std::memory_order_release);
+                ::close(fd);
+                return ring;
+            }
+            ::munmap(ring->_segment, ring->_segmentLen);
+            ring->_segment = 0;
+            ring->_ctl = 0;
+        }
+        if (statbuf.st_size > 0) {
+            // Let readers of the old segment know it is stale, then
+            // replace it with a new one.
+            if ((size_t)statbuf.st_size >= sizeof(Control)) {
+                ring->map(fd, statbuf.st_size);
+                ring->_ctl->state.store(RING_STALE, std::memory_order_release);
+                ring->_ctl->wakeSeq.fetch_add(1, std::memory_order_release);
+                futex(&ring->_ctl->wakeSeq, FUTEX_WAKE, INT_MAX, 0);
+                ::munmap(ring->_segment, ring->_segmentLen);
+                ring->_segment = 0;
+                ring->_ctl = 0;
+            }
+            ::close(fd);
+            ::shm_unlink(sname);
+            fd = ::shm_open(sname, O_RDWR | O_CREAT | O_EXCL, 0664);
+            if (fd < 0) throw n_u::IOException(ring->_name, "shm_open", errno);
+        }
+        if (::ftruncate(fd, len) < 0)
+            throw n_u::IOException(ring->_name, "ftruncate", errno);
+
+        // A new segment is filled with zeroes.
+        ring->map(fd, len);
+        ring->_dataSize = dsize;
+        Control* ctl = ring->_ctl;
+        ctl->version = RING_VERSION;
+        ctl->dataSize = dsize;
+        ctl->headerLen.store(0);
+        ctl->reservePos.store(0);
+        ctl->writePos.store(0);
+        ctl->nsamples.store(0);
+        ctl->wakeSeq.store(0);
+        ctl->waiters.store(0);
+        ctl->state.store(RING_WRITER_OPEN);
+        std::atomic_thread_fence(std::memory_order_release);
+        ctl->magic = RING_MAGIC;
+        ::close(fd);
+        ILOG(("%s: created shared memory ring, %zu bytes", sname, dsize));
+    }
+    catch (const n_u::IOException&) {
+        ::close(fd);
+        delete ring;
+        throw;
+    }
+    return ring;
+}
+
+/* static */
+ShmSampleRing* ShmSampleRing::attach(const string& name)
+{
+    ShmSampleRing* ring = new ShmSampleRing(name, false);
+
+    // Readers need write access for the futex waiter count.
+    int fd = ::shm_open(ring->_name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        int ierr = errno;
+        delete ring;
+        throw n_u::IOException(shmName(name), "shm_open", ierr);
+    }
+    try {
+        struct stat statbuf;
+        if (::fstat(fd, &statbuf) < 0)
+            throw n_u::IOException(ring->_name, "fstat", errno);
+        if ((size_t)statbuf.st_size <= controlLength())
+            throw n_u::IOException(ring->_name, "attach",
+                "segment too small, not a sample ring");
+        ring->map(fd, statbuf.st_size);
+        Control* ctl = ring->_ctl;
+        if (ctl->magic != RING_MAGIC || ctl->version != RING_VERSION ||
+            ctl->dataSize + controlLength() != (size_t)statbuf.st_size)
+            throw n_u::IOException(ring->_name, "attach",
+                "not a sample ring, or wrong version");
+        ring->_dataSize = ctl->dataSize;
+        ring->_readPos = ctl->writePos.load(std::memory_order_acquire);
+        ::close(fd);
+    }
+    catch (const n_u::IOException&) {
+        ::close(fd);
+        delete ring;
+        throw;
+    }
+    return ring;
+}
+
+void ShmSampleRing::setHeader(const string& hdr)
+{
+    if (hdr.length() > MAX_HEADER_LEN)
+        throw n_u::IOException(_name, "setHeader", "header too long");
+    _ctl->headerLen.store(0, std::memory_order_release);
+    ::memcpy(_ctl->header, hdr.c_str(), hdr.length());
+    _ctl->headerLen.store(hdr.length(), std::memory_order_release);
+}
+
+string ShmSampleRing::getHeader() const
+{
+    size_t len = _ctl->headerLen.load(std::memory_order_acquire);
+    return string(_ctl->header, std::min(len, MAX_HEADER_LEN));
+}
+
+bool ShmSampleRing::publish(const void* hdr, size_t hlen,
+        const void* data, size_t dlen)
+{
+    size_t rlen = hlen + dlen;
+    if (rlen > getMaxSampleLength()) {
+        _ndiscarded++;
+        return false;
+    }
+    size_t reclen = (PREFIX_LEN + rlen + PREFIX_LEN - 1) & ~(PREFIX_LEN - 1);
+
+    unsigned long long pos = _ctl->writePos.load(std::memory_order_relaxed);
+    size_t off = pos % _dataSize;
+
+    if (off + reclen > _dataSize) {
+        // Not enough room before the end of the ring. Mark the rest
+        // as padding and put the record at the beginning.
+        unsigned long long wrapped = pos + (_dataSize - off);
+        _ctl->reservePos.store(wrapped + reclen, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        unsigned int* prefix = reinterpret_cast<unsigned int*>(_data + off);
+        prefix[0] = 0;
+        prefix[1] = WRAP_FLAG;
+        pos = wrapped;
+        off = 0;
+    }
+    else {
+        _ctl->reservePos.store(pos + reclen, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    char* rec = _data + off;
+    unsigned int* prefix = reinterpret_cast<unsigned int*>(rec);
+    prefix[0] = rlen;
+    prefix[1] = 0;
+    ::memcpy(rec + PREFIX_LEN, hdr, hlen);
+    ::memcpy(rec + PREFIX_LEN + hlen, data, dlen);
+
+    _ctl->writePos.store(pos + reclen, std::memory_order_release);
+    _ctl->nsamples.fetch_add(1, std::memory_order_relaxed);
+    _ctl->wakeSeq.fetch_add(1, std::memory_order_release);
+    if (_ctl->waiters.load(std::memory_order_relaxed) > 0)
+        futex(&_ctl->wakeSeq, FUTEX_WAKE, INT_MAX, 0);
+    return true;
+}
+
+void ShmSampleRing::resync()
+{
+    unsigned long long wpos = _ctl->writePos.load(std::memory_order_acquire);
+    _nbytesLost += wpos - _readPos;
+    _readPos = wpos;
+    _peekLen = 0;
+    _noverruns++;
+}
+
+const void* ShmSampleRing::peek(size_t& lenp)
+{
+    for (;;) {
+        unsigned long long wpos =
+            _ctl->writePos.load(std::memory_order_acquire);
+        if (_readPos == wpos) return 0;
+        if (wpos - _readPos > _dataSize) {
+            resync();
+            continue;
+        }
+        size_t off = _readPos % _dataSize;
+        const unsigned int* prefix =
+            reinterpret_cast<const unsigned int*>(_data + off);
+        unsigned int rlen = prefix[0];
+        unsigned int flags = prefix[1];
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_ctl->reservePos.load(std::memory_order_relaxed) >
+                _readPos + _dataSize) {
+            resync();
+            continue;
+        }
+        if (flags & WRAP_FLAG) {
+            _readPos += _dataSize - off;
+            continue;
+        }
+        _peekLen = (PREFIX_LEN + rlen + PREFIX_LEN - 1) & ~(PREFIX_LEN - 1);
+        lenp = rlen;
+        return _data + off + PREFIX_LEN;
+    }
+}
+
+bool ShmSampleRing::consume()
+{
+    if (_peekLen == 0) return true;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_ctl->reservePos.load(std::memory_order_relaxed) >
+            _readPos + _dataSize) {
+        resync();
+        return false;
+    }
+    _readPos += _peekLen;
+    _peekLen = 0;
+    return true;
+}
+
+size_t ShmSampleRing::read(void* buf, size_t len)
+{
+    char* cbuf = static_cast<char*>(buf);
+    size_t nout = 0;
+    for (;;) {
+        size_t rlen;
+        const void* rec = peek(rlen);
+        if (!rec || nout + rlen > len) break;
+        ::memcpy(cbuf + nout, rec, rlen);
+        // discard the copy if it was overwritten
+        if (consume()) nout += rlen;
+    }
+    _peekLen = 0;
+    return nout;
+}
+
+bool ShmSampleRing::wait(int msecs)
+{
+    unsigned int seq = _ctl->wakeSeq.load(std::memory_order_acquire);
+    if (_ctl->writePos.load(std::memory_order_acquire) != _readPos)
+        return true;
+    if (isStale()) return false;
+
+    struct timespec ts;
+    ts.tv_sec = msecs / MSECS_PER_SEC;
+    ts.tv_nsec = (msecs % MSECS_PER_SEC) * NSECS_PER_MSEC;
+
+    _ctl->waiters.fetch_add(1, std::memory_order_relaxed);
+    futex(&_ctl->wakeSeq, FUTEX_WAIT, seq, &ts);
+    _ctl->waiters.fetch_sub(1, std::memory_order_relaxed);
+
+    return _ctl->writePos.load(std::memory_order_acquire) != _readPos;
+}
+
+bool ShmSampleRing::isStale() const
+{
+    return _ctl->state.load(std::memory_order_acquire) == RING_STALE;
+}
+
+bool ShmSampleRing::isWriterClosed() const
+{
+    return _ctl->state.load(std::memory_order_acquire) != RING_WRITER_OPEN;
+}
+
+size_t ShmSampleRing::getLagBytes() const
+{
+    return _ctl->writePos.load(std::memory_order_acquire) - _readPos;
+}
+
+long long ShmSampleRing::getNumSamples() const
+{
+    return _ctl->nsamples.load(std::memory_order_relaxed);
+}
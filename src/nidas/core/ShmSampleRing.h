@@ -0,0 +1,288 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_CORE_SHMSAMPLERING_H
+#define NIDAS_CORE_SHMSAMPLERING_H
+
+#include "Sample.h"
+
+#include <nidas/util/IOException.h>
+
+#include <string>
+#include <atomic>
+
+namespace nidas { namespace core {
+
+/**
+ * A ring buffer of samples in POSIX shared memory, with one writer
+ * and any number of readers on the same host.
+ *
+ * The writer copies each sample, header and data, once into the ring.
+ * Readers attach to the ring by name and each keeps its own read
+ * position, so the writer never waits for a reader. A reader
+ * which falls more than one ring length behind the writer has been
+ * overrun: it is moved forward to the current write position and the
+ * overrun is counted.
+ *
+ * The ring does not interpret the records. ShmSampleOutput publishes
+ * each sample as a SampleHeader in little-endian order followed by
+ * the data, so a record can be accessed in place by a reader, or copied
+ * to a buffer where it has the same format as a NIDAS archive.
+ *
+ * The shared memory segment also holds the text of the
+ * SampleInputHeader from the writer, so that readers attaching
+ * at any time can parse the stream.
+ */
+class ShmSampleRing
+{
+public:
+
+    /**
+     * Create the named ring as its writer. If a ring of the same
+     * size already exists, it is re-used and the write position
+     * continues from where it was, so that attached readers
+     * carry on with the new writer. Otherwise any existing
+     * segment is marked stale and unlinked, and a new one created.
+     * @param name Name of the segment, as passed to shm_open().
+     *      A leading '/' is added if necessary.
+     * @param size Number of bytes for sample records in the ring.
+     *
+     * @throws nidas::util::IOException
+     */
+    static ShmSampleRing* create(const std::string& name, size_t size);
+
+    /**
+     * Attach to an existing ring as a reader. The read position is
+     * set to the current write position.
+     *
+     * @throws nidas::util::IOException
+     */
+    static ShmSampleRing* attach(const std::string& name);
+
+    /**
+     * Unmap the segment. A writer marks the ring as closed,
+     * but does not unlink it.
+     */
+    ~ShmSampleRing();
+
+    const std::string& getName() const { return _name; }
+
+    bool isWriter() const { return _writer; }
+
+    /**
+     * Bytes available for records in the ring.
+     */
+    size_t getDataSize() const { return _dataSize; }
+
+    /**
+     * Largest sample, header and data, that can be put in the ring.
+     */
+    size_t getMaxSampleLength() const { return _dataSize / 4 - PREFIX_LEN; }
+
+    /**
+     * Writer: store the text of the SampleInputHeader in the segment.
+     *
+     * @throws nidas::util::IOException
+     */
+    void setHeader(const std::string& hdr);
+
+    /**
+     * Reader: the SampleInputHeader text saved by the writer.
+     * Empty if the writer has not stored one yet.
+     */
+    std::string getHeader() const;
+
+    /**
+     * Writer: copy a sample into the ring, with its header as it is
+     * in memory, in host byte order. ShmSampleOutput only uses this
+     * on little-endian hosts, and otherwise swaps the header, so that
+     * the records in the ring are little-endian.
+     * @return false if the sample is too big for the ring.
+     */
+    bool publish(const Sample* samp)
+    {
+        return publish(samp->getHeaderPtr(), samp->getHeaderLength(),
+            samp->getConstVoidDataPtr(), samp->getDataByteLength());
+    }
+
+    /**
+     * Writer: copy a record, in two pieces, into the ring.
+     * Typically the first piece is a SampleHeader, and the
+     * second is the sample data.
+     * @return false if the record is too big for the ring.
+     */
+    bool publish(const void* hdr, size_t hlen, const void* data, size_t dlen);
+
+    /**
+     * Reader: zero-copy access to the next record in the ring.
+     * @param lenp Returned length of the record, header and data.
+     * @return Pointer to the record in the segment, or NULL if no
+     *      record is available. The pointer is only valid until
+     *      the following call to consume().
+     */
+    const void* peek(size_t& lenp);
+
+    /**
+     * Reader: done with the record returned by peek(), move to the
+     * next one.
+     * @return false if the writer overwrote the record while it was
+     *      being used, in which case the contents seen through the
+     *      pointer from peek() should be discarded.
+     */
+    bool consume();
+
+    /**
+     * Reader: copy as many whole records as will fit into buf.
+     * @return Number of bytes copied, 0 if no records are available
+     *      or if the next record is bigger than len.
+     */
+    size_t read(void* buf, size_t len);
+
+    /**
+     * Reader: block until a record is available, or msecs have
+     * elapsed.
+     * @return true if a record is available.
+     */
+    bool wait(int msecs);
+
+    /**
+     * Reader: has a writer replaced the ring with a new segment of
+     * the same name? A reader of a stale ring must attach again
+     * to see new samples.
+     */
+    bool isStale() const;
+
+    /**
+     * Reader: has the writer closed the ring?
+     */
+    bool isWriterClosed() const;
+
+    /**
+     * Reader: number of bytes the writer is ahead of this reader.
+     */
+    size_t getLagBytes() const;
+
+    /**
+     * Reader: number of times this reader has been overrun.
+     */
+    size_t getNumOverruns() const { return _noverruns; }
+
+    /**
+     * Reader: number of bytes skipped due to overruns.
+     */
+    long long getNumBytesLost() const { return _nbytesLost; }
+
+    /**
+     * Total samples published to the ring, by all writers.
+     */
+    long long getNumSamples() const;
+
+    /**
+     * Writer: number of samples not published because they were
+     * bigger than getMaxSampleLength().
+     */
+    size_t getNumDiscardedSamples() const { return _ndiscarded; }
+
+private:
+
+    /**
+     * Layout of the control block at the beginning of the segment.
+     * It must only contain types which can be shared between processes.
+     */
+    struct Control;
+
+    enum RingState { RING_WRITER_OPEN = 1, RING_WRITER_CLOSED = 2, RING_STALE = 3 };
+
+    static const unsigned int RING_MAGIC = 0x4e534852;   // "NSHR"
+
+    static const unsigned int RING_VERSION = 1;
+
+    /**
+     * Each record in the ring starts with its length and a flag,
+     * and is padded to a multiple of PREFIX_LEN bytes.
+     */
+    static const size_t PREFIX_LEN = 8;
+
+    static const unsigned int WRAP_FLAG = 1;
+
+    static const size_t MAX_HEADER_LEN = 4096;
+
+    ShmSampleRing(const std::string& name, bool writer);
+
+    /**
+     * @throws nidas::util::IOException
+     */
+    void map(int fd, size_t len);
+
+    static std::string shmName(const std::string& name);
+
+    static size_t controlLength();
+
+    /**
+     * Reader: move to the current write position after an overrun.
+     */
+    void resync();
+
+    std::string _name;
+
+    bool _writer;
+
+    void* _segment;
+
+    size_t _segmentLen;
+
+    Control* _ctl;
+
+    char* _data;
+
+    size_t _dataSize;
+
+    /**
+     * Reader position, in bytes since the ring was created.
+     */
+    unsigned long long _readPos;
+
+    /**
+     * Length in the ring of the record returned by peek().
+     */
+    size_t _peekLen;
+
+    size_t _noverruns;
+
+    long long _nbytesLost;
+
+    size_t _ndiscarded;
+
+    /** No copying. */
+    ShmSampleRing(const ShmSampleRing&);
+
+    /** No assignment. */
+    ShmSampleRing& operator=(const ShmSampleRing&);
+};
+
+}}	// namespace nidas namespace core
+
+#endif
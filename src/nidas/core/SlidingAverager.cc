@@ -0,0 +1,267 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "SlidingAverager.h"
+#include "DSMSensor.h"
+#include "Project.h"
+#include "Variable.h"
+
+#include <nidas/util/Logger.h>
+#include <nidas/util/UTime.h>
+
+#include <algorithm>
+
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+SlidingAverager::SlidingAverager():
+    _source(false),_outSample(),_periodUsecs(0),_windowUsecs(0),
+    _budgetUsecs(0),_nextTime(0),_outVarIndices(),_inmap(),_lenmap(),
+    _outmap(),_ndataValues(0),_values(),_sums(),_cnts(),_sensors(),
+    _latency(),_mutex()
+{
+    _outSample.setSampleId(Project::getInstance()->getUniqueSampleId(0));
+    setAveragePeriodSecs(1.0);
+    addSampleTag(&_outSample);
+}
+
+SlidingAverager::~SlidingAverager()
+{
+}
+
+void SlidingAverager::setAveragePeriodSecs(float val)
+{
+    _periodUsecs = (int)rint((double)val * USECS_PER_SEC);
+    _outSample.setRate(1.0 / val);
+}
+
+void SlidingAverager::addVariable(const Variable *var)
+{
+    Variable* newvar = new Variable(*var);
+    _outSample.addVariable(newvar);
+    _outVarIndices[newvar] = _ndataValues;
+    _ndataValues += var->getLength();
+}
+
+void SlidingAverager::connect(SampleSource* source)
+{
+    SampleSource* raw = source->getRawSampleSource();
+
+    list<const SampleTag*> intags = source->getSampleTags();
+
+    unsigned int nvars = _outSample.getVariables().size();
+    vector<bool> varMatched(nvars);
+
+    list<const SampleTag*>::const_iterator inti = intags.begin();
+    for ( ; inti != intags.end(); ++inti ) {
+        const SampleTag* intag = *inti;
+        dsm_sample_id_t sampid = intag->getId();
+
+        bool matchInSample = false;
+        VariableIterator vi = intag->getVariableIterator();
+        for ( ; vi.hasNext(); ) {
+            const Variable* var = vi.next();
+            for (unsigned int iout = 0; iout < nvars; iout++) {
+                Variable& myvar = _outSample.getVariable(iout);
+                if (!(*var == myvar)) continue;
+
+                varMatched[iout] = true;
+                matchInSample = true;
+                _inmap[sampid].push_back(intag->getDataIndex(var));
+                _outmap[sampid].push_back(_outVarIndices[&myvar]);
+                _lenmap[sampid].push_back(var->getLength());
+                // copy attributes of variable
+                myvar = *var;
+            }
+        }
+        if (!matchInSample) continue;
+
+        DSMSensor* sensor = const_cast<DSMSensor*>(intag->getDSMSensor());
+        if (raw && sensor) {
+            sensor->addSampleClientForTag(this,intag);
+            raw->addSampleClientForTag(sensor,sensor->getRawSampleTag());
+            _sensors.insert(sensor);
+        }
+        else source->addSampleClientForTag(this,intag);
+    }
+
+    string missing;
+    for (unsigned int i = 0; i < nvars; i++) {
+        if (!varMatched[i]) {
+            const Variable& var = _outSample.getVariable(i);
+            missing += ' ';
+            missing += var.getName();
+            if (!var.getSite()) missing += "(null site)";
+        }
+    }
+    if (!missing.empty())
+        WLOG(("SlidingAverager: variables not found in source:") << missing);
+
+    n_u::Autolock autolock(_mutex);
+    _values.assign(_ndataValues, deque<TimedValue>());
+    _sums.assign(_ndataValues, 0.0);
+    _cnts.assign(_ndataValues, 0);
+    _nextTime = 0;
+}
+
+void SlidingAverager::disconnect(SampleSource* source) throw()
+{
+    set<DSMSensor*>::const_iterator si = _sensors.begin();
+    for ( ; si != _sensors.end(); ++si)
+        (*si)->removeSampleClient(this);
+    _sensors.clear();
+    source->removeSampleClient(this);
+}
+
+void SlidingAverager::expire(dsm_time_t tend)
+{
+    dsm_time_t tstart = tend - getWindowUsecs();
+    for (unsigned int i = 0; i < _ndataValues; i++) {
+        deque<TimedValue>& values = _values[i];
+        while (!values.empty() && values.front().first < tstart) {
+            _sums[i] -= values.front().second;
+            _cnts[i]--;
+            values.pop_front();
+        }
+        // don't let rounding errors accumulate in an empty window
+        if (_cnts[i] == 0) _sums[i] = 0.0;
+    }
+}
+
+SampleT<float>* SlidingAverager::average(dsm_time_t tend)
+{
+    expire(tend);
+
+    unsigned int nok = 0;
+    for (unsigned int i = 0; i < _ndataValues; i++)
+        if (_cnts[i] > 0) nok++;
+    if (nok == 0) return 0;
+
+    SampleT<float>* osamp = getSample<float>(_ndataValues);
+    osamp->setTimeTag(tend - getWindowUsecs() / 2);
+    osamp->setId(_outSample.getId());
+    float* fp = osamp->getDataPtr();
+    for (unsigned int i = 0; i < _ndataValues; i++) {
+        if (_cnts[i] > 0) fp[i] = _sums[i] / _cnts[i];
+        else fp[i] = floatNAN;
+    }
+    return osamp;
+}
+
+void SlidingAverager::output(SampleT<float>* osamp, dsm_time_t tend)
+{
+    _source.distribute(osamp);
+
+    int latency = (int)(n_u::getSystemTime() - tend);
+    n_u::Autolock autolock(_mutex);
+    _latency.nout++;
+    _latency.sum += latency;
+    _latency.max = std::max(_latency.max, latency);
+    _latency.last = latency;
+    if (_budgetUsecs > 0 && latency > _budgetUsecs) _latency.nOverBudget++;
+}
+
+bool SlidingAverager::receive(const Sample* samp) throw()
+{
+    if (samp->getType() != FLOAT_ST && samp->getType() != DOUBLE_ST) return false;
+
+    dsm_sample_id_t id = samp->getId();
+
+    map<dsm_sample_id_t,vector<unsigned int> >::const_iterator mi;
+    if ((mi = _inmap.find(id)) == _inmap.end()) return false;
+    const vector<unsigned int>& invec = mi->second;
+    const vector<unsigned int>& outvec = _outmap.find(id)->second;
+    const vector<unsigned int>& lenvec = _lenmap.find(id)->second;
+
+    dsm_time_t tt = samp->getTimeTag();
+
+    SampleT<float>* osamp = 0;
+    dsm_time_t tend = 0;
+
+    _mutex.lock();
+
+    if (_nextTime == 0)
+        _nextTime = tt - (tt % _periodUsecs) + _periodUsecs;
+    else if (tt >= _nextTime) {
+        tend = _nextTime;
+        osamp = average(tend);
+        _nextTime += _periodUsecs;
+        if (tt >= _nextTime)
+            _nextTime = tt - (tt % _periodUsecs) + _periodUsecs;
+    }
+
+    for (unsigned int iv = 0; iv < invec.size(); iv++) {
+        unsigned int ii = invec[iv];
+        unsigned int oi = outvec[iv];
+        for (unsigned int j = 0; j < lenvec[iv] && ii < samp->getDataLength();
+             j++, ii++, oi++) {
+            double v = samp->getDataValue(ii);
+            if (std::isnan(v)) continue;
+            _values[oi].push_back(TimedValue(tt, v));
+            _sums[oi] += v;
+            _cnts[oi]++;
+        }
+    }
+    _mutex.unlock();
+
+    if (osamp) output(osamp, tend);
+    return true;
+}
+
+void SlidingAverager::flush() throw()
+{
+    SampleT<float>* osamp = 0;
+    dsm_time_t tend = 0;
+
+    _mutex.lock();
+    if (_nextTime > 0) {
+        tend = _nextTime;
+        osamp = average(tend);
+    }
+    for (unsigned int i = 0; i < _ndataValues; i++) {
+        _values[i].clear();
+        _sums[i] = 0.0;
+        _cnts[i] = 0;
+    }
+    _nextTime = 0;
+    _mutex.unlock();
+
+    if (osamp) output(osamp, tend);
+}
+
+SlidingAverager::LatencyStats SlidingAverager::getLatencyStats()
+{
+    n_u::Autolock autolock(_mutex);
+    return _latency;
+}
+
+void SlidingAverager::resetLatencyStats()
+{
+    n_u::Autolock autolock(_mutex);
+    _latency = LatencyStats();
+}
@@ -0,0 +1,284 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_CORE_SLIDINGAVERAGER_H
+#define NIDAS_CORE_SLIDINGAVERAGER_H
+
+#include "Resampler.h"
+#include "SampleTag.h"
+
+#include <nidas/util/ThreadSupport.h>
+
+#include <cmath>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace nidas { namespace core {
+
+class DSMSensor;
+class Variable;
+
+/**
+ * A Resampler for control loops, which outputs a running average of
+ * its variables over a sliding window, with a bounded latency.
+ *
+ * When connected to a SamplePipeline, it receives the processed samples
+ * of the sensors directly, as they are processed from the raw sorter,
+ * rather than from the processed sorter, whose length would add several
+ * seconds of latency.  The averages are updated incrementally as each
+ * value arrives and expires from the window, and an average is output
+ * as soon as a sample at or after the end of its period is received.
+ *
+ * The latency of each output, the system time when it was sent minus
+ * the end time of its window, is compared against a latency budget.
+ */
+class SlidingAverager : public Resampler {
+public:
+
+    SlidingAverager();
+
+    virtual ~SlidingAverager();
+
+    /**
+     * Output period, in seconds.
+     */
+    void setAveragePeriodSecs(float val);
+
+    float getAveragePeriodSecs() const
+    {
+        return (double)_periodUsecs / USECS_PER_SEC;
+    }
+
+    /**
+     * Length of the sliding window, in seconds.  If not set,
+     * the window is the output period.
+     */
+    void setWindowSecs(float val)
+    {
+        _windowUsecs = (int)rint((double)val * USECS_PER_SEC);
+    }
+
+    float getWindowSecs() const
+    {
+        return (double)getWindowUsecs() / USECS_PER_SEC;
+    }
+
+    /**
+     * Latency budget of an output, in seconds.
+     */
+    void setLatencyBudgetSecs(float val)
+    {
+        _budgetUsecs = (int)rint((double)val * USECS_PER_SEC);
+    }
+
+    float getLatencyBudgetSecs() const
+    {
+        return (double)_budgetUsecs / USECS_PER_SEC;
+    }
+
+    void addVariable(const Variable *var);
+
+    SampleSource* getRawSampleSource() { return 0; }
+
+    SampleSource* getProcessedSampleSource() { return &_source; }
+
+    std::list<const SampleTag*> getSampleTags() const
+    {
+        return _source.getSampleTags();
+    }
+
+    SampleTagIterator getSampleTagIterator() const
+    {
+        return _source.getSampleTagIterator();
+    }
+
+    void addSampleClient(SampleClient* client) throw()
+    {
+        _source.addSampleClient(client);
+    }
+
+    void removeSampleClient(SampleClient* client) throw()
+    {
+        _source.removeSampleClient(client);
+    }
+
+    void addSampleClientForTag(SampleClient* client,const SampleTag*) throw()
+    {
+        _source.addSampleClient(client);
+    }
+
+    void removeSampleClientForTag(SampleClient* client,const SampleTag*) throw()
+    {
+        _source.removeSampleClient(client);
+    }
+
+    int getClientCount() const throw()
+    {
+        return _source.getClientCount();
+    }
+
+    const SampleStats& getSampleStats() const
+    {
+        return _source.getSampleStats();
+    }
+
+    /**
+     * Connect to a SampleSource.  If the source has a raw sample
+     * source, as a SamplePipeline does, the averager becomes a client
+     * of the sensors of the matching samples, which are in turn
+     * connected to the raw source.  Otherwise the averager is a client
+     * of the source for the matching samples.
+     *
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void connect(SampleSource* source);
+
+    void disconnect(SampleSource* source) throw();
+
+    bool receive(const Sample *s) throw();
+
+    /**
+     * Output the averages of the current window, if it has any
+     * values, and empty it.
+     */
+    void flush() throw();
+
+    /**
+     * Latencies of the outputs, in microseconds.
+     */
+    struct LatencyStats
+    {
+        LatencyStats(): nout(0), nOverBudget(0), sum(0), max(0), last(0) {}
+        unsigned int nout;
+        unsigned int nOverBudget;
+        long long sum;
+        int max;
+        int last;
+    };
+
+    /**
+     * Latency statistics since the start, or since resetLatencyStats().
+     */
+    LatencyStats getLatencyStats();
+
+    void resetLatencyStats();
+
+private:
+
+    void addSampleTag(const SampleTag* tag) throw ()
+    {
+        _source.addSampleTag(tag);
+    }
+
+    void removeSampleTag(const SampleTag* tag) throw ()
+    {
+        _source.removeSampleTag(tag);
+    }
+
+    int getWindowUsecs() const
+    {
+        return _windowUsecs > 0 ? _windowUsecs : _periodUsecs;
+    }
+
+    /**
+     * Create a sample of the averages of the window ending at tend,
+     * or return NULL if the window has no values.
+     * _mutex must be locked.
+     */
+    SampleT<float>* average(dsm_time_t tend);
+
+    /**
+     * Send a sample of averages, and add its latency to the statistics.
+     * _mutex must not be locked, so that the clients of this averager
+     * don't hold up the samples it receives.
+     */
+    void output(SampleT<float>* osamp, dsm_time_t tend);
+
+    /**
+     * Remove the values before the start of the window ending at tend.
+     */
+    void expire(dsm_time_t tend);
+
+    SampleSourceSupport _source;
+
+    SampleTag _outSample;
+
+    int _periodUsecs;
+
+    int _windowUsecs;
+
+    int _budgetUsecs;
+
+    /**
+     * End time of the window of the next output.
+     */
+    dsm_time_t _nextTime;
+
+    /**
+     * Index of each requested output variable in the output sample.
+     */
+    std::map<Variable*,unsigned int> _outVarIndices;
+
+    std::map<dsm_sample_id_t,std::vector<unsigned int> > _inmap;
+
+    std::map<dsm_sample_id_t,std::vector<unsigned int> > _lenmap;
+
+    std::map<dsm_sample_id_t,std::vector<unsigned int> > _outmap;
+
+    unsigned int _ndataValues;
+
+    /**
+     * The values of each output value in the window, in the
+     * order received, with their running sums and counts.
+     */
+    typedef std::pair<dsm_time_t, double> TimedValue;
+    std::vector<std::deque<TimedValue> > _values;
+
+    std::vector<double> _sums;
+
+    std::vector<int> _cnts;
+
+    /**
+     * Sensors that this averager is a client of.
+     */
+    std::set<DSMSensor*> _sensors;
+
+    LatencyStats _latency;
+
+    nidas::util::Mutex _mutex;
+
+    /** No copying. */
+    SlidingAverager(const SlidingAverager&);
+
+    /** No assignment. */
+    SlidingAverager& operator=(const SlidingAverager&);
+};
+
+}}	// namespace nidas namespace core
+
+#endif
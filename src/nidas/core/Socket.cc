@@ -26,6 +26,7 @@
 
 #include "Socket.h"
 #include "McSocket.h"
+#include "BrokerSocket.h"
 #include "McSocketUDP.h"
 #include "DatagramSocket.h"
 #include "MultipleUDPSockets.h"
@@ -493,6 +494,8 @@ IOChannel* Socket::createSocket(const xercesc::DOMElement* node)
     if (type == "mcaccept" || type == "mcrequest" ||
 	type == "dgaccept" || type == "dgrequest")
     	channel = new McSocket();
+    else if (type == "brokeraccept" || type == "brokerrequest")
+    	channel = new BrokerSocket();
     else if (type == "server")
     	channel = new ServerSocket();
     else if (type == "client" || type.length() == 0)
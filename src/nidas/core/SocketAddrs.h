@@ -45,6 +45,12 @@
 
 #define NIDAS_VARIABLE_LIST_PORT_TCP    30007   // server port for providing list of variables
 
+#define NIDAS_BROKER_PORT_TCP           30008   // ConnectionBroker connections from DSMs
+
+#define DSM_JSONRPC_PORT_TCP            30009   // dsm process JSON over HTTP, loopback only
+
+#define DSM_SERVER_JSONRPC_PORT_TCP     30010   // dsm_server JSON over HTTP, loopback only
+
 #define NIDAS_MULTICAST_ADDR "239.0.0.10"
 
 #endif
@@ -25,6 +25,7 @@
 */
 
 #include "TimetagAdjuster.h"
+#include "ClockModel.h"
 #include "SampleTracer.h"
 #include <nidas/util/Logger.h>
 
@@ -58,7 +59,8 @@ TimetagAdjuster::TimetagAdjuster(dsm_sample_id_t id, double rate):
     _nBigTdiff(0),
     _nworsen(0),
     _nimprove(0),
-    _nSamp5Min(5 * 60 * USECS_PER_SEC / _dtUsec)
+    _nSamp5Min(5 * 60 * USECS_PER_SEC / _dtUsec),
+    _clock(ClockModel::getInstance(GET_DSM_ID(id)))
 {
     /*
      * _npts = max(5, 1 * USECS_PER_SEC / dtUsec)
@@ -72,6 +74,19 @@ TimetagAdjuster::TimetagAdjuster(dsm_sample_id_t id, double rate):
 }
 
 dsm_time_t TimetagAdjuster::adjust(dsm_time_t tt)
+{
+    if (_clock) tt = _clock->correct(tt);
+    return adjustCorrected(tt);
+}
+
+void TimetagAdjuster::adjust(dsm_time_t* tt, unsigned int n)
+{
+    if (_clock) _clock->correct(tt, n);
+    for (unsigned int i = 0; i < n; i++)
+        tt[i] = adjustCorrected(tt[i]);
+}
+
+dsm_time_t TimetagAdjuster::adjustCorrected(dsm_time_t tt)
 {
     /*
      * To enable the SampleTracer for a given sample id, add these arguments
@@ -32,6 +32,7 @@
 
 namespace nidas { namespace core {
 
+class ClockModel;
 class SampleTracer;
 
 /**
@@ -40,6 +41,11 @@ class SampleTracer;
  * at acquisition time.
  *
  * See nidas/doc/timetags.md for a discussion of the algorithm.
+ *
+ * Before the adjustment, the time tags are corrected to the reference
+ * clock of the DSM, using the ClockModel that the sensors of the DSM
+ * share. The correction has no effect unless the model is being fed,
+ * for example by an IRIGSensor.
  */
 
 class TimetagAdjuster {
@@ -58,6 +64,21 @@ public:
      */
     dsm_time_t adjust(dsm_time_t tt);
 
+    /**
+     * Adjust an array of successive time tags in place. The clock model
+     * correction is applied to the whole array in one pass, before
+     * the time tags are adjusted.
+     */
+    void adjust(dsm_time_t* tt, unsigned int n);
+
+    /**
+     * Set the ClockModel used to correct the time tags, or 0 for none.
+     * The default is the shared ClockModel of the DSM of the samples.
+     */
+    void setClockModel(const ClockModel* val) { _clock = val; }
+
+    const ClockModel* getClockModel() const { return _clock; }
+
     /**
      * Log various statistics of the TimetagAdjuster, used by sensors classes
      * on shutdown.
@@ -140,7 +161,12 @@ public:
     static const int BIG_GAP_SECONDS = 10;
 
 private:
-   
+
+    /**
+     * Adjust a time tag which has been corrected by the ClockModel.
+     */
+    dsm_time_t adjustCorrected(dsm_time_t tt);
+
     /**
      * Result time tags will have a integral number of delta-Ts
      * from this base time. This base time is slowly adjusted
@@ -234,6 +260,8 @@ private:
      * Number of samples in 5 minutes, used for running average.
      */
     unsigned int _nSamp5Min;
+
+    const ClockModel* _clock;
 };
 
 }}	// namespace nidas namespace core
@@ -25,9 +25,11 @@
 */
 
 #include "XmlRpcThread.h"
+#include "JsonRpcServer.h"
 #include "DSMEngine.h"
 #include "Datagrams.h"
 #include <nidas/util/Logger.h>
+#include <xmlrpcpp/XmlRpcException.h>
 
 #include <iostream>
 
@@ -36,7 +38,8 @@ using namespace std;
 using namespace XmlRpc;
 
 XmlRpcThread::XmlRpcThread(const std::string& name):
-    Thread(name), _xmlrpc_server(0)
+    Thread(name), _xmlrpc_server(new XmlRpcServer),_dispatcher(name),
+    _dispatchedMethods(),_jsonServer(0)
 {
     // unblock SIGUSR1 to register a signal handler, then block it
     // so that the pselect within XmlRpcDispatch will catch it.
@@ -50,6 +53,7 @@ void XmlRpcThread::interrupt()
     // XmlRpcServer::work(-1.0) if there are no rpc
     // requests coming in, but we'll do it anyway.
     if (_xmlrpc_server) _xmlrpc_server->exit();
+    if (_jsonServer) _jsonServer->interrupt();
     try {
         kill(SIGUSR1);
     }
@@ -62,6 +66,64 @@ XmlRpcThread::~XmlRpcThread()
 {
     // user must have done a join of this thread before calling
     // this destructor.
+    stopDispatching();
     if (_xmlrpc_server) _xmlrpc_server->shutdown();
+    list<DispatchedMethod*>::iterator mi = _dispatchedMethods.begin();
+    for ( ; mi != _dispatchedMethods.end(); ++mi) delete *mi;
     delete _xmlrpc_server;
 }
+
+XmlRpcThread::DispatchedMethod::DispatchedMethod(XmlRpcServerMethod* method,
+        XmlRpcServer* server, RpcDispatcher* dispatcher):
+    XmlRpcServerMethod(method->name(), server),_method(method),
+    _dispatcher(dispatcher)
+{
+}
+
+void XmlRpcThread::DispatchedMethod::execute(XmlRpcValue& params,
+        XmlRpcValue& result)
+{
+    // the XmlRpcServer returns a fault response to the client
+    if (!_dispatcher->execute(name(), params, result))
+        throw XmlRpcException(string(result));
+}
+
+void XmlRpcThread::addMethod(XmlRpcServerMethod* method, float timeout,
+        int maxConcurrent)
+{
+    _dispatcher.addMethod(method, timeout, maxConcurrent);
+    _dispatchedMethods.push_back(
+        new DispatchedMethod(method, _xmlrpc_server, &_dispatcher));
+}
+
+void XmlRpcThread::startDispatching(int jsonPort)
+{
+    _dispatcher.start();
+    try {
+        _jsonServer = new JsonRpcServer(&_dispatcher,
+            nidas::util::Inet4SocketAddress(
+                nidas::util::Inet4Address::getByName("127.0.0.1"), jsonPort));
+        _jsonServer->start();
+    }
+    catch (const nidas::util::Exception& e) {
+        WLOG(("%s: JSON RPC not available: %s", getName().c_str(), e.what()));
+        delete _jsonServer;
+        _jsonServer = 0;
+    }
+}
+
+void XmlRpcThread::stopDispatching()
+{
+    if (_jsonServer) {
+        _jsonServer->interrupt();
+        try {
+            _jsonServer->join();
+        }
+        catch (const nidas::util::Exception& e) {
+            WLOG(("%s: %s", _jsonServer->getName().c_str(), e.what()));
+        }
+        delete _jsonServer;
+        _jsonServer = 0;
+    }
+    _dispatcher.stop();
+}
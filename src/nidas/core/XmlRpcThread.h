@@ -27,14 +27,25 @@
 #ifndef NIDAS_CORE_XMLRPCTHREAD_H
 #define NIDAS_CORE_XMLRPCTHREAD_H
 
+#include "RpcDispatcher.h"
+
 #include <nidas/util/Thread.h>
 #include <xmlrpcpp/XmlRpc.h>
 
 namespace nidas { namespace core {
 
+class JsonRpcServer;
+
 /**
  * A thread that provides XML-based Remote Procedure Calls
  * to web interfaces.
+ *
+ * Methods added with addMethod() are executed by an RpcDispatcher,
+ * in a pool of worker threads, and are also served as JSON over HTTP
+ * by a JsonRpcServer on the loopback interface.  The XmlRpcServer
+ * executes one request at a time, but it waits no longer than the
+ * timeout of a method for its result, so a method which hangs does
+ * not lock up the XML-RPC interface.
  */
 class XmlRpcThread: public nidas::util::Thread
 {
@@ -47,12 +58,60 @@ public:
 
     void interrupt();
 
+    /**
+     * Serve a method from the XmlRpcServer and the JsonRpcServer,
+     * executing it in the RpcDispatcher.  The method should have been
+     * constructed with a NULL XmlRpcServer.
+     * @see RpcDispatcher::addMethod().
+     */
+    void addMethod(XmlRpc::XmlRpcServerMethod* method, float timeout = 0.0,
+        int maxConcurrent = 0);
+
 protected:
 
+    /**
+     * Start the workers of the RpcDispatcher and a JsonRpcServer on
+     * port jsonPort of the loopback interface. Failure to bind
+     * the port is logged, and is otherwise ignored.
+     */
+    void startDispatching(int jsonPort);
+
+    /**
+     * Stop the JsonRpcServer and the workers of the RpcDispatcher.
+     */
+    void stopDispatching();
+
     XmlRpc::XmlRpcServer* _xmlrpc_server;
 
+    RpcDispatcher _dispatcher;
+
 private:
 
+    /**
+     * Registered with the XmlRpcServer in place of a method added
+     * with addMethod(), to execute it in the RpcDispatcher.
+     */
+    class DispatchedMethod: public XmlRpc::XmlRpcServerMethod
+    {
+    public:
+        DispatchedMethod(XmlRpc::XmlRpcServerMethod* method,
+            XmlRpc::XmlRpcServer* server, RpcDispatcher* dispatcher);
+
+        void execute(XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result);
+
+        std::string help() { return _method->help(); }
+
+    private:
+        XmlRpc::XmlRpcServerMethod* _method;
+        RpcDispatcher* _dispatcher;
+        DispatchedMethod(const DispatchedMethod&);
+        DispatchedMethod& operator=(const DispatchedMethod&);
+    };
+
+    std::list<DispatchedMethod*> _dispatchedMethods;
+
+    JsonRpcServer* _jsonServer;
+
     /** Copy not needed */
     XmlRpcThread(const XmlRpcThread&);
 
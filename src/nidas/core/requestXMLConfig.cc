@@ -27,46 +27,22 @@
 #include "XMLParser.h"
 #include "XMLConfigInput.h"
 #include "XMLFdInputSource.h"
+#include "ConnectionBroker.h"
 #include <nidas/util/Logger.h>
 #include <nidas/util/auto_ptr.h>
 
 namespace n_c = nidas::core;
 namespace n_u = nidas::util;
 
-extern xercesc::DOMDocument* n_c::requestXMLConfig(bool all,
-  const n_u::Inet4SocketAddress& mcastAddr, sigset_t* signalMask)
-{
-    DLOG(("entering requestXMLConfig(all=") << all
-         << ",mcastaddr=" << mcastAddr.toString() << ")");
+namespace {
 
-    // XMLConfigInput is a McSocket<nidas::util::Socket> whose default
-    // request type is XML_CONFIG.
-    n_c::XMLConfigInput xmlRequestSocket;
-    if (all)
-    {
-        xmlRequestSocket.setRequestType(XML_ALL_CONFIG);
-    }
-    xmlRequestSocket.setInet4McastSocketAddress(mcastAddr);
-
-    n_u::auto_ptr<n_u::Socket> configSock;
-    n_u::Inet4PacketInfoX pktinfo;
-
-    DLOG(("calling connect() on XMLConfigInput..."));
-    try {
-        if ( signalMask != (sigset_t*)0 )
-            pthread_sigmask(SIG_UNBLOCK,signalMask,0);
-        configSock.reset(xmlRequestSocket.connect(pktinfo));
-        if ( signalMask != (sigset_t*)0 )
-            pthread_sigmask(SIG_BLOCK,signalMask,0);
-    }
-    catch(...) {
-        if ( signalMask != (sigset_t*)0 )
-            pthread_sigmask(SIG_BLOCK,signalMask,0);
-        xmlRequestSocket.close();
-        throw;
-    }
-    xmlRequestSocket.close();
-    DLOG(("connect() finished."));
+/**
+ * Parse the XML read from a socket, and close it.
+ */
+xercesc::DOMDocument* parseXMLConfig(n_u::Socket* sock,
+    const std::string& sockName)
+{
+    n_u::auto_ptr<n_u::Socket> configSock(sock);
 
     xercesc::DOMDocument* doc = 0;
     try {
@@ -83,8 +59,6 @@ extern xercesc::DOMDocument* n_c::requestXMLConfig(bool all,
         // This happend both on x86_64 and armbe with xercesc 3.1.
         // Apparently the destructor for xercesc::InputSource should be invoked
         // before the destructor of xercesc:: DOMBuilder.
-        std::string sockName;
-        sockName = configSock->getRemoteSocketAddress().toAddressString();
         DLOG(("requestXMLConfig: sockName: ") << sockName);
 
         n_c::XMLFdInputSource sockSource(sockName,configSock->getFd());
@@ -109,3 +83,69 @@ extern xercesc::DOMDocument* n_c::requestXMLConfig(bool all,
     DLOG(("successful return from requestXMLConfig()"));
     return doc;
 }
+
+}
+
+extern xercesc::DOMDocument* n_c::requestXMLConfig(bool all,
+  const n_u::Inet4SocketAddress& mcastAddr, sigset_t* signalMask)
+{
+    DLOG(("entering requestXMLConfig(all=") << all
+         << ",mcastaddr=" << mcastAddr.toString() << ")");
+
+    // XMLConfigInput is a McSocket<nidas::util::Socket> whose default
+    // request type is XML_CONFIG.
+    n_c::XMLConfigInput xmlRequestSocket;
+    if (all)
+    {
+        xmlRequestSocket.setRequestType(XML_ALL_CONFIG);
+    }
+    xmlRequestSocket.setInet4McastSocketAddress(mcastAddr);
+
+    n_u::auto_ptr<n_u::Socket> configSock;
+    n_u::Inet4PacketInfoX pktinfo;
+
+    DLOG(("calling connect() on XMLConfigInput..."));
+    try {
+        if ( signalMask != (sigset_t*)0 )
+            pthread_sigmask(SIG_UNBLOCK,signalMask,0);
+        configSock.reset(xmlRequestSocket.connect(pktinfo));
+        if ( signalMask != (sigset_t*)0 )
+            pthread_sigmask(SIG_BLOCK,signalMask,0);
+    }
+    catch(...) {
+        if ( signalMask != (sigset_t*)0 )
+            pthread_sigmask(SIG_BLOCK,signalMask,0);
+        xmlRequestSocket.close();
+        throw;
+    }
+    xmlRequestSocket.close();
+    DLOG(("connect() finished."));
+
+    std::string sockName =
+        configSock->getRemoteSocketAddress().toAddressString();
+    return parseXMLConfig(configSock.release(), sockName);
+}
+
+extern xercesc::DOMDocument* n_c::requestXMLConfigBroker(bool all,
+  const n_u::Inet4SocketAddress& server, sigset_t* signalMask)
+{
+    DLOG(("entering requestXMLConfigBroker(all=") << all
+         << ",server=" << server.toString() << ")");
+
+    // a signal caught while waiting interrupts the wait
+    sigset_t sigmask;
+    pthread_sigmask(SIG_BLOCK, 0, &sigmask);
+    if (signalMask) {
+        for (int sig = 1; sig < NSIG; sig++)
+            if (sigismember(signalMask, sig)) sigdelset(&sigmask, sig);
+    }
+
+    n_c::ConnectionBroker* broker = n_c::ConnectionBroker::getInstance();
+    n_u::Socket* sock = broker->connect(server,
+        (all ? XML_ALL_CONFIG : XML_CONFIG), &sigmask);
+
+    // Other connections of this process go to the same server.
+    broker->setDefaultServerAddress(server);
+
+    return parseXMLConfig(sock, server.toAddressString());
+}
@@ -50,6 +50,22 @@ requestXMLConfig(bool all,
                  const n_u::Inet4SocketAddress& mcastAddr,
                  sigset_t* signalMask=(sigset_t*)0 );
 
+/**
+ * Request the XML configuration as a stream of the ConnectionBroker
+ * from a server, which then becomes the default server address
+ * of the ConnectionBroker.
+ * @param all: If true, request the entire project XML, otherwise just
+ *    the XML which corresponds to the address of the calling DSM.
+ * @param signalMask: Signals which are unblocked while waiting
+ *    for the connection.
+ *
+ * @throws nidas::util::Exception
+ **/
+extern xercesc::DOMDocument*
+requestXMLConfigBroker(bool all,
+                       const n_u::Inet4SocketAddress& server,
+                       sigset_t* signalMask=(sigset_t*)0 );
+
 }}  // namespace nidas namespace core
 
 #endif // REQUESTXMLCONFIG_H
@@ -32,6 +32,7 @@
 
 #include <nidas/util/Logger.h>
 
+#include <algorithm>
 #include <cmath>
 
 #include <iostream>
@@ -134,7 +135,6 @@ bool A2DSensor::process(const Sample* insamp,list<const Sample*>& results) throw
 
     A2DSampleInfo& sinfo = _sampleInfos[sindex];
     SampleTag* stag = sinfo.stag;
-    const vector<Variable*>& vars = stag->getVariables();
 
     SampleT<float>* osamp = getSample<float>(sinfo.nvalues);
     osamp->setTimeTag(insamp->getTimeTag() - getLagUsecs());
@@ -142,29 +142,15 @@ bool A2DSensor::process(const Sample* insamp,list<const Sample*>& results) throw
     float *fp = osamp->getDataPtr();
     const float* fpend = fp + sinfo.nvalues;
 
-    for (unsigned int ivar = 0; ivar < vars.size(); ivar++) {
-        Variable* var = vars[ivar];
-        int ichan = sinfo.channels[ivar];
-
-        for (unsigned int ival = 0; sp < spend && ival < var->getLength();
-             ival++, fp++)
-        {
-            short sval = *sp++;
-            if (getOutputMode() == Counts) {
-                *fp = sval;
-                continue;
-            }
-
-            if (sval == -32768 || sval == 32767) {
-                *fp = floatNAN;
-                continue;
-            }
-
-            float fval = getInitialConverter()->convert(ichan, sval);
-            fval = getFinalConverter()->convert(ichan, fval);
-            *fp = fval;
-        }
+    int n = std::min((int)(spend - sp), sinfo.nvalues);
+    if (getOutputMode() == Counts) {
+        for (int i = 0; i < n; i++) fp[i] = sp[i];
+    }
+    else {
+        updateConversions(sinfo);
+        convertSample(sinfo, sp, fp, n);
     }
+    fp += n;
 
     for ( ; fp < fpend; ) *fp++ = floatNAN;
     if (getOutputMode() == Engineering) applyConversions(stag, osamp);
@@ -173,6 +159,83 @@ bool A2DSensor::process(const Sample* insamp,list<const Sample*>& results) throw
     return true;
 }
 
+void A2DSensor::updateConversions(A2DSampleInfo& sinfo)
+{
+    A2DConverter* initial = getInitialConverter();
+    A2DConverter* final = getFinalConverter();
+
+    unsigned int changes = initial->getChangeCount() + final->getChangeCount();
+    if (changes == sinfo.convChanges) return;
+    sinfo.convChanges = changes;
+
+    sinfo.intercepts.resize(sinfo.nvalues);
+    sinfo.slopes.resize(sinfo.nvalues);
+    sinfo.exactValues.clear();
+
+    const vector<Variable*>& vars = sinfo.stag->getVariables();
+    int ival = 0;
+    for (unsigned int iv = 0; iv < vars.size(); iv++) {
+        int ichan = sinfo.channels[iv];
+        float b0, m0, b1, m1;
+        bool linear = isLinearChannel(ichan) &&
+            initial->getLinear(ichan, b0, m0) &&
+            final->getLinear(ichan, b1, m1);
+        for (unsigned int i = 0; i < vars[iv]->getLength() &&
+                ival < sinfo.nvalues; i++, ival++) {
+            if (linear) {
+                // b1 + m1 * (b0 + m0 * counts)
+                sinfo.intercepts[ival] = b1 + (double)m1 * b0;
+                sinfo.slopes[ival] = (double)m1 * m0;
+            }
+            else {
+                sinfo.intercepts[ival] = floatNAN;
+                sinfo.slopes[ival] = floatNAN;
+                sinfo.exactValues.push_back(make_pair(ival, ichan));
+            }
+        }
+    }
+}
+
+void A2DSensor::convertCounts(const short* __restrict__ sp,
+    const float* __restrict__ intercepts, const float* __restrict__ slopes,
+    float* __restrict__ fp, int n)
+{
+    // Blocks of a fixed length are vectorized by gcc at -O2,
+    // where a loop of unknown length is not.
+    int i = 0;
+    for ( ; i + 8 <= n; i += 8) {
+        const short* s = sp + i;
+        const float* b = intercepts + i;
+        const float* m = slopes + i;
+        float* f = fp + i;
+        for (int j = 0; j < 8; j++) f[j] = b[j] + m[j] * s[j];
+    }
+    for ( ; i < n; i++) fp[i] = intercepts[i] + slopes[i] * sp[i];
+
+    for (i = 0; i < n; i++)
+        if (sp[i] == -32768 || sp[i] == 32767) fp[i] = floatNAN;
+}
+
+void A2DSensor::convertSample(A2DSampleInfo& sinfo, const short* sp,
+    float* fp, int n)
+{
+    convertCounts(sp, &sinfo.intercepts[0], &sinfo.slopes[0], fp, n);
+
+    for (unsigned int i = 0; i < sinfo.exactValues.size(); i++) {
+        int ival = sinfo.exactValues[i].first;
+        if (ival >= n) break;
+        short sval = sp[ival];
+        if (sval == -32768 || sval == 32767) continue;
+        fp[ival] = convertValue(sinfo.exactValues[i].second, sval);
+    }
+}
+
+float A2DSensor::convertValue(int ichan, short sval)
+{
+    float fval = getInitialConverter()->convert(ichan, sval);
+    return getFinalConverter()->convert(ichan, fval);
+}
+
 void A2DSensor::validate()
 {
     /*
@@ -243,9 +243,12 @@ protected:
     {
     public:
         A2DSampleInfo(int n)
-            : nvars(n),nvalues(0),stag(0),channels(nvars) {}
+            : nvars(n),nvalues(0),stag(0),channels(nvars),
+            intercepts(),slopes(),exactValues(),convChanges(~0u) {}
         A2DSampleInfo(const A2DSampleInfo& x): nvars(x.nvars),nvalues(x.nvalues),
-            stag(x.stag),channels(x.channels)
+            stag(x.stag),channels(x.channels),intercepts(x.intercepts),
+            slopes(x.slopes),exactValues(x.exactValues),
+            convChanges(x.convChanges)
         {
         }
         A2DSampleInfo& operator= (const A2DSampleInfo& rhs)
@@ -255,6 +258,10 @@ protected:
                 nvalues = rhs.nvalues;
                 stag = rhs.stag;
                 channels = rhs.channels;
+                intercepts = rhs.intercepts;
+                slopes = rhs.slopes;
+                exactValues = rhs.exactValues;
+                convChanges = rhs.convChanges;
             }
             return *this;
         }
@@ -264,8 +271,64 @@ protected:
         int nvalues;
         SampleTag* stag;
         std::vector<int> channels;
+
+        /**
+         * The initial and final conversions of each value of the
+         * sample, fused into one intercept and slope.
+         * @see updateConversions().
+         */
+        std::vector<float> intercepts;
+        std::vector<float> slopes;
+
+        /**
+         * Value index and channel of the values whose conversion
+         * is not linear, which are converted by convertValue().
+         */
+        std::vector<std::pair<int, int> > exactValues;
+
+        /**
+         * Sum of the change counts of the converters when the
+         * fused conversions were computed.
+         */
+        unsigned int convChanges;
     };
 
+    /**
+     * Compute the fused conversions of a sample, if the
+     * converters have changed since they were last computed.
+     */
+    void updateConversions(A2DSampleInfo& sinfo);
+
+    /**
+     * Convert n A2D counts with fused intercepts and slopes,
+     * setting the values of out-of-range counts, -32768 and 32767,
+     * to NAN.  The conversion loop has no branches or calls,
+     * so that the compiler can vectorize it.
+     */
+    static void convertCounts(const short* __restrict__ sp,
+        const float* __restrict__ intercepts,
+        const float* __restrict__ slopes, float* __restrict__ fp, int n);
+
+    /**
+     * Convert the values of a sample from counts, the values
+     * of fused conversions with convertCounts() and the others
+     * with convertValue().
+     * @param n Number of counts, up to sinfo.nvalues.
+     */
+    void convertSample(A2DSampleInfo& sinfo, const short* sp, float* fp, int n);
+
+    /**
+     * Whether the conversion of a channel consists of only the
+     * initial and final conversions.  Derived classes which do
+     * more should return false, and override convertValue().
+     */
+    virtual bool isLinearChannel(int) const { return true; }
+
+    /**
+     * Convert one value of a channel that is not linear.
+     */
+    virtual float convertValue(int ichan, short sval);
+
     std::vector<A2DSampleInfo> _sampleInfos;
 
     /**
@@ -32,6 +32,8 @@
 #include <nidas/util/UTime.h>
 #include <nidas/util/Logger.h>
 
+#include <algorithm>
+
 using namespace nidas::dynld;
 using namespace nidas::core;
 using namespace std;
@@ -42,14 +44,16 @@ NIDAS_CREATOR_FUNCTION(IEEE_Float)
 
 IEEE_Float::IEEE_Float(): SerialSensor(),
     _endian(nidas::util::EndianConverter::EC_LITTLE_ENDIAN),
-    _converter(0),_sampleTag(0),_nvars(0)
+    _floatsIn(0),_sampleTag(0),_nvars(0)
 {
 }
 
 void IEEE_Float::init()
 {
-    _converter = n_u::EndianConverter::getConverter(_endian,
-            n_u::EndianConverter::getHostEndianness());
+    if (_endian == n_u::EndianConverter::EC_BIG_ENDIAN)
+        _floatsIn = &n_u::BigEndianIn::floatToFloat;
+    else
+        _floatsIn = &n_u::LittleEndianIn::floatToFloat;
 }
 
 void IEEE_Float::validate()
@@ -109,13 +113,14 @@ bool IEEE_Float::process(const Sample* samp,list<const Sample*>& results)
     float* dout = outs->getDataPtr();
     const vector<Variable*>& vars = _sampleTag->getVariables();
 
+    // convert all the floats in the sample at once, then apply
+    // the variable conversions in place.
+    int nin = std::min(_nvars, (int)((deod - dp) / sizeof(float)));
+    _floatsIn(dp, dout, nin);
+
     int iv = 0;
-    for ( ; iv < _nvars && dp + sizeof(float) <= deod; iv++) {
-        Variable* var = vars[iv];
-        float val = _converter->floatValue(dp);
-        var->convert(outs->getTimeTag(), &val, 1, dout++);
-        dp += sizeof(float);
-    }
+    for ( ; iv < nin; iv++, dout++)
+        vars[iv]->convert(outs->getTimeTag(), dout, 1);
     for ( ; iv < _nvars; iv++) *dout++ = floatNAN;
 
     results.push_back(outs);
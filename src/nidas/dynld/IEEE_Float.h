@@ -68,7 +68,10 @@ private:
 
     nidas::util::EndianConverter::endianness _endian;
 
-    const nidas::util::EndianConverter* _converter;
+    /**
+     * Bulk conversion of the input floats, chosen from _endian in init().
+     */
+    void (*_floatsIn)(const void* p, float* out, unsigned int n);
 
     SampleTag* _sampleTag;
 
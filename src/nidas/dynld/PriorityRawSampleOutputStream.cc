@@ -0,0 +1,274 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "PriorityRawSampleOutputStream.h"
+#include <nidas/core/DSMSensor.h>
+
+#include <nidas/util/Logger.h>
+#include <nidas/util/UTime.h>
+
+using namespace nidas::core;
+using namespace nidas::dynld;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+NIDAS_CREATOR_FUNCTION(PriorityRawSampleOutputStream)
+
+namespace {
+
+/**
+ * Period for measuring the rate of samples whose SampleTag has no rate.
+ */
+const dsm_time_t RATE_MEASURE_USECS = 10 * USECS_PER_SEC;
+
+/**
+ * Period for measuring link throughput.
+ */
+const dsm_time_t THROUGHPUT_USECS = 10 * USECS_PER_SEC;
+
+/**
+ * Period for logging the counts, if any samples were deferred.
+ */
+const dsm_time_t STATUS_LOG_USECS = 60 * USECS_PER_SEC;
+
+/**
+ * Value of a "priority" parameter of a SampleTag, or an empty string.
+ */
+string priorityParameter(const SampleTag* tag)
+{
+    const Parameter* param = tag->getParameter("priority");
+    if (!param || param->getType() != Parameter::STRING_PARAM ||
+            param->getLength() != 1) return "";
+    return param->getStringValue(0);
+}
+
+}
+
+PriorityRawSampleOutputStream::PriorityRawSampleOutputStream():
+    SpoolRawSampleOutputStream(),
+    _highRate(5.0),_decimate(10),
+    _idStates(),_congested(false),
+    _statusTime(0),_statusBytes(0),_throughput(0.0),
+    _ndecimated(0),_ncongestions(0),
+    _nlogDeferred(0),_nlogDecimated(0),_logTime(0)
+{
+}
+
+PriorityRawSampleOutputStream::PriorityRawSampleOutputStream(IOChannel* i,
+        SampleConnectionRequester* rqstr):
+    SpoolRawSampleOutputStream(i,rqstr),
+    _highRate(5.0),_decimate(10),
+    _idStates(),_congested(false),
+    _statusTime(0),_statusBytes(0),_throughput(0.0),
+    _ndecimated(0),_ncongestions(0),
+    _nlogDeferred(0),_nlogDecimated(0),_logTime(0)
+{
+    setName("PriorityRawSampleOutputStream: " + getIOChannel()->getName());
+}
+
+PriorityRawSampleOutputStream::PriorityRawSampleOutputStream(
+        PriorityRawSampleOutputStream& x, IOChannel* iochannel):
+    SpoolRawSampleOutputStream(x,iochannel),
+    _highRate(x._highRate),_decimate(x._decimate),
+    _idStates(),_congested(false),
+    _statusTime(0),_statusBytes(0),_throughput(0.0),
+    _ndecimated(0),_ncongestions(0),
+    _nlogDeferred(0),_nlogDecimated(0),_logTime(0)
+{
+    setName("PriorityRawSampleOutputStream: " + getIOChannel()->getName());
+}
+
+PriorityRawSampleOutputStream::~PriorityRawSampleOutputStream()
+{
+}
+
+PriorityRawSampleOutputStream*
+PriorityRawSampleOutputStream::clone(IOChannel* iochannel)
+{
+    return new PriorityRawSampleOutputStream(*this,iochannel);
+}
+
+void PriorityRawSampleOutputStream::fromDOMElement(
+        const xercesc::DOMElement* node)
+{
+    SpoolRawSampleOutputStream::fromDOMElement(node);
+
+    const Parameter* param = getParameter("highRate");
+    if (param) {
+        if (param->getLength() != 1 || param->getNumericValue(0) <= 0.0)
+            throw n_u::InvalidParameterException(getName(),
+                "parameter", "bad value for highRate");
+        setHighRate(param->getNumericValue(0));
+    }
+    param = getParameter("decimate");
+    if (param) {
+        if (param->getLength() != 1 || param->getNumericValue(0) < 1.0)
+            throw n_u::InvalidParameterException(getName(),
+                "parameter", "bad value for decimate");
+        setDecimate((unsigned int) param->getNumericValue(0));
+    }
+}
+
+PriorityRawSampleOutputStream::priority
+PriorityRawSampleOutputStream::configuredPriority(dsm_sample_id_t id) const
+{
+    list<const SampleTag*> tags = getSourceSampleTags();
+    list<const SampleTag*>::const_iterator ti = tags.begin();
+    for ( ; ti != tags.end(); ++ti) {
+        const SampleTag* tag = *ti;
+        if (tag->getId() != id) continue;
+
+        string pval = priorityParameter(tag);
+        double rate = tag->getRate();
+
+        // The processed samples of the sensor are where a rate and
+        // parameters are usually configured.
+        const DSMSensor* sensor = tag->getDSMSensor();
+        if (sensor) {
+            list<const SampleTag*> stags = sensor->getSampleTags();
+            list<const SampleTag*>::const_iterator si = stags.begin();
+            for ( ; si != stags.end(); ++si) {
+                if (pval.empty()) pval = priorityParameter(*si);
+                rate = std::max(rate, (*si)->getRate());
+            }
+        }
+        if (pval == "essential") return PRIORITY_ESSENTIAL;
+        if (pval == "bulk") return PRIORITY_BULK;
+        if (!pval.empty())
+            WLOG(("%s: unknown priority \"%s\" for sample %d,%d",
+                  getName().c_str(), pval.c_str(),
+                  GET_DSM_ID(id), GET_SPS_ID(id)));
+        if (rate > 0.0)
+            return rate >= _highRate ? PRIORITY_BULK : PRIORITY_ESSENTIAL;
+        break;
+    }
+    return PRIORITY_UNKNOWN;
+}
+
+PriorityRawSampleOutputStream::IdState&
+PriorityRawSampleOutputStream::getIdState(const Sample* samp)
+{
+    dsm_sample_id_t id = samp->getId();
+    map<dsm_sample_id_t, IdState>::iterator mi = _idStates.find(id);
+    if (mi == _idStates.end()) {
+        mi = _idStates.insert(make_pair(id, IdState())).first;
+        mi->second.prio = configuredPriority(id);
+        mi->second.firstTime = samp->getTimeTag();
+    }
+    IdState& state = mi->second;
+
+    if (state.prio == PRIORITY_UNKNOWN) {
+        dsm_time_t dt = samp->getTimeTag() - state.firstTime;
+        if (dt >= RATE_MEASURE_USECS) {
+            double rate = state.nseen / ((double)dt / USECS_PER_SEC);
+            state.prio = rate >= _highRate ?
+                PRIORITY_BULK : PRIORITY_ESSENTIAL;
+            DLOG(("%s: sample %d,%d, measured rate=%.2f, %s",
+                  getName().c_str(), GET_DSM_ID(id), GET_SPS_ID(id), rate,
+                  (state.prio == PRIORITY_BULK ? "bulk" : "essential")));
+        }
+        else state.nseen++;
+    }
+    return state;
+}
+
+void PriorityRawSampleOutputStream::setCongested(bool val)
+{
+    if (val == _congested) return;
+    _congested = val;
+    if (val && (_ncongestions++ < 10 || !(_ncongestions % 100)))
+        ILOG(("%s: link congested, throughput=%.0f bytes/sec, "
+              "times congested=%lld", getName().c_str(), _throughput,
+              _ncongestions));
+}
+
+void PriorityRawSampleOutputStream::updateStatus()
+{
+    IOStream* ios = getIOStream();
+    dsm_time_t tnow = n_u::getSystemTime();
+    long long nbytes = ios->getNumOutputBytes();
+
+    if (_statusTime == 0) {
+        _statusTime = _logTime = tnow;
+        _statusBytes = nbytes;
+        return;
+    }
+    // a new IOStream is created on a reconnection
+    if (nbytes < _statusBytes) _statusBytes = 0;
+
+    if (tnow - _statusTime >= THROUGHPUT_USECS) {
+        _throughput = (nbytes - _statusBytes) /
+            ((double)(tnow - _statusTime) / USECS_PER_SEC);
+        _statusTime = tnow;
+        _statusBytes = nbytes;
+    }
+
+    if (tnow - _logTime >= STATUS_LOG_USECS) {
+        if (_congested || getNumDeferredSamples() != _nlogDeferred ||
+                _ndecimated != _nlogDecimated)
+            ILOG(("%s: throughput=%.0f bytes/sec, congested=%d, "
+                  "deferred=%lld, decimated=%lld, backfilled=%lld, "
+                  "spooled bytes=%lld", getName().c_str(), _throughput,
+                  _congested, getNumDeferredSamples(), _ndecimated,
+                  getNumBackfilledSamples(), getSpoolPendingBytes()));
+        _nlogDeferred = getNumDeferredSamples();
+        _nlogDecimated = _ndecimated;
+        _logTime = tnow;
+    }
+}
+
+size_t PriorityRawSampleOutputStream::write(const Sample* samp,
+        bool streamFlush)
+{
+    IOStream* ios = getIOStream();
+    if (!ios) return 0;
+
+    updateStatus();
+
+    IdState& state = getIdState(samp);
+    size_t slen = samp->getHeaderLength() + samp->getDataByteLength();
+
+    if (_congested && state.prio == PRIORITY_BULK &&
+            (state.count++ % _decimate) != 0) {
+        if (!defer(samp)) _ndecimated++;
+        return slen;
+    }
+
+    size_t l = SampleOutputStream::write(samp, streamFlush);
+    if (l == 0) {
+        setCongested(true);
+        return defer(samp) ? slen : 0;
+    }
+
+    // IOStream empties its buffer on a successful physical write.
+    if (ios->available() == 0) setCongested(false);
+    else if (ios->available() > ios->getBufferLength() / 2)
+        setCongested(true);
+
+    if (!_congested && !backfill()) setCongested(true);
+    return l;
+}
@@ -0,0 +1,199 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_DYNLD_PRIORITYRAWSAMPLEOUTPUTSTREAM_H
+#define NIDAS_DYNLD_PRIORITYRAWSAMPLEOUTPUTSTREAM_H
+
+#include "SpoolRawSampleOutputStream.h"
+
+#include <map>
+#include <algorithm>
+
+namespace nidas { namespace dynld {
+
+/**
+ * A RawSampleOutputStream for slow or unreliable links, which
+ * favors low-rate samples when the link cannot keep up.
+ *
+ * Each raw sample id is put in one of two priority classes. Essential
+ * samples, such as housekeeping and other low-rate samples, are always
+ * written. Bulk samples, such as those from sonics and 2D probes, are
+ * decimated while the link is congested: one of every "decimate"
+ * samples of each id is written, and the others are deferred to the
+ * spool of SpoolRawSampleOutputStream if a spoolDir is configured,
+ * otherwise dropped.  When the link is no longer congested, deferred
+ * samples are replayed from the spool along with the current samples.
+ * As with SpoolRawSampleOutputStream, all samples are spooled while
+ * the output is not connected.
+ *
+ * The link is considered congested when the IOStream fails to write a
+ * sample, or when more than half of the IOStream buffer remains after a
+ * physical write, and no longer congested when a physical write empties
+ * the buffer. A blocking socket will simply wait when the network is
+ * slow, so the socket should be configured with block="false".
+ *
+ * The priority of a sample id is determined, in order, from:
+ * - a "priority" parameter of the raw SampleTag, or of any of the
+ *   sample tags of its sensor, with a value of "essential" or "bulk",
+ * - the rate of the SampleTag, or the highest rate of the samples of
+ *   its sensor, compared to the "highRate" parameter of this output,
+ * - the rate measured over the first 10 seconds, during which the
+ *   samples are treated as essential.
+ *
+ * Parameters of the output:
+ * @code
+ * <output class="PriorityRawSampleOutputStream">
+ *     <socket type="mcrequest" block="false"/>
+ *     <parameter name="highRate" type="float" value="5"/>
+ *     <parameter name="decimate" type="int" value="10"/>
+ *     <parameter name="spoolDir" type="string" value="/var/tmp/nidas_spool"/>
+ *     <parameter name="spoolMaxMB" type="float" value="500"/>
+ * </output>
+ * @endcode
+ */
+class PriorityRawSampleOutputStream: public SpoolRawSampleOutputStream
+{
+public:
+
+    PriorityRawSampleOutputStream();
+
+    PriorityRawSampleOutputStream(IOChannel* iochan,
+            SampleConnectionRequester* rqstr=0);
+
+    virtual ~PriorityRawSampleOutputStream();
+
+    /**
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void fromDOMElement(const xercesc::DOMElement* node);
+
+    /**
+     * Samples with a rate of this value or more are bulk samples.
+     */
+    void setHighRate(float val) { _highRate = val; }
+
+    float getHighRate() const { return _highRate; }
+
+    /**
+     * When congested, write one of every val bulk samples.
+     */
+    void setDecimate(unsigned int val) { _decimate = std::max(val, 1U); }
+
+    unsigned int getDecimate() const { return _decimate; }
+
+    /**
+     * Is the link currently congested?
+     */
+    bool isCongested() const { return _congested; }
+
+    /**
+     * Bytes per second written to the IOChannel, over the last
+     * measurement interval of 10 seconds.
+     */
+    float getLinkThroughput() const { return _throughput; }
+
+    /**
+     * Bulk samples which were not written while congested,
+     * and were not spooled.
+     */
+    long long getNumDecimatedSamples() const { return _ndecimated; }
+
+    using SampleOutputStream::write;
+
+protected:
+
+    PriorityRawSampleOutputStream* clone(IOChannel* iochannel);
+
+    PriorityRawSampleOutputStream(PriorityRawSampleOutputStream&,IOChannel*);
+
+    /**
+     * Write, decimate or defer a sample, according to its priority
+     * and the state of the link, and replay from the spool.
+     *
+     * @throws nidas::util::IOException
+     **/
+    size_t write(const Sample* samp, bool streamFlush);
+
+private:
+
+    enum priority { PRIORITY_UNKNOWN, PRIORITY_ESSENTIAL, PRIORITY_BULK };
+
+    struct IdState
+    {
+        IdState():
+            prio(PRIORITY_UNKNOWN),count(0),firstTime(0),nseen(0)
+        {}
+        priority prio;
+        /** Count of samples while congested, for decimation. */
+        unsigned int count;
+        /** Time and count of samples for measuring their rate. */
+        dsm_time_t firstTime;
+        unsigned int nseen;
+    };
+
+    IdState& getIdState(const Sample* samp);
+
+    priority configuredPriority(dsm_sample_id_t id) const;
+
+    void setCongested(bool val);
+
+    void updateStatus();
+
+    float _highRate;
+
+    unsigned int _decimate;
+
+    std::map<dsm_sample_id_t, IdState> _idStates;
+
+    bool _congested;
+
+    dsm_time_t _statusTime;
+
+    long long _statusBytes;
+
+    float _throughput;
+
+    long long _ndecimated;
+
+    long long _ncongestions;
+
+    /** Counts at the last status log. */
+    long long _nlogDeferred;
+
+    long long _nlogDecimated;
+
+    dsm_time_t _logTime;
+
+    /** No copying. */
+    PriorityRawSampleOutputStream(const PriorityRawSampleOutputStream&);
+
+    /** No assignment. */
+    PriorityRawSampleOutputStream& operator=(const PriorityRawSampleOutputStream&);
+};
+
+}}	// namespace nidas namespace dynld
+
+#endif
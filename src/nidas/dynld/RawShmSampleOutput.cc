@@ -0,0 +1,52 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "RawShmSampleOutput.h"
+
+using namespace nidas::core;
+using namespace nidas::dynld;
+using namespace std;
+
+NIDAS_CREATOR_FUNCTION(RawShmSampleOutput)
+
+RawShmSampleOutput::RawShmSampleOutput(): ShmSampleOutput()
+{
+}
+
+RawShmSampleOutput::RawShmSampleOutput(RawShmSampleOutput& x,
+	IOChannel* iochannel):
+	ShmSampleOutput(x,iochannel)
+{
+}
+
+RawShmSampleOutput::~RawShmSampleOutput()
+{
+}
+
+RawShmSampleOutput* RawShmSampleOutput::clone(IOChannel* iochannel)
+{
+    return new RawShmSampleOutput(*this,iochannel);
+}
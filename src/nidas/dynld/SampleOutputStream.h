@@ -102,9 +102,13 @@ protected:
     SampleOutputStream(SampleOutputStream&,IOChannel*);
 
     /**
+     * Serialize a sample to the IOStream. receive() counts a sample
+     * as discarded if this returns 0. Derived classes can override
+     * it to decide what to do with each sample.
+     *
      * @throws nidas::util::IOException
      **/
-    size_t write(const Sample* samp, bool streamFlush);
+    virtual size_t write(const Sample* samp, bool streamFlush);
 
     IOStream* _iostream;
 
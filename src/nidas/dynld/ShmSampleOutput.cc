@@ -0,0 +1,120 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "ShmSampleOutput.h"
+#include <nidas/core/ShmRingIOChannel.h>
+#include <nidas/core/ShmSampleRing.h>
+
+#include <nidas/util/Logger.h>
+
+#include <byteswap.h>
+
+using namespace nidas::dynld;
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+NIDAS_CREATOR_FUNCTION(ShmSampleOutput)
+
+ShmSampleOutput::ShmSampleOutput():
+    SampleOutputBase(),_ring(0)
+{
+}
+
+/*
+ * Copy constructor, with a new IOChannel.
+ */
+ShmSampleOutput::ShmSampleOutput(ShmSampleOutput& x,IOChannel* ioc):
+    SampleOutputBase(x,ioc),_ring(0)
+{
+}
+
+ShmSampleOutput::~ShmSampleOutput()
+{
+}
+
+ShmSampleOutput* ShmSampleOutput::clone(IOChannel* ioc)
+{
+    return new ShmSampleOutput(*this,ioc);
+}
+
+void ShmSampleOutput::fromDOMElement(const xercesc::DOMElement* node)
+{
+    SampleOutputBase::fromDOMElement(node);
+    ShmRingIOChannel* ioc = dynamic_cast<ShmRingIOChannel*>(getIOChannel());
+    if (!ioc)
+        throw n_u::InvalidParameterException(getName(), "output",
+            "child element must be a shmring");
+    ioc->setWriter(true);
+}
+
+SampleOutput* ShmSampleOutput::connected(IOChannel* ioc) throw()
+{
+    SampleOutput* so = SampleOutputBase::connected(ioc);
+    ShmRingIOChannel* rioc = dynamic_cast<ShmRingIOChannel*>(getIOChannel());
+    if (rioc) _ring = rioc->getRing();
+    return so;
+}
+
+void ShmSampleOutput::close()
+{
+    _ring = 0;
+    SampleOutputBase::close();
+}
+
+bool ShmSampleOutput::receive(const Sample *samp) throw()
+{
+    if (!_ring) return false;
+
+    dsm_time_t tsamp = samp->getTimeTag();
+    try {
+        if (tsamp >= getNextFileTime()) createNextFile(tsamp);
+    }
+    catch(const n_u::IOException& ioe) {
+        WLOG(("%s: %s", getName().c_str(), ioe.what()));
+    }
+
+    bool success;
+    if (__BYTE_ORDER == __BIG_ENDIAN)
+    {
+        // Samples in the ring are in the same byte order as an archive.
+        SampleHeader header;
+        header.setTimeTag(bswap_64(samp->getTimeTag()));
+        header.setDataByteLength(bswap_32(samp->getDataByteLength()));
+        header.setRawId(bswap_32(samp->getRawId()));
+        success = _ring->publish(&header, SampleHeader::getSizeOf(),
+                samp->getConstVoidDataPtr(), samp->getDataByteLength());
+    }
+    else success = _ring->publish(samp);
+
+    if (!success) {
+        if (!(incrementDiscardedSamples() % 1000))
+            WLOG(("%s: %zd samples discarded, too large for ring",
+                  getName().c_str(), getNumDiscardedSamples()));
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_DYNLD_SHMSAMPLEOUTPUT_H
+#define NIDAS_DYNLD_SHMSAMPLEOUTPUT_H
+
+#include <nidas/core/SampleOutput.h>
+
+namespace nidas {
+
+namespace core {
+class ShmSampleRing;
+}
+
+namespace dynld {
+
+using namespace nidas::core;
+
+/**
+ * A SampleOutput which publishes samples to a ShmSampleRing in shared
+ * memory, so that any number of local readers, such as data_dump or
+ * data_stats with an input of shm:name, can read them without the cost
+ * of a socket connection per reader. Each sample is copied once into
+ * the ring, in the same format as it is written to an archive. The
+ * output never blocks: readers which fall too far behind lose samples.
+ *
+ * The IOChannel of a ShmSampleOutput must be a \<shmring\> element.
+ */
+class ShmSampleOutput: public SampleOutputBase
+{
+public:
+
+    ShmSampleOutput();
+
+    virtual ~ShmSampleOutput();
+
+    /**
+     * Creates the ring in the IOChannel.
+     */
+    SampleOutput* connected(IOChannel* ioc) throw();
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void close();
+
+    bool receive(const Sample *s) throw();
+
+    void flush() throw() {}
+
+    /**
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void fromDOMElement(const xercesc::DOMElement* node);
+
+protected:
+
+    ShmSampleOutput* clone(IOChannel* iochannel);
+
+    ShmSampleOutput(ShmSampleOutput&,IOChannel*);
+
+private:
+
+    ShmSampleRing* _ring;
+
+    /**
+     * No copy.
+     */
+    ShmSampleOutput(const ShmSampleOutput&);
+
+    /**
+     * No assignment.
+     */
+    ShmSampleOutput& operator=(const ShmSampleOutput&);
+
+};
+
+}}	// namespace nidas namespace dynld
+
+#endif
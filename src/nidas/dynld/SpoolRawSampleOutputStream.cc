@@ -0,0 +1,269 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "SpoolRawSampleOutputStream.h"
+#include <nidas/core/SampleSpool.h>
+
+#include <nidas/util/Logger.h>
+#include <nidas/util/UTime.h>
+
+using namespace nidas::core;
+using namespace nidas::dynld;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+NIDAS_CREATOR_FUNCTION(SpoolRawSampleOutputStream)
+
+namespace {
+
+/**
+ * Maximum number of spooled samples to write for each received sample.
+ */
+const int BACKFILL_BURST = 16;
+
+}
+
+SpoolRawSampleOutputStream::SpoolRawSampleOutputStream():
+    RawSampleOutputStream(),
+    _spoolDir(),_spoolMaxBytes(100000000),_replayRate(0.0),
+    _spool(0),_spoolOwner(this),_spoolError(false),_replaying(false),
+    _replayCredit(0.0),_replayTime(0),_ndeferred(0),_nbackfilled(0)
+{
+}
+
+SpoolRawSampleOutputStream::SpoolRawSampleOutputStream(IOChannel* i,
+        SampleConnectionRequester* rqstr):
+    RawSampleOutputStream(i,rqstr),
+    _spoolDir(),_spoolMaxBytes(100000000),_replayRate(0.0),
+    _spool(0),_spoolOwner(this),_spoolError(false),_replaying(false),
+    _replayCredit(0.0),_replayTime(0),_ndeferred(0),_nbackfilled(0)
+{
+    setName("SpoolRawSampleOutputStream: " + getIOChannel()->getName());
+}
+
+SpoolRawSampleOutputStream::SpoolRawSampleOutputStream(
+        SpoolRawSampleOutputStream& x, IOChannel* iochannel):
+    RawSampleOutputStream(x,iochannel),
+    _spoolDir(x._spoolDir),_spoolMaxBytes(x._spoolMaxBytes),
+    _replayRate(x._replayRate),
+    _spool(0),_spoolOwner(x._spoolOwner),_spoolError(false),
+    _replaying(false),_replayCredit(0.0),_replayTime(0),
+    _ndeferred(0),_nbackfilled(0)
+{
+    setName("SpoolRawSampleOutputStream: " + getIOChannel()->getName());
+}
+
+SpoolRawSampleOutputStream::~SpoolRawSampleOutputStream()
+{
+    delete _spool;
+}
+
+SpoolRawSampleOutputStream*
+SpoolRawSampleOutputStream::clone(IOChannel* iochannel)
+{
+    return new SpoolRawSampleOutputStream(*this,iochannel);
+}
+
+void SpoolRawSampleOutputStream::close()
+{
+    if (_spool) {
+        try {
+            _spool->sync();
+        }
+        catch (const n_u::IOException& e) {
+            WLOG(("%s: %s", getName().c_str(), e.what()));
+        }
+    }
+    _replaying = false;
+    RawSampleOutputStream::close();
+}
+
+void SpoolRawSampleOutputStream::fromDOMElement(
+        const xercesc::DOMElement* node)
+{
+    RawSampleOutputStream::fromDOMElement(node);
+
+    const Parameter* param = getParameter("spoolDir");
+    if (param) {
+        if (param->getType() != Parameter::STRING_PARAM ||
+                param->getLength() != 1)
+            throw n_u::InvalidParameterException(getName(),
+                "parameter", "bad value for spoolDir");
+        setSpoolDirectory(param->getStringValue(0));
+    }
+    param = getParameter("spoolMaxMB");
+    if (param) {
+        if (param->getLength() != 1 || param->getNumericValue(0) <= 0.0)
+            throw n_u::InvalidParameterException(getName(),
+                "parameter", "bad value for spoolMaxMB");
+        setSpoolMaxBytes((long long)(param->getNumericValue(0) * 1000000));
+    }
+    param = getParameter("replayRate");
+    if (param) {
+        if (param->getLength() != 1 || param->getNumericValue(0) < 0.0)
+            throw n_u::InvalidParameterException(getName(),
+                "parameter", "bad value for replayRate");
+        setReplayRate(param->getNumericValue(0));
+    }
+}
+
+SampleSpool* SpoolRawSampleOutputStream::getSpool()
+{
+    if (_spoolError || _spoolDir.empty()) return 0;
+    if (_spoolOwner != this) return _spoolOwner->getSpool();
+
+    if (!_spool) {
+        _spool = new SampleSpool(_spoolDir, _spoolMaxBytes);
+        try {
+            _spool->open();
+        }
+        catch (const n_u::IOException& e) {
+            disableSpool(e);
+        }
+    }
+    return _spool;
+}
+
+void SpoolRawSampleOutputStream::disableSpool(const n_u::IOException& e)
+{
+    _spoolError = true;
+    if (_spoolOwner != this) {
+        _spoolOwner->disableSpool(e);
+        return;
+    }
+    WLOG(("%s: %s, samples will not be spooled",
+          getName().c_str(), e.what()));
+    delete _spool;
+    _spool = 0;
+}
+
+long long SpoolRawSampleOutputStream::getSpoolPendingBytes() const
+{
+    const SampleSpool* spool = _spoolOwner->_spool;
+    return spool ? spool->getPendingBytes() : 0;
+}
+
+bool SpoolRawSampleOutputStream::defer(const Sample* samp)
+{
+    SampleSpool* spool = getSpool();
+    if (!spool) return false;
+    try {
+        spool->append(samp);
+    }
+    catch (const n_u::IOException& e) {
+        disableSpool(e);
+        return false;
+    }
+    _ndeferred++;
+    return true;
+}
+
+bool SpoolRawSampleOutputStream::backfill()
+{
+    SampleSpool* spool = getSpool();
+    if (!spool) return true;
+    if (spool->empty()) {
+        if (_replaying)
+            ILOG(("%s: replay of spool finished, %lld samples",
+                  getName().c_str(), _nbackfilled));
+        _replaying = false;
+        return true;
+    }
+    if (!_replaying) {
+        ILOG(("%s: replaying %lld bytes from spool %s",
+              getName().c_str(), spool->getPendingBytes(),
+              spool->getDirectory().c_str()));
+        _replaying = true;
+        _replayCredit = 0.0;
+        _replayTime = 0;
+    }
+
+    if (_replayRate > 0.0) {
+        // Accumulate at most one second of replay.
+        dsm_time_t tnow = n_u::getSystemTime();
+        if (_replayTime > 0)
+            _replayCredit = std::min(_replayCredit +
+                (double)(tnow - _replayTime) * _replayRate / USECS_PER_SEC,
+                (double)_replayRate);
+        _replayTime = tnow;
+    }
+
+    IOStream* ios = getIOStream();
+
+    for (int i = 0; i < BACKFILL_BURST; i++) {
+        if (_replayRate > 0.0 && _replayCredit <= 0.0) break;
+        const Sample* samp;
+        try {
+            samp = spool->front();
+        }
+        catch (const n_u::IOException& e) {
+            disableSpool(e);
+            return true;
+        }
+        if (!samp) break;
+
+        size_t l = SampleOutputStream::write(samp, false);
+        if (l == 0) return false;
+        try {
+            spool->pop();
+        }
+        catch (const n_u::IOException& e) {
+            WLOG(("%s: %s", getName().c_str(), e.what()));
+        }
+        _nbackfilled++;
+        _replayCredit -= l;
+
+        if (ios->available() > ios->getBufferLength() / 2) return false;
+    }
+    return true;
+}
+
+size_t SpoolRawSampleOutputStream::write(const Sample* samp, bool streamFlush)
+{
+    size_t l = SampleOutputStream::write(samp, streamFlush);
+    if (l == 0) {
+        // keep it for later, rather than discard it
+        if (defer(samp))
+            return samp->getHeaderLength() + samp->getDataByteLength();
+        return 0;
+    }
+    backfill();
+    return l;
+}
+
+bool SpoolRawSampleOutputStream::receive(const Sample* samp) throw()
+{
+    // Not connected: this is the original, saving samples
+    // until a connection is made.
+    if (!getIOStream()) {
+        if (!defer(samp) && !(incrementDiscardedSamples() % 1000))
+            WLOG(("%s: %zd samples discarded while not connected",
+                  getName().c_str(), getNumDiscardedSamples()));
+        return true;
+    }
+    return RawSampleOutputStream::receive(samp);
+}
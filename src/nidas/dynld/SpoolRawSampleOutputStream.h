@@ -0,0 +1,218 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_DYNLD_SPOOLRAWSAMPLEOUTPUTSTREAM_H
+#define NIDAS_DYNLD_SPOOLRAWSAMPLEOUTPUTSTREAM_H
+
+#include "RawSampleOutputStream.h"
+
+namespace nidas {
+
+namespace core {
+class SampleSpool;
+}
+
+namespace dynld {
+
+/**
+ * A RawSampleOutputStream which saves samples in a SampleSpool on
+ * local disk while it is not connected, or when samples cannot be
+ * written, and replays them once connected, interleaved with the
+ * current samples.
+ *
+ * The original output, as configured in the XML, is kept as a client
+ * of the raw sample source by DSMEngine while there is no connection,
+ * and appends every sample it receives to the spool.  When a
+ * connection is made, the connected output reads back the spool,
+ * writing at most replayRate bytes per second of spooled samples,
+ * and never more than the link keeps up with. The spool is bounded
+ * by spoolMaxMB, beyond which the oldest samples are dropped, and the
+ * read position survives a restart of the process.
+ *
+ * Replayed samples arrive at the server out of time order, and are
+ * archived as they are received, so that the archive is complete
+ * without merging in a local archive from the DSM.
+ *
+ * @code
+ * <output class="SpoolRawSampleOutputStream">
+ *     <socket type="mcrequest"/>
+ *     <parameter name="spoolDir" type="string" value="/var/tmp/nidas_spool"/>
+ *     <parameter name="spoolMaxMB" type="float" value="500"/>
+ *     <parameter name="replayRate" type="float" value="20000"/>
+ * </output>
+ * @endcode
+ *
+ * Without a spoolDir, this behaves like a RawSampleOutputStream.
+ */
+class SpoolRawSampleOutputStream: public RawSampleOutputStream
+{
+public:
+
+    SpoolRawSampleOutputStream();
+
+    SpoolRawSampleOutputStream(IOChannel* iochan,
+            SampleConnectionRequester* rqstr=0);
+
+    virtual ~SpoolRawSampleOutputStream();
+
+    bool isSpooling() const { return !_spoolDir.empty(); }
+
+    /**
+     * Spool the sample if not connected, otherwise write it.
+     */
+    bool receive(const Sample *s) throw();
+
+    /**
+     * @throws nidas::util::IOException
+     **/
+    void close();
+
+    /**
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void fromDOMElement(const xercesc::DOMElement* node);
+
+    /**
+     * Directory for the spool. If empty, which is the default,
+     * samples are not spooled.
+     */
+    void setSpoolDirectory(const std::string& val) { _spoolDir = val; }
+
+    const std::string& getSpoolDirectory() const { return _spoolDir; }
+
+    void setSpoolMaxBytes(long long val) { _spoolMaxBytes = val; }
+
+    long long getSpoolMaxBytes() const { return _spoolMaxBytes; }
+
+    /**
+     * Maximum rate, in bytes per second, of replaying spooled samples.
+     * 0, the default, replays as fast as the link allows.
+     */
+    void setReplayRate(float val) { _replayRate = val; }
+
+    float getReplayRate() const { return _replayRate; }
+
+    /**
+     * Samples written to the spool.
+     */
+    long long getNumDeferredSamples() const { return _ndeferred; }
+
+    /**
+     * Samples read back from the spool and written.
+     */
+    long long getNumBackfilledSamples() const { return _nbackfilled; }
+
+    /**
+     * Bytes in the spool waiting to be replayed.
+     */
+    long long getSpoolPendingBytes() const;
+
+    using SampleOutputStream::write;
+
+protected:
+
+    SpoolRawSampleOutputStream* clone(IOChannel* iochannel);
+
+    /**
+     * Copy constructor, with a new IOChannel. The new output
+     * shares the spool of the original.
+     */
+    SpoolRawSampleOutputStream(SpoolRawSampleOutputStream&,IOChannel*);
+
+    /**
+     * Write a sample, spooling it if it can't be written, and
+     * then replay spooled samples.
+     *
+     * @throws nidas::util::IOException
+     **/
+    size_t write(const Sample* samp, bool streamFlush);
+
+    /**
+     * Append a sample to the spool.
+     * @return false if there is no spool, or on an error.
+     */
+    bool defer(const Sample* samp);
+
+    /**
+     * Write spooled samples, within the replay rate, while
+     * the IOStream keeps up.
+     * @return false if the IOStream is not keeping up with
+     *      the current samples.
+     *
+     * @throws nidas::util::IOException
+     **/
+    bool backfill();
+
+    /**
+     * The spool, opened when first needed.
+     */
+    nidas::core::SampleSpool* getSpool();
+
+private:
+
+    /**
+     * Stop using the spool after an error.
+     */
+    void disableSpool(const nidas::util::IOException& e);
+
+    std::string _spoolDir;
+
+    long long _spoolMaxBytes;
+
+    float _replayRate;
+
+    nidas::core::SampleSpool* _spool;
+
+    /**
+     * The original owns the spool, clones use it.
+     */
+    SpoolRawSampleOutputStream* _spoolOwner;
+
+    bool _spoolError;
+
+    bool _replaying;
+
+    /**
+     * Bytes which may be replayed, accumulated at the replay rate.
+     */
+    double _replayCredit;
+
+    dsm_time_t _replayTime;
+
+    long long _ndeferred;
+
+    long long _nbackfilled;
+
+    /** No copying. */
+    SpoolRawSampleOutputStream(const SpoolRawSampleOutputStream&);
+
+    /** No assignment. */
+    SpoolRawSampleOutputStream& operator=(const SpoolRawSampleOutputStream&);
+};
+
+}}	// namespace nidas namespace dynld
+
+#endif
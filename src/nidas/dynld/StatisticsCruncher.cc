@@ -78,14 +78,16 @@ StatisticsCruncher::StatisticsCruncher(StatisticsProcessor* proc,
 	_statsType(stype),_splitVarNames(),
         _leadCommon(),_commonSuffix(),_outSample(),_nOutVar(0),
 	_outlen(0),
-	_tout(LONG_LONG_MIN),_sampleMap(),
+	_tout(LONG_LONG_MIN),_sampleMap(),_accumulate(0),
 	_xMin(0),_xMax(0),_xSum(0),_xySum(0),_xyzSum(0),_x4Sum(0),
-	_nSamples(0),_triComb(0),
+	_nSamples(0),_xShift(0),_xValues(0),_triComb(0),
 	_nsum(0),_ncov(0),_ntri(0),_n1mom(0),_n2mom(0),_n3mom (0),_n4mom(0),_ntot(0),
         _higherMoments(himom),
         _site(0),_station(-1),
         _startTime(LONG_LONG_MIN),_endTime(LONG_LONG_MAX),
-        _fillGaps(false)
+        _fillGaps(false),_shiftedSums(false),
+        _xyIndex(),_xyComb(),_xyzComb(),_x3Index(),
+        _longerPeriods(),_periodSums()
 {
     assert(_ninvars > 0);
 
@@ -157,6 +159,8 @@ StatisticsCruncher::~StatisticsCruncher()
     delete [] _xyzSum;
     delete [] _x4Sum;
     delete [] _nSamples;
+    delete [] _xShift;
+    delete [] _xValues;
 
     if (_triComb) {
 	for (unsigned int i=0; i < _ntri; i++) delete [] _triComb[i];
@@ -164,6 +168,30 @@ StatisticsCruncher::~StatisticsCruncher()
     }
 
     delete _resampler;
+
+    for (unsigned int i = 0; i < _longerPeriods.size(); i++)
+        delete _longerPeriods[i];
+}
+
+void StatisticsCruncher::addLongerPeriod(float secs, unsigned int spsId)
+{
+    assert(_outSample.getVariables().size() == 0);
+
+    dsm_time_t usecs = (dsm_time_t)rint(MSECS_PER_SEC * secs) * USECS_PER_MSEC;
+    if (usecs <= _periodUsecs || usecs % _periodUsecs) {
+        ostringstream ost;
+        ost << secs << " secs is not a multiple of the " <<
+            (double)_periodUsecs / USECS_PER_SEC << " sec statistics period";
+        throw n_u::InvalidParameterException("StatisticsCruncher",
+            "longer period", ost.str());
+    }
+    PeriodSums* sums = new PeriodSums();
+    sums->periodUsecs = usecs;
+    sums->tag = new SampleTag();
+    sums->tag->setSampleId(spsId);
+    sums->tag->setDSMId(_outSample.getDSMId());
+    sums->tag->setRate(1.0 / secs);
+    _longerPeriods.push_back(sums);
 }
 
 void StatisticsCruncher::setStartTime(const nidas::util::UTime& val) 
@@ -305,6 +333,18 @@ void StatisticsCruncher::connect(SampleSource* source)
     initStats();
     zeroStats();
 
+    // The samples of the longer periods have the same variables.
+    for (unsigned int i = 0; i < _longerPeriods.size(); i++) {
+        PeriodSums* sums = _longerPeriods[i];
+        SampleTag* tag = sums->tag;
+        if (_station >= 0) tag->setStation(_station);
+        VariableIterator vi = _outSample.getVariableIterator();
+        for ( ; vi.hasNext(); ) tag->addVariable(new Variable(*vi.next()));
+        zeroSums(*sums);
+        addSampleTag(tag);
+    }
+    if (!_longerPeriods.empty()) zeroSums(_periodSums);
+
     ostringstream ost;
     ost << "outSample=";
     for (unsigned int i = 0; i < _outSample.getVariables().size(); i++) {
@@ -328,6 +368,8 @@ void StatisticsCruncher::attach(SampleSource* source)
     // (for example if a sensor's input is moved between motes), this code
     // allows matching of a variable from more than one input sample.
 
+    _accumulate = getAccumulator(_statsType);
+
     vector <bool> varMatches(_ninvars);
     unsigned int nmatches = 0;
     int sourceStation = -1;
@@ -460,6 +502,10 @@ void StatisticsCruncher::attach(SampleSource* source)
 		    msg << " " << _reqVariables[i]->getName();
 		msg.log();
 	    }
+	    for (unsigned int i = 0; i < varIndices.size(); ++i) {
+		sinfo.inIndices.push_back(varIndices[i][0]);
+		sinfo.outIndices.push_back(varIndices[i][1]);
+	    }
             _sampleMap[id] = sinfo;
 	    // Should have one input sample if cross terms
 	    if (_crossTerms) {
@@ -1307,8 +1353,16 @@ void StatisticsCruncher::initStats()
 	_xSum = new double[_nsum];
     }
 
+    delete [] _nSamples;
     _nSamples = new unsigned int[_nsum];
 
+    delete [] _xShift;
+    _xShift = new double[_ninvars];
+    for (i = 0; i < _ninvars; i++) _xShift[i] = 0.0;
+
+    delete [] _xValues;
+    _xValues = new double[_ninvars];
+
     /*
      * Create array of pointers so that xySum[i][j], for j >= i,
      * points to the right element in the sparse array.
@@ -1345,6 +1399,80 @@ void StatisticsCruncher::initStats()
     delete [] _x4Sum;
     _x4Sum = 0;
     if (_n4mom > 0) _x4Sum = new double[_n4mom];
+
+    setupSumIndices();
+}
+
+void StatisticsCruncher::setupSumIndices()
+{
+    unsigned int i,j,k,n;
+
+    // The order of the elements is the order in which receive()
+    // accumulates them.
+    _xyComb.clear();
+    switch (_statsType) {
+    case STATS_VAR:
+	for (i = 0; i < _n2mom; i++) {
+	    _xyComb.push_back(i);
+	    _xyComb.push_back(i);
+	}
+	break;
+    case STATS_COV:
+    case STATS_TRIVAR:
+    case STATS_PRUNEDTRIVAR:
+    case STATS_FLUX:
+    case STATS_RFLUX:
+    case STATS_SFLUX:
+	n = _ninvars;
+	if (_statsType == STATS_RFLUX) n = 3;
+	else if (_statsType == STATS_SFLUX) n = 1;
+	for (i = 0; i < n; i++) {
+	    // no scalar:scalar cross terms in STATS_FLUX
+	    unsigned int nx = (_statsType == STATS_FLUX && i > 2) ? i+1 : _ninvars;
+	    for (j = i; j < nx; j++) {
+		_xyComb.push_back(i);
+		_xyComb.push_back(j);
+	    }
+	}
+	break;
+    default:
+	break;
+    }
+    assert(_xyComb.size() == 2 * (_ncov > 0 ? _ncov : _n2mom));
+
+    _xyIndex.assign(_ninvars * _ninvars, UINT_MAX);
+    for (n = 0; n < _xyComb.size() / 2; n++) {
+	i = _xyComb[2 * n];
+	j = _xyComb[2 * n + 1];
+	_xyIndex[i * _ninvars + j] = _xyIndex[j * _ninvars + i] = n;
+    }
+
+    _xyzComb.clear();
+    if (_statsType == STATS_TRIVAR) {
+	for (i = 0; i < _ninvars; i++)
+	    for (j = i; j < _ninvars; j++)
+		for (k = j; k < _ninvars; k++) {
+		    _xyzComb.push_back(i);
+		    _xyzComb.push_back(j);
+		    _xyzComb.push_back(k);
+		}
+    }
+    else if (_statsType == STATS_PRUNEDTRIVAR) {
+	for (n = 0; n < _ntri; n++)
+	    for (i = 0; i < 3; i++) _xyzComb.push_back(_triComb[n][i]);
+    }
+    else {
+	for (i = 0; i < _n3mom; i++)
+	    for (j = 0; j < 3; j++) _xyzComb.push_back(i);
+    }
+    assert(_xyzComb.size() == 3 * (_ntri > 0 ? _ntri : _n3mom));
+
+    _x3Index.assign(_ninvars, UINT_MAX);
+    for (n = 0; n < _xyzComb.size() / 3; n++) {
+	i = _xyzComb[3 * n];
+	if (_xyzComb[3 * n + 1] == i && _xyzComb[3 * n + 2] == i)
+	    _x3Index[i] = n;
+    }
 }
 
 void StatisticsCruncher::zeroStats()
@@ -1388,27 +1516,18 @@ bool StatisticsCruncher::receive(const Sample* samp) throw()
     }
     if (tt < _tout - _periodUsecs) return false;
 
-    struct sampleInfo& sinfo = vmi->second;
-    const vector<unsigned int*>& vindices = sinfo.varIndices;
-
-    unsigned int nvarsin = vindices.size();
+    const struct sampleInfo& sinfo = vmi->second;
     unsigned int nvsamp = samp->getDataLength();
 
-    unsigned int i,j,k;
-    unsigned int vi,vj,vk,vo;
-    double *xySump,*xyzSump;
-    double x;
-    double xy;
-
-    unsigned int nonNANs = 0;
+    unsigned int nonNANs;
+    if (samp->getType() == FLOAT_ST)
+        nonNANs = gatherValues((const float*)samp->getConstVoidDataPtr(),
+            nvsamp, sinfo);
+    else
+        nonNANs = gatherValues((const double*)samp->getConstVoidDataPtr(),
+            nvsamp, sinfo);
     if (sinfo.weightsIndex < nvsamp)
     	nonNANs = (unsigned int)samp->getDataValue(sinfo.weightsIndex);
-    else if (_crossTerms) {
-	for (i = 0; i < nvarsin; i++) {
-	    vi = vindices[i][0];
-	    if(vi < nvsamp && !std::isnan(samp->getDataValue(vi))) nonNANs++;
-	}
-    }
 
     static LogContext lp(LOG_VERBOSE);
     if (lp.active())
@@ -1424,75 +1543,157 @@ bool StatisticsCruncher::receive(const Sample* samp) throw()
 
     if (_crossTerms && nonNANs < _ninvars) return false;
 
-    switch (_statsType) {
+    (this->*_accumulate)(sinfo);
+    return true;
+}
+
+template<typename T>
+unsigned int StatisticsCruncher::gatherValues(const T* data,
+    unsigned int nvsamp, const sampleInfo& sinfo)
+{
+    unsigned int nvarsin = sinfo.inIndices.size();
+    const unsigned int* vin = nvarsin > 0 ? &sinfo.inIndices[0] : 0;
+
+    // Values past the end of the sample are missing.
+    unsigned int nonNANs = 0;
+    for (unsigned int i = 0; i < nvarsin; i++) {
+        unsigned int vi = vin[i];
+        double x = vi < nvsamp ? data[vi] : doubleNAN;
+        _xValues[i] = x;
+        nonNANs += (x == x);
+    }
+    return nonNANs;
+}
+
+/* static */
+StatisticsCruncher::accumulator_t
+StatisticsCruncher::getAccumulator(statisticsType type)
+{
+    switch (type) {
+    case STATS_MINIMUM:
+        return &StatisticsCruncher::accumulate<STATS_MINIMUM>;
+    case STATS_MAXIMUM:
+        return &StatisticsCruncher::accumulate<STATS_MAXIMUM>;
+    case STATS_MEAN:
+        return &StatisticsCruncher::accumulate<STATS_MEAN>;
+    case STATS_SUM:
+        return &StatisticsCruncher::accumulate<STATS_SUM>;
+    case STATS_VAR:
+        return &StatisticsCruncher::accumulate<STATS_VAR>;
+    case STATS_COV:
+        return &StatisticsCruncher::accumulate<STATS_COV>;
+    case STATS_FLUX:
+        return &StatisticsCruncher::accumulate<STATS_FLUX>;
+    case STATS_RFLUX:
+        return &StatisticsCruncher::accumulate<STATS_RFLUX>;
+    case STATS_SFLUX:
+        return &StatisticsCruncher::accumulate<STATS_SFLUX>;
+    case STATS_TRIVAR:
+        return &StatisticsCruncher::accumulate<STATS_TRIVAR>;
+    case STATS_PRUNEDTRIVAR:
+        return &StatisticsCruncher::accumulate<STATS_PRUNEDTRIVAR>;
+    case STATS_WINDDIR:
+        return &StatisticsCruncher::accumulate<STATS_WINDDIR>;
+    case STATS_UNKNOWN:
+        break;
+    }
+    return &StatisticsCruncher::accumulate<STATS_UNKNOWN>;
+}
+
+/*
+ * The switch on the statistics type is resolved at compile time, leaving
+ * only the code of one type in each accumulator. The values of the
+ * sample have been gathered into _xValues, in the order of
+ * sinfo.inIndices, with NANs for missing values. The types without
+ * cross terms mask the NANs, rather than branching on them.
+ */
+template<StatisticsCruncher::statisticsType ST>
+void StatisticsCruncher::accumulate(const sampleInfo& sinfo)
+{
+    unsigned int nvarsin = sinfo.inIndices.size();
+    const unsigned int* vout = nvarsin > 0 ? &sinfo.outIndices[0] : 0;
+    double* xv = _xValues;
+
+    unsigned int i,j,k,n;
+    unsigned int vo;
+    double *xySump,*xyzSump;
+    double x;
+    double xy;
+    bool ok;
+
+    if (_crossTerms && ST != STATS_WINDDIR) {
+	// cross term product, all input data is present and non-NAN
+	// crossterms, so: vout[i] == i;
+	if (_shiftedSums && _nSamples[0] == 0) {
+	    for (i = 0; i < nvarsin; i++) _xShift[i] = xv[i];
+	}
+	for (i = 0; i < nvarsin; i++) xv[i] -= _xShift[i];
+    }
+
+    switch (ST) {
     case STATS_MINIMUM:
 	for (i = 0; i < nvarsin; i++) {
-	    vi = vindices[i][0];
-	    if (vi < nvsamp && !std::isnan(x = samp->getDataValue(vi))) {
-		vo = vindices[i][1];
-		if (++_nSamples[vo] == 1 || x < _xMin[vo])
-		    _xMin[vo] = x;
-	    }
+	    x = xv[i];
+	    vo = vout[i];
+	    ok = x == x;
+	    n = _nSamples[vo];
+	    _xMin[vo] = (ok && (n == 0 || x < _xMin[vo])) ? x : _xMin[vo];
+	    _nSamples[vo] = n + ok;
 	}
-	return true;
+	break;
     case STATS_MAXIMUM:
 	for (i = 0; i < nvarsin; i++) {
-	    vi = vindices[i][0];
-	    if (vi < nvsamp && !std::isnan(x = samp->getDataValue(vi))) {
-		vo = vindices[i][1];
-		if (++_nSamples[vo] == 1 || x > _xMax[vo])
-		    _xMax[vo] = x;
-	    }
+	    x = xv[i];
+	    vo = vout[i];
+	    ok = x == x;
+	    n = _nSamples[vo];
+	    _xMax[vo] = (ok && (n == 0 || x > _xMax[vo])) ? x : _xMax[vo];
+	    _nSamples[vo] = n + ok;
 	}
-	return true;
+	break;
     case STATS_MEAN:
     case STATS_SUM:
 	for (i = 0; i < nvarsin; i++) {
-	    vi = vindices[i][0];
-	    if (vi < nvsamp && !std::isnan(x = samp->getDataValue(vi))) {
-		vo = vindices[i][1];
-		_xSum[vo] += x;
-		_nSamples[vo]++;
-	    }
+	    x = xv[i];
+	    vo = vout[i];
+	    ok = x == x;
+	    if (_shiftedSums && ok && _nSamples[vo] == 0) _xShift[vo] = x;
+	    _xSum[vo] += ok ? x - _xShift[vo] : 0.0;
+	    _nSamples[vo] += ok;
 	}
-	return true;
+	break;
     case STATS_WINDDIR:
-        {
-            vi = vindices[0][0];
-            double u = samp->getDataValue(vi);
-            vi = vindices[1][0];
-            double v = samp->getDataValue(vi);
-            if (!std::isnan(u) && !std::isnan(v)) {
-                _xSum[0] += u;
-                _xSum[1] += v;
-		_nSamples[0]++;
-            }
+	// receive() doesn't check for NANs when the sample has
+	// a weights value, so check that u and v are both non-NAN.
+	if (xv[0] == xv[0] && xv[1] == xv[1]) {
+	    if (_shiftedSums && _nSamples[0] == 0) {
+		_xShift[0] = xv[0];
+		_xShift[1] = xv[1];
+	    }
+	    _xSum[0] += xv[0] - _xShift[0];
+	    _xSum[1] += xv[1] - _xShift[1];
+	    _nSamples[0]++;
 	}
-	return true;
+	break;
     case STATS_VAR:
 	for (i = 0; i < nvarsin; i++) {
-	    vi = vindices[i][0];
-	    if (vi < nvsamp && !std::isnan(x = samp->getDataValue(vi))) {
-		vo = vindices[i][1];
-		_xSum[vo] += x;
-		_xySum[vo][vo] += x * x;
-		_nSamples[vo]++;
-	    }
+	    x = xv[i];
+	    vo = vout[i];
+	    ok = x == x;
+	    if (_shiftedSums && ok && _nSamples[vo] == 0) _xShift[vo] = x;
+	    x = ok ? x - _xShift[vo] : 0.0;
+	    _xSum[vo] += x;
+	    _xySum[vo][vo] += x * x;
+	    _nSamples[vo] += ok;
 	}
-	return true;
+	break;
     case STATS_COV:
-	// cross term product, all input data is present and non-NAN
 	xySump = _xySum[0];
 	for (i = 0; i < nvarsin; i++) {
-	    vi = vindices[i][0];
-            assert(vi < nvsamp);
-	    // crossterms, so: vindices[i][1] == i;
-	    x = samp->getDataValue(vi);
+	    x = xv[i];
 	    _xSum[i] += x;
 	    for (j = i; j < nvarsin; j++) {
-		vj = vindices[j][0];
-                assert(vj < nvsamp);
-		xy = x * samp->getDataValue(vj);
+		xy = x * xv[j];
 		*xySump++ += xy;
 	    }
             if (_higherMoments) {
@@ -1504,18 +1705,12 @@ bool StatisticsCruncher::receive(const Sample* samp) throw()
 	break;
     case STATS_FLUX:
 	// no scalar:scalar cross terms
-	// cross term product, all input data is present and non-NAN
 	xySump = _xySum[0];
 	for (i = 0; i < 3; i++) {
-	    vi = vindices[i][0];
-            assert(vi < nvsamp);
-	    // crossterms, so: vindices[i][1] == i;
-	    x = samp->getDataValue(vi);
+	    x = xv[i];
 	    _xSum[i] += x;
 	    for (j = i; j < nvarsin; j++) {
-		vj = vindices[j][0];
-                assert(vj < nvsamp);
-		xy = x * samp->getDataValue(vj);
+		xy = x * xv[j];
 		*xySump++ += xy;
 	    }
             if (_higherMoments) {
@@ -1524,9 +1719,7 @@ bool StatisticsCruncher::receive(const Sample* samp) throw()
             }
 	}
 	for (; i < nvarsin; i++) {	// scalar means and variances
-	    vi = vindices[i][0];
-            assert(vi < nvsamp);
-	    x = samp->getDataValue(vi);
+	    x = xv[i];
 	    _xSum[i] += x;
 	    *xySump++ += (xy = x * x);
             if (_higherMoments) {
@@ -1538,18 +1731,12 @@ bool StatisticsCruncher::receive(const Sample* samp) throw()
 	break;
     case STATS_RFLUX:	
 	// only wind:scalar cross terms, no scalar:scalar terms
-	// cross term product, all input data is present and non-NAN
 	xySump = _xySum[0];	
 	for (i = 0; i < 3; i++) {
-	    vi = vindices[i][0];
-            assert(vi < nvsamp);
-	    // crossterms, so: vindices[i][1] == i;
-	    x = samp->getDataValue(vi);
+	    x = xv[i];
 	    _xSum[i] += x;
 	    for (j = i; j < nvarsin; j++) {
-		vj = vindices[j][0];
-                assert(vj < nvsamp);
-		xy = x * samp->getDataValue(vj);
+		xy = x * xv[j];
 		*xySump++ += xy;
 	    }
             if (_higherMoments) {
@@ -1557,27 +1744,18 @@ bool StatisticsCruncher::receive(const Sample* samp) throw()
                 _x4Sum[i] += xy * x;
             }
 	}
-	for (; i < nvarsin; i++) {	// scalar means
-	    vi = vindices[i][0];
-            assert(vi < nvsamp);
-	    _xSum[i] += samp->getDataValue(vi);
-	}
+	for (; i < nvarsin; i++)	// scalar means
+	    _xSum[i] += xv[i];
 	_nSamples[0]++;		// only need one nSamples
 	break;
     case STATS_SFLUX:	
 	// first term is scaler
-	// cross term product, all input data is present and non-NAN
 	xySump = _xySum[0];		// no wind:wind terms
 	i = 0;
-	vi = vindices[i][0];
-        assert(vi < nvsamp);
-	// crossterms, so: vindices[i][1] == i;
-	x = samp->getDataValue(vi);
+	x = xv[i];
 	for (j = i; j < nvarsin; j++) {
-	    vj = vindices[j][0];
-            assert(vj < nvsamp);
-	    _xSum[j] += samp->getDataValue(vj);
-	    xy = x * samp->getDataValue(vj);
+	    _xSum[j] += xv[j];
+	    xy = x * xv[j];
 	    *xySump++ += xy;
 	}
         if (_higherMoments) {
@@ -1587,24 +1765,16 @@ bool StatisticsCruncher::receive(const Sample* samp) throw()
 	_nSamples[0]++;		// only need one nSamples
 	break;
     case STATS_TRIVAR:
-	// cross term product, all input data is present and non-NAN
 	xySump = _xySum[0];
 	xyzSump = _xyzSum;
 	for (i=0; i < nvarsin; i++) {	// no scalar:scalar cross terms
-	    vi = vindices[i][0];
-            assert(vi < nvsamp);
-	    // crossterms, so: vindices[i][1] == i;
-	    x = samp->getDataValue(vi);
+	    x = xv[i];
 	    _xSum[i] += x;
 	    for (j = i; j < nvarsin; j++) {
-		vj = vindices[j][0];
-                assert(vj < nvsamp);
-		xy = x * samp->getDataValue(vj);
+		xy = x * xv[j];
 		*xySump++ += xy;
 		for (k=j; k < nvarsin; k++) {
-		    vk = vindices[k][0];
-                    assert(vk < nvsamp);
-		    *xyzSump++ += xy * samp->getDataValue(vk);
+		    *xyzSump++ += xy * xv[k];
 		    if (_higherMoments && k == i) _x4Sum[i] += xy * x * x;
 		}
 	    }
@@ -1612,55 +1782,236 @@ bool StatisticsCruncher::receive(const Sample* samp) throw()
 	_nSamples[0]++;		// only need one nSamples
 	break;
     case STATS_PRUNEDTRIVAR:
-	// cross term product, all input data is present and non-NAN
 	xySump = _xySum[0];
 	xyzSump = _xyzSum;
 	for (i = 0; i < nvarsin; i++) {
-	    vi = vindices[i][0];
-            assert(vi < nvsamp);
-	    // crossterms, so: vindices[i][1] == i;
-	    x = samp->getDataValue(vi);
+	    x = xv[i];
 	    _xSum[i] += x;
 	    for (j = i; j < nvarsin; j++) {
-		vj = vindices[j][0];
-                assert(vj < nvsamp);
-		xy = x * samp->getDataValue(vj);
+		xy = x * xv[j];
 		*xySump++ += xy;
 	    }
 	    if (_higherMoments) _x4Sum[i] += x * x * x * x;
 	}
-	for (unsigned int n = 0; n < _ntri; n++) {
+	for (n = 0; n < _ntri; n++) {
 	    i = _triComb[n][0];
 	    j = _triComb[n][1];
 	    k = _triComb[n][2];
-	    vi = vindices[i][0];
-            assert(vi < nvsamp);
-	    vj = vindices[j][0];
-            assert(vj < nvsamp);
-	    vk = vindices[k][0];
-            assert(vk < nvsamp);
-	    *xyzSump++ += samp->getDataValue(vi) *
-	    	samp->getDataValue(vj) * samp->getDataValue(vk);
+	    *xyzSump++ += xv[i] * xv[j] * xv[k];
 	}
 	_nSamples[0]++;		// only need one nSamples
 	break;
     case STATS_UNKNOWN:
         break;
     }
-    return true;
 }
 
 void StatisticsCruncher::computeStats()
+{
+    if (_tout == LONG_LONG_MIN) return;
+
+    if (_longerPeriods.empty()) {
+        computeStats(_outSample, _tout, _periodUsecs);
+        return;
+    }
+
+    // computeStats() normalizes and zeroes the sums, so save them
+    // for merging into the longer periods.
+    saveSums(_periodSums);
+    computeStats(_outSample, _tout, _periodUsecs);
+
+    for (unsigned int i = 0; i < _longerPeriods.size(); i++) {
+        PeriodSums& sums = *_longerPeriods[i];
+        dsm_time_t tend = _tout +
+            (sums.periodUsecs - _tout % sums.periodUsecs) % sums.periodUsecs;
+
+        // Finish a longer period which didn't get its last shorter
+        // period, because there was no data.
+        if (sums.tout != LONG_LONG_MIN && sums.tout < tend) {
+            if (hasSamples(sums)) finishLongerPeriod(sums);
+            else zeroSums(sums);
+        }
+        sums.tout = tend;
+        mergeSums(sums, _periodSums);
+        if (tend == _tout) finishLongerPeriod(sums);
+    }
+}
+
+void StatisticsCruncher::zeroSums(PeriodSums& sums) const
+{
+    sums.xSum.assign(_xSum ? _nsum : 0, 0.0);
+    sums.xySum.assign(_ncov > 0 ? _ncov : _n2mom, 0.0);
+    sums.xyzSum.assign(_ntri > 0 ? _ntri : _n3mom, 0.0);
+    sums.x4Sum.assign(_n4mom, 0.0);
+    sums.xMin.assign(_xMin ? _ninvars : 0, floatNAN);
+    sums.xMax.assign(_xMax ? _ninvars : 0, floatNAN);
+    sums.nSamples.assign(_nsum, 0);
+    sums.xShift.assign(_ninvars, 0.0);
+}
+
+void StatisticsCruncher::saveSums(PeriodSums& sums) const
+{
+    std::copy(_xSum, _xSum + sums.xSum.size(), sums.xSum.begin());
+    if (!sums.xySum.empty())
+        std::copy(_xySum[0], _xySum[0] + sums.xySum.size(), sums.xySum.begin());
+    std::copy(_xyzSum, _xyzSum + sums.xyzSum.size(), sums.xyzSum.begin());
+    std::copy(_x4Sum, _x4Sum + sums.x4Sum.size(), sums.x4Sum.begin());
+    std::copy(_xMin, _xMin + sums.xMin.size(), sums.xMin.begin());
+    std::copy(_xMax, _xMax + sums.xMax.size(), sums.xMax.begin());
+    std::copy(_nSamples, _nSamples + sums.nSamples.size(), sums.nSamples.begin());
+    std::copy(_xShift, _xShift + sums.xShift.size(), sums.xShift.begin());
+}
+
+void StatisticsCruncher::loadSums(const PeriodSums& sums)
+{
+    std::copy(sums.xSum.begin(), sums.xSum.end(), _xSum);
+    if (!sums.xySum.empty())
+        std::copy(sums.xySum.begin(), sums.xySum.end(), _xySum[0]);
+    std::copy(sums.xyzSum.begin(), sums.xyzSum.end(), _xyzSum);
+    std::copy(sums.x4Sum.begin(), sums.x4Sum.end(), _x4Sum);
+    std::copy(sums.xMin.begin(), sums.xMin.end(), _xMin);
+    std::copy(sums.xMax.begin(), sums.xMax.end(), _xMax);
+    std::copy(sums.nSamples.begin(), sums.nSamples.end(), _nSamples);
+    std::copy(sums.xShift.begin(), sums.xShift.end(), _xShift);
+}
+
+void StatisticsCruncher::mergeSums(PeriodSums& dest, const PeriodSums& src) const
+{
+    unsigned int i,j,k,n;
+
+    // The merged sums are about the shifts of dest, or those
+    // of src for variables without samples in dest.
+    bool shifted = false;
+    for (i = 0; i < _ninvars; i++) {
+        if (getCount(dest, i) == 0) dest.xShift[i] = src.xShift[i];
+        else if (dest.xShift[i] != src.xShift[i]) shifted = true;
+    }
+
+    if (!shifted) {
+        // Sums about the same shifts are merged by adding them.
+        for (i = 0; i < dest.xSum.size(); i++) dest.xSum[i] += src.xSum[i];
+        for (i = 0; i < dest.xySum.size(); i++) dest.xySum[i] += src.xySum[i];
+        for (i = 0; i < dest.xyzSum.size(); i++) dest.xyzSum[i] += src.xyzSum[i];
+        for (i = 0; i < dest.x4Sum.size(); i++) dest.x4Sum[i] += src.x4Sum[i];
+    }
+    else {
+        /*
+         * Convert the sums of src to sums about the shifts of dest.
+         * With d = src.xShift - dest.xShift, the deviations from
+         * the shifts of dest are (x - src.xShift + d), and the
+         * binomial expansion of their power sums gives them
+         * from the lower order sums of src.
+         */
+        vector<double> d(_ninvars);
+        for (i = 0; i < _ninvars; i++) d[i] = src.xShift[i] - dest.xShift[i];
+
+        const vector<double>& s1 = src.xSum;
+        const vector<double>& s2 = src.xySum;
+
+        for (i = 0; i < s1.size(); i++)
+            dest.xSum[i] += s1[i] + getCount(src, i) * d[i];
+
+        for (n = 0; n < s2.size(); n++) {
+            i = _xyComb[2 * n];
+            j = _xyComb[2 * n + 1];
+            double c = getCount(src, i);
+            dest.xySum[n] += s2[n] + d[i] * s1[j] + d[j] * s1[i] +
+                c * d[i] * d[j];
+        }
+
+        for (n = 0; n < src.xyzSum.size(); n++) {
+            i = _xyzComb[3 * n];
+            j = _xyzComb[3 * n + 1];
+            k = _xyzComb[3 * n + 2];
+            double c = getCount(src, i);
+            unsigned int ij = _xyIndex[i * _ninvars + j];
+            unsigned int ik = _xyIndex[i * _ninvars + k];
+            unsigned int jk = _xyIndex[j * _ninvars + k];
+            assert(ij != UINT_MAX && ik != UINT_MAX && jk != UINT_MAX);
+            dest.xyzSum[n] += src.xyzSum[n] +
+                d[i] * s2[jk] + d[j] * s2[ik] + d[k] * s2[ij] +
+                d[i] * d[j] * s1[k] + d[i] * d[k] * s1[j] +
+                d[j] * d[k] * s1[i] + c * d[i] * d[j] * d[k];
+        }
+
+        for (i = 0; i < src.x4Sum.size(); i++) {
+            double c = getCount(src, i);
+            double di = d[i];
+            unsigned int ii = _xyIndex[i * _ninvars + i];
+            assert(ii != UINT_MAX && _x3Index[i] != UINT_MAX);
+            dest.x4Sum[i] += src.x4Sum[i] + 4. * di * src.xyzSum[_x3Index[i]] +
+                6. * di * di * s2[ii] + 4. * di * di * di * s1[i] +
+                c * di * di * di * di;
+        }
+    }
+
+    for (i = 0; i < dest.xMin.size(); i++) {
+        if (src.nSamples[i] > 0 &&
+            (dest.nSamples[i] == 0 || src.xMin[i] < dest.xMin[i]))
+            dest.xMin[i] = src.xMin[i];
+    }
+    for (i = 0; i < dest.xMax.size(); i++) {
+        if (src.nSamples[i] > 0 &&
+            (dest.nSamples[i] == 0 || src.xMax[i] > dest.xMax[i]))
+            dest.xMax[i] = src.xMax[i];
+    }
+    for (i = 0; i < dest.nSamples.size(); i++)
+        dest.nSamples[i] += src.nSamples[i];
+}
+
+void StatisticsCruncher::merge(const StatisticsCruncher& other)
+{
+    if (!_nSamples || !other._nSamples)
+        throw n_u::InvalidParameterException("StatisticsCruncher",
+            "merge", "cruncher is not connected");
+    if (other._statsType != _statsType || other._ninvars != _ninvars ||
+        other._ntot != _ntot || other._higherMoments != _higherMoments)
+        throw n_u::InvalidParameterException("StatisticsCruncher",
+            "merge", "crunchers compute different statistics");
+
+    if (other._tout == LONG_LONG_MIN) return;
+    if (_tout == LONG_LONG_MIN) _tout = other._tout;
+    else if (other._tout != _tout)
+        throw n_u::InvalidParameterException("StatisticsCruncher",
+            "merge", "crunchers are in different periods");
+
+    PeriodSums sums;
+    PeriodSums osums;
+    zeroSums(sums);
+    zeroSums(osums);
+    saveSums(sums);
+    other.saveSums(osums);
+    mergeSums(sums, osums);
+    loadSums(sums);
+}
+
+/* static */
+bool StatisticsCruncher::hasSamples(const PeriodSums& sums)
+{
+    for (unsigned int i = 0; i < sums.nSamples.size(); i++)
+        if (sums.nSamples[i] > 0) return true;
+    return false;
+}
+
+void StatisticsCruncher::finishLongerPeriod(PeriodSums& sums)
+{
+    // The current sums have been zeroed after the output of the
+    // shorter period, so use them for the computation.
+    loadSums(sums);
+    computeStats(*sums.tag, sums.tout, sums.periodUsecs);
+    zeroSums(sums);
+}
+
+void StatisticsCruncher::computeStats(const SampleTag& tag, dsm_time_t tout,
+                                      dsm_time_t periodUsecs)
 {
     double *xyzSump;
     unsigned int i,j,k,l,n,nx,nr;
     double x,xm,xr;
 
-    if (_tout == LONG_LONG_MIN) return;
-
     SampleT<float>* osamp = getSample<float>(_outlen);
-    osamp->setTimeTag(_tout - _periodUsecs / 2);
-    osamp->setId(_outSample.getId());
+    osamp->setTimeTag(tout - periodUsecs / 2);
+    osamp->setId(tag.getId());
     // osamp->setId(0);
     float* outData = osamp->getDataPtr();
     int nSamp = _nSamples[0];
@@ -1681,7 +2032,8 @@ void StatisticsCruncher::computeStats()
 	break;
     case STATS_MEAN:
 	for (i=0; i < _ninvars; i++) {
-	    if (_nSamples[i] > 0) outData[l++] = _xSum[i] / _nSamples[i];
+	    if (_nSamples[i] > 0)
+                outData[l++] = _xSum[i] / _nSamples[i] + _xShift[i];
 	    else outData[l++] = floatNAN;
 	}
 	break;
@@ -1693,7 +2045,7 @@ void StatisticsCruncher::computeStats()
             // distinguish between actual 0 amounts and no reports, and let
             // users decide how to interpret a sum with a missing value.
 	    if (_nSamples[i] > 0)
-                outData[l++] = _xSum[i];
+                outData[l++] = _xSum[i] + _nSamples[i] * _xShift[i];
 	    else
                 outData[l++] = floatNAN;
 	}
@@ -1712,7 +2064,7 @@ void StatisticsCruncher::computeStats()
 	    	_xSum[i] = floatNAN;
 	    else
 	        _xSum[i] /= _nSamples[i];
-	    if (i < _n1mom) outData[l++] = (float)_xSum[i];
+	    if (i < _n1mom) outData[l++] = (float)(_xSum[i] + _xShift[i]);
 	}
 
 	// compute variance
@@ -1728,8 +2080,8 @@ void StatisticsCruncher::computeStats()
 	break;
     case STATS_WINDDIR:
         if (_nSamples[0] > 0) {
-            double u = _xSum[0] / _nSamples[0];
-            double v = _xSum[1] / _nSamples[0];
+            double u = _xSum[0] / _nSamples[0] + _xShift[0];
+            double v = _xSum[1] / _nSamples[0] + _xShift[1];
             outData[l++] = n_u::dirFromUV(u, v);
 	}
         else {
@@ -1745,7 +2097,7 @@ void StatisticsCruncher::computeStats()
 
 	for (i=0; i < _ninvars; i++) {
 	    _xSum[i] /= nSamp;  	// compute mean
-	    if (i < _n1mom) outData[l++] = (float)_xSum[i];
+	    if (i < _n1mom) outData[l++] = (float)(_xSum[i] + _xShift[i]);
 	}
 
 	// 2nd order
@@ -1857,7 +2209,7 @@ void StatisticsCruncher::computeStats()
     {
         LogMessage msg;
         msg << "Covariance Sample: "
-            << n_u::UTime(_tout-_periodUsecs/2).format(true,"%Y %m %d %H:%M:%S")
+            << n_u::UTime(tout-periodUsecs/2).format(true,"%Y %m %d %H:%M:%S")
             << ' ';
         for (i = 0; i < _ntot; i++)
             msg << outData[i] << ' ';
@@ -1882,4 +2234,12 @@ void StatisticsCruncher::flush() throw()
         computeStats();
         _tout += _periodUsecs;
     }
+
+    // and the partial longer periods
+    for (unsigned int i = 0; i < _longerPeriods.size(); i++) {
+        PeriodSums& sums = *_longerPeriods[i];
+        if (sums.tout != LONG_LONG_MIN && hasSamples(sums))
+            finishLongerPeriod(sums);
+        sums.tout = LONG_LONG_MIN;
+    }
 }
@@ -199,6 +199,65 @@ public:
         _fillGaps = val;
     }
 
+    /**
+     * Add a longer statistics period, which must be an integral
+     * multiple of the period of this cruncher.  The sums of
+     * the longer period are not accumulated from the input samples,
+     * but are merged from the sums of each shorter period when it
+     * is finished. The sums are power sums about zero, so the merge
+     * is exact: the results are the same as those of a separate
+     * StatisticsCruncher with the longer period, to within rounding.
+     *
+     * The statistics of the longer period are output in a sample
+     * with the same variables as the sample of this cruncher, with
+     * a short id of @p spsId.  Must be called before connect().
+     *
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void addLongerPeriod(float secs, unsigned int spsId);
+
+    /**
+     * Whether to accumulate the sums of each variable about a shift,
+     * the first value of the variable in each period, rather than
+     * about zero. The variances and higher moments are then computed
+     * from sums of small deviations, without the loss of precision
+     * when the mean is large compared to the standard deviation.
+     * Sums about different shifts are combined exactly with the
+     * binomial expansion of the power sums, the parallel form of
+     * Welford's algorithm given by Chan et al. Must be set before
+     * connect().
+     */
+    void setShiftedSums(bool val)
+    {
+        _shiftedSums = val;
+    }
+
+    bool getShiftedSums() const
+    {
+        return _shiftedSums;
+    }
+
+    /**
+     * Merge the sums of the current period of another cruncher,
+     * with the same statistics of the same variables, into those of
+     * this cruncher. One can then accumulate the samples of a period
+     * in separate crunchers, for example in separate threads, and
+     * merge them when they are all received. Neither cruncher may be
+     * receiving samples during the merge.
+     *
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void merge(const StatisticsCruncher& other);
+
+    /**
+     * Number of longer periods, whose statistics are merged
+     * from those of this cruncher.
+     */
+    unsigned int getNumLongerPeriods() const
+    {
+        return _longerPeriods.size();
+    }
+
 protected:
 
     /**
@@ -255,8 +314,20 @@ protected:
 
     void zeroStats();
 
+    /**
+     * Compute the statistics of the period ending at _tout, and
+     * merge its sums into those of the longer periods.
+     */
     void computeStats();
 
+    /**
+     * Compute and send a sample of statistics from the current sums,
+     * for a period of @p periodUsecs ending at @p tout, then zero the
+     * sums.
+     */
+    void computeStats(const SampleTag& tag, dsm_time_t tout,
+                      dsm_time_t periodUsecs);
+
     void
     addVariable(const std::string& name,
                 const std::string& longname,
@@ -339,13 +410,46 @@ private:
     dsm_time_t _tout;
 
     struct sampleInfo {
-        sampleInfo(): weightsIndex(0),varIndices() {}
+        sampleInfo(): weightsIndex(0),varIndices(),inIndices(),outIndices() {}
         unsigned int weightsIndex;
 	std::vector<unsigned int*> varIndices;
+        /**
+         * The input and output indices of varIndices, in separate
+         * arrays for receive().
+         */
+        std::vector<unsigned int> inIndices;
+        std::vector<unsigned int> outIndices;
     };
 
     std::map<dsm_sample_id_t,sampleInfo > _sampleMap;
 
+    typedef void (StatisticsCruncher::*accumulator_t)(const sampleInfo&);
+
+    /**
+     * The accumulate() of my statistics type, selected by attach(),
+     * so that receive() makes one call per sample to code
+     * specialized for the type.
+     */
+    accumulator_t _accumulate;
+
+    static accumulator_t getAccumulator(statisticsType type);
+
+    /**
+     * Add the values of a sample, gathered into _xValues by
+     * gatherValues(), to the sums of statistics type ST.
+     */
+    template<statisticsType ST>
+    void accumulate(const sampleInfo& sinfo);
+
+    /**
+     * Copy the values of the input variables of a sample into _xValues,
+     * as doubles, with NANs for variables past the end of the sample.
+     * @return Number of non-NAN values.
+     */
+    template<typename T>
+    unsigned int gatherValues(const T* data, unsigned int nvsamp,
+        const sampleInfo& sinfo);
+
     float* _xMin;
 
     float* _xMax;
@@ -359,6 +463,17 @@ private:
 
     unsigned int *_nSamples;
 
+    /**
+     * The sums are of the input values minus these shifts.
+     * The shifts are zero unless _shiftedSums.
+     */
+    double* _xShift;
+
+    /**
+     * Shifted input values of a sample with cross terms.
+     */
+    double* _xValues;
+
     unsigned int **_triComb;
 
     /**
@@ -398,6 +513,108 @@ private:
 
     bool _fillGaps;
 
+    bool _shiftedSums;
+
+    /**
+     * Sums of a statistics period, with the same layout as
+     * the arrays of sums above.
+     */
+    struct PeriodSums {
+        PeriodSums(): tag(0),periodUsecs(0),tout(LONG_LONG_MIN),
+            xSum(),xySum(),xyzSum(),x4Sum(),xMin(),xMax(),nSamples(),
+            xShift() {}
+        ~PeriodSums() { delete tag; }
+        SampleTag* tag;
+        dsm_time_t periodUsecs;
+        dsm_time_t tout;
+        std::vector<double> xSum;
+        std::vector<double> xySum;
+        std::vector<double> xyzSum;
+        std::vector<double> x4Sum;
+        std::vector<float> xMin;
+        std::vector<float> xMax;
+        std::vector<unsigned int> nSamples;
+        std::vector<double> xShift;
+    private:
+        PeriodSums(const PeriodSums&);
+        PeriodSums& operator=(const PeriodSums&);
+    };
+
+    /**
+     * Size and zero the sums of a period.
+     */
+    void zeroSums(PeriodSums& sums) const;
+
+    /**
+     * Copy the current sums to a period.
+     */
+    void saveSums(PeriodSums& sums) const;
+
+    /**
+     * Set the current sums from those of a period.
+     */
+    void loadSums(const PeriodSums& sums);
+
+    /**
+     * Add the sums of @p src to @p dest. If the shifts of the sums
+     * differ, those of @p src are first converted to the shifts
+     * of @p dest.
+     */
+    void mergeSums(PeriodSums& dest, const PeriodSums& src) const;
+
+    /**
+     * Number of samples in the sums of variable @p i.
+     */
+    unsigned int getCount(const PeriodSums& sums, unsigned int i) const
+    {
+        return _crossTerms ? sums.nSamples[0] : sums.nSamples[i];
+    }
+
+    /**
+     * Create the tables of the variables of the elements in the arrays
+     * of sums, needed to convert sums from one shift to another.
+     */
+    void setupSumIndices();
+
+    /**
+     * Index in the _xySum array of variables i,j, or UINT_MAX.
+     */
+    std::vector<unsigned int> _xyIndex;
+
+    /**
+     * Variables of each element in the _xySum array.
+     */
+    std::vector<unsigned int> _xyComb;
+
+    /**
+     * Variables of each element in the _xyzSum array.
+     */
+    std::vector<unsigned int> _xyzComb;
+
+    /**
+     * Index in the _xyzSum array of the 3rd moment of each variable,
+     * or UINT_MAX.
+     */
+    std::vector<unsigned int> _x3Index;
+
+    static bool hasSamples(const PeriodSums& sums);
+
+    /**
+     * Compute and send the statistics of a longer period, and zero its sums.
+     */
+    void finishLongerPeriod(PeriodSums& sums);
+
+    /**
+     * Longer periods, whose sums are merged from those of this cruncher.
+     */
+    std::vector<PeriodSums*> _longerPeriods;
+
+    /**
+     * Sums of the last period of this cruncher, saved before they
+     * are normalized by computeStats() and merged into the longer periods.
+     */
+    PeriodSums _periodSums;
+
     /** No copy.  */
     StatisticsCruncher(const StatisticsCruncher&);
 
@@ -0,0 +1,428 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2026, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "StatisticsFileOutput.h"
+#include <nidas/core/Parameter.h>
+#include <nidas/core/SampleTag.h>
+#include <nidas/core/Variable.h>
+#include <nidas/util/EndianConverter.h>
+#include <nidas/util/Logger.h>
+#include <nidas/util/UTime.h>
+
+#include <cmath>
+#include <sstream>
+
+using namespace nidas::dynld;
+using namespace nidas::core;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+NIDAS_CREATOR_FUNCTION(StatisticsFileOutput)
+
+namespace {
+
+template<typename T>
+void appendValues(vector<char>& buf, const T* vals, size_t n)
+{
+    const char* cp = (const char*) vals;
+    buf.insert(buf.end(), cp, cp + n * sizeof(T));
+}
+
+}
+
+StatisticsFileOutput::StatisticsFileOutput():
+    SampleOutputBase(),
+    _recordsPerBlock(12),_periodTime(LONG_LONG_MIN),_period(),
+    _halfPeriods(),_nperiods(0),_writer(0),_queueCond(),_queue(),_flushRequested(false),_ioError(false),
+    _columns()
+{
+    setName("StatisticsFileOutput");
+    setHeaderSource(this);
+}
+
+StatisticsFileOutput::StatisticsFileOutput(IOChannel* ioc,
+        SampleConnectionRequester* rqstr):
+    SampleOutputBase(ioc,rqstr),
+    _recordsPerBlock(12),_periodTime(LONG_LONG_MIN),_period(),
+    _halfPeriods(),_nperiods(0),_writer(0),_queueCond(),_queue(),_flushRequested(false),_ioError(false),
+    _columns()
+{
+    setName("StatisticsFileOutput: " + getIOChannel()->getName());
+    setHeaderSource(this);
+}
+
+/*
+ * Copy constructor, with a new IOChannel.
+ */
+StatisticsFileOutput::StatisticsFileOutput(StatisticsFileOutput& x,
+        IOChannel* ioc):
+    SampleOutputBase(x,ioc),
+    _recordsPerBlock(x._recordsPerBlock),_periodTime(LONG_LONG_MIN),_period(),
+    _halfPeriods(),_nperiods(0),_writer(0),_queueCond(),_queue(),_flushRequested(false),_ioError(false),
+    _columns()
+{
+    setName("StatisticsFileOutput: " + getIOChannel()->getName());
+    setHeaderSource(this);
+}
+
+StatisticsFileOutput::~StatisticsFileOutput()
+{
+    stopWriter();
+    freePeriod(_period);
+}
+
+StatisticsFileOutput* StatisticsFileOutput::clone(IOChannel* ioc)
+{
+    // invoke copy constructor
+    return new StatisticsFileOutput(*this,ioc);
+}
+
+void StatisticsFileOutput::setRecordsPerBlock(unsigned int val)
+{
+    if (val == 0)
+        throw n_u::InvalidParameterException(getName(),"records",
+            "must be greater than zero");
+    _recordsPerBlock = val;
+}
+
+void StatisticsFileOutput::fromDOMElement(const xercesc::DOMElement* node)
+{
+    SampleOutputBase::fromDOMElement(node);
+
+    const list<const Parameter*>& params = getParameters();
+    list<const Parameter*>::const_iterator pi;
+    for (pi = params.begin(); pi != params.end(); ++pi) {
+        const Parameter* param = *pi;
+        if (param->getName() == "records") {
+            if ((param->getType() != Parameter::INT_PARAM &&
+                param->getType() != Parameter::FLOAT_PARAM) ||
+                param->getLength() != 1 || param->getNumericValue(0) < 1)
+                throw n_u::InvalidParameterException(getName(),
+                    "parameter","bad records parameter");
+            setRecordsPerBlock((unsigned int) param->getNumericValue(0));
+        }
+    }
+}
+
+bool StatisticsFileOutput::receive(const Sample* samp) throw()
+{
+    if (SampleOutputBase::receive(samp)) return true;
+    if (!getIOChannel()) return false;
+
+    _queueCond.lock();
+    bool ioError = _ioError;
+    _queueCond.unlock();
+    if (ioError) {
+        // this disconnect may schedule this object to be deleted
+        // in another thread, so don't do anything after the
+        // disconnect except return;
+        disconnect();
+        return false;
+    }
+
+    if (!_writer) {
+        _writer = new Writer(this);
+        _writer->start();
+    }
+
+    // The crunchers send the samples of a period, followed by those
+    // of their longer periods, which end at the same time or earlier.
+    // Pass the period to the writer when the next one begins, which is
+    // a later end, or a sample id already in the period if the time
+    // went back.
+    dsm_time_t tend = getPeriodEnd(samp);
+    bool next = tend > _periodTime;
+    for (unsigned int i = 0; !next && i < _period.size(); i++)
+        next = _period[i]->getId() == samp->getId();
+    if (next) {
+        if (!_period.empty()) queuePeriod();
+        _periodTime = tend;
+    }
+
+    samp->holdReference();
+    _period.push_back(samp);
+    return true;
+}
+
+dsm_time_t StatisticsFileOutput::getPeriodEnd(const Sample* samp)
+{
+    map<dsm_sample_id_t, dsm_time_t>::const_iterator hi =
+        _halfPeriods.find(samp->getId());
+    if (hi == _halfPeriods.end()) {
+        list<const SampleTag*> tags = getSourceSampleTags();
+        list<const SampleTag*>::const_iterator ti = tags.begin();
+        for ( ; ti != tags.end(); ++ti) {
+            const SampleTag* tag = *ti;
+            _halfPeriods[tag->getId()] = tag->getRate() > 0.0 ?
+                (dsm_time_t)rint(USECS_PER_SEC / tag->getRate() / 2) : 0;
+        }
+        // an unknown sample ends at its time tag
+        hi = _halfPeriods.insert(
+            make_pair(samp->getId(), (dsm_time_t)0)).first;
+    }
+    return samp->getTimeTag() + hi->second;
+}
+
+void StatisticsFileOutput::queuePeriod()
+{
+    _nperiods++;
+    _queueCond.lock();
+    _queue.push_back(vector<const Sample*>());
+    _queue.back().swap(_period);
+    _queueCond.unlock();
+    _queueCond.signal();
+}
+
+void StatisticsFileOutput::flush() throw()
+{
+    if (!_writer) return;
+    if (!_period.empty()) queuePeriod();
+
+    _queueCond.lock();
+    _flushRequested = true;
+    _queueCond.signal();
+    while (_flushRequested) _queueCond.wait();
+    _queueCond.unlock();
+}
+
+void StatisticsFileOutput::stopWriter()
+{
+    if (!_writer) return;
+    if (!_period.empty()) queuePeriod();
+
+    // the writer writes the queue and the collected records
+    // before it stops
+    _queueCond.lock();
+    _flushRequested = true;
+    _queueCond.unlock();
+    _writer->interrupt();
+    try {
+        _writer->join();
+    }
+    catch (const n_u::Exception& e) {
+        WLOG(("%s: %s", getName().c_str(), e.what()));
+    }
+    delete _writer;
+    _writer = 0;
+    _flushRequested = false;
+    _ioError = false;
+}
+
+void StatisticsFileOutput::close()
+{
+    stopWriter();
+    _periodTime = LONG_LONG_MIN;
+    SampleOutputBase::close();
+}
+
+void StatisticsFileOutput::freePeriod(vector<const Sample*>& period)
+{
+    for (unsigned int i = 0; i < period.size(); i++)
+        period[i]->freeReference();
+    period.clear();
+}
+
+StatisticsFileOutput::Writer::Writer(StatisticsFileOutput* output):
+    n_u::Thread("StatisticsFileOutput"),_output(output)
+{
+}
+
+int StatisticsFileOutput::Writer::run()
+{
+    return _output->writePeriods();
+}
+
+void StatisticsFileOutput::Writer::interrupt()
+{
+    // Lock the condition, so that the writer can't miss the interrupt
+    // between checking isInterrupted() and waiting.
+    _output->_queueCond.lock();
+    n_u::Thread::interrupt();
+    _output->_queueCond.unlock();
+    _output->_queueCond.signal();
+}
+
+int StatisticsFileOutput::writePeriods()
+{
+    _queueCond.lock();
+    for (;;) {
+        if (!_queue.empty()) {
+            vector<const Sample*> period;
+            period.swap(_queue.front());
+            _queue.pop_front();
+            bool ioError = _ioError;
+            _queueCond.unlock();
+
+            if (!ioError) {
+                try {
+                    writePeriod(period);
+                }
+                catch (const n_u::IOException& ioe) {
+                    PLOG(("%s: %s", getName().c_str(), ioe.what()));
+                    ioError = true;
+                }
+            }
+            freePeriod(period);
+
+            _queueCond.lock();
+            _ioError = _ioError || ioError;
+            continue;
+        }
+        if (_flushRequested) {
+            bool ioError = _ioError;
+            _queueCond.unlock();
+
+            if (!ioError) {
+                try {
+                    writeBlocks(0);
+                }
+                catch (const n_u::IOException& ioe) {
+                    PLOG(("%s: %s", getName().c_str(), ioe.what()));
+                    ioError = true;
+                }
+            }
+
+            _queueCond.lock();
+            _ioError = _ioError || ioError;
+            _flushRequested = false;
+            _queueCond.broadcast();
+            continue;
+        }
+        if (_writer->isInterrupted()) break;
+        _queueCond.wait();
+    }
+    _queueCond.unlock();
+    return n_u::Thread::RUN_OK;
+}
+
+void StatisticsFileOutput::writePeriod(const vector<const Sample*>& period)
+{
+    if (period.empty()) return;
+
+    dsm_time_t tt = period.front()->getTimeTag();
+    if (tt >= getNextFileTime()) {
+        writeBlocks(0);
+        createNextFile(tt);
+    }
+    // The columns are set by sendHeader(), unless the IOChannel
+    // doesn't write a header.
+    if (_columns.empty()) setColumns();
+
+    for (unsigned int i = 0; i < period.size(); i++) {
+        const Sample* samp = period[i];
+        map<dsm_sample_id_t, Columns>::iterator ci =
+            _columns.find(samp->getId());
+        if (ci == _columns.end()) {
+            incrementDiscardedSamples();
+            continue;
+        }
+        Columns& cols = ci->second;
+        cols.times.push_back(samp->getTimeTag());
+        unsigned int nv = std::min(cols.nvars, samp->getDataLength());
+        for (unsigned int iv = 0; iv < nv; iv++)
+            cols.values.push_back((float) samp->getDataValue(iv));
+        for (unsigned int iv = nv; iv < cols.nvars; iv++)
+            cols.values.push_back(floatNAN);
+        if (cols.times.size() >= _recordsPerBlock) writeBlocks(ci->first);
+    }
+}
+
+void StatisticsFileOutput::writeBlocks(dsm_sample_id_t id)
+{
+    vector<char> buf;
+    map<dsm_sample_id_t, Columns>::iterator ci = _columns.begin();
+    for ( ; ci != _columns.end(); ++ci) {
+        if (id != 0 && ci->first != id) continue;
+        Columns& cols = ci->second;
+        if (cols.times.empty()) continue;
+
+        unsigned int hdr[2] = { ci->first, (unsigned int)cols.times.size() };
+        appendValues(buf, hdr, 2);
+        appendValues(buf, &cols.times[0], cols.times.size());
+
+        // records are collected in rows, and written in columns
+        unsigned int nrec = cols.times.size();
+        vector<float> column(nrec);
+        for (unsigned int iv = 0; iv < cols.nvars; iv++) {
+            for (unsigned int ir = 0; ir < nrec; ir++)
+                column[ir] = cols.values[ir * cols.nvars + iv];
+            appendValues(buf, &column[0], nrec);
+        }
+        cols.times.clear();
+        cols.values.clear();
+    }
+    if (!buf.empty()) write(&buf[0], buf.size());
+}
+
+void StatisticsFileOutput::setColumns()
+{
+    _columns.clear();
+    list<const SampleTag*> tags = getSourceSampleTags();
+    list<const SampleTag*>::const_iterator ti = tags.begin();
+    for ( ; ti != tags.end(); ++ti) {
+        const SampleTag* tag = *ti;
+        unsigned int nvars = 0;
+        VariableIterator vi = tag->getVariableIterator();
+        for ( ; vi.hasNext(); ) nvars += vi.next()->getLength();
+        _columns[tag->getId()].nvars = nvars;
+    }
+}
+
+void StatisticsFileOutput::sendHeader(dsm_time_t tt, SampleOutput* output)
+{
+    setColumns();
+
+    ostringstream ost;
+    ost << "NIDAS statistics columns, version 1\n" <<
+        "byte order: " <<
+        (n_u::EndianConverter::getHostEndianness() ==
+            n_u::EndianConverter::EC_BIG_ENDIAN ? "big" : "little") <<
+        " endian\n" <<
+        "file time: " << n_u::UTime(tt).format(true,"%Y %m %d %H:%M:%S") <<
+        '\n';
+
+    list<const SampleTag*> tags = getSourceSampleTags();
+    list<const SampleTag*>::const_iterator ti = tags.begin();
+    for ( ; ti != tags.end(); ++ti) {
+        const SampleTag* tag = *ti;
+        unsigned int nvars = _columns[tag->getId()].nvars;
+
+        ost << "sample: " << tag->getDSMId() << ',' << tag->getSpSId() <<
+            " id=" << tag->getId() <<
+            " period=" << (tag->getRate() > 0.0 ? 1.0 / tag->getRate() : 0.0) <<
+            " nvars=" << nvars << '\n';
+        VariableIterator vi = tag->getVariableIterator();
+        for ( ; vi.hasNext(); ) {
+            const Variable* var = vi.next();
+            ost << "  " << var->getName();
+            if (var->getLength() > 1) ost << '[' << var->getLength() << ']';
+            ost << ' ' << var->getUnits() << '\n';
+        }
+    }
+    ost << "end header\n";
+    output->write(ost.str().c_str(), ost.str().length());
+}
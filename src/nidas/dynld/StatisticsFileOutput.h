@@ -0,0 +1,255 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2026, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_DYNLD_STATISTICSFILEOUTPUT_H
+#define NIDAS_DYNLD_STATISTICSFILEOUTPUT_H
+
+#include <nidas/core/SampleOutput.h>
+#include <nidas/core/HeaderSource.h>
+#include <nidas/util/Thread.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace nidas { namespace dynld {
+
+using namespace nidas::core;
+
+/**
+ * A SampleOutput which writes the samples of a StatisticsProcessor
+ * to local files, in columns, rather than to a netcdf server.
+ * The layout of the columns is taken from the source SampleTags of the
+ * output, which for a StatisticsProcessor are the output SampleTags of
+ * its crunchers.
+ *
+ * The samples of each averaging period, those ending at the same time,
+ * including the longer periods of the crunchers which end with it, are
+ * buffered and passed together to a writer thread, so that the
+ * processing does not wait on the file system. The writer thread
+ * collects the records of each sample id into blocks of columns,
+ * and writes a block when it has getRecordsPerBlock() records, before
+ * starting the next file, and on flush().
+ *
+ * Each file starts with an ASCII header, ending in a line of
+ * "end header", describing the samples and their variables.
+ * A block, in host byte order as given in the header, is:
+ *  - uint32: sample id, as in the header
+ *  - uint32: number of records, nrec
+ *  - int64[nrec]: time tags, in microseconds since 1970 UTC
+ *  - float32[nrec]: the values of each variable, in the order
+ *    of the header
+ *
+ * Configure it as an output of a StatisticsProcessor, with a fileset:
+ * @code
+ * <output class="StatisticsFileOutput">
+ *     <parameter name="records" type="int" value="12"/>
+ *     <fileset dir="$DATADIR/stats" file="stats_%Y%m%d.dat" length="86400"/>
+ * </output>
+ * @endcode
+ */
+class StatisticsFileOutput: public SampleOutputBase, public HeaderSource
+{
+public:
+
+    StatisticsFileOutput();
+
+    StatisticsFileOutput(IOChannel* iochannel,SampleConnectionRequester* rqstr=0);
+
+    ~StatisticsFileOutput();
+
+    /**
+     * Pass the buffered period to the writer thread, and wait
+     * until it and all the collected records are written.
+     */
+    void flush() throw();
+
+    bool receive(const Sample* samp) throw();
+
+    /**
+     * Write the buffered samples, stop the writer thread,
+     * and close the IOChannel.
+     *
+     * @throws nidas::util::IOException
+     **/
+    void close();
+
+    /**
+     * Implementation of HeaderSource::sendHeader(), writing the
+     * description of the columns at the start of each file.
+     *
+     * @throws nidas::util::IOException
+     **/
+    void sendHeader(dsm_time_t,SampleOutput* output);
+
+    unsigned int getRecordsPerBlock() const { return _recordsPerBlock; }
+
+    /**
+     * Number of periods passed to the writer thread.
+     */
+    unsigned int getNumPeriods() const { return _nperiods; }
+
+    /**
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void setRecordsPerBlock(unsigned int val);
+
+    /**
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void fromDOMElement(const xercesc::DOMElement* node);
+
+protected:
+
+    StatisticsFileOutput* clone(IOChannel* iochannel);
+
+    /**
+     * Copy constructor, with a new IOChannel.
+     */
+    StatisticsFileOutput(StatisticsFileOutput&,IOChannel*);
+
+private:
+
+    class Writer: public nidas::util::Thread
+    {
+    public:
+        Writer(StatisticsFileOutput* output);
+        int run();
+        void interrupt();
+    private:
+        StatisticsFileOutput* _output;
+        /** No copying. */
+        Writer(const Writer&);
+        /** No assignment. */
+        Writer& operator=(const Writer&);
+    };
+
+    /**
+     * The records of a sample id, not yet written.
+     */
+    struct Columns
+    {
+        Columns(): nvars(0),times(),values() {}
+        unsigned int nvars;
+        std::vector<dsm_time_t> times;
+        /**
+         * The values of the records, nvars per record. They are
+         * transposed to columns when written.
+         */
+        std::vector<float> values;
+    };
+
+    /**
+     * Loop of the writer thread, writing the periods in _queue.
+     */
+    int writePeriods();
+
+    /**
+     * Write a period to the current file, or to the next one if
+     * its time tag is past the end of the current file.
+     *
+     * @throws nidas::util::IOException
+     **/
+    void writePeriod(const std::vector<const Sample*>& period);
+
+    /**
+     * Write a block of the records of a sample id, or of
+     * all of them if id is 0.
+     *
+     * @throws nidas::util::IOException
+     **/
+    void writeBlocks(dsm_sample_id_t id);
+
+    /**
+     * Set the columns of each sample id from the source SampleTags.
+     */
+    void setColumns();
+
+    /**
+     * The end time of the period of a sample, from its time tag, which
+     * is the middle of the period, and the rate of its SampleTag.
+     */
+    dsm_time_t getPeriodEnd(const Sample* samp);
+
+    void freePeriod(std::vector<const Sample*>& period);
+
+    /**
+     * Pass _period to the writer thread.
+     */
+    void queuePeriod();
+
+    void stopWriter();
+
+    unsigned int _recordsPerBlock;
+
+    /**
+     * End time of the samples in _period.
+     */
+    dsm_time_t _periodTime;
+
+    std::vector<const Sample*> _period;
+
+    /**
+     * Half the period of each sample id, for getPeriodEnd().
+     */
+    std::map<dsm_sample_id_t, dsm_time_t> _halfPeriods;
+
+    unsigned int _nperiods;
+
+    Writer* _writer;
+
+    /**
+     * Protects _queue, _flushRequested and _ioError, which are
+     * shared with the writer thread.
+     */
+    nidas::util::Cond _queueCond;
+
+    std::deque<std::vector<const Sample*> > _queue;
+
+    bool _flushRequested;
+
+    bool _ioError;
+
+    /**
+     * The columns of each sample id, for the writer thread.
+     */
+    std::map<dsm_sample_id_t, Columns> _columns;
+
+    /**
+     * No copying.
+     */
+    StatisticsFileOutput(const StatisticsFileOutput&);
+
+    /**
+     * No assignment.
+     */
+    StatisticsFileOutput& operator=(const StatisticsFileOutput&);
+
+};
+
+}}	// namespace nidas namespace dynld
+
+#endif
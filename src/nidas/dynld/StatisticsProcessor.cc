@@ -48,7 +48,7 @@ StatisticsProcessor::StatisticsProcessor():
     _cruncherListMutex(),_connectedSources(),_connectedOutputs(),
     _crunchers(),_infoBySampleId(),
     _startTime(LONG_LONG_MIN),_endTime(LONG_LONG_MAX),_statsPeriod(0.0),
-    _fillGaps(false),_cntsNames()
+    _longerPeriods(),_fillGaps(false),_shiftedSums(false),_cntsNames()
 {
     setName("StatisticsProcessor");
 }
@@ -106,6 +106,47 @@ void StatisticsProcessor::flush() throw()
     }
 }
 
+void StatisticsProcessor::fromDOMElement(const xercesc::DOMElement* node)
+{
+    SampleIOProcessor::fromDOMElement(node);
+
+    const std::list<const Parameter*>& params = getParameters();
+    list<const Parameter*>::const_iterator pi;
+    for (pi = params.begin(); pi != params.end(); ++pi) {
+        const Parameter* param = *pi;
+        if (param->getName() == "periods") {
+            if ((param->getType() != Parameter::FLOAT_PARAM &&
+                param->getType() != Parameter::INT_PARAM) ||
+                param->getLength() < 1)
+                throw n_u::InvalidParameterException(getName(),
+                    "parameter","bad periods parameter");
+            vector<float> periods;
+            for (int i = 0; i < param->getLength(); i++) {
+                float period = param->getNumericValue(i);
+                float n = rint(period / _statsPeriod);
+                if (_statsPeriod <= 0.0 || n < 2.0 ||
+                    fabs(n * _statsPeriod - period) > 1.e-3) {
+                    ostringstream ost;
+                    ost << period << " secs is not a multiple of the " <<
+                        _statsPeriod << " sec statistics period";
+                    throw n_u::InvalidParameterException(getName(),
+                        "periods", ost.str());
+                }
+                periods.push_back(period);
+            }
+            setLongerPeriods(periods);
+        }
+        else if (param->getName() == "shiftedsums") {
+            if ((param->getType() != Parameter::BOOL_PARAM &&
+                param->getType() != Parameter::INT_PARAM) ||
+                param->getLength() != 1)
+                throw n_u::InvalidParameterException(getName(),
+                    "parameter","bad shiftedsums parameter");
+            setShiftedSums(param->getNumericValue(0) != 0.0);
+        }
+    }
+}
+
 void StatisticsProcessor::addRequestedSampleTag(SampleTag* tag)
 {
 
@@ -308,8 +349,15 @@ void StatisticsProcessor::connectSource(SampleSource* source)
 
     // loop over requested sample tags
     list<const SampleTag*> reqtags = getRequestedSampleTags();
+
+    // Output samples of the longer periods are numbered after
+    // the requested samples.
+    unsigned int idStride = 0;
     list<const SampleTag*>::const_iterator reqti = reqtags.begin();
-    for ( ; reqti != reqtags.end(); ++reqti ) {
+    for ( ; reqti != reqtags.end(); ++reqti)
+        idStride = std::max(idStride, (*reqti)->getSampleId());
+
+    for (reqti = reqtags.begin(); reqti != reqtags.end(); ++reqti ) {
         const SampleTag* reqtag = *reqti;
 
         // make sure we have at least one variable
@@ -405,11 +453,19 @@ void StatisticsProcessor::connectSource(SampleSource* source)
                         cruncher->setStartTime(getStartTime());
                         cruncher->setEndTime(getEndTime());
                         cruncher->setFillGaps(getFillGaps());
+                        cruncher->setShiftedSums(getShiftedSums());
 
                         _cruncherListMutex.lock();
                         _crunchers.push_back(cruncher);
                         _cruncherListMutex.unlock();
                         crunchersByOutputId[newtag.getId()] = cruncher;
+                        for (unsigned int i = 0; i < _longerPeriods.size(); i++) {
+                            unsigned int spsId = newtag.getSpSId() + (i + 1) * idStride;
+                            if (spsId > 0xffff)
+                                throw n_u::InvalidParameterException(getName(),
+                                    "periods", "too many samples for the longer periods");
+                            cruncher->addLongerPeriod(_longerPeriods[i], spsId);
+                        }
                         cruncher->connect(source);
 
                         list<const SampleTag*> tags = cruncher->getSampleTags();
@@ -124,6 +124,33 @@ public:
         return _statsPeriod;
     }
 
+    /**
+     * Longer statistics periods, in seconds, which must be integral
+     * multiples of getPeriod(). The StatisticsCrunchers merge their
+     * sums into these longer periods, so that the statistics of
+     * several periods are computed with one pass over the input samples.
+     * The output samples of a longer period have the same variables as
+     * those of getPeriod(), and sample ids following the ids of the
+     * requested samples. Set from a processor parameter, for example:
+     * @code
+     * <parameter name="periods" type="float" value="1800 3600"/>
+     * @endcode
+     */
+    const std::vector<float>& getLongerPeriods() const
+    {
+        return _longerPeriods;
+    }
+
+    void setLongerPeriods(const std::vector<float>& val)
+    {
+        _longerPeriods = val;
+    }
+
+    /**
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void fromDOMElement(const xercesc::DOMElement* node);
+
     /**
      * Whether to generate output samples over time gaps.
      * In some circumstances one might be generating statistics
@@ -141,6 +168,26 @@ public:
         _fillGaps = val;
     }
 
+    /**
+     * Whether the crunchers accumulate their sums about the first
+     * value of each variable in a period, for accurate statistics of
+     * variables with a large mean relative to their fluctuations.
+     * See StatisticsCruncher::setShiftedSums(). Set from a
+     * processor parameter:
+     * @code
+     * <parameter name="shiftedsums" type="bool" value="true"/>
+     * @endcode
+     */
+    bool getShiftedSums() const
+    {
+        return _shiftedSums;
+    }
+
+    void setShiftedSums(bool val)
+    {
+        _shiftedSums = val;
+    }
+
     /**
      * All output samples (and StatisticsCrunchers) should have a
      * unique name for their counts output variable. This will
@@ -187,8 +234,12 @@ private:
 
     float _statsPeriod;
 
+    std::vector<float> _longerPeriods;
+
     bool _fillGaps;
 
+    bool _shiftedSums;
+
     /**
      * Set of counts variables for output samples.
      */
@@ -182,6 +182,20 @@ void ATIK_Sonic::transducerShadowCorrection(dsm_time_t, float* uvw)
     memcpy(uvw,nuvw,3*sizeof(float));
 }
 
+void ATIK_Sonic::transducerShadowCorrection(dsm_time_t tt,
+        float* u, float* v, float* w, unsigned int n)
+{
+    if (_shadowFactor == 0.0) return;
+
+    for (unsigned int i = 0; i < n; i++) {
+        float uvw[3] = { u[i], v[i], w[i] };
+        transducerShadowCorrection(tt, uvw);
+        u[i] = uvw[0];
+        v[i] = uvw[1];
+        w[i] = uvw[2];
+    }
+}
+
 void ATIK_Sonic::removeShadowCorrection(dsm_time_t, float* ) throw()
 {
     // TODO. The shadow correction is somewhat difficult to invert,
@@ -223,12 +237,9 @@ bool ATIK_Sonic::process(const Sample* samp,
     dsm_time_t timetag;
 
     if (getScanfers().size() > 0) {
-        std::list<const Sample*> parseResults;
-        SerialSensor::process(samp,parseResults);
-        if (parseResults.empty()) return false;
-
-        // result from base class parsing of ASCII
-        const Sample* psamp = parseResults.front();
+        // parse the ASCII message into the scratch sample
+        SampleT<float>* psamp = getScratchSample();
+        if (!parseSample(samp, psamp)) return false;
 
         // base class runs ttadjust on the time tag
         timetag = psamp->getTimeTag();
@@ -263,7 +274,6 @@ bool ATIK_Sonic::process(const Sample* samp,
         if (diag > _diagThreshold) {
             for (i = 0; i < 4; i++) uvwt[i] = floatNAN;
         }
-        psamp->freeReference();
     }
     else {
         // binary output into a char sample.
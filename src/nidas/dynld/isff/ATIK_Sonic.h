@@ -56,6 +56,13 @@ public:
      */
     void transducerShadowCorrection(nidas::core::dsm_time_t tt, float* uvwt);
 
+    /**
+     * Apply the ATIK path shadow correction to columns of @p n wind
+     * components, for Wind3D::applyCorrections().
+     */
+    void transducerShadowCorrection(nidas::core::dsm_time_t tt,
+        float* u, float* v, float* w, unsigned int n);
+
     /**
      * Placeholder for a method to remove a shadow correction that 
      * had been applied by the sonic firmware. This is so that
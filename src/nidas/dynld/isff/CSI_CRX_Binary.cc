@@ -25,6 +25,7 @@
 */
 
 #include "CSI_CRX_Binary.h"
+#include "CSI_IRGA_Sonic.h"
 #include <nidas/util/EndianConverter.h>
 
 #include <nidas/core/Variable.h>
@@ -37,10 +38,6 @@ namespace n_u = nidas::util;
 
 NIDAS_CREATOR_FUNCTION_NS(isff,CSI_CRX_Binary)
 
-static const n_u::EndianConverter* fromBig =
-    n_u::EndianConverter::getConverter(n_u::EndianConverter::EC_BIG_ENDIAN);
-
-
 CSI_CRX_Binary::CSI_CRX_Binary():
     _numOut(0),
     _sampleId(0),
@@ -74,25 +71,8 @@ void CSI_CRX_Binary::validate()
 
 unsigned short CSI_CRX_Binary::signature(const unsigned char* buf, const unsigned char* eob)
 {
-    union {
-        unsigned char s[2];
-        unsigned short val;
-    } sig;
-
-    sig.val = 0xaaaa;
-
-    unsigned char t1,t2;
-
-    for ( ; buf < eob; buf++) {
-        t1 = sig.s[1];
-        sig.s[1] = sig.s[0];
-
-        t2 = (sig.s[0] << 1) + ((sig.s[0] & 0x80) >> 7);
-
-        sig.s[0] = t2 + t1 + *buf;
-    }
-
-    return sig.val;
+    // The CR10X and CR23X compute the same signature as the EC150.
+    return CSI_IRGA_Sonic::signature(buf, eob);
 }
 
 bool CSI_CRX_Binary::reportBadCRC()
@@ -118,7 +98,7 @@ bool CSI_CRX_Binary::process(const Sample* samp,
     if (len < 4) return false;  // at least the 2-byte signature and one word of data
     const unsigned char* eptr = buf0 + len - 2;   // pointer to signature
 
-    unsigned short sval = fromBig->uint16Value(eptr);
+    unsigned short sval = n_u::bigUint16In(eptr);
 
     unsigned short cval = signature((const unsigned char*)buf0,(const unsigned char*)eptr);
 
@@ -157,7 +137,7 @@ bool CSI_CRX_Binary::process(const Sample* samp,
 #ifdef DEBUG
                 // just for initial curiosity's sake, print out the id
                 if (bptr + 2 > eptr) break;
-                short val = fromBig->int16Value(bptr);
+                short val = n_u::bigInt16In(bptr);
                 int outputid = (val & 0x3ff);
                 cerr << "CSI_CRX_Binary: output array id=" << outputid << endl;
 #endif
@@ -167,7 +147,7 @@ bool CSI_CRX_Binary::process(const Sample* samp,
             else if ((c & 0x3c) == 0x1c) {
                 // first byte of a 4 byte value
                 if (bptr + 4 > eptr) break;
-                int val = fromBig->int32Value(bptr);
+                int val = n_u::bigInt32In(bptr);
 
                 // check third byte of a 4 byte value
                 bptr += 2;
@@ -214,7 +194,7 @@ bool CSI_CRX_Binary::process(const Sample* samp,
             // bits 4,3,2 (aka DEF) not all ones, a two byte low resolution value.
 
             if (bptr + 2 > eptr) break;
-            short val = fromBig->int16Value(bptr);
+            short val = n_u::bigInt16In(bptr);
             bptr += 2;
 
             int neg = val & 0x8000;
@@ -31,6 +31,7 @@
 #include <nidas/core/AsciiSscanf.h>
 #include <nidas/core/TimetagAdjuster.h>
 
+#include <algorithm>
 #include <limits>
 
 using namespace nidas::dynld::isff;
@@ -51,9 +52,9 @@ CSI_IRGA_Sonic::CSI_IRGA_Sonic():
     _Pirga(),
     _Tirga(),
     _binary(false),
-    _endian(nidas::util::EndianConverter::EC_LITTLE_ENDIAN),
-    _converter(0),
-    _ttadjust(0)
+    _binLayout(),
+    _ttadjust(0),
+    _binValues()
 {
 }
 
@@ -154,25 +155,52 @@ void CSI_IRGA_Sonic::checkSampleTags()
      const std::list<AsciiSscanf*>& sscanfers = getScanfers();
      if (sscanfers.empty()) {
          _binary = true;
-         _converter = n_u::EndianConverter::getConverter(_endian,
-            n_u::EndianConverter::getHostEndianness());
+         /*
+          * Binary record: u,v,w,tc floats, diagnostic integer,
+          * co2, h2o floats, IRGA diagnostic integer, then floats for
+          * cell temp and pressure, co2 sig, h2o sig, diff press,
+          * source temp, detector temp.
+          */
+         unsigned int nbinvals = _numOut - 3;  // except final 3 derived
+         _binLayout.assign(std::max(nbinvals, 5u), BIN_FLOAT);
+         _binLayout[4] = BIN_UINT32;
+         if (_binLayout.size() > 7) _binLayout[7] = BIN_UINT32;
      }
 }
 
+namespace {
+    inline unsigned char rotl1(unsigned char c)
+    {
+        return (unsigned char)((c << 1) | (c >> 7));
+    }
+}
+
 unsigned short CSI_IRGA_Sonic::signature(const unsigned char* buf, const unsigned char* eob)
 {
     /* The last field of the EC150 output is a CRC. From the EC150 manual,
-     * here is how it is calculated.
+     * here is how it is calculated:
+     *
+     *  for each byte b:
+     *      lsb_new = (lsb << 1) + msb + b, plus 1 if bit 7 of lsb is set
+     *      msb = lsb
+     *      lsb = lsb_new
+     *
+     * which is a rotate of lsb, and two additions.  It isn't a polynomial
+     * CRC, so a lookup table by byte doesn't apply: it would only lengthen
+     * the dependency from one byte to the next. Instead, the loop is unrolled
+     * so that msb and lsb trade places, rather than being copied, and
+     * msb + b is added off the dependency chain.
      */
+    unsigned char msb = 0xaa, lsb = 0xaa;   // seed of 0xaaaa
 
-    unsigned char msb, lsb;
-    unsigned char b;
-    unsigned short seed = 0xaaaa;
-    msb = seed >> 8;
-    lsb = seed;
-    for(; buf < eob; ) {
-        b = (lsb << 1) + msb + *buf++;
-        if( lsb & 0x80 ) b++;
+    for ( ; buf + 4 <= eob; buf += 4) {
+        msb = rotl1(lsb) + (unsigned char)(msb + buf[0]);
+        lsb = rotl1(msb) + (unsigned char)(lsb + buf[1]);
+        msb = rotl1(lsb) + (unsigned char)(msb + buf[2]);
+        lsb = rotl1(msb) + (unsigned char)(lsb + buf[3]);
+    }
+    for ( ; buf < eob; buf++) {
+        unsigned char b = rotl1(lsb) + (unsigned char)(msb + *buf);
         msb = lsb;
         lsb = b;
     }
@@ -206,7 +234,7 @@ bool CSI_IRGA_Sonic::process(const Sample* samp,
 
         bptr -= sizeof(short);  // 2 byte signature
         if (bptr < buf) return reportBadCRC();
-        sigval = _converter->uint16Value(bptr);
+        sigval = n_u::littleUint16In(bptr);
         eob = bptr;
     }
     else {
@@ -229,13 +257,14 @@ bool CSI_IRGA_Sonic::process(const Sample* samp,
 
     if (calcsig != sigval) return reportBadCRC();
 
-    const Sample* psamp = 0;
     unsigned int nvals;
     const float* pdata;
 
     const unsigned int nbinvals = _numOut - 3;  // requested variables, except final 3 derived
 
-    vector<float> pvector(nbinvals);
+    // values unpacked from a binary record, reused for each record
+    vector<float>& pvector = _binValues;
+    pvector.resize(std::max(nbinvals, (unsigned int)_binLayout.size()));
 
     if (_binary) {
 
@@ -244,31 +273,21 @@ bool CSI_IRGA_Sonic::process(const Sample* samp,
             wsamptime = _ttadjust->adjust(wsamptime);
         wsamptime -= _timeDelay;
 
+        // decode the 4 byte fields in the record, up to the
+        // number requested
+        unsigned int nfields = std::min((unsigned int)(eob - buf) / 4,
+                (unsigned int)_binLayout.size());
+        const binFieldType* layout = &_binLayout[0];
         bptr = buf;
-        for (nvals = 0; bptr + sizeof(float) <= eob && nvals < 4; ) {
-            pvector[nvals++] = _converter->floatValue(bptr);  // u,v,w,tc
-            bptr += sizeof(float);
-        }
-        if (bptr + sizeof(uint32_t) <= eob) {
-            pvector[nvals++] = _converter->uint32Value(bptr);   // diagnostic
-            bptr += sizeof(int);
-        }
-        for (int i = 0; bptr + sizeof(float) <= eob && i < 2 && nvals < nbinvals; i++) {
-            pvector[nvals++] = _converter->floatValue(bptr);      // co2, h2o
-            bptr += sizeof(float);
-        }
-        if (bptr + sizeof(uint32_t) <= eob && nvals < nbinvals) {
-            pvector[nvals++] = _converter->uint32Value(bptr);   // IRGA diagnostic
-            bptr += sizeof(int);
-        }
-        for ( ; bptr + sizeof(float) <= eob && nvals < nbinvals; ) {
-            // cell temp and pressure, co2 sig, h2o sig, diff press, source temp, detector temp
-            pvector[nvals++] = _converter->floatValue(bptr);
-            bptr += sizeof(float);
+        for (nvals = 0; nvals < nfields; nvals++, bptr += 4) {
+            if (layout[nvals] == BIN_FLOAT)
+                pvector[nvals] = n_u::littleFloatIn(bptr);
+            else
+                pvector[nvals] = n_u::littleUint32In(bptr);
         }
 #ifdef UNPACK_COUNTER
         if (bptr + sizeof(uint32_t) <= eob) {
-            unsigned int counter = _converter->uint32Value(bptr);   // counter
+            unsigned int counter = n_u::littleUint32In(bptr);   // counter
             bptr += sizeof(int);
             ILOG(("%s: counter=%u",getName().c_str(),counter));
         }
@@ -290,14 +309,9 @@ bool CSI_IRGA_Sonic::process(const Sample* samp,
         }
     }
     else {
-        std::list<const Sample*> parseResults;
-
-        SerialSensor::process(samp,parseResults);
-
-        if (parseResults.empty()) return false;
-
-        // result from base class parsing of ASCII
-        psamp = parseResults.front();
+        // parse the ASCII message into the scratch sample
+        SampleT<float>* psamp = getScratchSample();
+        if (!parseSample(samp, psamp)) return false;
 
         // base class has adjusted time tag for latency jitter
         wsamptime = psamp->getTimeTag() - _timeDelay;
@@ -387,8 +401,6 @@ bool CSI_IRGA_Sonic::process(const Sample* samp,
         _Pirga.set(dout, floatNAN);
         _Tirga.set(dout, floatNAN);
     }
-    if (psamp) psamp->freeReference();
-
     results.push_back(wsamp);
     return true;
 }
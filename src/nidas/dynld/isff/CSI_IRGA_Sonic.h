@@ -33,6 +33,8 @@
 #include <nidas/util/EndianConverter.h>
 #include <nidas/core/VariableIndex.h>
 
+#include <vector>
+
 class TimetagAdjuster;
 
 namespace nidas { namespace dynld { namespace isff {
@@ -101,22 +103,29 @@ private:
     /**
      * Campbell has provided custom firmware on the EC100 logger box so that
      * it can generate binary values (IEEE floats and 4-byte integers)
-     * instead of ASCII.
+     * instead of ASCII. The values are little-endian.
      */
     bool _binary;
 
     /**
-     * Endian-ness of binary values.
+     * Types of the 4 byte fields of a binary record.
      */
-    nidas::util::EndianConverter::endianness _endian;
+    enum binFieldType { BIN_FLOAT, BIN_UINT32 };
 
     /**
-     * Converter for binary values.
+     * Field types of the binary record, one for each requested
+     * variable, compiled in checkSampleTags(), so that a record is
+     * decoded in one pass without checking which field is which.
      */
-    const nidas::util::EndianConverter* _converter;
+    std::vector<binFieldType> _binLayout;
 
     nidas::core::TimetagAdjuster* _ttadjust;
 
+    /**
+     * Values unpacked from a binary record.
+     */
+    std::vector<float> _binValues;
+
     /// No copying
     CSI_IRGA_Sonic(const CSI_IRGA_Sonic &);
 
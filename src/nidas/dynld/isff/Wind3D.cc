@@ -52,6 +52,7 @@ Wind3D::Wind3D():
     _allBiasesNaN(false),
     _despike(false),
     _metek(false),
+    _despiker(4),
     _rotator(), _tilter(), _orienter(),
     _tcOffset(0.0),_tcSlope(1.0),
     _horizontalRotation(true),_tiltCorrection(true),
@@ -78,9 +79,7 @@ Wind3D::Wind3D():
     for (int i = 0; i < 3; i++) {
         _bias[i] = 0.0;
     }
-    for (int i = 0; i < 4; i++) {
-        _ttlast[i] = 0;
-    }
+    _despiker.setMaxGapUsecs(DATA_GAP_USEC);
 }
 
 Wind3D::~Wind3D()
@@ -97,27 +96,21 @@ Wind3D::~Wind3D()
 void Wind3D::despike(dsm_time_t tt,
 	float* uvwt,int n,bool* spikeOrMissing) throw()
 {
-    vector<double> dvec(n);	// despiked data
-    double* duvwt = &dvec.front();
-    /*
-     * Despike data
-     */
-    for (int i=0; i < n; i++) {
-        /* Restart statistics after data gap. */
-        if (tt - _ttlast[i] > DATA_GAP_USEC) _despiker[i].reset();
-
-        /* Despike status, 1=despiked, 0=not despiked */
-        spikeOrMissing[i] = std::isnan(uvwt[i]);
-        duvwt[i] = _despiker[i].despike(uvwt[i],spikeOrMissing+i);
-        if (!spikeOrMissing[i]) _ttlast[i] = tt;
-    }
+    if ((unsigned int)n != _despiker.getNumChannels())
+        _despiker.setNumChannels(n);
 
-    // If user wants despiked data, copy results back to passed array.
-    if (getDespike()) {
-        for (int i=0; i < n; i++) {
-            uvwt[i] = duvwt[i];
-        }
-    }
+    // Despike status, true=despiked or missing. Replace the
+    // values with the forecasts if the user wants despiked data.
+    _despiker.despike(tt, uvwt, spikeOrMissing, getDespike());
+}
+
+void Wind3D::despike(const dsm_time_t* tt,
+        float* u, float* v, float* w, float* tc, unsigned int n) throw()
+{
+    if (_despiker.getNumChannels() != 4) _despiker.setNumChannels(4);
+
+    float* data[4] = { u, v, w, tc };
+    _despiker.despike(tt, data, 0, n, getDespike());
 }
 
 
@@ -222,6 +215,96 @@ void Wind3D::offsetsTiltAndRotate(dsm_time_t tt, float* uvwt) throw()
     if (_horizontalRotation) _rotator.rotate(uvwt,uvwt+1);
 }
 
+void Wind3D::applyCorrections(const dsm_time_t* tt,
+        float* u, float* v, float* w, float* tc, unsigned int n) throw()
+{
+    for (unsigned int i0 = 0; i0 < n; ) {
+
+        // Read the calibrations in effect at the first sample
+        // of this run, and find the time they next change.
+        readOffsetsAnglesCalFile(tt[i0]);
+        dsm_time_t tnext = LONG_LONG_MAX;
+        if (_oaCalFile)
+            tnext = _oaCalFile->nextTime().toUsecs();
+#ifdef HAVE_LIBGSL
+        if (_atCalFile && _shadowFactor != 0.0) {
+            getTransducerRotation(tt[i0]);
+            if (_atCalFile)
+                tnext = std::min(tnext, _atCalFile->nextTime().toUsecs());
+        }
+#endif
+        unsigned int i1 = i0 + 1;
+        for ( ; i1 < n && tt[i1] < tnext; i1++);
+
+        // apply shadow correction before correcting for unusual orientation
+        transducerShadowCorrection(tt[i0], u + i0, v + i0, w + i0, i1 - i0);
+
+        orientTiltAndRotate(u + i0, v + i0, w + i0, tc + i0, i1 - i0);
+        i0 = i1;
+    }
+}
+
+void Wind3D::orientTiltAndRotate(float* u, float* v, float* w, float* tc,
+        unsigned int n)
+{
+    if (_tiltCorrection && !_tilter.isIdentity()) {
+        // The tilt mixes all three components, so combine the
+        // orientation, tilt and rotation into one matrix M, and
+        // since the biases are removed after the orientation,
+        // M * (orient - bias) = M * orient - M * bias.
+        double orient[3][3], tilt[3][3];
+        double rot[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+        _orienter.getMatrix(orient);
+        _tilter.getMatrix(tilt);
+        if (_horizontalRotation) _rotator.getMatrix(rot);
+
+        double mt[3][3];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                mt[i][j] = 0.0;
+                for (int k = 0; k < 3; k++) mt[i][j] += rot[i][k] * tilt[k][j];
+            }
+        }
+
+        double m[3][3], c[3];
+        for (int i = 0; i < 3; i++) {
+            c[i] = 0.0;
+            for (int j = 0; j < 3; j++) {
+                m[i][j] = 0.0;
+                for (int k = 0; k < 3; k++) m[i][j] += mt[i][k] * orient[k][j];
+                c[i] -= mt[i][j] * _bias[j];
+            }
+        }
+
+        for (unsigned int i = 0; i < n; i++) {
+            double x0 = u[i], x1 = v[i], x2 = w[i];
+            u[i] = (float)(m[0][0] * x0 + m[0][1] * x1 + m[0][2] * x2 + c[0]);
+            v[i] = (float)(m[1][0] * x0 + m[1][1] * x1 + m[1][2] * x2 + c[1]);
+            w[i] = (float)(m[2][0] * x0 + m[2][1] * x1 + m[2][2] * x2 + c[2]);
+        }
+    }
+    else {
+        // Without a tilt the orientation and rotation are done separately,
+        // so that, as in offsetsTiltAndRotate(), a missing w does not
+        // spoil u and v.
+        _orienter.applyOrientation(u, v, w, n);
+        if (_tiltCorrection) {
+            const float b0 = _bias[0], b1 = _bias[1], b2 = _bias[2];
+            for (unsigned int i = 0; i < n; i++) {
+                u[i] -= b0;
+                v[i] -= b1;
+                w[i] -= b2;
+            }
+        }
+        if (_horizontalRotation) _rotator.rotate(u, v, n);
+    }
+
+    const double slope = _tcSlope;
+    const double offset = _tcOffset;
+    for (unsigned int i = 0; i < n; i++)
+        tc[i] = tc[i] * slope + offset;
+}
+
 void Wind3D::validate()
 {
     SerialSensor::validate();
@@ -535,30 +618,79 @@ void Wind3D::getTransducerRotation(dsm_time_t tt)
         }
     }
 }
-#endif
 
-bool Wind3D::process(const Sample* samp,
-	std::list<const Sample*>& results)
+void Wind3D::transducerShadowCorrection(dsm_time_t tt,
+        float* u, float* v, float* w, unsigned int n)
 {
-    std::list<const Sample*> parseResults;
-
-    SerialSensor::process(samp,parseResults);
+    if (!_atCalFile || _shadowFactor == 0.0 || std::isnan(_atMatrix[0][0]))
+        return;
 
-    if (parseResults.empty()) return false;
+    getTransducerRotation(tt);
 
-    // result from base class parsing of ASCII
-    const Sample* psamp = parseResults.front();
+    double mat[3][3], inv[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            mat[i][j] = _atMatrix[i][j];
+            inv[i][j] = _atInverse[i][j];
+        }
+    }
+    const double f = _shadowFactor;
+
+    // Same steps as the single sample correction, with the inverse
+    // matrix rather than an LU solve, and without a test for missing
+    // values: one nan results in a nan speed and three nan components.
+    for (unsigned int i = 0; i < n; i++) {
+        double x0 = u[i], x1 = v[i], x2 = w[i];
+        double spd2 = x0 * x0 + x1 * x1 + x2 * x2;
+
+        // rotate from UVW to non-orthogonal transducer coordinates, ABC
+        double a = inv[0][0] * x0 + inv[0][1] * x1 + inv[0][2] * x2;
+        double b = inv[1][0] * x0 + inv[1][1] * x1 + inv[1][2] * x2;
+        double c = inv[2][0] * x0 + inv[2][1] * x1 + inv[2][2] * x2;
+
+        a /= 1.0 - f + f * ::sqrt(1.0 - a * a / spd2);
+        b /= 1.0 - f + f * ::sqrt(1.0 - b * b / spd2);
+        c /= 1.0 - f + f * ::sqrt(1.0 - c * c / spd2);
+
+        // rotate back to uvw coordinates
+        u[i] = (float)(mat[0][0] * a + mat[0][1] * b + mat[0][2] * c);
+        v[i] = (float)(mat[1][0] * a + mat[1][1] * b + mat[1][2] * c);
+        w[i] = (float)(mat[2][0] * a + mat[2][1] * b + mat[2][2] * c);
+    }
+}
+#else
+void Wind3D::transducerShadowCorrection(dsm_time_t, float*, float*, float*,
+        unsigned int)
+{
+}
+#endif
 
-    unsigned int nParsedVals = psamp->getDataLength();
-    const float* pdata = (const float*) psamp->getConstVoidDataPtr();
+bool Wind3D::process(const Sample* samp,
+	std::list<const Sample*>& results)
+{
+    // Parse the ASCII message directly into the output sample.
+    // CharacterSensor::parseSample() fills any unparsed values with nan,
+    // and applies any time tag adjustments and variable conversions.
+    // This way any extra variables beyond the first 5 standard sonic
+    // variables (u,v,w,tc,diag) will get passed on to the output.  Any
+    // derived sonic variables (ldiag,dir,spd) will overwrite the value at
+    // their respective index.
+    SampleT<float>* wsamp = getSample<float>(
+        std::max((unsigned int)getMaxScanfFields(), _noutVals));
+
+    if (!parseSample(samp, wsamp)) {
+        wsamp->freeReference();
+        return false;
+    }
 
-    const float* pend = pdata + nParsedVals;
+    unsigned int nParsedVals = wsamp->getDataLength();
+    float* dout = wsamp->getDataPtr();
 
     // u,v,w,tc,diag
     float uvwtd[5];
 
     for (unsigned int i = 0; i < sizeof(uvwtd) / sizeof(uvwtd[0]); i++) {
-        if (pdata < pend) uvwtd[i] = *pdata++;
+        if (i < nParsedVals) uvwtd[i] = dout[i];
         else uvwtd[i] = floatNAN;
     }
     
@@ -590,27 +722,12 @@ bool Wind3D::process(const Sample* samp,
 
     offsetsTiltAndRotate(samp->getTimeTag(), uvwtd);
 
-    // new sample
-    SampleT<float>* wsamp = getSample<float>(_noutVals);
-
-    // First fill the output sample with the parsed values.  The
-    // CharacterSensor::process() method takes care of filling any unparsed
-    // values in the output sample with nan.  This way any extra variables
-    // beyond the first 5 standard sonic variables (u,v,w,tc,diag) will get
-    // passed on to the output.  Any derived sonic variables
-    // (ldiag,dir,spd) will overwrite the value at their respective index.
-    memcpy(wsamp->getVoidDataPtr(), psamp->getConstVoidDataPtr(),
-           std::min(psamp->getDataByteLength(),
-                    wsamp->getDataByteLength()));
-
-    // any defined time lag has been applied by SerialSensor
-    wsamp->setTimeTag(psamp->getTimeTag());
+    // any defined time lag has been applied by parseSample
     wsamp->setId(_sampleId);
 
-    // finished with parsed sample
-    psamp->freeReference();
-
-    float* dout = wsamp->getDataPtr();
+    for (unsigned int i = nParsedVals; i < _noutVals; i++)
+        dout[i] = floatNAN;
+    wsamp->setDataLength(_noutVals);
 
     float *dptr = dout;
 
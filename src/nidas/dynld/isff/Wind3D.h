@@ -28,7 +28,7 @@
 #define NIDAS_DNYLD_ISFF_WIND3D_H
 
 #include <nidas/core/SerialSensor.h>
-#include <nidas/core/AdaptiveDespiker.h>
+#include <nidas/core/MultiChannelDespiker.h>
 #include <nidas/Config.h>
 #include "WindOrienter.h"
 #include "WindTilter.h"
@@ -123,29 +123,27 @@ public:
 
     void setOutlierProbability(double val)
     {
-	for (int i = 0; i < 4; i++)
-	    _despiker[i].setOutlierProbability(val);
+        _despiker.setOutlierProbability(val);
     }
 
     double getOutlierProbability() const
     {
-        return _despiker[0].getOutlierProbability();
+        return _despiker.getOutlierProbability();
     }
 
     void setDiscLevelMultiplier(double val)
     {
-	for (int i = 0; i < 4; i++)
-	    _despiker[i].setDiscLevelMultiplier(val);
+        _despiker.setDiscLevelMultiplier(val);
     }
 
     double getDiscLevelMultiplier() const
     {
-        return _despiker[0].getDiscLevelMultiplier();
+        return _despiker.getDiscLevelMultiplier();
     }
 
     double getDiscLevel() const
     {
-        return _despiker[0].getDiscLevel();
+        return _despiker.getDiscLevel(0);
     }
 
     void setTcOffset(double val) 
@@ -187,6 +185,14 @@ public:
     void despike(nidas::core::dsm_time_t tt,float* uvwt,int n, bool* spikeOrMissing)
     	throw();
 
+    /**
+     * Despike columns of u,v,w,tc for @p n samples, with time tags @p tt,
+     * as despike() does for each sample.  The spikes are replaced by
+     * their forecasts if getDespike() is true.
+     */
+    void despike(const nidas::core::dsm_time_t* tt,
+        float* u, float* v, float* w, float* tc, unsigned int n) throw();
+
     /**
      * Do standard bias removal, tilt correction and horizontal rotation of
      * 3d sonic anemometer data.
@@ -210,6 +216,24 @@ public:
      **/
     void readOffsetsAnglesCalFile(nidas::core::dsm_time_t tt) throw();
 
+    /**
+     * Apply the transducer shadow correction, orientation, bias removal,
+     * tilt correction, Tc correction and horizontal rotation to columns
+     * of u,v,w,tc for @p n samples, with time tags @p tt. The results are
+     * the same, within rounding, as calling transducerShadowCorrection(),
+     * applyOrientation() and offsetsTiltAndRotate() for each sample,
+     * as is done in process().
+     *
+     * The samples are corrected in runs over which the calibrations from
+     * the CalFiles are constant, and within a run the orientation, tilt and
+     * rotation are combined into one matrix, so the inner loops are simple
+     * enough to be vectorized. This is meant for reprocessing large
+     * amounts of sonic data. Despiking is not done here, since it depends
+     * on the previous samples.
+     */
+    void applyCorrections(const nidas::core::dsm_time_t* tt,
+        float* u, float* v, float* w, float* tc, unsigned int n) throw();
+
     /**
      * Validate the configuration of this sensor. Calls the base class
      * validate(), parseParameters(), and checkSampleTags().
@@ -247,6 +271,15 @@ public:
     virtual void transducerShadowCorrection(nidas::core::dsm_time_t, float *);
 #endif
 
+    /**
+     * Apply the transducer shadow correction to columns of @p n
+     * wind components, using the transducer geometry in effect at
+     * time @p tt. Used by applyCorrections(). Does nothing unless
+     * there is GSL support, a transducer geometry and a shadowFactor.
+     */
+    virtual void transducerShadowCorrection(nidas::core::dsm_time_t tt,
+        float* u, float* v, float* w, unsigned int n);
+
 protected:
 
     typedef nidas::dynld::isff::WindOrienter WindOrienter;
@@ -255,8 +288,6 @@ protected:
 
     static const int DATA_GAP_USEC = 60000000;
 
-    nidas::core::dsm_time_t _ttlast[4];
-
     double _bias[3];
 
     bool _allBiasesNaN;
@@ -265,7 +296,10 @@ protected:
     
     bool _metek;
 
-    nidas::core::AdaptiveDespiker _despiker[4];
+    /**
+     * Despiker of u,v,w,tc.
+     */
+    nidas::core::MultiChannelDespiker _despiker;
  
     WindRotator _rotator;
 
@@ -364,6 +398,14 @@ protected:
 
 private:
 
+    /**
+     * Apply the orientation, bias removal, tilt correction, Tc
+     * correction and horizontal rotation to columns of @p n samples,
+     * with the current settings.
+     */
+    void orientTiltAndRotate(float* u, float* v, float* w, float* tc,
+        unsigned int n);
+
     // no copying
     Wind3D(const Wind3D& x);
 
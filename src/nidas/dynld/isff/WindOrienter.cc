@@ -186,6 +186,37 @@ applyOrientation(float* uvwt)
     }
 }
 
+void
+WindOrienter::
+applyOrientation(float* u, float* v, float* w, unsigned int n) const
+{
+    if (_unusualOrientation)
+    {
+        const int tx0 = _tx[0], tx1 = _tx[1], tx2 = _tx[2];
+        const float sx0 = _sx[0], sx1 = _sx[1], sx2 = _sx[2];
+        for (unsigned int i = 0; i < n; i++)
+        {
+            float dn[3] = { u[i], v[i], w[i] };
+            u[i] = sx0 * dn[tx0];
+            v[i] = sx1 * dn[tx1];
+            w[i] = sx2 * dn[tx2];
+        }
+    }
+}
+
+void
+WindOrienter::
+getMatrix(double mat[3][3]) const
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            mat[i][j] = (j == _tx[i] ? _sx[i] : 0.0);
+        }
+    }
+}
+
 bool
 WindOrienter::
 applyOrientation2D(float* u, float* v)
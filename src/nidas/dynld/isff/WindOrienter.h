@@ -69,6 +69,21 @@ public:
     bool
     applyOrientation2D(float* u, float *v);
 
+    /**
+     * Apply orientation changes to arrays of @p n wind components.
+     * The result is the same as applyOrientation() on each (u,v,w).
+     **/
+    void
+    applyOrientation(float* u, float* v, float* w, unsigned int n) const;
+
+    /**
+     * Get the current orientation as a 3x3 matrix, of the new u,v,w
+     * components versus the original ones, so that it can be combined
+     * with other rotations.
+     */
+    void
+    getMatrix(double mat[3][3]) const;
+
     /**
      * Parse the orientation parameter and set the vectors which translate
      * the axes and signs of the wind sensor components.  The parameter
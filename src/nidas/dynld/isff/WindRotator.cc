@@ -30,3 +30,28 @@ void WindRotator::rotate(float* up, float* vp) const
     *up = u;
     *vp = v;
 }
+
+void WindRotator::rotate(float* u, float* v, unsigned int n) const
+{
+    const double c = _cosAngle;
+    const double s = _sinAngle;
+    for (unsigned int i = 0; i < n; i++) {
+        float ui = (float)( u[i] * c + v[i] * s);
+        float vi = (float)(-u[i] * s + v[i] * c);
+        u[i] = ui;
+        v[i] = vi;
+    }
+}
+
+void WindRotator::getMatrix(double mat[3][3]) const
+{
+    mat[0][0] = _cosAngle;
+    mat[0][1] = _sinAngle;
+    mat[0][2] = 0.0;
+    mat[1][0] = -_sinAngle;
+    mat[1][1] = _cosAngle;
+    mat[1][2] = 0.0;
+    mat[2][0] = 0.0;
+    mat[2][1] = 0.0;
+    mat[2][2] = 1.0;
+}
@@ -47,6 +47,17 @@ public:
 
     void rotate(float* up, float* vp) const;
 
+    /**
+     * Rotate arrays of @p n U,V components.
+     */
+    void rotate(float* u, float* v, unsigned int n) const;
+
+    /**
+     * Get the rotation as a 3x3 matrix of U,V,W, leaving W unchanged,
+     * so that it can be combined with a WindTilter matrix.
+     */
+    void getMatrix(double mat[3][3]) const;
+
 private:
 
     double _angle;
@@ -34,6 +34,13 @@ void WindTilter::rotate(float* up, float* vp, float* wp) const
     *wp = (float) out[2];
 }
 
+void WindTilter::getMatrix(double mat[3][3]) const
+{
+    for (int i = 0; i < 3; i++)
+	for (int j = 0; j < 3; j++)
+	    mat[i][j] = _mat[i][j];
+}
+
 void WindTilter::computeMatrix()
 {
     double sinlean,coslean,sinaz,cosaz;
@@ -150,6 +150,11 @@ public:
 
     void rotate(float*u, float*v, float*w) const;
 
+    /**
+     * Get the rotation matrix, from sonic to flow coordinates.
+     */
+    void getMatrix(double mat[3][3]) const;
+
 private:
 
     void computeMatrix();
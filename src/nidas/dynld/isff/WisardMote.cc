@@ -52,7 +52,7 @@ namespace n_u = nidas::util;
 bool WisardMote::_functionsMapped = false;
 
 /* static */
-map<int, pair<WisardMote::unpack_t,unsigned int> > WisardMote::_unpackMap;
+WisardMote::UnpackInfo WisardMote::_unpackTable[256];
 
 /* static */
 map<int, string> WisardMote::_typeNames;
@@ -69,14 +69,13 @@ NIDAS_CREATOR_FUNCTION_NS(isff, WisardMote)
 
 WisardMote::WisardMote() :
     _sampleTagsById(),
+    _moteTables(),
     _processorSensor(0),
     _sensorSerialNumbersByMoteIdAndType(),
     _sequenceNumbersByMoteId(),
     _badCRCsByMoteId(),
     _tdiffByMoteId(),
-    _numBadSensorTypes(),
     _unconfiguredMotes(),
-    _noSampleTags(),
     _ignoredSensorTypes(),
     _nowarnSensorTypes(),
     _tsoilData()
@@ -153,9 +152,60 @@ void WisardMote::validate()
 
     VLOG(("final getSampleTags().size()=") << getSampleTags().size());
     VLOG(("final _sampleTagsByIdTags.size()=") << _sampleTagsById.size());
+
+    _processorSensor->buildMoteTables();
+
     SerialSensor::validate();
 }
 
+vector<WisardMote::SensorTypeInfo>& WisardMote::getMoteTable(int moteId)
+{
+    map<int, vector<SensorTypeInfo> >::iterator mi = _moteTables.find(moteId);
+    if (mi != _moteTables.end()) return mi->second;
+
+    vector<SensorTypeInfo>& table = _moteTables[moteId];
+    table.resize(256);
+
+    for (unsigned int stype = 0; stype < table.size(); stype++) {
+        SensorTypeInfo& sti = table[stype];
+        sti.unpack = _unpackTable[stype].unpack;
+        sti.nfields = _unpackTable[stype].nfields;
+
+        // sample id of processed sample
+        dsm_sample_id_t sid = getId() + (moteId << 8) + stype;
+        map<dsm_sample_id_t, SampleTag*>::const_iterator ti =
+            _sampleTagsById.find(sid);
+
+        if (ti != _sampleTagsById.end() && ti->second) {
+            sti.stag = ti->second;
+            unsigned int slen = sti.stag->getVariables().size();
+            sti.slen = std::max(slen, sti.nfields);
+        }
+        else {
+            // if a sample is ignored, we don't create a sample, but still
+            // need to keep parsing the raw sample.
+            bool ignore = _ignoredSensorTypes.find(stype) != _ignoredSensorTypes.end();
+            if (!ignore) {
+                sti.slen = sti.nfields;
+                sti.warnNoTag =
+                    _nowarnSensorTypes.find(stype) == _nowarnSensorTypes.end();
+            }
+        }
+    }
+    return table;
+}
+
+void WisardMote::buildMoteTables()
+{
+    _moteTables.clear();
+    map<dsm_sample_id_t, SampleTag*>::const_iterator ti = _sampleTagsById.begin();
+    for ( ; ti != _sampleTagsById.end(); ++ti) {
+        int moteId = (ti->first - getId()) >> 8;
+        getMoteTable(moteId);
+    }
+    VLOG(("%s: %zu mote tables", getName().c_str(), _moteTables.size()));
+}
+
 void WisardMote::createSampleTags(const SampleTag* stag,const vector<int>& sensorMotes,list<SampleTag*>& newtags)
 {
 
@@ -246,7 +296,7 @@ void WisardMote::addMoteSampleTag(SampleTag* tag)
          << hex << tag->getSpSId() << dec
          << ", ntags=" << getSampleTags().size());
     
-    if (_sampleTagsById[tag->getId()]) {
+    if (_sampleTagsById.find(tag->getId()) != _sampleTagsById.end()) {
         WLOG(("%s: duplicate processed sample tag for id %d,%#x",
                     getName().c_str(), tag->getDSMId(),tag->getSpSId()));
         delete tag;
@@ -254,6 +304,8 @@ void WisardMote::addMoteSampleTag(SampleTag* tag)
     else {
         _sampleTagsById[tag->getId()] = tag;
         addSampleTag(tag);
+        // the tables are rebuilt with the new tag
+        _moteTables.clear();
     }
 }
 
@@ -385,6 +437,9 @@ bool WisardMote::process(const Sample * samp, list<const Sample *>&results)
     if (header.messageType != 1)
         return false; // other than a data message
 
+    // dispatch table of the sensor types of this mote
+    vector<SensorTypeInfo>& table = getMoteTable(header.moteId);
+
     while (cp < eos) {
 
         /* get Wisard sensor type */
@@ -395,59 +450,44 @@ bool WisardMote::process(const Sample * samp, list<const Sample *>&results)
               n_u::UTime(ttag).format(true, "%Y %m %d %H:%M:%S.%3f").c_str(),
               header.moteId, getSensorId(),sensorType));
 
-        /* find the appropriate member function to unpack the data for this sensorType */
-        const pair<unpack_t,int>& upair = _unpackMap[sensorType];
-        unpack_t unpack = upair.first;
+        /* the member function to unpack the data for this sensorType */
+        SensorTypeInfo& sti = table[sensorType];
+        unpack_t unpack = sti.unpack;
 
         if (unpack == NULL) {
-            if (!( _numBadSensorTypes[header.moteId][sensorType]++ % 1000))
+            if (!(sti.nunknown++ % 1000))
                 WLOG(("%s: %s, moteId=%d: unknown sensorType=%#.2x, at byte %u, #times=%u",
                         getName().c_str(),
                         n_u::UTime(ttag).format(true, "%Y %m %d %H:%M:%S.%3f").c_str(),
                         header.moteId, sensorType,
-                        (unsigned int)(cp-sos-1),_numBadSensorTypes[header.moteId][sensorType]));
+                        (unsigned int)(cp-sos-1),sti.nunknown));
             break;
         }
 
-        unsigned int nfields = upair.second;
-
         // sample id of processed sample
         dsm_sample_id_t sid = getId() + (header.moteId << 8) + sensorType;
-        SampleTag* stag = _sampleTagsById[sid];
+        SampleTag* stag = sti.stag;
         SampleT<float>* osamp = 0;
 
-        /* create an output floating point sample */
-        if (stag) {
-            const vector<Variable*>& vars = stag->getVariables();
-            unsigned int slen = vars.size();
-            osamp = getSample<float> (std::max(slen,nfields));
+        if (sti.warnNoTag && !(sti.nnotag++ % 1000))
+            WLOG(("%s: %s, no sample tag for %d,%#x, mote=%d, sensorType=%#.2x, #times=%u",
+                    getName().c_str(),
+                    n_u::UTime(ttag).format(true, "%Y %m %d %H:%M:%S.%3f").c_str(),
+                    GET_DSM_ID(sid),GET_SPS_ID(sid),header.moteId,sensorType,sti.nnotag));
+
+        /* create an output floating point sample, unless the sensor
+         * type is ignored */
+        if (sti.slen > 0) {
+            osamp = getSample<float>(sti.slen);
             osamp->setId(sid);
             osamp->setTimeTag(ttag);
         }
-        else {
-            // if a sample is ignored, we don't create a sample, but still
-            // need to keep parsing this raw sample.
-            bool ignore = _ignoredSensorTypes.find(sensorType) != _ignoredSensorTypes.end();
-            if (!ignore) {
-                bool warn = _nowarnSensorTypes.find(sensorType) == _nowarnSensorTypes.end();
-                if (warn) {
-                    if (!( _noSampleTags[header.moteId][sensorType]++ % 1000))
-                        WLOG(("%s: %s, no sample tag for %d,%#x, mote=%d, sensorType=%#.2x, #times=%u",
-                                getName().c_str(),
-                                n_u::UTime(ttag).format(true, "%Y %m %d %H:%M:%S.%3f").c_str(),
-                                GET_DSM_ID(sid),GET_SPS_ID(sid),header.moteId,sensorType,_noSampleTags[header.moteId][sensorType]));
-                }
-                osamp = getSample<float> (nfields);
-                osamp->setId(sid);
-                osamp->setTimeTag(ttag);
-            }
-        }
 
         /* unpack the sample for this sensorType.
          * If osamp is NULL, the character pointer will be
          * moved past the field for this sensorType, but (obviously) no
          * data stored in the sample. */
-        cp = (this->*unpack)(cp, eos, nfields, &header, stag, osamp);
+        cp = (this->*unpack)(cp, eos, sti.nfields, &header, stag, osamp);
 
         /* push out */
         if (osamp) results.push_back(osamp);
@@ -1432,141 +1472,141 @@ const char* WisardMote::unpackNR01(const char *cp, const char *eos,
 void WisardMote::initFuncMap()
 {
     if (_functionsMapped) return;
-    _unpackMap[0x01] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackPicTime,1);
+    _unpackTable[0x01] = UnpackInfo(&WisardMote::unpackPicTime,1);
     _typeNames[0x01] = "PicTime";
 
-    _unpackMap[0x04] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackInt16,1);
+    _unpackTable[0x04] = UnpackInfo(&WisardMote::unpackInt16,1);
     _typeNames[0x04] = "Int16";
 
-    _unpackMap[0x05] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackInt32,1);
+    _unpackTable[0x05] = UnpackInfo(&WisardMote::unpackInt32,1);
     _typeNames[0x05] = "Int32";
 
-    _unpackMap[0x0b] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackAccumSec,1);
+    _unpackTable[0x0b] = UnpackInfo(&WisardMote::unpackAccumSec,1);
     _typeNames[0x0b] = "SecOfYear";
 
-    _unpackMap[0x0c] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackUint32,1);
+    _unpackTable[0x0c] = UnpackInfo(&WisardMote::unpackUint32,1);
     _typeNames[0x0c] = "TimerCounter";
 
-    _unpackMap[0x0d] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpack100thSec,1);
+    _unpackTable[0x0d] = UnpackInfo(&WisardMote::unpack100thSec,1);
     _typeNames[0x0d] = "Time100thSec";
 
-    _unpackMap[0x0e] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpack10thSec,2);
+    _unpackTable[0x0e] = UnpackInfo(&WisardMote::unpack10thSec,2);
     _typeNames[0x0e] = "Time10thSec";
 
-    _unpackMap[0x0f] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackPicTimeFields,4);
+    _unpackTable[0x0f] = UnpackInfo(&WisardMote::unpackPicTimeFields,4);
     _typeNames[0x0f] = "PicTimeFields";
 
     for (int i = 0x10; i < 0x14; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackTRH,3);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackTRH,3);
         _typeNames[i] = "TRH";
     }
 
     for (int i = 0x1c; i < 0x20; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackUint16,2);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackUint16,2);
         _typeNames[i] = "Rain";
     }
 
     for (int i = 0x20; i < 0x24; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackTsoil,NTSOILS*2);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackTsoil,NTSOILS*2);
         _typeNames[i] = "Tsoil";
     }
 
     for (int i = 0x24; i < 0x28; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackGsoil,1);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackGsoil,1);
         _typeNames[i] = "Gsoil";
     }
 
     for (int i = 0x28; i < 0x2c; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackQsoil,1);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackQsoil,1);
         _typeNames[i] = "Qsoil";
     }
 
     for (int i = 0x2c; i < 0x30; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackTP01,5);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackTP01,5);
         _typeNames[i] = "TP01";
     }
 
     for (int i = 0x30; i < 0x34; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackInt16,5);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackInt16,5);
         _typeNames[i] = "5 fields of Int16";
     }
 
     for (int i = 0x34; i < 0x38; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackInt16,4);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackInt16,4);
         _typeNames[i] = "4 fields of Int16";
     }
 
     for (int i = 0x38; i < 0x3c; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackInt16,1);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackInt16,1);
         _typeNames[i] = "1 field of Int16, often Wetness";
     }
 
     for (int i = 0x3c; i < 0x40; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackInt16,1);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackInt16,1);
         _typeNames[i] = "Infra-red surface temperature";
     }
 
-    _unpackMap[0x40] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackStatus,1);
+    _unpackTable[0x40] = UnpackInfo(&WisardMote::unpackStatus,1);
     _typeNames[0x40] = "Status";
 
-    _unpackMap[0x41] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackXbee,7);
+    _unpackTable[0x41] = UnpackInfo(&WisardMote::unpackXbee,7);
     _typeNames[0x41] = "Xbee Status";
 
-    _unpackMap[0x49] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackPower,6);
+    _unpackTable[0x49] = UnpackInfo(&WisardMote::unpackPower,6);
     _typeNames[0x49] = "Power Monitor";
 
     for (int i = 0x4c; i < 0x50; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackNR01,8);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackNR01,8);
         _typeNames[i] = "Hukseflux NR01";
     }
 
     for (int i = 0x50; i < 0x54; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackRnet,1);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackRnet,1);
         _typeNames[i] = "Q7 Net Radiometer";
     }
 
     for (int i = 0x54; i < 0x58; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackRsw,1);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackRsw,1);
         _typeNames[i] = "Uplooking Pyranometer (Rsw.in)";
     }
 
     for (int i = 0x58; i < 0x5c; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackRsw,1);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackRsw,1);
         _typeNames[i] = "Downlooking Pyranometer (Rsw.out)";
     }
 
     for (int i = 0x5c; i < 0x60; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackRlw,5);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackRlw,5);
         _typeNames[i] = "Uplooking Epply Pyrgeometer (Rlw.in)";
     }
 
     for (int i = 0x60; i < 0x64; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackRlw,5);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackRlw,5);
         _typeNames[i] = "Downlooking Epply Pyrgeometer (Rlw.out)";
     }
 
     for (int i = 0x64; i < 0x68; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackRlwKZ,2);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackRlwKZ,2);
         _typeNames[i] = "Uplooking K&Z Pyrgeometer (Rlw.in)";
     }
 
     for (int i = 0x68; i < 0x6c; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackRlwKZ,2);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackRlwKZ,2);
         _typeNames[i] = "Downlooking K&Z Pyrgeometer (Rlw.out)";
     }
 
     for (int i = 0x6c; i < 0x70; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackCNR2,2);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackCNR2,2);
         _typeNames[i] = "CNR2 Net Radiometer";
     }
 
     for (int i = 0x70; i < 0x74; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackRsw2,2);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackRsw2,2);
         _typeNames[i] = "Diffuse shortwave";
     }
 
     for (int i = 0x74; i < 0x78; i++) {
-        _unpackMap[i] = pair<WisardMote::unpack_t,unsigned int>(&WisardMote::unpackRsw,1);
+        _unpackTable[i] = UnpackInfo(&WisardMote::unpackRsw,1);
         _typeNames[i] = "Photosynthetically active radiation";
     }
 
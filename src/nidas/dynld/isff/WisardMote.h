@@ -338,9 +338,21 @@ private:
     static bool _functionsMapped;
 
     /**
-     * Mapping between sensor type and function which parses the data.
+     * Function which parses the data of a sensor type,
+     * and the number of fields it unpacks.
      */
-    static std::map<int, std::pair<unpack_t,unsigned int> > _unpackMap;
+    struct UnpackInfo
+    {
+        UnpackInfo(): unpack(0), nfields(0) {}
+        UnpackInfo(unpack_t f, unsigned int n): unpack(f), nfields(n) {}
+        unpack_t unpack;
+        unsigned int nfields;
+    };
+
+    /**
+     * Unpack functions, indexed by sensor type.
+     */
+    static UnpackInfo _unpackTable[256];
 
     static std::map<int, std::string> _typeNames;
 
@@ -352,6 +364,66 @@ private:
      */
     std::map<dsm_sample_id_t, SampleTag*> _sampleTagsById;
 
+    /**
+     * How the data of a sensor type from a mote is processed.
+     */
+    struct SensorTypeInfo
+    {
+        SensorTypeInfo():
+            unpack(0), nfields(0), slen(0), stag(0), warnNoTag(false),
+            nunknown(0), nnotag(0)
+        {}
+
+        unpack_t unpack;
+
+        unsigned int nfields;
+
+        /**
+         * Length of the output sample, or 0 if the sensor
+         * type is ignored and no sample is generated.
+         */
+        unsigned int slen;
+
+        /**
+         * Processed sample tag, or NULL if none was configured.
+         */
+        SampleTag* stag;
+
+        /**
+         * Warn if there is no sample tag for this sensor type.
+         */
+        bool warnNoTag;
+
+        /**
+         * Number of times this sensor type was not recognized.
+         */
+        unsigned int nunknown;
+
+        /**
+         * Number of times a sample was generated without a sample tag.
+         */
+        unsigned int nnotag;
+    };
+
+    /**
+     * Return the table of the 256 sensor types of a mote,
+     * building it if necessary.
+     */
+    std::vector<SensorTypeInfo>& getMoteTable(int moteId);
+
+    /**
+     * Rebuild the tables of the motes which have sample tags.
+     * Called at the end of validate().
+     */
+    void buildMoteTables();
+
+    /**
+     * Tables of sensor types for each mote id, so that each field of
+     * a message is dispatched with an array index, rather than
+     * map lookups of the unpack function and sample tag.
+     */
+    std::map<int, std::vector<SensorTypeInfo> > _moteTables;
+
     /**
      * Pointer to the WisardMote that does the processing for
      * the samples with this sensor id. Since more than one WisardMote
@@ -371,15 +443,8 @@ private:
 
     std::map<int, int> _tdiffByMoteId;
 
-    /**
-     * For each mote id, the number of unrecognized sensor types.
-     */
-    std::map <int, std::map<int, unsigned int> > _numBadSensorTypes;
-
     std::map<int, unsigned int> _unconfiguredMotes;
 
-    std::map <int, std::map<int, unsigned int> > _noSampleTags;
-
     std::set<int> _ignoredSensorTypes;
 
     std::set<int> _nowarnSensorTypes;
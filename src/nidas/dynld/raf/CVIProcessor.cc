@@ -45,8 +45,8 @@ NIDAS_CREATOR_FUNCTION_NS(raf,CVIProcessor)
 CVIProcessor::CVIProcessor(): SampleIOProcessor(false),
     _connectionMutex(),_connectedSources(),_connectedOutputs(),
     _outputSampleTag(0),_d2aDeviceName(),_digioDeviceName(),
-    _varMatched(),_averager(),
-    _rate(0.0),_lvSampleId(0),_aout(),_dout(),
+    _varMatched(),_averager(),_slidingAverager(),_lowLatency(false),
+    _lvSensor(0),_rate(0.0),_lvSampleId(0),_aout(),_dout(),
     _numD2A(0),_numDigout(0),_site(0)
 {
     for (unsigned int i = 0; i < sizeof(_douts)/sizeof(_douts[0]); i++)
@@ -61,7 +61,7 @@ CVIProcessor::~CVIProcessor()
     std::set<SampleOutput*>::const_iterator oi = _connectedOutputs.begin();
     for ( ; oi != _connectedOutputs.end(); ++oi) {
         SampleOutput* output = * oi;
-        _averager.removeSampleClient(output);
+        getAverager()->removeSampleClient(output);
 
         output->flush();
         try {
@@ -98,6 +98,7 @@ void CVIProcessor::addRequestedSampleTag(SampleTag* tag)
         if (_site) var->setSite(_site);
         _varMatched.push_back(false);
         _averager.addVariable(var);
+        _slidingAverager.addVariable(var);
     }
     if (tag->getRate() <= 0.0) {
         ostringstream ost;
@@ -105,6 +106,10 @@ void CVIProcessor::addRequestedSampleTag(SampleTag* tag)
         throw n_u::InvalidParameterException("CVIProcessor","sample",ost.str());
     }
     _averager.setAveragePeriodSecs(1.0/tag->getRate());
+    _slidingAverager.setAveragePeriodSecs(1.0/tag->getRate());
+    // default latency budget, until set by the "latency" parameter
+    if (_slidingAverager.getLatencyBudgetSecs() <= 0.0)
+        _slidingAverager.setLatencyBudgetSecs(1.0/tag->getRate());
 
     // SampleIOProcessor will delete
     SampleIOProcessor::addRequestedSampleTag(tag);
@@ -115,8 +120,11 @@ void CVIProcessor::connectSource(SampleSource* source)
 {
     /*
      * In the typical usage on a DSM, this connection will
-     * be from the SamplePipeline.
+     * be from the SamplePipeline.  The SlidingAverager is
+     * connected to the pipeline itself, so that it can
+     * bypass the processed sorter.
      */
+    SampleSource* pipeline = source;
     source = source->getProcessedSampleSource();
     assert(source);
 
@@ -153,30 +161,37 @@ void CVIProcessor::connectSource(SampleSource* source)
 #endif
 
         // can throw IOException
-        if (sensor && _lvSampleId == 0 && dynamic_cast<CVI_LV_Input*>(sensor))
-                attachLVInput(source,intag);
+        CVI_LV_Input* lvsensor = dynamic_cast<CVI_LV_Input*>(sensor);
+        if (lvsensor && _lvSampleId == 0)
+                attachLVInput(source,intag,lvsensor);
         // sensor->setApplyVariableConversions(true);
     }
 
-    _averager.connect(source);
+    if (_lowLatency) _slidingAverager.connect(pipeline);
+    else _averager.connect(source);
 }
 
 void CVIProcessor::disconnectSource(SampleSource* source) throw()
 {
+    SampleSource* pipeline = source;
     source = source->getProcessedSampleSource();
 
     _connectionMutex.lock();
     _connectedSources.erase(source);
     _connectionMutex.unlock();
 
-    _averager.disconnect(source);
-    _averager.flush();
+    if (_lowLatency) _slidingAverager.disconnect(pipeline);
+    else _averager.disconnect(source);
+    getAverager()->flush();
+    if (_lvSensor) _lvSensor->setLatencySource(0);
+    _lvSensor = 0;
     source->removeSampleClient(this);
     _aout.close();
     _dout.close();
 }
 
-void CVIProcessor::attachLVInput(SampleSource* source, const SampleTag* tag)
+void CVIProcessor::attachLVInput(SampleSource* source, const SampleTag* tag,
+                                 CVI_LV_Input* sensor)
 {
     // cerr << "CVIProcessor::attachLVInput: sensor=" <<
       //   _lvSensor->getName() << endl;
@@ -203,20 +218,23 @@ void CVIProcessor::attachLVInput(SampleSource* source, const SampleTag* tag)
     }
     _lvSampleId = tag->getId();
     source->addSampleClientForTag(this,tag);
+
+    _lvSensor = sensor;
+    if (_lowLatency) _lvSensor->setLatencySource(&_slidingAverager);
 }
 
 void CVIProcessor::connect(SampleOutput* output) throw()
 {
     ILOG(("CVIProcessor::connect from ") << output->getName());
     _connectionMutex.lock();
-    _averager.addSampleClient(output);
+    getAverager()->addSampleClient(output);
     _connectedOutputs.insert(output);
     _connectionMutex.unlock();
 }
 
 void CVIProcessor::disconnect(SampleOutput* output) throw()
 {
-    _averager.removeSampleClient(output);
+    getAverager()->removeSampleClient(output);
 
     _connectionMutex.lock();
     _connectedOutputs.erase(output);
@@ -244,7 +262,7 @@ void CVIProcessor::disconnect(SampleOutput* output) throw()
 
 void CVIProcessor::flush() throw()
 {
-    _averager.flush();
+    getAverager()->flush();
     std::set<SampleOutput*>::const_iterator oi = _connectedOutputs.begin();
     for ( ; oi != _connectedOutputs.end(); ++oi) {
         SampleOutput* output = * oi;
@@ -353,6 +371,28 @@ void CVIProcessor::fromDOMElement(const xercesc::DOMElement* node)
                         "bad dout parameter");
                 setDigIODeviceName(param->getStringValue(0));
         }
+        else if (pname == "lowlatency") {
+                if (param->getType() != Parameter::BOOL_PARAM ||
+                    param->getLength() != 1)
+                    throw n_u::InvalidParameterException(
+                        SampleIOProcessor::getName(),"parameter",
+                        "bad lowlatency parameter");
+                _lowLatency = (bool)param->getNumericValue(0);
+        }
+        else if (pname == "window") {
+                if (param->getLength() != 1 || param->getNumericValue(0) <= 0.0)
+                    throw n_u::InvalidParameterException(
+                        SampleIOProcessor::getName(),"parameter",
+                        "bad window parameter");
+                _slidingAverager.setWindowSecs(param->getNumericValue(0));
+        }
+        else if (pname == "latency") {
+                if (param->getLength() != 1 || param->getNumericValue(0) <= 0.0)
+                    throw n_u::InvalidParameterException(
+                        SampleIOProcessor::getName(),"parameter",
+                        "bad latency parameter");
+                _slidingAverager.setLatencyBudgetSecs(param->getNumericValue(0));
+        }
     }
 }
 
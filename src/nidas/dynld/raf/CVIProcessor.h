@@ -33,13 +33,24 @@
 #include <nidas/dynld/ViperDIO.h>
 #include <nidas/dynld/DSC_AnalogOut.h>
 #include <nidas/core/SampleAverager.h>
+#include <nidas/core/SlidingAverager.h>
 
 namespace nidas { namespace dynld { namespace raf {
 
 using namespace nidas::core;
 
+class CVI_LV_Input;
+
 /**
  * Processor to support Counter-flow Virtual Impactor.
+ *
+ * By default the variables sent to the CVI are averaged from the
+ * processed sorter of the pipeline.  If the "lowlatency" parameter is
+ * true, they are instead averaged by a SlidingAverager from the sensors
+ * as they are processed, bypassing the processed sorter, over a sliding
+ * window given by the "window" parameter in seconds.  The latency of
+ * each output is checked against the "latency" parameter, in seconds,
+ * and reported in the status of the CVI_LV_Input.
  */
 class CVIProcessor: public SampleIOProcessor, public SampleClient
 {
@@ -131,7 +142,17 @@ protected:
     /**
      * @throws nidas::util::IOException
      **/
-    void attachLVInput(SampleSource* src, const SampleTag* tag);
+    void attachLVInput(SampleSource* src, const SampleTag* tag,
+                       CVI_LV_Input* sensor);
+
+    /**
+     * The averager of the output variables.
+     */
+    Resampler* getAverager()
+    {
+        if (_lowLatency) return &_slidingAverager;
+        return &_averager;
+    }
 
 private:
 
@@ -151,6 +172,12 @@ private:
 
     SampleAverager _averager;
 
+    SlidingAverager _slidingAverager;
+
+    bool _lowLatency;
+
+    CVI_LV_Input* _lvSensor;
+
     float _rate;
 
     dsm_sample_id_t _lvSampleId;
@@ -27,6 +27,8 @@
 #include "CVI_LV_Input.h"
 #include <nidas/core/ServerSocketIODevice.h>
 
+#include <iomanip>
+
 using namespace nidas::core;
 using namespace nidas::dynld::raf;
 using namespace std;
@@ -35,7 +37,7 @@ namespace n_u = nidas::util;
 
 NIDAS_CREATOR_FUNCTION_NS(raf,CVI_LV_Input)
 
-CVI_LV_Input::CVI_LV_Input(): _tt0(0), prevCVTdiff(0)
+CVI_LV_Input::CVI_LV_Input(): _tt0(0), prevCVTdiff(0), _latencySource(0)
 {
 }
 
@@ -147,3 +149,25 @@ bool CVI_LV_Input::process(const Sample *samp,
     }
     return !results.empty();
 }
+
+void CVI_LV_Input::printStatus(std::ostream& ostr)
+{
+    CharacterSensor::printStatus(ostr);
+    if (!_latencySource) {
+        ostr << "<td></td></tr>" << endl;
+        return;
+    }
+
+    // latencies of the low latency CVI outputs, since the start
+    SlidingAverager::LatencyStats stats = _latencySource->getLatencyStats();
+    bool warn = stats.nOverBudget > 0;
+    ostr << "<td align=left>" << (warn ? "<font color=red><b>" : "") <<
+        "CVI nout=" << stats.nout << fixed << setprecision(3);
+    if (stats.nout > 0)
+        ostr << ",latency mean=" <<
+            (double)stats.sum / stats.nout / USECS_PER_SEC <<
+            "s,max=" << (double)stats.max / USECS_PER_SEC << 's';
+    ostr << ",budget=" << _latencySource->getLatencyBudgetSecs() <<
+        "s,over=" << stats.nOverBudget <<
+        (warn ? "</b></font>" : "") << "</td></tr>" << endl;
+}
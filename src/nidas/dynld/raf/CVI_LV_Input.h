@@ -28,6 +28,7 @@
 #define NIDAS_DYNLD_RAF_CVI_LV_INPUT_H
 
 #include <nidas/core/CharacterSensor.h>
+#include <nidas/core/SlidingAverager.h>
 
 namespace nidas { namespace dynld { namespace raf {
 
@@ -69,6 +70,17 @@ public:
     bool process(const Sample *samp,
                  std::list<const Sample*> &results) throw();
 
+    /**
+     * The averager of the low latency CVI outputs, whose latencies
+     * are shown in the status of this sensor.
+     */
+    void setLatencySource(SlidingAverager* val)
+    {
+        _latencySource = val;
+    }
+
+    void printStatus(std::ostream& ostr);
+
 private:
 
     float CVTdiff(float f);
@@ -82,6 +94,14 @@ private:
      * Store previous CV time diff.  For repair of SOCRATES flights 3-7.
      */
     float prevCVTdiff;
+
+    SlidingAverager* _latencySource;
+
+    /** No copying. */
+    CVI_LV_Input(const CVI_LV_Input&);
+
+    /** No assignment. */
+    CVI_LV_Input& operator=(const CVI_LV_Input&);
 };
 
 }}}	// namespace nidas namespace dynld namespace raf
@@ -34,6 +34,7 @@
 
 #include <nidas/util/Logger.h>
 
+#include <algorithm>
 #include <cmath>
 
 #include <iostream>
@@ -477,8 +478,15 @@ bool DSMAnalogSensor::process(const Sample* insamp,list<const Sample*>& results)
         osamp->setId(stag->getId());
         float *fp = osamp->getDataPtr();
 
-        int ival;
-        for (ival = 0; ival < sinfo.nvars && sp < spend; ival++,fp++) {
+        int ival = 0;
+        if (getOutputMode() != Counts && sinfo.nvalues == sinfo.nvars) {
+            ival = std::min((int)(spend - sp), sinfo.nvars);
+            updateConversions(sinfo);
+            convertSample(sinfo, sp, fp, ival);
+            sp += ival;
+            fp += ival;
+        }
+        for ( ; ival < sinfo.nvars && sp < spend; ival++,fp++) {
             short sval = *sp++;
             if (getOutputMode() == Counts) {
                 *fp = sval;
@@ -507,6 +515,13 @@ bool DSMAnalogSensor::process(const Sample* insamp,list<const Sample*>& results)
     return true;
 }
 
+float DSMAnalogSensor::convertValue(int ichan, short sval)
+{
+    float fval = getInitialConverter()->convert(ichan, sval);
+    if (getGain(ichan) == 4) fval = voltageActual(fval);
+    return getFinalConverter()->convert(ichan, fval);
+}
+
 float DSMAnalogSensor::voltageActual(float voltageMeasured)
 {
   // Don't extrapolate, just return end-cal.
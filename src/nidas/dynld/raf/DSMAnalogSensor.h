@@ -155,6 +155,15 @@ protected:
 
     bool processTemperature(const Sample*, std::list<const Sample*>& result) throw();
 
+    /**
+     * Channels with a gain of 4 have a temperature compensation,
+     * voltageActual(), between the initial and final conversions,
+     * which is not linear.
+     */
+    bool isLinearChannel(int ichan) const { return getGain(ichan) != 4; }
+
+    float convertValue(int ichan, short sval);
+
     /**
      * Read a filter file containing coefficients for an Analog Devices
      * A2D chip.  Lines that start with a '#' are skipped.
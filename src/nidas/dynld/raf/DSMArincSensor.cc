@@ -34,6 +34,7 @@
 #include <nidas/util/Logger.h>
 #include <nidas/util/UTime.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <asm/ioctls.h>
@@ -72,27 +73,32 @@ using namespace nidas::dynld::raf;
 namespace n_u = nidas::util;
 
 DSMArincSensor::DSMArincSensor() :
-    _altaEnetDevice(false), _speed(AR_HIGH), _parity(AR_ODD),_converters(),
-    _ttadjusters()
+    _altaEnetDevice(false), _speed(AR_HIGH), _parity(AR_ODD),_labels(),
+    _packLabels(false),_packedGroups()
 {
     for (unsigned int label = 0; label < NLABELS; label++)
     {
-        _processed[label] = false;
         _observedLabelCnt[label] = 0;
     }
 }
 
 DSMArincSensor::~DSMArincSensor()
 {
-    for (map<dsm_sample_id_t, TimetagAdjuster*>::const_iterator tti =
-            _ttadjusters.begin();
-        tti != _ttadjusters.end(); ++tti) {
-        TimetagAdjuster* tta = tti->second;
+    for (unsigned int label = 0; label < NLABELS; label++) {
+        TimetagAdjuster* tta = _labels[label].ttadjuster;
         if (tta) {
             tta->log(nidas::util::LOGGER_INFO, this, true);
             delete tta;
         }
     }
+    for (unsigned int i = 0; i < _packedGroups.size(); i++) {
+        TimetagAdjuster* tta = _packedGroups[i].ttadjuster;
+        if (tta) {
+            tta->log(nidas::util::LOGGER_INFO, this, true);
+            delete tta;
+        }
+        if (_packedGroups[i].samp) _packedGroups[i].samp->freeReference();
+    }
 
 /* Debug output to show all labels that came from a sensor.
 
@@ -135,6 +141,8 @@ void DSMArincSensor::open(int flags)
             si != sortedSampleTags.end(); ++si)
     {
         SampleTag* stag = *si;
+        // the packed samples are not labels
+        if (stag->getSampleId() >= NLABELS) continue;
         arcfg_t arcfg;
 
         // remove the Sensor ID from the short ID to get the label
@@ -167,6 +175,63 @@ void DSMArincSensor::close()
     DSMSensor::close();
 }
 
+void DSMArincSensor::validate()
+{
+    DSMSensor::validate();
+
+    const Parameter *parm = getParameter("packLabels");
+    if (parm) {
+        if ((parm->getType() != Parameter::BOOL_PARAM &&
+            parm->getType() != Parameter::INT_PARAM) || parm->getLength() != 1)
+            throw n_u::InvalidParameterException(getName(),"packLabels",
+                "should be a boolean or integer (FALSE=0,TRUE=1) of length 1");
+        _packLabels = (bool) parm->getNumericValue(0);
+    }
+    if (!_packLabels || !_packedGroups.empty()) return;
+
+    // One packed sample per rate, highest rate first, with the
+    // variables of its labels in order of label.
+    list<SampleTag*>& tags = getSampleTags();
+    set <SampleTag*, SortByRateThenLabel> sortedSampleTags
+        ( tags.begin(), tags.end() );
+
+    for (set<SampleTag*>::const_iterator si = sortedSampleTags.begin();
+            si != sortedSampleTags.end(); ++si)
+    {
+        SampleTag* stag = *si;
+        if (!stag->isProcessed()) continue;
+
+        unsigned int label = stag->getSampleId();
+        if (label >= NLABELS)
+            throw n_u::InvalidParameterException(getName(),"sample id",
+                "should be an ARINC label, less than 0400");
+
+        if (_packedGroups.empty() ||
+                _packedGroups.back().tag->getRate() != stag->getRate()) {
+            PackedGroup grp;
+            grp.tag = new SampleTag(this);
+            grp.tag->setSampleId(NLABELS + _packedGroups.size());
+            grp.tag->setRate(stag->getRate());
+            _packedGroups.push_back(grp);
+        }
+        SampleTag* ptag = _packedGroups.back().tag;
+
+        LabelInfo& linfo = _labels[label];
+        linfo.processed = true;
+        linfo.packed = _packedGroups.size() - 1;
+        linfo.index = ptag->getVariables().size();
+
+        for (unsigned int iv = 0; iv < stag->getVariables().size(); iv++)
+            ptag->addVariable(new Variable(stag->getVariable(iv)));
+
+        // the label's own sample is no longer output
+        stag->setProcessed(false);
+    }
+
+    for (unsigned int i = 0; i < _packedGroups.size(); i++)
+        addSampleTag(_packedGroups[i].tag);
+}
+
 /*
  * Initialize anything needed for process method.
  */
@@ -191,16 +256,19 @@ void DSMArincSensor::init()
     for (si = tags.begin(); si != tags.end(); ++si) {
         SampleTag* stag = *si;
         unsigned short label = stag->getSampleId();
-        _processed[label] = stag->isProcessed();
-        if (stag->isProcessed()) {
+        if (label >= NLABELS) continue;     // a packed sample
+        LabelInfo& linfo = _labels[label];
+        // validate() has set the processed labels of packed samples
+        if (linfo.packed < 0) linfo.processed = stag->isProcessed();
+        if (linfo.processed) {
             if (getApplyVariableConversions()) {
                 for (unsigned int iv = 0; iv < stag->getVariables().size(); iv++) {
                     Variable& var = stag->getVariable(iv);
                     VariableConverter* vcon = var.getConverter();
                     if (vcon) {
-                        if (_converters.find(stag->getId()) != _converters.end())
+                        if (linfo.converter)
                             throw n_u::InvalidParameterException(getName(),"variable","more than one variable for a sample id, or init() is being called more than once");
-                        _converters[stag->getId()] = vcon;
+                        linfo.converter = vcon;
                     }
                 }
             }
@@ -213,7 +281,13 @@ void DSMArincSensor::init()
                 ttval = stag->getTimetagAdjust();
             }
             if (ttval > 0.0) {
-                _ttadjusters[stag->getId()] = new TimetagAdjuster(stag->getId(), stag->getRate());
+                if (linfo.packed >= 0) {
+                    PackedGroup& grp = _packedGroups[linfo.packed];
+                    if (!grp.ttadjuster)
+                        grp.ttadjuster = new TimetagAdjuster(grp.tag->getId(), grp.tag->getRate());
+                }
+                else if (!linfo.ttadjuster)
+                    linfo.ttadjuster = new TimetagAdjuster(stag->getId(), stag->getRate());
             }
         }
     }
@@ -255,7 +329,6 @@ bool DSMArincSensor::process(const Sample* samp, list<const Sample*>& results)
 
     // absolute time at 00:00 GMT of day.
     dsm_time_t t0day = samp->getTimeTag() - (samp->getTimeTag() % USECS_PER_DAY);
-    dsm_time_t tt;
 
     // milliseconds since 00:00 UTC
     int tmodMsec = (samp->getTimeTag() % USECS_PER_DAY) / USECS_PER_MSEC;
@@ -270,7 +343,7 @@ bool DSMArincSensor::process(const Sample* samp, list<const Sample*>& results)
         _observedLabelCnt[label]++;
         //     ILOG(("%3d/%3d %08x %04o", i, nfields, pSamp[i].data, label ));
 
-        // Even if the user doesn't want to see a value (_processed[label] == false),
+        // Even if the user doesn't want to see a value (processed == false),
         // we still want to process it.
         // For example on the Honeywell GPS, latitude and longitude have separate labels
         // for the coarse and fine values. When the label for the fine latitude
@@ -280,76 +353,15 @@ bool DSMArincSensor::process(const Sample* samp, list<const Sample*>& results)
         sampleType stype = FLOAT_ST;
         double d = processLabel(pSamp[i].data,&stype);
 
-        if (!_processed[label]) continue;
-
-        // pSamp[i].time is the number of milliseconds since midnight
-        // for the individual label. Use it to create a correct
-        // time tag for the label, which is in units of microseconds.
-
-        // On startup the initial pSamp[i].time values can be bad for the first
-        // second (e.g. PREDICT tf04). Check the difference between the sample
-        // time and pSamp[i].time
-        int td = pSamp[i].time - tmodMsec;
-
-        if (::abs(td) < MSECS_PER_SEC) {
-            tt = t0day + (dsm_time_t)pSamp[i].time * USECS_PER_MSEC;
-
-            // correct for problems around midnight rollover
-            if (::llabs(tt - samp->getTimeTag()) > USECS_PER_HALF_DAY) {
-                if (tt > samp->getTimeTag()) tt -= USECS_PER_DAY;
-                else tt += USECS_PER_DAY;
-            }
-        }
-        else {
-            tt = samp->getTimeTag();
-#ifdef DEBUG
-            WLOG(("%s: tmodMsec=%d, pSamp[%d].time=%d",
-                        n_u::UTime(samp->getTimeTag()).format(true,"%Y %m %d %H%M%S.%4f").c_str(),tmodMsec,i,pSamp[i].time));
-#endif
-        }
-
-        // sample id is sum of sensor id and label
-        dsm_sample_id_t id = getId() + label;
-
-        TimetagAdjuster* ttadj = _ttadjusters[id];
-        if (ttadj) tt = ttadj->adjust(tt);
-
-        // if there is a VariableConverter defined for this sample, apply it.
-        if (_converters.find(id) != _converters.end())
-            d = _converters[id]->convert(tt,d);
+        const LabelInfo& linfo = _labels[label];
+        if (!linfo.processed) continue;
 
-        Sample* outs = 0;
+        dsm_time_t tt = labelTimeTag(pSamp[i].time, samp->getTimeTag(),
+            t0day, tmodMsec);
 
-        switch (stype) {
-        case DOUBLE_ST:
-            {
-                SampleT<double>* outd = getSample<double>(1);
-                outd->getDataPtr()[0] = d;
-                outs = outd;
-            }
-            break;
-        case UINT32_ST:
-            {
-                SampleT<uint32_t>* outi = getSample<uint32_t>(1);
-                outi->getDataPtr()[0] = (uint32_t) d;
-                outs = outi;
-            }
-            break;
-        case FLOAT_ST:
-        default:
-            {
-                SampleT<float>* outf = getSample<float>(1);
-                outf->getDataPtr()[0] = (float) d;
-                outs = outf;
-            }
-            break;
-        }
-
-        // set the sample id to sum of sensor id and label
-        outs->setId(id);
-        outs->setTimeTag(tt);
-        results.push_back(outs);
+        outputLabel(linfo, label, tt, d, stype, true, results);
     }
+    if (!_packedGroups.empty()) outputPacked(true, results);
 
     return true;
 }
@@ -360,59 +372,25 @@ bool DSMArincSensor::processAlta(const dsm_time_t timeTag, unsigned char *input,
 
     // absolute time at 00:00 GMT of day.
     dsm_time_t t0day = timeTag - (timeTag % USECS_PER_DAY);
-    dsm_time_t tt;
 
     // milliseconds since 00:00 UTC
     int tmodMsec = (timeTag % USECS_PER_DAY) / USECS_PER_MSEC;
 
     for (int i = 0; i < nfields; i++) {
 
-        //     if (i == nfields-1)
-        //       ILOG(("sample[%3d]: %8lu %4o 0x%08lx", i, pSamp[i].time,
-        //             (int)(pSamp[i].data & 0xff), (pSamp[i].data & (unsigned int)0xffffff00) ));
-
         uint32_t data = pSamp[i].data;
         unsigned short label = ReverseBits[data & 0xff];
         data = (data & 0xffffff00) + label;
         _observedLabelCnt[label]++;
 
-        // Even if the user doesn't want to see a value (_processed[label] == false),
-        // we still want to process it.
-        // For example on the Honeywell GPS, latitude and longitude have separate labels
-        // for the coarse and fine values. When the label for the fine latitude
-        // is found, a derived total latitude is generated from the sum of the coarse and fine
-        // values. In this case we want to process the coarse latitude label, but
-        // that value is not passed as a sample.
+        // See comment in process() about unprocessed labels.
         sampleType stype = FLOAT_ST;
         double d = processLabel(data, &stype);
 
-        if (!_processed[label]) continue;
-
-        // pSamp[i].time is the number of milliseconds since midnight
-        // for the individual label. Use it to create a correct
-        // time tag for the label, which is in units of microseconds.
+        const LabelInfo& linfo = _labels[label];
+        if (!linfo.processed) continue;
 
-        // On startup the initial pSamp[i].time values can be bad for the first
-        // second (e.g. PREDICT tf04). Check the difference between the sample
-        // time and pSamp[i].time
-        int td = pSamp[i].time - tmodMsec;
-//DLOG(("  td=%d = %d - %d", td, pSamp[i].time, tmodMsec));
-        if (::abs(td) < MSECS_PER_SEC) {
-            tt = t0day + (dsm_time_t)pSamp[i].time * USECS_PER_MSEC;
-
-            // correct for problems around midnight rollover
-            if (::llabs(tt - timeTag) > USECS_PER_HALF_DAY) {
-                if (tt > timeTag) tt -= USECS_PER_DAY;
-                else tt += USECS_PER_DAY;
-            }
-        }
-        else {
-            tt = timeTag;
-#ifdef DEBUG
-            WLOG(("%s: tmodMsec=%d, pSamp[%d].time=%d",
-                        n_u::UTime(timeTag).format(true,"%Y %m %d %H%M%S.%4f").c_str(),tmodMsec,i,pSamp[i].time));
-#endif
-        }
+        dsm_time_t tt = labelTimeTag(pSamp[i].time, timeTag, t0day, tmodMsec);
 
         DLOG(("%3d/%3d %s %s dt=%llu %04o %08x %f",
             i, nfields,
@@ -420,47 +398,120 @@ bool DSMArincSensor::processAlta(const dsm_time_t timeTag, unsigned char *input,
             n_u::UTime(tt).format(true,"%H%M%S.%4f").c_str(), (timeTag-tt)/1000,
             label, data, d ));
 
-        // sample id is sum of sensor id and label
-        dsm_sample_id_t id = getId() + label;
+        outputLabel(linfo, label, tt, d, stype, false, results);
+    }
+    if (!_packedGroups.empty()) outputPacked(false, results);
 
-        // if there is a VariableConverter defined for this sample, apply it.
-        if (_converters.find(id) != _converters.end())
-            d = _converters[id]->convert(tt,d);
+    return true;
+}
 
-        Sample* outs = 0;
+dsm_time_t DSMArincSensor::labelTimeTag(int msec, dsm_time_t timeTag,
+    dsm_time_t t0day, int tmodMsec)
+{
+    // msec is the number of milliseconds since midnight
+    // for the individual label. Use it to create a correct
+    // time tag for the label, which is in units of microseconds.
 
-        switch (stype) {
-        case DOUBLE_ST:
-            {
-                SampleT<double>* outd = getSample<double>(1);
-                outd->getDataPtr()[0] = d;
-                outs = outd;
-            }
-            break;
-        case UINT32_ST:
-            {
-                SampleT<uint32_t>* outi = getSample<uint32_t>(1);
-                outi->getDataPtr()[0] = (uint32_t) d;
-                outs = outi;
-            }
-            break;
-        case FLOAT_ST:
-        default:
-            {
-                SampleT<float>* outf = getSample<float>(1);
-                outf->getDataPtr()[0] = (float) d;
-                outs = outf;
-            }
-            break;
+    // On startup the initial msec values can be bad for the first
+    // second (e.g. PREDICT tf04). Check the difference between the sample
+    // time and msec.
+    int td = msec - tmodMsec;
+
+    if (::abs(td) >= MSECS_PER_SEC) {
+#ifdef DEBUG
+        WLOG(("%s: tmodMsec=%d, msec=%d",
+                    n_u::UTime(timeTag).format(true,"%Y %m %d %H%M%S.%4f").c_str(),tmodMsec,msec));
+#endif
+        return timeTag;
+    }
+
+    dsm_time_t tt = t0day + (dsm_time_t)msec * USECS_PER_MSEC;
+
+    // correct for problems around midnight rollover
+    if (::llabs(tt - timeTag) > USECS_PER_HALF_DAY) {
+        if (tt > timeTag) tt -= USECS_PER_DAY;
+        else tt += USECS_PER_DAY;
+    }
+    return tt;
+}
+
+void DSMArincSensor::outputLabel(const LabelInfo& linfo, unsigned short label,
+    dsm_time_t tt, double d, sampleType stype, bool adjust,
+    list<const Sample*>& results)
+{
+    if (linfo.packed >= 0) {
+        PackedGroup& grp = _packedGroups[linfo.packed];
+        // a label repeated in a raw sample starts the next packed sample
+        if (grp.samp && grp.filled[linfo.index])
+            outputPacked(grp, adjust, results);
+        if (!grp.samp) {
+            unsigned int nvals = grp.tag->getVariables().size();
+            grp.samp = getSample<double>(nvals);
+            std::fill(grp.samp->getDataPtr(), grp.samp->getDataPtr() + nvals,
+                doubleNAN);
+            grp.filled.assign(nvals, false);
+            // time of the first label of the rate in this raw sample
+            grp.samp->setTimeTag(tt);
+            grp.samp->setId(grp.tag->getId());
         }
+        if (linfo.converter) d = linfo.converter->convert(tt,d);
+        grp.samp->getDataPtr()[linfo.index] = d;
+        grp.filled[linfo.index] = true;
+        return;
+    }
+
+    if (adjust && linfo.ttadjuster) tt = linfo.ttadjuster->adjust(tt);
 
-        // set the sample id to sum of sensor id and label
-        outs->setId(id);
-        outs->setTimeTag(tt);
-        results.push_back(outs);
+    // if there is a VariableConverter defined for this sample, apply it.
+    if (linfo.converter) d = linfo.converter->convert(tt,d);
+
+    Sample* outs = 0;
+
+    switch (stype) {
+    case DOUBLE_ST:
+        {
+            SampleT<double>* outd = getSample<double>(1);
+            outd->getDataPtr()[0] = d;
+            outs = outd;
+        }
+        break;
+    case UINT32_ST:
+        {
+            SampleT<uint32_t>* outi = getSample<uint32_t>(1);
+            outi->getDataPtr()[0] = (uint32_t) d;
+            outs = outi;
+        }
+        break;
+    case FLOAT_ST:
+    default:
+        {
+            SampleT<float>* outf = getSample<float>(1);
+            outf->getDataPtr()[0] = (float) d;
+            outs = outf;
+        }
+        break;
     }
 
-    return true;
+    // set the sample id to sum of sensor id and label
+    outs->setId(getId() + label);
+    outs->setTimeTag(tt);
+    results.push_back(outs);
+}
+
+void DSMArincSensor::outputPacked(bool adjust, list<const Sample*>& results)
+{
+    for (unsigned int i = 0; i < _packedGroups.size(); i++)
+        outputPacked(_packedGroups[i], adjust, results);
+}
+
+void DSMArincSensor::outputPacked(PackedGroup& grp, bool adjust,
+    list<const Sample*>& results)
+{
+    if (!grp.samp) return;
+    if (adjust && grp.ttadjuster)
+        grp.samp->setTimeTag(grp.ttadjuster->adjust(grp.samp->getTimeTag()));
+    results.push_back(grp.samp);
+    grp.samp = 0;
 }
 
 void DSMArincSensor::printStatus(std::ostream& ostr)
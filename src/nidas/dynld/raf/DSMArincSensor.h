@@ -125,6 +125,14 @@ public:
      */
     void close();
 
+    /**
+     * If the "packLabels" parameter is true, create the SampleTags
+     * of the packed samples.
+     *
+     * @throws nidas::util::InvalidParameterException
+     */
+    void validate();
+
     /**
      * Perform any initialization necessary for process method.
      *
@@ -174,22 +182,95 @@ protected:
      */
     void registerWithUDPArincSensor();
 
-    /// A list of which samples are processed.
-    int _processed[NLABELS];
     int _observedLabelCnt[NLABELS];
 
     bool _altaEnetDevice;
 
 private:
 
+    /**
+     * How the value of a label is output, indexed by label, so that
+     * process() does not search for it.
+     */
+    struct LabelInfo
+    {
+        LabelInfo(): processed(false), converter(0), ttadjuster(0),
+            packed(-1), index(0) {}
+        /// Whether the label is output, or only decoded.
+        bool processed;
+        VariableConverter* converter;
+        TimetagAdjuster* ttadjuster;
+        /// Index of the packed sample of the label, or -1.
+        int packed;
+        /// Index of the label's value in the packed sample.
+        unsigned int index;
+    };
+
+    /**
+     * A multi-value sample of the labels of a rate.
+     */
+    struct PackedGroup
+    {
+        PackedGroup(): tag(0), samp(0), filled(), ttadjuster(0) {}
+        SampleTag* tag;
+        /// The sample being filled by the current raw sample.
+        SampleT<double>* samp;
+        /// Which values of samp have been set.
+        std::vector<bool> filled;
+        TimetagAdjuster* ttadjuster;
+    };
+
+    /**
+     * Compute the time tag of a label from its milliseconds since
+     * midnight, and the time tag of the raw sample.
+     */
+    dsm_time_t labelTimeTag(int msec, dsm_time_t timeTag, dsm_time_t t0day,
+        int tmodMsec);
+
+    /**
+     * Convert the value of a processed label and output it, as a
+     * single value sample, or into its packed sample.  If the label
+     * is already in its packed sample, that sample is output first,
+     * and the label starts a new one.
+     */
+    void outputLabel(const LabelInfo& linfo, unsigned short label,
+        dsm_time_t tt, double d, sampleType stype, bool adjust,
+        std::list<const Sample*>& results);
+
+    /**
+     * Output the packed samples filled by a raw sample.
+     */
+    void outputPacked(bool adjust, std::list<const Sample*>& results);
+
+    /**
+     * Output the packed sample of a group, if any.
+     */
+    void outputPacked(PackedGroup& grp, bool adjust,
+        std::list<const Sample*>& results);
+
     /** channel configuration */
     unsigned int _speed;
     unsigned int _parity;
 
-    std::map<dsm_sample_id_t,VariableConverter*> _converters;
+    LabelInfo _labels[NLABELS];
+
+    /**
+     * If the "packLabels" parameter is true, the labels of a raw
+     * sample are output in a sample of doubles for each rate,
+     * instead of a sample for each label.  The packed samples have
+     * sample ids following the labels: NLABELS, NLABELS+1, ...
+     * from the highest rate, and the SampleTags of the labels are
+     * set to not processed.
+     */
+    bool _packLabels;
+
+    std::vector<PackedGroup> _packedGroups;
 
-    std::map<dsm_sample_id_t, TimetagAdjuster*> _ttadjusters;
+    /** No copying. */
+    DSMArincSensor(const DSMArincSensor&);
 
+    /** No assignment. */
+    DSMArincSensor& operator=(const DSMArincSensor&);
 };
 
 // typedef SampleT<unsigned int> ArincSample;
@@ -102,12 +102,13 @@ int Extract2D::usage(const char* argv0)
 	    either -s or -x options can be specified, but not both\n\
 */
     cerr << "\
-Usage: " << argv0 << " [-x dsmid,sensorid] [-a] [-s] [-c] [-n #] output input ... \n\n\
+Usage: " << argv0 << " [-x dsmid,sensorid] [-a] [-s] [-c] [-n #] [-t] output input ... \n\n\
     -a: copy all records, ignore all thresholds.\n\
     -s: generate diode count histogram along flight path.\n\
     -c: generate particle count histogram.\n\
     -n #: Minimum number of time slices required per record to\n\
             transfer to output file.\n\
+    -t: read, format and write the records in one thread.\n\
     output: output file name or file name format\n\
     input ...: one or more input file name or file name formats\n\
 " << endl;
@@ -117,7 +118,7 @@ Usage: " << argv0 << " [-x dsmid,sensorid] [-a] [-s] [-c] [-n #] output input ..
 
 Extract2D::Extract2D():
     outputHeader(true), outputDiodeCount(false), outputParticleCount(false),
-    copyAllRecords(false), xmlFileName(), inputFileNames(), outputFileName(),
+    copyAllRecords(false), singleThread(false), xmlFileName(), inputFileNames(), outputFileName(),
     outputFileLength(0), header(), includeIds(), excludeIds(), newids(),
     minNumberParticlesRequired(DefaultMinimumNumberParticlesRequired)
 {
@@ -127,7 +128,7 @@ int Extract2D::parseRunstring(int argc, char** argv) throw()
 {
     int opt_char;     /* option character */
 
-    while ((opt_char = getopt(argc, argv, "acsn:")) != -1) {
+    while ((opt_char = getopt(argc, argv, "acsn:t")) != -1) {
 	switch (opt_char) {
 	case 'a':
 	    copyAllRecords = true;
@@ -141,6 +142,9 @@ int Extract2D::parseRunstring(int argc, char** argv) throw()
 	case 's':
 	    outputDiodeCount = true;
             break;
+	case 't':
+	    singleThread = true;
+            break;
 /*
         case 'x':
             {
@@ -174,6 +174,9 @@ protected:
     /// Copy 100% of 2D records from source file to output file, no filtering.
     bool copyAllRecords;
 
+    /// Read, format and write the records in the same thread.
+    bool singleThread;
+
     string xmlFileName;
 
     list<string> inputFileNames;
@@ -29,6 +29,7 @@
 #include "IRIGSensor.h"
 #include <nidas/core/DSMEngine.h>
 #include <nidas/core/UnixIODevice.h>
+#include <nidas/core/Parameter.h>
 
 #include <nidas/util/Logger.h>
 #include <nidas/util/UTime.h>
@@ -53,7 +54,7 @@ const n_u::EndianConverter* IRIGSensor::lecvtr = n_u::EndianConverter::getConver
         n_u::EndianConverter::EC_LITTLE_ENDIAN);
 
 IRIGSensor::IRIGSensor():
-    _sampleId(0),_nvars(0),_nStatusPrints(0),_slews()
+    _sampleId(0),_nvars(0),_nStatusPrints(0),_slews(),_clockModel(0)
 {
 }
 
@@ -89,6 +90,26 @@ void IRIGSensor::open(int flags)
     checkClock();
 }
 
+void IRIGSensor::init()
+{
+    DSMSensor::init();
+
+    if (!getSampleTags().empty()) {
+        const SampleTag* stag = getSampleTags().front();
+        _sampleId = stag->getId();
+        _nvars = stag->getVariables().size();
+    }
+
+    const Parameter* p = getParameter("CLOCK_MODEL");
+    if (p) {
+        if (p->getType() != Parameter::BOOL_PARAM || p->getLength() != 1)
+            throw n_u::InvalidParameterException(getName(),
+                "CLOCK_MODEL", "should be a boolean of length 1");
+        if (p->getNumericValue(0))
+            _clockModel = ClockModel::getInstance(getDSMId());
+    }
+}
+
 /**
  * Get the current time from the IRIG card via ioctl.
  * This is not meant to be used for frequent use.
@@ -391,8 +412,18 @@ bool IRIGSensor::process(const Sample* samp,std::list<const Sample*>& result)
 
     int iv = 0;
     // clock difference, IRIG-UNIX
-    if (samp->getDataByteLength() >= offsetof(dsm_clock_data_2, end))
-        osamp->getDataPtr()[iv++] = (float)(getIRIGTime(samp) - getUnixTime(samp)) / USECS_PER_SEC;
+    if (samp->getDataByteLength() >= offsetof(dsm_clock_data_2, end)) {
+        dsm_time_t irigTime = getIRIGTime(samp);
+        dsm_time_t unixTime = getUnixTime(samp);
+        osamp->getDataPtr()[iv++] = (float)(irigTime - unixTime) / USECS_PER_SEC;
+
+        // Only observations from a synced clock go into the model.
+        if (_clockModel && !(*getStatusPtr(samp) &
+                (CLOCK_STATUS_NOSYNC | CLOCK_STATUS_NOCODE |
+                 CLOCK_STATUS_NOYEAR | CLOCK_STATUS_NOMAJT |
+                 CLOCK_SYNC_NOT_OK)))
+            _clockModel->addObservation(unixTime, irigTime);
+    }
     else
         osamp->getDataPtr()[iv++] = floatNAN;
 
@@ -420,8 +451,5 @@ void IRIGSensor::fromDOMElement(const xercesc::DOMElement* node)
 
     // hack for XML configs that don't set the rate of the IRIG data.
     if (stag->getRate() == 0.0) stag->setRate(1.0);
-
-    _sampleId = stag->getId();
-    _nvars = stag->getVariables().size();
 }
 
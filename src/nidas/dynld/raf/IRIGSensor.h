@@ -28,6 +28,7 @@
 
 #include <nidas/linux/irigclock.h>
 #include <nidas/core/DSMSensor.h>
+#include <nidas/core/ClockModel.h>
 #include <nidas/util/InvalidParameterException.h>
 #include <nidas/util/EndianConverter.h>
 
@@ -76,6 +77,16 @@ public:
      **/
     void close();
 
+    /**
+     * If the boolean CLOCK_MODEL parameter is true, the IRIG and
+     * UNIX times of the samples are added to the shared ClockModel
+     * of this DSM, which is used to correct the time tags of the
+     * other sensors.
+     *
+     * @throws nidas::util::InvalidParameterException
+     **/
+    void init();
+
     /**
      * Get the current time from the IRIG card.
      * This is not meant to be used for frequent use.
@@ -143,6 +154,17 @@ private:
 
     int _slews[IRIG_MAX_DT_DIFF - IRIG_MIN_DT_DIFF + 1];
 
+    /**
+     * ClockModel fed by the samples, or 0.
+     */
+    ClockModel* _clockModel;
+
+    /** No copying. */
+    IRIGSensor(const IRIGSensor&);
+
+    /** No assignment. */
+    IRIGSensor& operator=(const IRIGSensor&);
+
 };
 
 }}}	// namespace nidas namespace dynld namespace raf
@@ -31,8 +31,10 @@
 #include <nidas/core/Variable.h>
 #include <nidas/core/DSMEngine.h>
 
+#include <nidas/util/EndianConverter.h>
 #include <nidas/util/Logger.h>
 
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 
@@ -302,19 +304,10 @@ bool PSI9116_Sensor::process(const Sample* samp,list<const Sample*>& results)
             vals2Take = nvalsin + _nPrevSampVals;
             _nPrevSampVals = vals2Take;
         }
-        for ( ; ipout < vals2Take; ipout++) {
-#if __BYTE_ORDER == __BIG_ENDIAN
-	    union flip d;
-	    d.bytes[3] = *input++;
-	    d.bytes[2] = *input++;
-	    d.bytes[1] = *input++;
-	    d.bytes[0] = *input++;
-	    dout[ipout] = d.fval;
-#else
-            ::memcpy(dout+ipout,input,4);
-            input += 4;
-#endif
-            valsTaken++;
+        if (ipout < vals2Take) {
+            valsTaken = vals2Take - ipout;
+            n_u::LittleEndianIn::floatToFloat(input, dout + ipout, valsTaken);
+            input += valsTaken * sizeof(float);
         }
         // Do we have at least one full sample?
         if (vals2Take == _nchannels) {
@@ -414,21 +407,10 @@ bool PSI9116_Sensor::process(const Sample* samp,list<const Sample*>& results)
     dout = outs->getDataPtr();
 
     // data values in format 8 are little endian floats
-    int iout;
-    for (iout = 0; iout < nvalsin; iout++) {
-#if __BYTE_ORDER == __BIG_ENDIAN
-	union flip d;
-	d.bytes[3] = *input++;
-	d.bytes[2] = *input++;
-	d.bytes[1] = *input++;
-	d.bytes[0] = *input++;
-	dout[iout] = d.fval;
-#else
-        ::memcpy(dout+iout,input,4);
-	input += 4;
-#endif
-        _nPrevSampVals++;
-    }
+    int iout = std::max(nvalsin, 0);
+    n_u::LittleEndianIn::floatToFloat(input, dout, iout);
+    input += iout * sizeof(float);
+    _nPrevSampVals += iout;
     if (iout < _nchannels) {
         // Partial sample - check to see if it broke mid-value
         if ((slen-1) % sizeof(float)) {
@@ -0,0 +1,350 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "ParallelSyncServer.h"
+#include "SyncServer.h"
+#include "SyncRecordSource.h"
+
+#include <nidas/core/FileSet.h>
+#include <nidas/core/Project.h>
+#include <nidas/core/XMLParser.h>
+#include <nidas/dynld/RawSampleInputStream.h>
+#include <nidas/dynld/SampleInputStream.h>
+#include <nidas/dynld/SampleOutputStream.h>
+#include <nidas/util/EOFException.h>
+#include <nidas/util/Logger.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+using namespace nidas::core;
+using namespace nidas::dynld;
+using namespace nidas::dynld::raf;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+namespace {
+
+/**
+ * Seconds of data past the verification period of a chunk, so that
+ * the records in the verification period are complete.
+ */
+const int CHUNK_MARGIN_SECS = 10;
+
+bool
+sameData(const Sample* s1, const Sample* s2)
+{
+    return s1->getDataByteLength() == s2->getDataByteLength() &&
+        ::memcmp(s1->getConstVoidDataPtr(), s2->getConstVoidDataPtr(),
+                 s1->getDataByteLength()) == 0;
+}
+
+string
+formatTime(dsm_time_t tt)
+{
+    return n_u::UTime(tt).format(true, "%Y %m %d %H:%M:%S");
+}
+
+}
+
+ParallelSyncServer::ParallelSyncServer():
+    _dataFileNames(), _xmlFileName(), _outputFileName(),
+    _sorterLengthSecs(SyncServer::SORTER_LENGTH_SECS),
+    _rawSorterLengthSecs(SyncServer::RAW_SORTER_LENGTH_SECS),
+    _startWindow(LONG_LONG_MIN), _endWindow(LONG_LONG_MAX),
+    _nchunks(::sysconf(_SC_NPROCESSORS_ONLN)),
+    _warmupSecs(DEFAULT_WARMUP_SECS), _verifySecs(DEFAULT_VERIFY_SECS),
+    _chunkStart(), _header()
+{
+}
+
+ParallelSyncServer::~ParallelSyncServer()
+{
+}
+
+void
+ParallelSyncServer::setTimeWindow(n_u::UTime start, n_u::UTime end)
+{
+    _startWindow = start.toUsecs();
+    _endWindow = end.toUsecs();
+}
+
+void
+ParallelSyncServer::scanTimeWindow()
+{
+    ILOG(("scanning ") << _dataFileNames.size() <<
+         " files for the time window");
+    nidas::core::FileSet* fset =
+        nidas::core::FileSet::getFileSet(_dataFileNames);
+    RawSampleInputStream sis(fset->connect());
+    SyncServer::setInputFilters(sis);
+    sis.readInputHeader();
+
+    dsm_time_t first = LONG_LONG_MAX;
+    dsm_time_t last = LONG_LONG_MIN;
+    try {
+        for (;;) {
+            Sample* samp = sis.readSample();
+            dsm_time_t tt = samp->getTimeTag();
+            if (tt < first) first = tt;
+            if (tt > last) last = tt;
+            samp->freeReference();
+        }
+    }
+    catch (const n_u::EOFException&) {
+    }
+    sis.close();
+    if (first > last)
+        throw n_u::IOException(_dataFileNames.front(), "scan",
+                               "no samples");
+
+    if (_startWindow == LONG_LONG_MIN) _startWindow = first;
+    if (_endWindow == LONG_LONG_MAX) _endWindow = last;
+}
+
+string
+ParallelSyncServer::chunkFileName(int ichunk) const
+{
+    ostringstream ost;
+    ost << _outputFileName << ".chunk" << ichunk;
+    return ost.str();
+}
+
+void
+ParallelSyncServer::sendHeader(dsm_time_t, SampleOutput* output)
+{
+    _header.write(output);
+}
+
+int
+ParallelSyncServer::run()
+{
+    if (_startWindow == LONG_LONG_MIN || _endWindow == LONG_LONG_MAX)
+        scanTimeWindow();
+
+    // Chunks of whole seconds, so that each sync record,
+    // whose time is a whole second, is in one chunk.
+    dsm_time_t span = (_endWindow - _startWindow) / std::max(_nchunks, 1);
+    span = std::max((span + USECS_PER_SEC - 1) / USECS_PER_SEC,
+                    (dsm_time_t)1) * USECS_PER_SEC;
+    dsm_time_t tsec = _startWindow - _startWindow % USECS_PER_SEC;
+
+    // The first chunk also starts on a second, so that merge()
+    // keeps the record of the second containing _startWindow.
+    _chunkStart.clear();
+    _chunkStart.push_back(tsec);
+    for (int i = 1; i < _nchunks && tsec + i * span < _endWindow; i++)
+        _chunkStart.push_back(tsec + i * span);
+    _chunkStart.push_back(LONG_LONG_MAX);
+    _nchunks = _chunkStart.size() - 1;
+
+    ILOG(("processing ") << formatTime(_startWindow) << " to " <<
+         formatTime(_endWindow) << " in " << _nchunks << " chunks of " <<
+         span / USECS_PER_SEC << " seconds");
+
+    vector<pid_t> pids;
+    int nfail = 0;
+    for (int i = 0; i < _nchunks; i++) {
+        pid_t pid = ::fork();
+        if (pid == 0) ::_exit(runChunk(i));
+        if (pid < 0) {
+            PLOG(("fork: ") << n_u::Exception::errnoToString(errno));
+            nfail++;
+            break;
+        }
+        pids.push_back(pid);
+    }
+
+    for (unsigned int i = 0; i < pids.size(); i++) {
+        int status;
+        pid_t res;
+        while ((res = ::waitpid(pids[i], &status, 0)) < 0 && errno == EINTR);
+        if (res < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            PLOG(("chunk ") << i << " failed");
+            nfail++;
+        }
+    }
+    if (nfail) return 1;
+
+    return merge();
+}
+
+int
+ParallelSyncServer::runChunk(int ichunk)
+{
+    // Let an interrupt of the parent terminate the chunks.
+    ::signal(SIGINT, SIG_DFL);
+    ::signal(SIGTERM, SIG_DFL);
+    ::signal(SIGHUP, SIG_DFL);
+
+    dsm_time_t start = _startWindow;
+    if (ichunk > 0)
+        start = _chunkStart[ichunk] - (dsm_time_t)_warmupSecs * USECS_PER_SEC;
+    dsm_time_t end = _endWindow;
+    if (ichunk < _nchunks - 1)
+        end = _chunkStart[ichunk + 1] +
+            (dsm_time_t)(_verifySecs + CHUNK_MARGIN_SECS) * USECS_PER_SEC;
+
+    int res;
+    try {
+        SyncServer sync;
+        sync.setDataFileNames(_dataFileNames);
+        if (_xmlFileName.length() > 0) sync.setXMLFileName(_xmlFileName);
+        sync.setSorterLengthSeconds(_sorterLengthSecs);
+        sync.setRawSorterLengthSeconds(_rawSorterLengthSecs);
+        sync.setTimeWindow(n_u::UTime(start), n_u::UTime(end));
+        sync.setOutputFileName(chunkFileName(ichunk));
+        sync.init();
+        res = sync.run();
+    }
+    catch (const n_u::Exception& e) {
+        PLOG(("chunk ") << ichunk << ": " << e.what());
+        res = 1;
+    }
+    Project::destroyInstance();
+    XMLImplementation::terminate();
+    return res;
+}
+
+int
+ParallelSyncServer::merge()
+{
+    nidas::core::FileSet* outSet = new nidas::core::FileSet();
+    outSet->setFileName(_outputFileName);
+    SampleOutputStream output(outSet);
+    output.setHeaderSource(this);
+
+    string syncHeader;
+    bool haveHeader = false;
+
+    // Records of the previous chunk in its verification period,
+    // by time, which the records of this chunk must match.
+    map<dsm_time_t, const Sample*> verify;
+    int nrecs = 0;
+    int nmismatch = 0;
+
+    for (int i = 0; i < _nchunks; i++) {
+        list<string> names(1, chunkFileName(i));
+        nidas::core::FileSet* fset = nidas::core::FileSet::getFileSet(names);
+        SampleInputStream input(fset->connect());
+        input.readInputHeader();
+        if (i == 0) _header = input.getInputHeader();
+
+        dsm_time_t t0 = _chunkStart[i];
+        dsm_time_t t1 = _chunkStart[i + 1];
+        dsm_time_t tverify = t0 + (dsm_time_t)_verifySecs * USECS_PER_SEC;
+        dsm_time_t tnext = LONG_LONG_MAX;
+        if (i < _nchunks - 1)
+            tnext = t1 + (dsm_time_t)_verifySecs * USECS_PER_SEC;
+        map<dsm_time_t, const Sample*> next;
+
+        try {
+            for (;;) {
+                Sample* samp = input.readSample();
+                dsm_time_t tt = samp->getTimeTag();
+
+                if (samp->getId() == SYNC_RECORD_HEADER_ID) {
+                    string head((const char*)samp->getConstVoidDataPtr(),
+                                samp->getDataByteLength());
+                    if (!haveHeader) {
+                        output.receive(samp);
+                        syncHeader = head;
+                        haveHeader = true;
+                    }
+                    else if (head != syncHeader) {
+                        WLOG(("chunk ") << i <<
+                             ": sync header differs from chunk 0");
+                        nmismatch++;
+                    }
+                }
+                else if (samp->getId() == SYNC_RECORD_ID && tt >= t0) {
+                    if (tt < t1) {
+                        output.receive(samp);
+                        nrecs++;
+                    }
+                    if (i > 0 && tt < tverify) {
+                        map<dsm_time_t, const Sample*>::iterator vi =
+                            verify.find(tt);
+                        if (vi == verify.end()) {
+                            WLOG(("chunk ") << i << ": record at " <<
+                                 formatTime(tt) << " not in chunk " << i - 1);
+                            nmismatch++;
+                        }
+                        else {
+                            if (!sameData(samp, vi->second)) {
+                                WLOG(("chunk ") << i << ": record at " <<
+                                     formatTime(tt) <<
+                                     " differs from chunk " << i - 1);
+                                nmismatch++;
+                            }
+                            vi->second->freeReference();
+                            verify.erase(vi);
+                        }
+                    }
+                    if (tt >= t1 && tt < tnext) {
+                        samp->holdReference();
+                        if (!next.insert(make_pair(tt, samp)).second)
+                            samp->freeReference();
+                    }
+                }
+                samp->freeReference();
+            }
+        }
+        catch (const n_u::EOFException&) {
+        }
+        input.close();
+
+        map<dsm_time_t, const Sample*>::iterator vi = verify.begin();
+        for ( ; vi != verify.end(); ++vi) {
+            WLOG(("chunk ") << i - 1 << ": record at " <<
+                 formatTime(vi->first) << " not in chunk " << i);
+            nmismatch++;
+            vi->second->freeReference();
+        }
+        verify.swap(next);
+    }
+    output.flush();
+    output.close();
+
+    ILOG(("wrote ") << nrecs << " sync records to " << _outputFileName);
+    if (nmismatch) {
+        PLOG(("") << nmismatch << " sync records differ at chunk "
+             "boundaries, chunk files are kept for inspection");
+        return 1;
+    }
+    for (int i = 0; i < _nchunks; i++)
+        ::unlink(chunkFileName(i).c_str());
+    return 0;
+}
@@ -0,0 +1,214 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_DYNLD_RAF_PARALLELSYNCSERVER_H
+#define NIDAS_DYNLD_RAF_PARALLELSYNCSERVER_H
+
+#include <nidas/core/HeaderSource.h>
+#include <nidas/core/SampleInputHeader.h>
+#include <nidas/util/UTime.h>
+
+#include <list>
+#include <string>
+#include <vector>
+
+namespace nidas { namespace dynld { namespace raf {
+
+/**
+ * Reprocess the raw archive of a flight into a file of sync records
+ * by splitting the time window of the flight into chunks which are
+ * processed in parallel.
+ *
+ * Each chunk is processed by a SyncServer in its own process, since
+ * the Project and its sensors hold the processing state of a pipeline.
+ * A chunk starts a warmup period before its first record, so that the
+ * sorters, the sensor processing and the sync record lags have settled
+ * by then, and continues for a verification period past its last record.
+ * The records of the chunks are then concatenated in time order, and
+ * the records of a chunk in the verification period are compared
+ * with those of the next chunk, which must be identical to what one
+ * serial SyncServer would have written across the boundary.
+ */
+class ParallelSyncServer: public nidas::core::HeaderSource
+{
+public:
+
+    ParallelSyncServer();
+
+    ~ParallelSyncServer();
+
+    void
+    setDataFileNames(const std::list<std::string>& val)
+    {
+        _dataFileNames = val;
+    }
+
+    void
+    setXMLFileName(const std::string& val)
+    {
+        _xmlFileName = val;
+    }
+
+    void
+    setSorterLengthSeconds(float val)
+    {
+        _sorterLengthSecs = val;
+    }
+
+    void
+    setRawSorterLengthSeconds(float val)
+    {
+        _rawSorterLengthSecs = val;
+    }
+
+    /**
+     * Time window of the flight to process.  If either end is not
+     * set, the data files are scanned for the times of the first
+     * and last samples.
+     */
+    void
+    setTimeWindow(nidas::util::UTime start, nidas::util::UTime end);
+
+    /**
+     * Number of chunks, which are processed at the same time.
+     */
+    void
+    setNumChunks(int val)
+    {
+        _nchunks = val;
+    }
+
+    /**
+     * Seconds of data processed before the first record of a chunk.
+     */
+    void
+    setWarmupSeconds(int val)
+    {
+        _warmupSecs = val;
+    }
+
+    /**
+     * Seconds of records which are compared with the next chunk.
+     */
+    void
+    setVerifySeconds(int val)
+    {
+        _verifySecs = val;
+    }
+
+    /**
+     * Name of the sync record file to write.  The chunks
+     * are written to temporary files of this name with
+     * a ".chunkN" suffix.
+     */
+    void
+    setOutputFileName(const std::string& val)
+    {
+        _outputFileName = val;
+    }
+
+    /**
+     * Process the chunks and merge their records.
+     * @return 0 on success, 1 if a chunk failed or the
+     *  records of the chunks did not agree at a boundary.
+     */
+    int
+    run();
+
+    /**
+     * Implementation of HeaderSource::sendHeader(), which writes the
+     * SampleInputHeader of the first chunk to the merged output.
+     *
+     * @throws nidas::util::IOException
+     */
+    void sendHeader(nidas::core::dsm_time_t,
+                    nidas::core::SampleOutput* output);
+
+    static const int DEFAULT_WARMUP_SECS = 60;
+
+    static const int DEFAULT_VERIFY_SECS = 10;
+
+private:
+
+    /**
+     * @throws nidas::util::IOException
+     */
+    void
+    scanTimeWindow();
+
+    std::string
+    chunkFileName(int ichunk) const;
+
+    /**
+     * Run the SyncServer of a chunk, in a child process.
+     */
+    int
+    runChunk(int ichunk);
+
+    /**
+     * @throws nidas::util::IOException
+     */
+    int
+    merge();
+
+    std::list<std::string> _dataFileNames;
+
+    std::string _xmlFileName;
+
+    std::string _outputFileName;
+
+    float _sorterLengthSecs;
+
+    float _rawSorterLengthSecs;
+
+    nidas::core::dsm_time_t _startWindow;
+
+    nidas::core::dsm_time_t _endWindow;
+
+    int _nchunks;
+
+    int _warmupSecs;
+
+    int _verifySecs;
+
+    /**
+     * Start times of the records written from each chunk,
+     * with the end of the last chunk appended.
+     */
+    std::vector<nidas::core::dsm_time_t> _chunkStart;
+
+    nidas::core::SampleInputHeader _header;
+
+    /** No copying. */
+    ParallelSyncServer(const ParallelSyncServer&);
+
+    /** No assignment. */
+    ParallelSyncServer& operator=(const ParallelSyncServer&);
+};
+
+}}}	// namespace nidas namespace dynld namespace raf
+
+#endif
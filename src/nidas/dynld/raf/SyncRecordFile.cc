@@ -0,0 +1,323 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#include "SyncRecordFile.h"
+#include "SyncRecordReader.h"
+
+#include <nidas/util/EOFException.h>
+#include <nidas/util/InvalidParameterException.h>
+#include <nidas/util/Logger.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace nidas::core;
+using namespace nidas::dynld::raf;
+using namespace std;
+
+namespace n_u = nidas::util;
+
+const char SyncRecordFile::MAGIC[16] = "NIDAS SYNCREC\n";
+
+namespace {
+
+/**
+ * Records start on a page, so that a range of
+ * them can be advised or locked separately.
+ */
+const size_t DATA_ALIGN = 4096;
+
+}
+
+SyncRecordFile::SyncRecordFile(const string& path):
+    _path(path), _base(0), _length(0), _header(0), _text(),
+    _variables(), _vars(0), _times(0), _data(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw n_u::IOException(path, "open", errno);
+
+    struct stat statbuf;
+    if (::fstat(fd, &statbuf) < 0) {
+        int ierr = errno;
+        ::close(fd);
+        throw n_u::IOException(path, "fstat", ierr);
+    }
+    _length = statbuf.st_size;
+    if (_length < sizeof(SyncRecordFileHeader)) {
+        ::close(fd);
+        throw n_u::IOException(path, "open", "not a sync record file");
+    }
+
+    _base = ::mmap(0, _length, PROT_READ, MAP_SHARED, fd, 0);
+    int ierr = errno;
+    ::close(fd);
+    if (_base == MAP_FAILED) {
+        _base = 0;
+        throw n_u::IOException(path, "mmap", ierr);
+    }
+
+    const char* cp = (const char*) _base;
+    _header = (const SyncRecordFileHeader*) cp;
+    const SyncRecordFileHeader& hdr = *_header;
+
+    const char* msg = 0;
+    if (::memcmp(hdr.magic, MAGIC, sizeof(MAGIC)))
+        msg = "not a sync record file";
+    else if (hdr.version != VERSION)
+        msg = "unknown version of sync record file";
+    else if (hdr.byteOrder != ENDIAN_MARK)
+        msg = "sync record file has a different byte order than this host";
+    else if (hdr.textOffset + hdr.textLength > _length ||
+             hdr.namesOffset + hdr.namesLength > _length ||
+             hdr.varsOffset + hdr.numVariables *
+                sizeof(SyncRecordFileVariable) > _length ||
+             hdr.dataOffset + hdr.numRecords * hdr.numValues *
+                sizeof(double) > _length ||
+             hdr.timesOffset + hdr.numRecords * sizeof(dsm_time_t) > _length)
+        msg = "sync record file is truncated";
+    if (msg) {
+        ::munmap(_base, _length);
+        _base = 0;
+        throw n_u::IOException(path, "open", msg);
+    }
+
+    _text = string(cp + hdr.textOffset, hdr.textLength);
+    _vars = (const SyncRecordFileVariable*)(cp + hdr.varsOffset);
+    _times = (const dsm_time_t*)(cp + hdr.timesOffset);
+    _data = (const double*)(cp + hdr.dataOffset);
+
+    for (unsigned int i = 0; i < hdr.numVariables; i++) {
+        const SyncRecordFileVariable& var = _vars[i];
+        if (var.nameOffset + var.nameLength > hdr.namesLength ||
+            var.syncRecOffset + var.valuesPerRecord > hdr.numValues ||
+            var.lagOffset >= hdr.numValues) {
+            ::munmap(_base, _length);
+            _base = 0;
+            throw n_u::IOException(path, "open",
+                                   "bad variable in sync record file");
+        }
+        string name(cp + hdr.namesOffset + var.nameOffset, var.nameLength);
+        _variables[name] = &var;
+    }
+}
+
+SyncRecordFile::~SyncRecordFile()
+{
+    if (_base) ::munmap(_base, _length);
+}
+
+size_t
+SyncRecordFile::findRecord(dsm_time_t tt) const
+{
+    const dsm_time_t* end = _times + _header->numRecords;
+    return std::lower_bound(_times, end, tt) - _times;
+}
+
+vector<string>
+SyncRecordFile::getVariableNames() const
+{
+    const char* names = (const char*) _base + _header->namesOffset;
+    vector<string> result;
+    for (unsigned int i = 0; i < _header->numVariables; i++)
+        result.push_back(string(names + _vars[i].nameOffset,
+                                _vars[i].nameLength));
+    return result;
+}
+
+SyncRecordColumn
+SyncRecordFile::getColumn(const string& name, dsm_time_t start,
+                          dsm_time_t end) const
+{
+    map<string, const SyncRecordFileVariable*>::const_iterator vi =
+        _variables.find(name);
+    if (vi == _variables.end())
+        throw n_u::InvalidParameterException(_path, "variable", name);
+    const SyncRecordFileVariable& var = *vi->second;
+
+    size_t i0 = findRecord(start);
+    size_t i1 = std::max(i0, findRecord(end));
+
+    SyncRecordColumn col;
+    col.values = getRecord(i0) + var.syncRecOffset;
+    col.lags = getRecord(i0) + var.lagOffset;
+    col.times = _times + i0;
+    col.numRecords = i1 - i0;
+    col.stride = _header->numValues;
+    col.valuesPerRecord = var.valuesPerRecord;
+    col.length = var.length;
+    col.rate = var.rate;
+    return col;
+}
+
+SyncRecordFileWriter::SyncRecordFileWriter():
+    _path(), _fd(-1), _offset(0), _header(), _times()
+{
+}
+
+SyncRecordFileWriter::~SyncRecordFileWriter()
+{
+    if (_fd >= 0) ::close(_fd);
+}
+
+void
+SyncRecordFileWriter::writeAll(const void* buf, size_t len)
+{
+    const char* cp = (const char*) buf;
+    while (len > 0) {
+        ssize_t l = ::write(_fd, cp, len);
+        if (l < 0) {
+            if (errno == EINTR) continue;
+            throw n_u::IOException(_path, "write", errno);
+        }
+        cp += l;
+        len -= l;
+        _offset += l;
+    }
+}
+
+void
+SyncRecordFileWriter::pad(size_t align)
+{
+    static const char zeros[DATA_ALIGN] = { 0 };
+    size_t rem = _offset % align;
+    if (rem) writeAll(zeros, align - rem);
+}
+
+void
+SyncRecordFileWriter::open(const string& path, const string& textHeader,
+                           const list<const SyncRecordVariable*>& variables,
+                           size_t numValues)
+{
+    _path = path;
+    _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (_fd < 0) throw n_u::IOException(path, "open", errno);
+    _offset = 0;
+    _times.clear();
+
+    ::memset(&_header, 0, sizeof(_header));
+    ::memcpy(_header.magic, SyncRecordFile::MAGIC, sizeof(_header.magic));
+    _header.version = SyncRecordFile::VERSION;
+    _header.byteOrder = SyncRecordFile::ENDIAN_MARK;
+    _header.numValues = numValues;
+    _header.numVariables = variables.size();
+
+    // The header is written again by close(), once the
+    // number of records is known.
+    writeAll(&_header, sizeof(_header));
+
+    _header.textOffset = _offset;
+    _header.textLength = textHeader.length();
+    writeAll(textHeader.c_str(), textHeader.length());
+
+    vector<SyncRecordFileVariable> vars;
+    string names;
+    list<const SyncRecordVariable*>::const_iterator vi;
+    for (vi = variables.begin(); vi != variables.end(); ++vi) {
+        const SyncRecordVariable* var = *vi;
+        SyncRecordFileVariable fvar;
+        ::memset(&fvar, 0, sizeof(fvar));
+        fvar.nameOffset = names.length();
+        fvar.nameLength = var->getName().length();
+        fvar.syncRecOffset = var->getSyncRecOffset();
+        fvar.lagOffset = var->getLagOffset();
+        fvar.length = var->getLength();
+        fvar.rate = var->getSampleRate();
+        fvar.valuesPerRecord = var->getLength() * (int)ceil(fvar.rate);
+        names += var->getName();
+        vars.push_back(fvar);
+    }
+    _header.namesOffset = _offset;
+    _header.namesLength = names.length();
+    writeAll(names.c_str(), names.length());
+
+    pad(sizeof(uint64_t));
+    _header.varsOffset = _offset;
+    if (!vars.empty())
+        writeAll(&vars.front(), vars.size() * sizeof(vars.front()));
+
+    pad(DATA_ALIGN);
+    _header.dataOffset = _offset;
+}
+
+bool
+SyncRecordFileWriter::write(dsm_time_t tt, const double* rec)
+{
+    if (!_times.empty() && tt <= _times.back()) return false;
+    writeAll(rec, _header.numValues * sizeof(double));
+    _times.push_back(tt);
+    return true;
+}
+
+void
+SyncRecordFileWriter::close()
+{
+    if (_fd < 0) return;
+    _header.numRecords = _times.size();
+    _header.timesOffset = _offset;
+    if (!_times.empty())
+        writeAll(&_times.front(), _times.size() * sizeof(dsm_time_t));
+
+    if (::pwrite(_fd, &_header, sizeof(_header), 0) !=
+        (ssize_t)sizeof(_header))
+        throw n_u::IOException(_path, "write", errno);
+    int res = ::close(_fd);
+    _fd = -1;
+    if (res < 0) throw n_u::IOException(_path, "close", errno);
+}
+
+size_t
+SyncRecordFileWriter::convert(SyncRecordReader& reader, const string& path)
+{
+    SyncRecordFileWriter writer;
+    size_t numValues = reader.getNumValues();
+    writer.open(path, reader.textHeader(), reader.getVariables(), numValues);
+
+    vector<double> rec(numValues);
+    size_t nrecs = 0;
+    try {
+        for (;;) {
+            dsm_time_t tt;
+            size_t len = reader.read(&tt, &rec.front(), numValues);
+            if (len == 0) continue;
+            // short records are filled out with NaNs
+            std::fill(rec.begin() + len, rec.end(), doubleNAN);
+            if (writer.write(tt, &rec.front())) nrecs++;
+            else WLOG(("") << path << ": discarding sync record at " <<
+                      n_u::UTime(tt).format(true, "%Y %m %d %H:%M:%S") <<
+                      ", which is out of time order");
+        }
+    }
+    catch (const n_u::EOFException&) {
+    }
+    writer.close();
+    return nrecs;
+}
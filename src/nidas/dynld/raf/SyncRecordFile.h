@@ -0,0 +1,310 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+/*
+ ********************************************************************
+ ** NIDAS: NCAR In-situ Data Acquistion Software
+ **
+ ** 2024, Copyright University Corporation for Atmospheric Research
+ **
+ ** This program is free software; you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation; either version 2 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** The LICENSE.txt file accompanying this software contains
+ ** a copy of the GNU General Public License. If it is not found,
+ ** write to the Free Software Foundation, Inc.,
+ ** 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ **
+ ********************************************************************
+*/
+
+#ifndef NIDAS_DYNLD_RAF_SYNCRECORDFILE_H
+#define NIDAS_DYNLD_RAF_SYNCRECORDFILE_H
+
+#include "SyncRecordVariable.h"
+
+#include <nidas/core/Sample.h>
+
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace nidas { namespace dynld { namespace raf {
+
+class SyncRecordReader;
+
+/**
+ * Header at the start of an indexed sync record file.  All offsets are
+ * in bytes from the start of the file, and all values are in the byte
+ * order of the host which wrote the file.
+ *
+ * An indexed sync record file contains, after this header:
+ * - the text of the sync header, as sent in the SYNC_RECORD_HEADER_ID
+ *   sample of a sync record stream,
+ * - the names of the variables,
+ * - a table of SyncRecordFileVariable, in the order of the sync header,
+ * - the sync records, each of numValues doubles, in time order,
+ *   starting on a page boundary,
+ * - the time index: the time tag of each record, as int64 microseconds.
+ */
+struct SyncRecordFileHeader
+{
+    char magic[16];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t numValues;
+    uint64_t numRecords;
+    uint64_t numVariables;
+    uint64_t textOffset;
+    uint64_t textLength;
+    uint64_t namesOffset;
+    uint64_t namesLength;
+    uint64_t varsOffset;
+    uint64_t dataOffset;
+    uint64_t timesOffset;
+};
+
+/**
+ * Entry for a variable in the table of an indexed sync record file.
+ */
+struct SyncRecordFileVariable
+{
+    uint64_t nameOffset;
+    uint32_t nameLength;
+    uint32_t syncRecOffset;
+    uint32_t lagOffset;
+    uint32_t length;
+    uint32_t valuesPerRecord;
+    float rate;
+};
+
+/**
+ * The values of a variable in a range of sync records, which point
+ * into the records of a SyncRecordFile.  The values of the variable in
+ * record i are at values[i * stride], and its lag at lags[i * stride].
+ */
+struct SyncRecordColumn
+{
+    SyncRecordColumn():
+        values(0), lags(0), times(0), numRecords(0), stride(0),
+        valuesPerRecord(0), length(0), rate(0.0)
+    {}
+
+    const double* values;
+
+    const double* lags;
+
+    const nidas::core::dsm_time_t* times;
+
+    size_t numRecords;
+
+    size_t stride;
+
+    /**
+     * Number of values of the variable in a record,
+     * its length times the ceiling of its rate.
+     */
+    size_t valuesPerRecord;
+
+    unsigned int length;
+
+    float rate;
+
+    /**
+     * Value i of the variable in record irec of the column.
+     */
+    double
+    value(size_t irec, size_t i) const
+    {
+        return values[irec * stride + i];
+    }
+};
+
+/**
+ * Read access to an indexed sync record file, which is memory mapped.
+ * Records are found by time with a binary search of the time index, and
+ * the values of a variable are accessed in place, without copying.
+ */
+class SyncRecordFile
+{
+public:
+
+    /**
+     * Map a sync record file.
+     *
+     * @throws nidas::util::IOException
+     */
+    SyncRecordFile(const std::string& path);
+
+    ~SyncRecordFile();
+
+    const std::string& textHeader() const { return _text; }
+
+    /**
+     * Number of data values in a sync record, which is the
+     * stride of the records in the file.
+     */
+    size_t getNumValues() const { return _header->numValues; }
+
+    size_t getNumRecords() const { return _header->numRecords; }
+
+    nidas::core::dsm_time_t
+    getTime(size_t irec) const
+    {
+        return _times[irec];
+    }
+
+    const double*
+    getRecord(size_t irec) const
+    {
+        return _data + irec * _header->numValues;
+    }
+
+    /**
+     * Index of the first record whose time is at or after @p tt,
+     * or getNumRecords() if there is none.
+     */
+    size_t
+    findRecord(nidas::core::dsm_time_t tt) const;
+
+    /**
+     * Names of the variables, in the order of the sync header.
+     */
+    std::vector<std::string>
+    getVariableNames() const;
+
+    /**
+     * The values of a variable in the records whose times are
+     * in [start, end).
+     *
+     * @throws nidas::util::InvalidParameterException
+     *  if there is no variable of that name.
+     */
+    SyncRecordColumn
+    getColumn(const std::string& name, nidas::core::dsm_time_t start,
+              nidas::core::dsm_time_t end) const;
+
+    static const char MAGIC[16];
+
+    static const uint32_t VERSION = 1;
+
+    static const uint32_t ENDIAN_MARK = 0x01020304;
+
+private:
+
+    std::string _path;
+
+    void* _base;
+
+    size_t _length;
+
+    const SyncRecordFileHeader* _header;
+
+    std::string _text;
+
+    std::map<std::string, const SyncRecordFileVariable*> _variables;
+
+    const SyncRecordFileVariable* _vars;
+
+    const nidas::core::dsm_time_t* _times;
+
+    const double* _data;
+
+    /** No copying. */
+    SyncRecordFile(const SyncRecordFile&);
+
+    /** No assignment. */
+    SyncRecordFile& operator=(const SyncRecordFile&);
+};
+
+/**
+ * Write an indexed sync record file.
+ */
+class SyncRecordFileWriter
+{
+public:
+
+    SyncRecordFileWriter();
+
+    ~SyncRecordFileWriter();
+
+    /**
+     * Create the file and write its sync header and variables.
+     *
+     * @throws nidas::util::IOException
+     */
+    void
+    open(const std::string& path, const std::string& textHeader,
+         const std::list<const SyncRecordVariable*>& variables,
+         size_t numValues);
+
+    /**
+     * Write a record of the numValues given to open().  Records must be
+     * in increasing time order, others are discarded.
+     * @return false if the record was discarded.
+     *
+     * @throws nidas::util::IOException
+     */
+    bool
+    write(nidas::core::dsm_time_t tt, const double* rec);
+
+    /**
+     * Write the time index and the final header.
+     *
+     * @throws nidas::util::IOException
+     */
+    void
+    close();
+
+    /**
+     * Convert a sync record stream to an indexed sync record file.
+     * @return Number of records written.
+     *
+     * @throws nidas::util::IOException
+     */
+    static size_t
+    convert(SyncRecordReader& reader, const std::string& path);
+
+private:
+
+    /**
+     * @throws nidas::util::IOException
+     */
+    void
+    writeAll(const void* buf, size_t len);
+
+    /**
+     * @throws nidas::util::IOException
+     */
+    void
+    pad(size_t align);
+
+    std::string _path;
+
+    int _fd;
+
+    uint64_t _offset;
+
+    SyncRecordFileHeader _header;
+
+    std::vector<nidas::core::dsm_time_t> _times;
+
+    /** No copying. */
+    SyncRecordFileWriter(const SyncRecordFileWriter&);
+
+    /** No assignment. */
+    SyncRecordFileWriter& operator=(const SyncRecordFileWriter&);
+};
+
+}}}	// namespace nidas namespace dynld namespace raf
+
+#endif
@@ -63,6 +63,24 @@ using nidas::util::LogMessage;
  */
 // #define LOG_ALL_SKIPS
 
+namespace {
+
+/*
+ * Fill a sync record with NaNs, in blocks of 8 as in
+ * A2DSensor::convertCounts().
+ */
+void fillNAN(double* dp, size_t n)
+{
+    size_t i = 0;
+    for ( ; i + 8 <= n; i += 8) {
+        double* bp = dp + i;
+        for (int j = 0; j < 8; j++) bp[j] = doubleNAN;
+    }
+    for ( ; i < n; i++) dp[i] = doubleNAN;
+}
+
+}
+
 inline
 std::string
 format_time(dsm_time_t tt, const std::string& fmt = "%Y %m %d %H:%M:%S.%3f")
@@ -231,11 +249,12 @@ void SyncInfo::computeSlotIndex(const Sample* samp)
 }
 
 SyncRecordSource::SyncRecordSource():
-    _source(false),_syncInfo(), _variables(),
+    _source(false),_syncInfo(),_syncIndex(),_syncInfos(),_variables(),
     _syncRecordHeaderSampleTag(),_syncRecordDataSampleTag(),
     _recSize(0),_syncHeaderTime(),_syncTime(),
     _current(0), _halfMaxUsecsPerSample(INT_MIN),
-    _syncRecord(),_dataPtr(),_unrecognizedSamples(),
+    _syncRecord(),_ringRecord(),_ringNext(0),_triggerUsecs(0),
+    _dataPtr(),_unrecognizedSamples(),
     _headerStream(),
     _aircraft(0),_initialized(false),_unknownSampleType(0),
     _badLaterSamples(0)
@@ -259,6 +278,8 @@ SyncRecordSource::~SyncRecordSource()
 {
     if (_syncRecord[0]) _syncRecord[0]->freeReference();
     if (_syncRecord[1]) _syncRecord[1]->freeReference();
+    for (int i = 0; i < NRINGREC; i++)
+        if (_ringRecord[i]) _ringRecord[i]->freeReference();
 
     // log the discarded, overWritten and, if LOG_SKIPS is defined,
     // the skipped samples for each sample id
@@ -427,8 +448,32 @@ init()
         // cerr << "sinfo.sampleLength=" << sinfo.sampleLength <<
         //     ", index=" << index << endl;
 	index += sinfo.sampleLength;
+        _syncInfos.push_back(&sinfo);
     }
     _recSize = index;
+
+    // The map is in order of DSM id and then sample id, so the
+    // range of sample ids of a DSM is from its first and last entries.
+    for (si = _syncInfo.begin(); si != _syncInfo.end(); ) {
+        unsigned int dsm = GET_DSM_ID(si->first);
+        unsigned int spsMin = GET_SPS_ID(si->first);
+        map<dsm_sample_id_t, SyncInfo>::iterator se = si;
+        for ( ; se != _syncInfo.end() && GET_DSM_ID(se->first) == dsm; ++se);
+        map<dsm_sample_id_t, SyncInfo>::iterator sl = se;
+        --sl;
+        if (dsm >= _syncIndex.size()) _syncIndex.resize(dsm + 1);
+        SampleIndex& sindex = _syncIndex[dsm];
+        sindex.spsMin = spsMin;
+        sindex.infos.resize(GET_SPS_ID(sl->first) - spsMin + 1, 0);
+        for ( ; si != se; ++si)
+            sindex.infos[GET_SPS_ID(si->first) - spsMin] = &si->second;
+    }
+
+    _triggerUsecs = USECS_PER_SEC +
+        std::max(_halfMaxUsecsPerSample, 250 * USECS_PER_MSEC);
+
+    for (int i = 0; i < NRINGREC; i++)
+        _ringRecord[i] = getSample<double>(_recSize);
 }
 
 void SyncRecordSource::connect(SampleSource* source) throw()
@@ -658,11 +703,11 @@ void SyncRecordSource::allocateRecord(int irec, dsm_time_t timetag)
     if (!_syncRecord[irec]) {
         dsm_time_t syncTime = timetag - (timetag % USECS_PER_SEC);    // beginning of second
 
-        SampleT<double>* sp = _syncRecord[irec] = getSample<double>(_recSize);
+        SampleT<double>* sp = _syncRecord[irec] = getRingRecord();
         sp->setTimeTag(syncTime);
         sp->setId(SYNC_RECORD_ID);
         _dataPtr[irec] = sp->getDataPtr();
-        std::fill(_dataPtr[irec], _dataPtr[irec] + _recSize, doubleNAN);
+        fillNAN(_dataPtr[irec], _recSize);
 
         _syncTime[irec] = syncTime;
 
@@ -679,6 +724,28 @@ void SyncRecordSource::allocateRecord(int irec, dsm_time_t timetag)
     }
 }
 
+SampleT<double>* SyncRecordSource::getRingRecord()
+{
+    for (int i = 0; i < NRINGREC; i++) {
+        int n = (_ringNext + i) % NRINGREC;
+        SampleT<double>* rec = _ringRecord[n];
+        if (rec && rec->getReferenceCount() == 1) {
+            _ringNext = (n + 1) % NRINGREC;
+            rec->holdReference();
+            return rec;
+        }
+    }
+
+    // The clients are holding all the records in the ring,
+    // replace the next one.
+    SampleT<double>* rec = getSample<double>(_recSize);
+    if (_ringRecord[_ringNext]) _ringRecord[_ringNext]->freeReference();
+    _ringRecord[_ringNext] = rec;
+    _ringNext = (_ringNext + 1) % NRINGREC;
+    rec->holdReference();
+    return rec;
+}
+
 int SyncRecordSource::advanceRecord(dsm_time_t timetag)
 {
 #ifdef DEBUG
@@ -692,10 +759,8 @@ int SyncRecordSource::advanceRecord(dsm_time_t timetag)
     _current = nextRecordIndex(_current);
     if (!_syncRecord[_current]) allocateRecord(_current,timetag);
 
-    map<dsm_sample_id_t, SyncInfo>::iterator si = _syncInfo.begin();
-    for ( ; si != _syncInfo.end(); ++si) {
-        si->second.advanceRecord(last);
-    }
+    for (unsigned int i = 0; i < _syncInfos.size(); i++)
+        _syncInfos[i]->advanceRecord(last);
 
 #ifdef DEBUG
     cerr << "after advanceRecord, _syncTime[" << _current << "]=" <<
@@ -932,7 +997,7 @@ bool SyncRecordSource::checkTime(const Sample* samp,
             if (ni > 1) {
                 ostringstream ost;
                 ost << "checkTime, tdiff=" << tdiff << ": ";
-                slog(stracer, ost.str(), samp, sinfo);
+                slog(stracer, ost.str().c_str(), samp, sinfo);
                 int ns;
                 for (ns = 0; ns < ni; ns++) {
                     if (!sinfo.incrementSlot()) break;
@@ -964,7 +1029,7 @@ bool SyncRecordSource::checkTime(const Sample* samp,
     return ret;
 }
 
-void SyncRecordSource::slog(SampleTracer& stracer,const string& msg,
+void SyncRecordSource::slog(SampleTracer& stracer,const char* msg,
         const Sample* samp, const SyncInfo& sinfo)
 {
     if (stracer.active(samp))
@@ -1058,10 +1123,9 @@ bool SyncRecordSource::receive(const Sample* samp) throw()
     dsm_time_t tt = samp->getTimeTag();
     dsm_sample_id_t sampleId = samp->getId();
 
-    map<dsm_sample_id_t, SyncInfo>::iterator si =
-        _syncInfo.find(sampleId);
-    if (si == _syncInfo.end()) return false;
-    SyncInfo& sinfo = si->second;
+    SyncInfo* sip = findSyncInfo(sampleId);
+    if (!sip) return false;
+    SyncInfo& sinfo = *sip;
 
     sinfo.total++;
     sinfo.overWritten = false;
@@ -1090,12 +1154,7 @@ bool SyncRecordSource::receive(const Sample* samp) throw()
      * a gap, one might have to send out both sync records.
      */
 
-    for (;;) {
-        dsm_time_t triggertime = _syncTime[_current] + USECS_PER_SEC +
-            std::max(_halfMaxUsecsPerSample, 250 * USECS_PER_MSEC);
-        if (tt >= triggertime) advanceRecord(tt);
-        else break;
-    }
+    while (tt >= _syncTime[_current] + _triggerUsecs) advanceRecord(tt);
 
     // First of this sample encounters, or the last sample was in
     // previous sync record which was written out. Restart
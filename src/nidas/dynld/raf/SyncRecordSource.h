@@ -290,6 +290,15 @@ public:
      **/
     void init();
 
+    /**
+     * Append variables to those laid out by init(), for users
+     * which do not select them from the Project, such as tests.
+     */
+    void addVariables(const std::list<const Variable*>& variables)
+    {
+        _variables.insert(_variables.end(), variables.begin(), variables.end());
+    }
+
     /**
      * Generate and send a sync record header sample.  The sync record
      * should have been laid out already, but that happens when a source is
@@ -354,7 +363,11 @@ private:
     bool checkTime(const Sample* samp, SyncInfo& sinfo, SampleTracer& stracer,
             nidas::util::LogContext& lc, int warn_times);
 
-    void slog(SampleTracer& stracer, const std::string& msg,
+    /**
+     * Trace a sample. The message is a char pointer, so that no
+     * string is constructed for the usual case of no tracing.
+     */
+    void slog(SampleTracer& stracer, const char* msg,
         const Sample* samp, const SyncInfo& sinfo);
 
     void log(nidas::util::LogContext& lc, const std::string& msg,
@@ -386,6 +399,26 @@ private:
     void
     allocateRecord(int irec, dsm_time_t timetag);
 
+    /**
+     * Get a record from the ring of sync records, one whose only
+     * reference is held by the ring, or a new one if the clients
+     * still hold all of them.
+     */
+    SampleT<double>* getRingRecord();
+
+    /**
+     * Find the SyncInfo of a sample id in _syncIndex.
+     * @return 0 if the sample is not in the sync record.
+     */
+    SyncInfo* findSyncInfo(dsm_sample_id_t id) const
+    {
+        unsigned int dsm = GET_DSM_ID(id);
+        if (dsm >= _syncIndex.size()) return 0;
+        const SampleIndex& sindex = _syncIndex[dsm];
+        unsigned int i = GET_SPS_ID(id) - sindex.spsMin;
+        return i < sindex.infos.size() ? sindex.infos[i] : 0;
+    }
+
     int advanceRecord(dsm_time_t timetag);
 
     /**
@@ -403,6 +436,27 @@ private:
      */
     std::map<dsm_sample_id_t, SyncInfo> _syncInfo;
 
+    /**
+     * The SyncInfos of one DSM, indexed by sample id minus spsMin.
+     */
+    struct SampleIndex
+    {
+        SampleIndex(): spsMin(0), infos() {}
+        unsigned int spsMin;
+        std::vector<SyncInfo*> infos;
+    };
+
+    /**
+     * Dense index of the SyncInfos in _syncInfo, by DSM id,
+     * built by init(), so that receive() does not search the map.
+     */
+    std::vector<SampleIndex> _syncIndex;
+
+    /**
+     * The SyncInfos in _syncInfo, in order of sample id.
+     */
+    std::vector<SyncInfo*> _syncInfos;
+
     /**
      * List of all variables in the sync record.
      */
@@ -427,6 +481,26 @@ private:
 
     SampleT<double>* _syncRecord[2];
 
+    /**
+     * Number of sync records in the ring, enough for the two being
+     * filled and a couple held by clients.
+     */
+    static const int NRINGREC = 4;
+
+    /**
+     * Ring of sync records, allocated by init() and reused
+     * from second to second.
+     */
+    SampleT<double>* _ringRecord[NRINGREC];
+
+    int _ringNext;
+
+    /**
+     * Offset from a sync time to the time tag of a sample which
+     * causes the sync record to be sent.
+     */
+    int _triggerUsecs;
+
     double* _dataPtr[2];
 
     size_t _unrecognizedSamples;
@@ -60,6 +60,7 @@ SyncServer::SyncServer():
     _inputStream(0), _outputStream(0),
     _xmlFileName(), _dataFileNames(),
     _address(new n_u::Inet4SocketAddress(DEFAULT_PORT)),
+    _outputFileName(),
     _sorterLengthSecs(SORTER_LENGTH_SECS),
     _rawSorterLengthSecs(RAW_SORTER_LENGTH_SECS),
     _sampleClient(0),
@@ -249,6 +250,18 @@ stop()
     _outputStream = 0;
 }
 
+void
+SyncServer::
+setInputFilters(RawSampleInputStream& sis)
+{
+    // Apply some sample filters in case the file is corrupted.
+    sis.setMaxDsmId(2000);
+    sis.setMaxSampleLength(64000);
+    sis.setMinSampleTime(n_u::UTime::parse(true,"2006 jan 1 00:00"));
+    // This needs another answer than just a fixed date.  Perhaps current date + 48 hours...
+    sis.setMaxSampleTime(n_u::UTime::parse(true,"2025 jan 1 00:00"));
+}
+
 void
 SyncServer::
 openStream()
@@ -264,13 +277,7 @@ openStream()
     // RawSampleStream owns the iochan ptr.
     _inputStream = new RawSampleInputStream(iochan);
     RawSampleInputStream& sis = *_inputStream;
-
-    // Apply some sample filters in case the file is corrupted.
-    sis.setMaxDsmId(2000);
-    sis.setMaxSampleLength(64000);
-    sis.setMinSampleTime(n_u::UTime::parse(true,"2006 jan 1 00:00"));
-    // This needs another answer than just a fixed date.  Perhaps current date + 48 hours...
-    sis.setMaxSampleTime(n_u::UTime::parse(true,"2025 jan 1 00:00"));
+    setInputFilters(sis);
 
     sis.readInputHeader();
     SampleInputHeader header = sis.getInputHeader();
@@ -332,12 +339,22 @@ init()
     // instead.
     if (! _sampleClient)
     {
-        nidas::core::ServerSocket* servSock =
-            new nidas::core::ServerSocket(*_address.get());
-        IOChannel* ioc = servSock->connect();
-        if (ioc != servSock) {
-            servSock->close();
-            delete servSock;
+        IOChannel* ioc;
+        if (_outputFileName.length() > 0)
+        {
+            nidas::core::FileSet* fset = new nidas::core::FileSet();
+            fset->setFileName(_outputFileName);
+            ioc = fset;
+        }
+        else
+        {
+            nidas::core::ServerSocket* servSock =
+                new nidas::core::ServerSocket(*_address.get());
+            ioc = servSock->connect();
+            if (ioc != servSock) {
+                servSock->close();
+                delete servSock;
+            }
         }
 
         // The SyncServer is a SampleConnectionRequester client of the
@@ -414,6 +431,16 @@ read(bool once)
     bool eof = false;
     RawSampleInputStream& sis = *_inputStream;
 
+    // Samples are sorted over the length of the raw sorter, so once
+    // they are well past the end of the time window the rest of the
+    // input can be skipped.  The margin allows for samples which are
+    // out of order in the archive.
+    dsm_time_t margin = (dsm_time_t)
+        ((2 * _rawSorterLengthSecs + 10) * USECS_PER_SEC);
+    dsm_time_t endRead = LONG_LONG_MAX;
+    if (_endWindow < LONG_LONG_MAX - margin)
+        endRead = _endWindow + margin;
+
     if (_firstSample)
     {
         DLOG(("SyncServer: handling firstSample"));
@@ -432,6 +459,12 @@ read(bool once)
                 eof = true;
                 break;
             }
+            if (sample->getTimeTag() > endRead)
+            {
+                sample->freeReference();
+                eof = true;
+                break;
+            }
             handleSample(sample);
         }
     }
@@ -134,6 +134,16 @@ public:
         _address.reset(addr);
     }
 
+    /**
+     * Write the sync samples to a file of this name, instead
+     * of to the output socket.
+     **/
+    void
+    setOutputFileName(const std::string& name)
+    {
+        _outputFileName = name;
+    }
+
     /**
      * Specify a SampleClient instance to receive the sync samples instead
      * of writing the sync samples to an output stream.
@@ -169,6 +179,14 @@ public:
     void
     setTimeWindow(nidas::util::UTime start, nidas::util::UTime end);
 
+    /**
+     * Apply the filters on raw samples which guard against corrupted
+     * input files to a stream, so that all readers of the raw data
+     * see the same samples.
+     **/
+    static void
+    setInputFilters(RawSampleInputStream& sis);
+
     static const int DEFAULT_PORT = 30001;
 
     static const float SORTER_LENGTH_SECS;
@@ -217,6 +235,8 @@ private:
 
     nidas::util::auto_ptr<nidas::util::SocketAddress> _address;
 
+    std::string _outputFileName;
+
     float _sorterLengthSecs;
 
     float _rawSorterLengthSecs;
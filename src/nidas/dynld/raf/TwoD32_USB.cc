@@ -125,6 +125,10 @@ bool TwoD32_USB::processImage(const Sample * samp,
 
         const unsigned char* sos = cp;       // possible start of particle slice
 
+        // skip the byte by byte scan of slices without a 0x55 byte
+        if (!word32HasByte(cp, 0x55))
+            cp = eow;
+
         for (; cp < eow; ) {
             switch (*cp) {
             case 0x55:  // overload (0x55aa) or sync (0x55*) string
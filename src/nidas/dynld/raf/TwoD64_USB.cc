@@ -250,6 +250,15 @@ bool TwoD64_USB::processImageRecord(const Sample * samp,
          * a possible syncWord or overloadWord */
         const unsigned char* eow = cp + wordSize;
 
+        // Most words are slices without a byte that can start a sync or
+        // overload word, which can skip the byte by byte scan.
+        if (!wordHasByte(cp, 0xaa) && !wordHasByte(cp, 0x55)
+#ifdef SLICE_DEBUG
+            && !sdlog.active()
+#endif
+            )
+            cp = eow;
+
         for (; cp < eow; ) {
 #ifdef SLICE_DEBUG
             if (sdlog.active())
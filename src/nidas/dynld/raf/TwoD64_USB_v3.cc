@@ -32,6 +32,7 @@
 #include <nidas/linux/usbtwod/usbtwod.h>
 #include "TwoD64_USB_v3.h"
 #include <nidas/core/UnixIODevice.h>
+#include <nidas/core/Parameter.h>
 #include <nidas/core/Variable.h>
 
 #include <nidas/util/UTime.h>
@@ -49,7 +50,8 @@ namespace n_u = nidas::util;
 using nidas::util::endlog;
 
 NIDAS_CREATOR_FUNCTION_NS(raf, TwoD64_USB_v3)
-TwoD64_USB_v3::TwoD64_USB_v3():_nHskp(0)
+TwoD64_USB_v3::TwoD64_USB_v3():_nHskp(0), _prevSOR(), _prevHskp(),
+    _hskpOnChange(false), _hskpUnchanged(0)
 {
      _probeClockRate=33.3333333;        //Default for v3 is 33 MHZ
      _timeWordMask=0x000003ffffffffffLL;    //Default for v3 is 42 bits
@@ -77,6 +79,14 @@ void TwoD64_USB_v3::init_parameters()
     }
     if (sorRate <= 0.0) throw n_u::InvalidParameterException(getName(),
         "sample","shadow OR sample rate not found");
+
+    const Parameter * p = getParameter("HSKP_ON_CHANGE");
+    if (p) {
+        if (p->getType() != Parameter::BOOL_PARAM || p->getLength() != 1)
+            throw n_u::InvalidParameterException(getName(),
+                "HSKP_ON_CHANGE", "should be a boolean of length 1");
+        _hskpOnChange = (bool)p->getNumericValue(0);
+    }
 }
 
 int TwoD64_USB_v3::TASToTap2D(void * t2d, float tas)
@@ -97,6 +107,11 @@ float TwoD64_USB_v3::Tap2DToTAS(const Tap2D * t2d) const
     return (float)p[0]/10.0;
 }
 
+void TwoD64_USB_v3::printStatusFields(std::ostream& ostr)
+{
+    ostr << ",hskpUnchanged=" << _hskpUnchanged;
+}
+
 void TwoD64_USB_v3::validate()
 {
     TwoD64_USB::validate();
@@ -129,6 +144,22 @@ bool TwoD64_USB_v3::processSOR(const Sample * samp,
         return false;
     }
 
+    // The housekeeping changes slowly, so when the record is the same
+    // as the previous one, its converted values are reused.
+    if (!_prevHskp.empty() && _prevSOR.length() == slen &&
+        !::memcmp(_prevSOR.data(), input, slen)) {
+        _hskpUnchanged++;
+        if (_hskpOnChange) return false;
+        SampleT<float>* outs = getSample<float>(_nHskp);
+        outs->setTimeTag(samp->getTimeTag());
+        outs->setId(_sorID);
+        ::memcpy(outs->getDataPtr(), &_prevHskp.front(),
+            _nHskp * sizeof(float));
+        results.push_back(outs);
+        return true;
+    }
+    _prevSOR.assign(input, slen);
+
     char in_str[slen+1];
     ::memcpy(in_str, input, slen);
     in_str[slen] = 0;
@@ -154,7 +185,17 @@ bool TwoD64_USB_v3::processSOR(const Sample * samp,
     }
     list<SampleTag*> tags = getSampleTags();
     applyConversions(tags.front(), outs);
+
+    // A different record can still convert to the same values.
+    if (_prevHskp.size() == _nHskp &&
+        !::memcmp(&_prevHskp.front(), dout, _nHskp * sizeof(float))) {
+        _hskpUnchanged++;
+        if (_hskpOnChange) {
+            outs->freeReference();
+            return false;
+        }
+    }
+    _prevHskp.assign(dout, dout + _nHskp);
     results.push_back(outs);
     return true;
 }
-
@@ -29,6 +29,9 @@
 
 #include "TwoD64_USB.h"
 
+#include <string>
+#include <vector>
+
 namespace nidas { namespace dynld { namespace raf {
 
 using namespace nidas::core;
@@ -56,9 +59,30 @@ private:
     /// Number of houeskeeping variables in sample 1.
     size_t _nHskp;
 
+    /**
+     * Text of the previous housekeeping record, and its converted
+     * values, which are reused if the next record is the same.
+     */
+    std::string _prevSOR;
+    std::vector<float> _prevHskp;
+
+    /**
+     * If true, from the HSKP_ON_CHANGE parameter, a housekeeping
+     * sample is only output when its values have changed.
+     */
+    bool _hskpOnChange;
+
 protected:
     virtual void init_parameters();
 
+    void printStatusFields(std::ostream& ostr);
+
+    /**
+     * Number of housekeeping samples whose values had not changed
+     * since the previous one, shown in printStatus().
+     */
+    unsigned int _hskpUnchanged;
+
     /**
      * Process the Shadow-OR sample from the probe.
      */
@@ -180,6 +180,10 @@ return false;  // Remove when ready.
          * a possible syncWord or overloadWord */
         const unsigned char* eow = cp + wordSize;
 
+        // skip the byte by byte scan of slices without a 0xaa byte
+        if (!wordHasByte(cp, 0xaa) && !wordHasByte(cp + 8, 0xaa))
+            cp = eow;
+
         for (; cp < eow; ++cp) {
             if (*cp == 0xaa) { // start of possible particle string
                 if (cp + wordSize > eod) {
@@ -51,6 +51,7 @@ TwoD_House::~TwoD_House()
 TwoD_House::TwoD_House() : DSMSerialSensor(), _noutValues(7)
 {
   ::memset(_houseKeeping, 0, sizeof(_houseKeeping));
+  ::memset(_houseOut, 0, sizeof(_houseOut));
 }
 
 
@@ -77,20 +78,24 @@ bool TwoD_House::process(const Sample* samp,list<const Sample*>& results)
 
     // Push the housekeeping.  They are not all decoded/available every sample,
     // they come round robin.
-    if (nf > 6 && tag < sizeof(_houseKeeping)/sizeof(_houseKeeping[0]))
+    if (nf > 6 && tag < sizeof(_houseKeeping)/sizeof(_houseKeeping[0]) &&
+        _houseKeeping[tag] != hkp) {
        _houseKeeping[tag] = hkp;
+       _houseOut[0] = _houseKeeping[V15_INDX];
+       _houseOut[1] = _houseKeeping[TMP_INDX];
+       _houseOut[2] = _houseKeeping[EE1_INDX] * 0.001;
+       _houseOut[3] = _houseKeeping[EE32_INDX] * 0.001;
+       _houseOut[4] = _houseKeeping[VN15_INDX];
+       _houseOut[5] = _houseKeeping[V5_INDX];
+    }
 
     SampleT<float> * outs = getSample<float>(_noutValues);
     float * dout = outs->getDataPtr();
     outs->setTimeTag(samp->getTimeTag());
     outs->setId(getId() + 1);
 
-    *dout++ = _houseKeeping[V15_INDX];
-    *dout++ = _houseKeeping[TMP_INDX];
-    *dout++ = _houseKeeping[EE1_INDX] * 0.001;
-    *dout++ = _houseKeeping[EE32_INDX] * 0.001;
-    *dout++ = _houseKeeping[VN15_INDX];
-    *dout++ = _houseKeeping[V5_INDX];
+    ::memcpy(dout, _houseOut, sizeof(_houseOut));
+    dout += sizeof(_houseOut) / sizeof(_houseOut[0]);
 
     *dout++ = shadow_or;
 
@@ -66,6 +66,12 @@ protected:
    */
   float _houseKeeping[8];
 
+  /**
+   * The housekeeping values of the output sample, which are
+   * only converted again when a housekeeping value changes.
+   */
+  float _houseOut[6];
+
   static const size_t V15_INDX, TMP_INDX, EE1_INDX, EE32_INDX,
 	VN15_INDX, V5_INDX;
 };
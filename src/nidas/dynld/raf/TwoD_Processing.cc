@@ -36,11 +36,35 @@
 #include <sstream>
 #include <iomanip>
 
+#include <endian.h>
+
 using namespace std;
 using namespace nidas::dynld::raf;
 
 namespace n_u = nidas::util;
 
+namespace {
+
+/**
+ * Shadowed diodes of 8 bytes of a slice, or of nbytes if fewer,
+ * as a 64 bit word with the first diode in the most significant bit.
+ */
+inline uint64_t shadowedDiodes(const unsigned char* data, int nbytes)
+{
+    uint64_t w;
+    if (nbytes >= 8)
+    {
+        ::memcpy(&w, data, sizeof(w));
+        return ~be64toh(w);
+    }
+    w = 0;
+    for (int i = 0; i < nbytes; ++i)
+        w |= (uint64_t)(unsigned char)~data[i] << (56 - i * 8);
+    return w;
+}
+
+}
+
 
 TwoD_Processing::TwoD_Processing() :
     _numImages(0),_lastStatusTime(0),
@@ -159,68 +183,48 @@ void TwoD_Processing::createSamples(dsm_time_t nextTimeTag,list < const Sample *
 void TwoD_Processing::processParticleSlice(Particle& p, const unsigned char * data)
 {
     int nBytes = NumberOfDiodes() / 8;
+    int nWords = (nBytes + 7) / 8;
+
+    p.width++;
 
     /* Note that 2D data is inverted.  So a '1' means no shadowing of the diode.
-     * '0' means shadowing and a particle.  Perform complement here.
+     * '0' means shadowing and a particle.  Complement it here, 64 diodes
+     * at a time, with the first diode in the most significant bit.
      */
-    unsigned char slice[nBytes];
-    for (int i = 0; i < nBytes; ++i)
-        slice[i] = ~(data[i]);
-
-    p.width++;
+    int first = -1, last = -1;
+    uint64_t firstWord = 0, lastWord = 0;
+    for (int i = 0; i < nWords; ++i)
+    {
+        uint64_t w = shadowedDiodes(data + i * 8, nBytes - i * 8);
+        if (w == 0)
+            continue;
+        // Compute area = number of bits set in particle
+        p.area += __builtin_popcountll(w);
+        if (first < 0)
+        {
+            first = i;
+            firstWord = w;
+        }
+        last = i;
+        lastWord = w;
+    }
+    if (first < 0)
+        return;
 
-    if ((slice[0] & 0x80)) { // touched edge
+    if (first == 0 && (firstWord & 0x8000000000000000ULL)) { // touched edge
         p.edgeTouch |= 0x0F;
     }
 
-    if ((slice[nBytes-1] & 0x01)) { // touched edge
+    // The last diode of a 32 diode probe is bit 32 of its only word.
+    int lastBit = nWords * 64 - nBytes * 8;
+    if (last == nWords - 1 && ((lastWord >> lastBit) & 0x01)) { // touched edge
         p.edgeTouch |= 0xF0;
     }
 
-    // Compute area = number of bits set in particle
-    for (int i = 0; i < nBytes; ++i)
-    {
-        unsigned char c = slice[i];
-        for (; c; p.area++)
-            c &= c - 1; // clear the least significant bit set
-    }
-
     // number of bits between first and last set bit, inclusive
-    int h = NumberOfDiodes();
-    for (int i = 0; i < nBytes; ++i)
-    {
-        if (slice[i] == 0)
-        {
-            h -= 8;
-            continue;
-        }
-        int r = 7;
-        unsigned char v = slice[i];
-        while (v >>= 1)
-            r--;
-        h -= r;
-        break;
-    }
-    for (int i = nBytes-1; i >= 0; --i)
-    {
-        if (slice[i] == 0)
-        {
-            h -= 8;
-            continue;
-        }
-        int r = 0;
-        unsigned char v = slice[i];
-        while ((v & 0x01) == 0)
-        {
-            r++;
-            v >>= 1;
-        }
-        h -= r;
-        break;
-    }
-
-    if (h > 0)
-        p.height = std::max((unsigned)h, p.height);
+    unsigned int h = (last - first + 1) * 64 - __builtin_clzll(firstWord) -
+        __builtin_ctzll(lastWord);
+    p.height = std::max(h, p.height);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -29,6 +29,9 @@
 
 #include <nidas/core/Sample.h>
 
+#include <cstring>
+#include <stdint.h>
+
 
 namespace nidas { namespace dynld { namespace raf {
 
@@ -111,6 +114,29 @@ protected:
      */
     virtual void processParticleSlice(Particle& p, const unsigned char * slice);
 
+//@{
+    /**
+     * Whether any byte of a 4 or 8 byte word of image data equals b,
+     * tested a word at a time rather than byte by byte.  Slices
+     * without a byte that can start a sync or overload word need not
+     * be scanned for one.
+     */
+    static bool wordHasByte(const unsigned char* word, unsigned char b)
+    {
+        uint64_t v;
+        ::memcpy(&v, word, sizeof(v));
+        v ^= 0x0101010101010101ULL * b;
+        return ((v - 0x0101010101010101ULL) & ~v & 0x8080808080808080ULL) != 0;
+    }
+    static bool word32HasByte(const unsigned char* word, unsigned char b)
+    {
+        uint32_t v;
+        ::memcpy(&v, word, sizeof(v));
+        v ^= 0x01010101U * b;
+        return ((v - 0x01010101U) & ~v & 0x80808080U) != 0;
+    }
+//@}
+
     /**
      * Look at particle stats/info and decide whether to accept or reject.
      * @param p is the particle information.
@@ -34,6 +34,7 @@
 #include <nidas/util/UTime.h>
 
 #include <asm/ioctls.h>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
@@ -46,6 +47,8 @@ namespace n_u = nidas::util;
 // 23 m/s mimics the newer spinning disk. 33 for the older.
 const float TwoD_USB::DefaultTrueAirspeed = 23.0;
 
+const float TwoD_USB::TASTableMax = 300.0;
+
 const n_u::EndianConverter * TwoD_USB::bigEndian =
     n_u::EndianConverter::getConverter(n_u::EndianConverter::
                                        EC_BIG_ENDIAN);
@@ -54,7 +57,8 @@ const n_u::EndianConverter * TwoD_USB::littleEndian =
     n_u::EndianConverter::getConverter(n_u::EndianConverter::
                                        EC_LITTLE_ENDIAN);
 
-TwoD_USB::TwoD_USB() : _tasRate(1), _tasOutOfRange(0), _sorID(0), _trueAirSpeed(0)
+TwoD_USB::TwoD_USB() : _tasRate(1), _tasOutOfRange(0), _sorID(0), _trueAirSpeed(0),
+    _tasLimits(), _tasTaps(), _tapTAS(), _tapTASv1()
 {
     setDefaultMode(O_RDWR);
 }
@@ -133,6 +137,55 @@ void TwoD_USB::init_parameters()
     if (!p)
         throw n_u::InvalidParameterException(getName(), "TAS_RATE","not found");
     setTASRate((int)(rint(p->getNumericValue(0)))); //tas_rate is the same rate used as sor_rate
+
+    buildTASTables();
+}
+
+/*---------------------------------------------------------------------------*/
+void TwoD_USB::buildTASTables()
+{
+    // The encoding of encodeTAS() only increases with the airspeed,
+    // from the divide by ten to without it, and by ntap, so each
+    // encoding is used from a lowest airspeed up to the next one.
+    // Find those airspeeds by bisection, down to adjacent doubles,
+    // so that the lookup in TASToTap2D() is exactly encodeTAS().
+    _tasLimits.clear();
+    _tasTaps.clear();
+    double tas = DefaultTrueAirspeed;
+    Tap2D t2d;
+    encodeTAS(&t2d, tas);
+    for (;;) {
+        _tasLimits.push_back(tas);
+        _tasTaps.push_back(t2d);
+
+        Tap2D thi;
+        double hi = TASTableMax;
+        encodeTAS(&thi, hi);
+        if (thi.ntap == t2d.ntap && thi.div10 == t2d.div10) break;
+        double lo = tas;
+        for (;;) {
+            double mid = lo + (hi - lo) / 2;
+            if (mid <= lo || mid >= hi) break;
+            Tap2D tmid;
+            encodeTAS(&tmid, mid);
+            if (tmid.ntap == t2d.ntap && tmid.div10 == t2d.div10) lo = mid;
+            else {
+                hi = mid;
+                thi = tmid;
+            }
+        }
+        tas = hi;
+        t2d = thi;
+    }
+
+    // ntap of a Tap2D is 9 bits, of a Tap2Dv1 8 bits.
+    _tapTAS.resize(1024);
+    for (unsigned int ntap = 0; ntap < _tapTAS.size(); ntap++)
+        _tapTAS[ntap] = (1.0e11 / ((float)ntap * 2 * 25000 / 511)) * getResolution();
+
+    _tapTASv1.resize(256);
+    for (unsigned int ntap = 0; ntap < _tapTASv1.size(); ntap++)
+        _tapTASv1[ntap] = (1.0e6 / (1.0 - ((float)ntap / 255))) * getResolution();
 }
 
 /*---------------------------------------------------------------------------*/
@@ -201,6 +254,25 @@ int TwoD_USB::TASToTap2D(void * tap2d, float tas)
     if (tas < DefaultTrueAirspeed)
         tas = DefaultTrueAirspeed;
 
+    if (tas > TASTableMax || _tasLimits.empty())
+        return encodeTAS(t2d, tas);
+
+    // the last encoding whose lowest airspeed is at or below tas
+    unsigned int i = std::upper_bound(_tasLimits.begin(), _tasLimits.end(),
+        (double)tas) - _tasLimits.begin() - 1;
+
+    memset(t2d, 0, sizeof(*t2d));
+    t2d->ntap = _tasTaps[i].ntap;
+    t2d->div10 = _tasTaps[i].div10;
+
+    // An airspeed which is too low encodes to tap 0 with the divide by
+    // ten, which no other airspeed does, see encodeTAS().
+    return (t2d->ntap == 0 && t2d->div10 == 1) ? -EINVAL : 0;
+}
+
+/*---------------------------------------------------------------------------*/
+int TwoD_USB::encodeTAS(Tap2D * t2d, double tas) const
+{
     double freq = tas / getResolution();
     double maxfreq;
     double PotFudgeFactor = 1.01;
@@ -244,7 +316,11 @@ int TwoD_USB::TASToTap2D(void * tap2d, float tas)
 /*---------------------------------------------------------------------------*/
 float TwoD_USB::Tap2DToTAS(const Tap2D * t2d) const
 {
-    float tas = (1.0e11 / ((float)t2d->ntap * 2 * 25000 / 511)) * getResolution();
+    float tas;
+    if (t2d->ntap < _tapTAS.size())
+        tas = _tapTAS[t2d->ntap];
+    else
+        tas = (1.0e11 / ((float)t2d->ntap * 2 * 25000 / 511)) * getResolution();
 
     if (t2d->div10 == 1)
         tas /= 10.0;
@@ -255,7 +331,11 @@ float TwoD_USB::Tap2DToTAS(const Tap2D * t2d) const
 /*---------------------------------------------------------------------------*/
 float TwoD_USB::Tap2DToTAS(const Tap2Dv1 * t2d) const
 {
-    float tas = (1.0e6 / (1.0 - ((float)t2d->ntap / 255))) * getResolution();
+    float tas;
+    if (t2d->ntap < _tapTASv1.size())
+        tas = _tapTASv1[t2d->ntap];
+    else
+        tas = (1.0e6 / (1.0 - ((float)t2d->ntap / 255))) * getResolution();
 
     if (t2d->div10 == 1)
         tas /= 10.0;
@@ -297,8 +377,9 @@ void TwoD_USB::printStatus(std::ostream& ostr)
 		fixed << setprecision(1) << imagePerSec <<
 		",lost=" << status.lostImages << ",lostSOR=" << status.lostSORs <<
 		",lostTAS=" << status.lostTASs << ", urbErrs=" << status.urbErrors <<
-                ",TAS=" << setprecision(0) << _trueAirSpeed << "m/s" <<
-		"</td></tr>" << endl;
+                ",TAS=" << setprecision(0) << _trueAirSpeed << "m/s";
+        printStatusFields(ostr);
+        ostr << "</td></tr>" << endl;
     }
     catch(const n_u::IOException& ioe) {
         ostr << "<td>" << ioe.what() << "</td></tr>" << endl;
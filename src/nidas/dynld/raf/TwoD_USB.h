@@ -36,6 +36,8 @@
 
 #include <nidas/linux/usbtwod/usbtwod.h>
 
+#include <vector>
+
 namespace nidas { namespace dynld { namespace raf {
 
 using namespace nidas::core;
@@ -126,6 +128,23 @@ protected:
      */
     virtual void sendTrueAirspeed(float tas);
 
+    /**
+     * Build the tables of the true airspeed encoding for the probe
+     * resolution, which is known once init_parameters() has been called.
+     */
+    void buildTASTables();
+
+    /**
+     * Encode a true airspeed without the tables.  Sets t2d->ntap
+     * and t2d->div10, and returns -EINVAL if tas is too low.
+     */
+    int encodeTAS(Tap2D * t2d, double tas) const;
+
+    /**
+     * Append the status of a subclass to the line of printStatus().
+     */
+    virtual void printStatusFields(std::ostream&) {}
+
     /**
      * How often to send the true air speed.
      * Probes also send back the shadowOR when they receive
@@ -157,6 +176,23 @@ protected:
 
     static const float DefaultTrueAirspeed;
 
+    /**
+     * The encodings of the true airspeeds from DefaultTrueAirspeed up
+     * to TASTableMax, in _tasTaps, and the lowest airspeed of each,
+     * in increasing order, in _tasLimits.
+     */
+    std::vector<double> _tasLimits;
+    std::vector<Tap2D> _tasTaps;
+
+    /**
+     * True airspeed of each ntap of a Tap2D, before the divide
+     * by 10, and the same for the first generation Tap2Dv1.
+     */
+    std::vector<float> _tapTAS;
+    std::vector<float> _tapTASv1;
+
+    static const float TASTableMax;
+
 private:
 
     /** No copying. */
@@ -34,6 +34,7 @@
 #include <nidas/util/UTime.h>
 #include <nidas/util/IOTimeoutException.h>
 
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 
@@ -45,7 +46,6 @@ namespace n_u = nidas::util;
 
 NIDAS_CREATOR_FUNCTION_NS(raf,UHSAS_Serial)
 
-const n_u::EndianConverter* UHSAS_Serial::fromLittle = n_u::EndianConverter::getConverter(n_u::EndianConverter::EC_LITTLE_ENDIAN);
 
 static const unsigned char setup_pkt[] =
 	{
@@ -525,14 +525,14 @@ bool UHSAS_Serial::process(const Sample* samp,list<const Sample*>& results)
         // If user asked for 100 values, add a bogus zeroth bin for historical reasons
         if (_nOutBins == _nValidChannels + 1) *dout++ = 0.0;
 
-        int sum = 0;
         // UHSAS puts out largest bins first
-        for (int iout = _nValidChannels-1; iout >= 0; --iout) {
-           int c = fromLittle->uint16Value(histoPtr);
-           histoPtr += sizeof(short);
-           sum += c;
-           dout[iout] = (float)c;
-        }
+        n_u::LittleEndianIn::uint16ToFloat(histoPtr, dout, _nValidChannels);
+        histoPtr += _nValidChannels * sizeof(short);
+        std::reverse(dout, dout + _nValidChannels);
+
+        int sum = 0;
+        for (int iout = 0; iout < _nValidChannels; ++iout)
+            sum += (int)dout[iout];
         dout += _nValidChannels;
         ivar++;
 
@@ -549,7 +549,7 @@ bool UHSAS_Serial::process(const Sample* samp,list<const Sample*>& results)
         // cerr << "house=";
         for (int iout = 0; iout < nhouse; ++iout) {
             if (iout != 8 && iout < 10) {
-                int c = fromLittle->uint16Value(housePtr);
+                int c = n_u::LittleEndianIn::uint16Value(housePtr);
                 // cerr << setw(6) << c;
                 double d = (float)c / _hkScale[iout];
 
@@ -74,8 +74,6 @@ public:
 
 private:
 
-    static const nidas::util::EndianConverter * fromLittle;
-
     /**
      * Total number of floats in the processed output sample.
      */
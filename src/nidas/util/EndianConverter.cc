@@ -115,3 +115,149 @@ const EndianConverter* EndianConverter::getConverter(
 {
     return getConverter(input,getHostEndianness());
 }
+
+namespace {
+
+const bool hostBigEndian = __BYTE_ORDER == __BIG_ENDIAN;
+
+/*
+ * GCC and clang vector extensions, which are compiled to SSE2 on x86
+ * and NEON on ARM, or to scalar code otherwise.  Bytes are swapped
+ * with shifts, which don't need the byte shuffles of SSSE3 or AVX,
+ * and so work with the default compiler flags.
+ * __builtin_convertvector appeared in GCC 9.
+ */
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9)
+#define ENDIAN_VECTORS
+typedef uint16_t v8u16 __attribute__((vector_size(16)));
+typedef int16_t v8i16 __attribute__((vector_size(16)));
+typedef int32_t v8i32 __attribute__((vector_size(32)));
+typedef float v8f __attribute__((vector_size(32)));
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+typedef int32_t v4i32 __attribute__((vector_size(16)));
+typedef float v4f __attribute__((vector_size(16)));
+
+inline v8u16 swap16(v8u16 u)
+{
+    return (u << 8) | (u >> 8);
+}
+
+inline v4u32 swap32(v4u32 u)
+{
+    return (u << 24) | ((u & 0xff00) << 8) | ((u >> 8) & 0xff00) | (u >> 24);
+}
+#endif
+
+}
+
+namespace nidas { namespace util {
+
+template <EndianConverter::endianness E>
+void EndianIn<E>::int16ToFloat(const void* p, float* out, unsigned int n,
+    float scale, float offset)
+{
+    const char* cp = (const char*) p;
+    unsigned int i = 0;
+#ifdef ENDIAN_VECTORS
+    const bool flip = (E == EndianConverter::EC_BIG_ENDIAN) != hostBigEndian;
+    for ( ; i + 8 <= n; i += 8) {
+        v8u16 u;
+        ::memcpy(&u, cp + i * 2, sizeof(u));
+        if (flip) u = swap16(u);
+        v8i32 iv = __builtin_convertvector((v8i16) u, v8i32);
+        v8f f = __builtin_convertvector(iv, v8f) * scale + offset;
+        ::memcpy(out + i, &f, sizeof(f));
+    }
+#endif
+    for ( ; i < n; i++)
+        out[i] = int16Value(cp + i * 2) * scale + offset;
+}
+
+template <EndianConverter::endianness E>
+void EndianIn<E>::uint16ToFloat(const void* p, float* out, unsigned int n,
+    float scale, float offset)
+{
+    const char* cp = (const char*) p;
+    unsigned int i = 0;
+#ifdef ENDIAN_VECTORS
+    const bool flip = (E == EndianConverter::EC_BIG_ENDIAN) != hostBigEndian;
+    for ( ; i + 8 <= n; i += 8) {
+        v8u16 u;
+        ::memcpy(&u, cp + i * 2, sizeof(u));
+        if (flip) u = swap16(u);
+        v8i32 iv = __builtin_convertvector(u, v8i32);
+        v8f f = __builtin_convertvector(iv, v8f) * scale + offset;
+        ::memcpy(out + i, &f, sizeof(f));
+    }
+#endif
+    for ( ; i < n; i++)
+        out[i] = uint16Value(cp + i * 2) * scale + offset;
+}
+
+template <EndianConverter::endianness E>
+void EndianIn<E>::int32ToFloat(const void* p, float* out, unsigned int n,
+    float scale, float offset)
+{
+    const char* cp = (const char*) p;
+    unsigned int i = 0;
+#ifdef ENDIAN_VECTORS
+    const bool flip = (E == EndianConverter::EC_BIG_ENDIAN) != hostBigEndian;
+    for ( ; i + 4 <= n; i += 4) {
+        v4u32 u;
+        ::memcpy(&u, cp + i * 4, sizeof(u));
+        if (flip) u = swap32(u);
+        v4f f = __builtin_convertvector((v4i32) u, v4f) * scale + offset;
+        ::memcpy(out + i, &f, sizeof(f));
+    }
+#endif
+    for ( ; i < n; i++)
+        out[i] = int32Value(cp + i * 4) * scale + offset;
+}
+
+template <EndianConverter::endianness E>
+void EndianIn<E>::uint32ToFloat(const void* p, float* out, unsigned int n,
+    float scale, float offset)
+{
+    const char* cp = (const char*) p;
+    unsigned int i = 0;
+#ifdef ENDIAN_VECTORS
+    const bool flip = (E == EndianConverter::EC_BIG_ENDIAN) != hostBigEndian;
+    for ( ; i + 4 <= n; i += 4) {
+        v4u32 u;
+        ::memcpy(&u, cp + i * 4, sizeof(u));
+        if (flip) u = swap32(u);
+        v4f f = __builtin_convertvector(u, v4f) * scale + offset;
+        ::memcpy(out + i, &f, sizeof(f));
+    }
+#endif
+    for ( ; i < n; i++)
+        out[i] = uint32Value(cp + i * 4) * scale + offset;
+}
+
+template <EndianConverter::endianness E>
+void EndianIn<E>::floatToFloat(const void* p, float* out, unsigned int n)
+{
+    const bool flip = (E == EndianConverter::EC_BIG_ENDIAN) != hostBigEndian;
+    if (!flip) {
+        ::memcpy(out, p, n * sizeof(float));
+        return;
+    }
+    const char* cp = (const char*) p;
+    unsigned int i = 0;
+#ifdef ENDIAN_VECTORS
+    for ( ; i + 4 <= n; i += 4) {
+        v4u32 u;
+        ::memcpy(&u, cp + i * 4, sizeof(u));
+        u = swap32(u);
+        ::memcpy(out + i, &u, sizeof(u));
+    }
+#endif
+    for ( ; i < n; i++)
+        out[i] = floatValue(cp + i * 4);
+}
+
+template class EndianIn<EndianConverter::EC_BIG_ENDIAN>;
+
+template class EndianIn<EndianConverter::EC_LITTLE_ENDIAN>;
+
+}}	// namespace nidas namespace util
@@ -29,6 +29,8 @@
 
 #include <cstring> // memcpy
 #include <stdint.h>
+#include <endian.h>
+#include <byteswap.h>
 
 #include "ThreadSupport.h"
 
@@ -292,6 +294,93 @@ inline void flipUint16Out(const uint16_t& v,void *p)
     cp[1] = u.b[0];
 }
 
+/**
+ * Functions for reading a big-endian value from an address and
+ * returning it in host byte order. Address does not need to be aligned.
+ * The host byte order is known at compile time, so unlike the virtual
+ * methods of an EndianConverter these are inlined, for use in loops
+ * over binary data.
+ */
+inline uint16_t bigUint16In(const void* p)
+{
+    uint16_t v;
+    ::memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    v = bswap_16(v);
+#endif
+    return v;
+}
+
+inline int16_t bigInt16In(const void* p)
+{
+    return (int16_t) bigUint16In(p);
+}
+
+inline uint32_t bigUint32In(const void* p)
+{
+    uint32_t v;
+    ::memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    v = bswap_32(v);
+#endif
+    return v;
+}
+
+inline int32_t bigInt32In(const void* p)
+{
+    return (int32_t) bigUint32In(p);
+}
+
+inline float bigFloatIn(const void* p)
+{
+    uint32_t v = bigUint32In(p);
+    float f;
+    ::memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+/**
+ * Functions for reading a little-endian value from an address and
+ * returning it in host byte order. Address does not need to be aligned.
+ */
+inline uint16_t littleUint16In(const void* p)
+{
+    uint16_t v;
+    ::memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER == __BIG_ENDIAN
+    v = bswap_16(v);
+#endif
+    return v;
+}
+
+inline int16_t littleInt16In(const void* p)
+{
+    return (int16_t) littleUint16In(p);
+}
+
+inline uint32_t littleUint32In(const void* p)
+{
+    uint32_t v;
+    ::memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER == __BIG_ENDIAN
+    v = bswap_32(v);
+#endif
+    return v;
+}
+
+inline int32_t littleInt32In(const void* p)
+{
+    return (int32_t) littleUint32In(p);
+}
+
+inline float littleFloatIn(const void* p)
+{
+    uint32_t v = littleUint32In(p);
+    float f;
+    ::memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
 /**
  * Virtual base class declaring methods for converting
  * numeric values between little-endian and big-endian representations,
@@ -694,6 +783,89 @@ public:
 #endif
     }
 };
+
+/**
+ * Conversions from a byte order which is known at compile time to the
+ * byte order of the host, for binary sensor data.  Unlike the virtual
+ * methods of EndianConverter, the single value methods are inlined,
+ * and there are methods which convert an array of values to floats,
+ * using vector instructions where the compiler supports them.
+ * Use the BigEndianIn and LittleEndianIn typedefs:
+ * @code
+ *     LittleEndianIn::uint16ToFloat(bufptr, dout, nbins);
+ * @endcode
+ * The addresses do not have to be aligned for the value type.
+ */
+template <EndianConverter::endianness E>
+class EndianIn
+{
+public:
+
+    static uint16_t uint16Value(const void* p)
+    {
+        return E == EndianConverter::EC_BIG_ENDIAN ?
+            bigUint16In(p) : littleUint16In(p);
+    }
+
+    static int16_t int16Value(const void* p)
+    {
+        return (int16_t) uint16Value(p);
+    }
+
+    static uint32_t uint32Value(const void* p)
+    {
+        return E == EndianConverter::EC_BIG_ENDIAN ?
+            bigUint32In(p) : littleUint32In(p);
+    }
+
+    static int32_t int32Value(const void* p)
+    {
+        return (int32_t) uint32Value(p);
+    }
+
+    static float floatValue(const void* p)
+    {
+        return E == EndianConverter::EC_BIG_ENDIAN ?
+            bigFloatIn(p) : littleFloatIn(p);
+    }
+
+    /**
+     * Convert n 2 byte signed integers at p to floats:
+     * out[i] = value[i] * scale + offset.
+     */
+    static void int16ToFloat(const void* p, float* out, unsigned int n,
+        float scale = 1.0, float offset = 0.0);
+
+    /**
+     * Convert n 2 byte unsigned integers at p to floats:
+     * out[i] = value[i] * scale + offset.
+     */
+    static void uint16ToFloat(const void* p, float* out, unsigned int n,
+        float scale = 1.0, float offset = 0.0);
+
+    /**
+     * Convert n 4 byte signed integers at p to floats:
+     * out[i] = value[i] * scale + offset.
+     */
+    static void int32ToFloat(const void* p, float* out, unsigned int n,
+        float scale = 1.0, float offset = 0.0);
+
+    /**
+     * Convert n 4 byte unsigned integers at p to floats:
+     * out[i] = value[i] * scale + offset.
+     */
+    static void uint32ToFloat(const void* p, float* out, unsigned int n,
+        float scale = 1.0, float offset = 0.0);
+
+    /**
+     * Convert n 4 byte IEEE floats at p to host floats.
+     */
+    static void floatToFloat(const void* p, float* out, unsigned int n);
+};
+
+typedef EndianIn<EndianConverter::EC_BIG_ENDIAN> BigEndianIn;
+
+typedef EndianIn<EndianConverter::EC_LITTLE_ENDIAN> LittleEndianIn;
+
 }}	// namespace nidas namespace util
 #endif
-
@@ -317,6 +317,23 @@ void Cond::wait()
     pthread_cleanup_pop(0);
 }
 
+bool Cond::timedWait(const struct timespec& abstime)
+{
+    int res;
+
+    // On thread cancellation, make sure the mutex is left unlocked.
+    pthread_cleanup_push(thread_mutex_unlock, _mutex.ptr());
+
+    res = ::pthread_cond_timedwait (&_p_cond, _mutex.ptr(), &abstime);
+
+    // thread was not canceled, don't want to unlock, so do a pop(0)
+    pthread_cleanup_pop(0);
+
+    if (res == ETIMEDOUT) return false;
+    if (res) throw Exception("Cond::timedWait",res);
+    return true;
+}
+
 RWLock::RWLock() throw(): _p_rwlock(),_attrs()
 {
     /* Can fail:
@@ -360,6 +360,16 @@ public:
      **/
     void wait();
 
+    /**
+     * Wait on the condition variable as in wait(), but no later
+     * than an absolute time of the CLOCK_REALTIME clock.
+     * @return false if the time was reached without the condition
+     *    variable being signalled. The mutex is locked in either case.
+     *
+     * @throws Exception
+     **/
+    bool timedWait(const struct timespec& abstime);
+
 private:
     /**
      * No assignment allowed.
@@ -0,0 +1,195 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/linux/arinc/arinc.h>
+#include <nidas/dynld/raf/DSMArincSensor.h>
+#include <nidas/core/Parameter.h>
+#include <nidas/core/Variable.h>
+
+#include <fcntl.h>
+
+#include <cmath>
+#include <list>
+#include <vector>
+
+using namespace nidas::core;
+using namespace nidas::dynld::raf;
+
+namespace {
+
+/**
+ * An ARINC sensor whose label value is the data bits above the label,
+ * and which records its ioctls instead of sending them to a driver.
+ */
+class TestArinc: public DSMArincSensor
+{
+public:
+  TestArinc(): configs(), nopen(0)
+  {
+    setDSMId(1);
+    setSensorId(1000);
+    setDeviceName("/dev/null");
+  }
+
+  double processLabel(const int data, sampleType*)
+  {
+    return data >> 8;
+  }
+
+  void ioctl(int request, void* buf, size_t)
+  {
+    if (request == (int)ARINC_SET)
+      configs.push_back(*(arcfg_t*)buf);
+    else if (request == (int)ARINC_OPEN)
+      nopen++;
+  }
+
+  void addLabel(unsigned int label, float rate)
+  {
+    SampleTag* stag = new SampleTag(this);
+    stag->setSampleId(label);
+    stag->setRate(rate);
+    Variable* var = new Variable();
+    var->setName("L" + std::to_string(label));
+    stag->addVariable(var);
+    addSampleTag(stag);
+  }
+
+  void packLabels()
+  {
+    ParameterT<bool>* param = new ParameterT<bool>();
+    param->setName("packLabels");
+    param->setValue(true);
+    addParameter(param);
+  }
+
+  std::vector<arcfg_t> configs;
+  int nopen;
+};
+
+const SampleTag*
+findTag(DSMSensor& sensor, unsigned int sampleId)
+{
+  std::list<SampleTag*>& tags = sensor.getSampleTags();
+  std::list<SampleTag*>::const_iterator ti = tags.begin();
+  for ( ; ti != tags.end(); ++ti)
+    if ((*ti)->getSampleId() == sampleId) return *ti;
+  return 0;
+}
+
+/**
+ * A raw sample of labels with values, one millisecond apart.
+ */
+Sample*
+rawSample(dsm_time_t tt, const std::vector<unsigned int>& labels,
+          const std::vector<int>& values)
+{
+  SampleT<char>* samp = getSample<char>(labels.size() * sizeof(tt_data_t));
+  samp->setTimeTag(tt);
+  tt_data_t* fields = (tt_data_t*) samp->getVoidDataPtr();
+  int msec = (tt % USECS_PER_DAY) / USECS_PER_MSEC;
+  for (unsigned int i = 0; i < labels.size(); ++i)
+  {
+    fields[i].time = msec + i;
+    fields[i].data = (values[i] << 8) | labels[i];
+  }
+  return samp;
+}
+
+void
+freeSamples(std::list<const Sample*>& results)
+{
+  std::list<const Sample*>::const_iterator si = results.begin();
+  for ( ; si != results.end(); ++si) (*si)->freeReference();
+  results.clear();
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_arinc_packed_config)
+{
+  TestArinc arinc;
+  arinc.addLabel(0310, 50);
+  arinc.addLabel(0311, 50);
+  arinc.addLabel(0100, 10);
+  arinc.packLabels();
+  arinc.validate();
+  arinc.init();
+
+  // one packed sample per rate, highest rate first, whose variables
+  // are those of its labels, in order of label
+  const SampleTag* fast = findTag(arinc, NLABELS);
+  const SampleTag* slow = findTag(arinc, NLABELS + 1);
+  BOOST_REQUIRE(fast);
+  BOOST_REQUIRE(slow);
+  BOOST_CHECK_EQUAL(fast->getRate(), 50);
+  BOOST_CHECK_EQUAL(slow->getRate(), 10);
+  BOOST_REQUIRE_EQUAL(fast->getVariables().size(), 2);
+  BOOST_CHECK_EQUAL(fast->getVariables()[0]->getName(), "L200");
+  BOOST_CHECK_EQUAL(fast->getVariables()[1]->getName(), "L201");
+  BOOST_REQUIRE_EQUAL(slow->getVariables().size(), 1);
+  BOOST_CHECK_EQUAL(slow->getVariables()[0]->getName(), "L64");
+  BOOST_CHECK(fast->isProcessed());
+  BOOST_CHECK(!findTag(arinc, 0310)->isProcessed());
+  BOOST_CHECK(!findTag(arinc, 0100)->isProcessed());
+
+  // only the labels are configured in the driver, not the packed samples
+  arinc.open(O_RDONLY);
+  BOOST_REQUIRE_EQUAL(arinc.configs.size(), 3);
+  BOOST_CHECK_EQUAL(arinc.configs[0].label, 0310);
+  BOOST_CHECK_EQUAL(arinc.configs[0].rate, 50);
+  BOOST_CHECK_EQUAL(arinc.configs[1].label, 0311);
+  BOOST_CHECK_EQUAL(arinc.configs[1].rate, 50);
+  BOOST_CHECK_EQUAL(arinc.configs[2].label, 0100);
+  BOOST_CHECK_EQUAL(arinc.configs[2].rate, 10);
+  for (unsigned int i = 0; i < arinc.configs.size(); ++i)
+    BOOST_CHECK((unsigned short)arinc.configs[i].label < NLABELS);
+  BOOST_CHECK_EQUAL(arinc.nopen, 1);
+  arinc.close();
+}
+
+BOOST_AUTO_TEST_CASE(test_arinc_packed_repeat)
+{
+  TestArinc arinc;
+  arinc.addLabel(0310, 50);
+  arinc.addLabel(0311, 50);
+  arinc.addLabel(0100, 10);
+  arinc.packLabels();
+  arinc.validate();
+  arinc.init();
+
+  // 0310 is repeated in the raw sample, so its first value must
+  // not be overwritten by the second
+  dsm_time_t tt = 1700000000LL * USECS_PER_SEC;
+  std::vector<unsigned int> labels = { 0310, 0311, 0310, 0100 };
+  std::vector<int> values = { 1, 2, 3, 4 };
+  Sample* raw = rawSample(tt, labels, values);
+  std::list<const Sample*> results;
+  arinc.process(raw, results);
+  raw->freeReference();
+
+  BOOST_REQUIRE_EQUAL(results.size(), 3);
+  std::list<const Sample*>::const_iterator si = results.begin();
+  const Sample* samp = *si++;
+  BOOST_CHECK_EQUAL(samp->getId(), findTag(arinc, NLABELS)->getId());
+  BOOST_CHECK_EQUAL(samp->getTimeTag(), tt);
+  BOOST_REQUIRE_EQUAL(samp->getDataLength(), 2);
+  BOOST_CHECK_EQUAL(samp->getDataValue(0), 1);
+  BOOST_CHECK_EQUAL(samp->getDataValue(1), 2);
+
+  samp = *si++;
+  BOOST_CHECK_EQUAL(samp->getId(), findTag(arinc, NLABELS)->getId());
+  BOOST_CHECK_EQUAL(samp->getTimeTag(), tt + 2 * USECS_PER_MSEC);
+  BOOST_REQUIRE_EQUAL(samp->getDataLength(), 2);
+  BOOST_CHECK_EQUAL(samp->getDataValue(0), 3);
+  BOOST_CHECK(std::isnan(samp->getDataValue(1)));
+
+  samp = *si++;
+  BOOST_CHECK_EQUAL(samp->getId(), findTag(arinc, NLABELS + 1)->getId());
+  BOOST_REQUIRE_EQUAL(samp->getDataLength(), 1);
+  BOOST_CHECK_EQUAL(samp->getDataValue(0), 4);
+  freeSamples(results);
+}
@@ -0,0 +1,27 @@
+// -*- mode: C++; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4; -*-
+// vim: set shiftwidth=4 softtabstop=4 expandtab:
+
+#ifndef NIDAS_TESTS_BENCHMARK_H
+#define NIDAS_TESTS_BENCHMARK_H
+
+/*
+ * Timing of the benchmark_* test cases.
+ *
+ * The benchmarks only report their rates, and never fail on them,
+ * since the rates depend on the host and on its load.
+ */
+
+#include <ctime>
+
+/**
+ * Seconds since t0, which was read from CLOCK_MONOTONIC.
+ */
+inline double
+elapsed(const struct timespec& t0)
+{
+    struct timespec t1;
+    ::clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1.e-9;
+}
+
+#endif
@@ -0,0 +1,223 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/core/ClockModel.h>
+#include <nidas/core/Parameter.h>
+#include <nidas/core/TimetagAdjuster.h>
+#include <nidas/core/Variable.h>
+#include <nidas/dynld/raf/IRIGSensor.h>
+#include <nidas/linux/irig/pc104sg.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <vector>
+
+#include <stddef.h>
+
+using namespace nidas::core;
+using nidas::dynld::raf::IRIGSensor;
+
+namespace {
+
+const dsm_time_t T0 = (dsm_time_t) 1700000000 * USECS_PER_SEC;
+
+/**
+ * A system clock which is OFFSET usecs behind the reference,
+ * and drifts DRIFT usecs per second further behind.
+ */
+const long long OFFSET = 250 * USECS_PER_MSEC;
+const double DRIFT = 20.0;
+
+dsm_time_t
+systemTime(dsm_time_t reftime)
+{
+    return reftime - OFFSET -
+        (dsm_time_t)::rint(DRIFT * (reftime - T0) / USECS_PER_SEC);
+}
+
+/**
+ * Uniform noise in [0, max) usecs, repeatable across runs.
+ */
+int
+noise(int max)
+{
+    static unsigned int seed = 1;
+    seed = seed * 1103515245 + 12345;
+    return (seed / 65536) % max;
+}
+
+/**
+ * A raw sample from an IRIG card, in the dsm_clock_data_3 format,
+ * of the reference time and the system time it was read.
+ */
+Sample*
+irigSample(dsm_time_t reftime, unsigned char status)
+{
+    dsm_time_t irigt = reftime + noise(40) - 20;
+    dsm_time_t unixt = systemTime(reftime);
+
+    SampleT<char>* samp = getSample<char>(offsetof(dsm_clock_data_3, end));
+    ::memset(samp->getVoidDataPtr(), 0, samp->getDataByteLength());
+    dsm_clock_data_3* dp = (dsm_clock_data_3*) samp->getVoidDataPtr();
+    IRIGSensor::lecvtr->int64Copy(irigt, &dp->irigt);
+    IRIGSensor::lecvtr->int64Copy(unixt, &dp->unixt);
+    dp->dummystatus = 0xff;
+    dp->status = status;
+    samp->setTimeTag(unixt);
+    return samp;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(test_clock_model_fit)
+{
+    ClockModel model;
+    BOOST_CHECK(!model.isValid());
+    BOOST_CHECK_EQUAL(model.correct(T0), T0);
+
+    for (int i = 0; i < 120; i++) {
+        dsm_time_t reftime = T0 + i * USECS_PER_SEC;
+        model.addObservation(systemTime(reftime), reftime + noise(40) - 20);
+    }
+    BOOST_CHECK(model.isValid());
+    BOOST_CHECK_EQUAL(model.getNumObservations(), model.getMaxObservations());
+    BOOST_CHECK_CLOSE(model.getDriftPPM(), DRIFT, 5.0);
+
+    // corrections of past and extrapolated times
+    for (int i = 60; i < 180; i += 10) {
+        dsm_time_t reftime = T0 + i * USECS_PER_SEC;
+        BOOST_CHECK(::llabs(model.correct(systemTime(reftime)) - reftime) < 30);
+    }
+
+    // a batch gives the same corrections
+    std::vector<dsm_time_t> tt;
+    for (int i = 0; i < 1000; i++)
+        tt.push_back(systemTime(T0 + i * USECS_PER_SEC / 7));
+    std::vector<dsm_time_t> batch(tt);
+    model.correct(&batch.front(), batch.size());
+    for (unsigned int i = 0; i < tt.size(); i++)
+        BOOST_CHECK_EQUAL(batch[i], model.correct(tt[i]));
+}
+
+BOOST_AUTO_TEST_CASE(test_clock_model_outliers)
+{
+    ClockModel model;
+    int i = 0;
+    for ( ; i < 10; i++) {
+        dsm_time_t reftime = T0 + i * USECS_PER_SEC;
+        model.addObservation(systemTime(reftime), reftime);
+    }
+    double offset = model.getOffsetSecs();
+
+    // a single outlier is rejected
+    dsm_time_t reftime = T0 + i++ * USECS_PER_SEC;
+    model.addObservation(systemTime(reftime), reftime + USECS_PER_SEC);
+    BOOST_CHECK_EQUAL(model.getNumRejected(), 1u);
+    BOOST_CHECK_EQUAL(model.getNumObservations(), 10u);
+    BOOST_CHECK_EQUAL(model.getOffsetSecs(), offset);
+
+    // a step of the reference clock restarts the model
+    for (unsigned int n = 1; n < ClockModel::MAX_CONSECUTIVE_REJECTS; n++) {
+        reftime = T0 + i++ * USECS_PER_SEC;
+        model.addObservation(systemTime(reftime), reftime + USECS_PER_SEC);
+    }
+    BOOST_CHECK_EQUAL(model.getNumObservations(), 1u);
+    BOOST_CHECK(!model.isValid());
+    for (int n = 0; n < 5; n++) {
+        reftime = T0 + i++ * USECS_PER_SEC;
+        model.addObservation(systemTime(reftime), reftime + USECS_PER_SEC);
+    }
+    BOOST_CHECK(model.isValid());
+    BOOST_CHECK_CLOSE(model.getOffsetSecs(), offset + 1.0, 0.1);
+
+    // system clock going backwards also restarts it
+    model.addObservation(systemTime(T0), T0);
+    BOOST_CHECK_EQUAL(model.getNumObservations(), 1u);
+}
+
+/*
+ * Replay IRIG samples, one per second, through an IRIGSensor which
+ * feeds the shared ClockModel of its DSM, interleaved with 10 Hz samples
+ * from another sensor on the DSM, whose time tags from the system
+ * clock have a varying latency.
+ */
+BOOST_AUTO_TEST_CASE(test_irig_replay)
+{
+    const unsigned int dsmid = 7;
+
+    IRIGSensor irig;
+    irig.setDSMId(dsmid);
+    SampleTag* stag = new SampleTag(&irig);
+    Variable* var = new Variable();
+    var->setName("Clock");
+    stag->addVariable(var);
+    irig.addSampleTag(stag);
+    ParameterT<bool>* param = new ParameterT<bool>();
+    param->setName("CLOCK_MODEL");
+    param->setValue(true);
+    irig.addParameter(param);
+    irig.init();
+
+    dsm_sample_id_t id = SET_DSM_ID(SET_SPS_ID(0, 101), dsmid);
+    const double rate = 10.0;
+    TimetagAdjuster single(id, rate);
+    TimetagAdjuster batch(id, rate);
+    TimetagAdjuster uncorrected(id, rate);
+    uncorrected.setClockModel(0);
+    ClockModel* model = ClockModel::getInstance(dsmid);
+    BOOST_CHECK_EQUAL(single.getClockModel(), model);
+    model->setMaxObservations(1000);
+
+    const int nsecs = 120;
+    double maxerr = 0.0;
+    double maxerrUncorr = 0.0;
+
+    for (int isec = 0; isec < nsecs; isec++) {
+        dsm_time_t reftime = T0 + isec * USECS_PER_SEC;
+
+        std::list<const Sample*> results;
+        Sample* samp = irigSample(reftime,
+            (isec % 30 == 29) ? CLOCK_STATUS_NOSYNC : 0);
+        irig.process(samp, results);
+        samp->freeReference();
+        std::list<const Sample*>::const_iterator ri = results.begin();
+        for ( ; ri != results.end(); ++ri) (*ri)->freeReference();
+
+        // the 10 samples of the next second
+        std::vector<dsm_time_t> sampleTimes;
+        std::vector<dsm_time_t> tt;
+        for (int i = 0; i < rate; i++) {
+            dsm_time_t ts = reftime + i * USECS_PER_SEC / rate;
+            sampleTimes.push_back(ts);
+            tt.push_back(systemTime(ts) + noise(5 * USECS_PER_MSEC));
+        }
+
+        std::vector<dsm_time_t> tbatch(tt);
+        batch.adjust(&tbatch.front(), tbatch.size());
+
+        for (unsigned int i = 0; i < tt.size(); i++) {
+            dsm_time_t tadj = single.adjust(tt[i]);
+            BOOST_CHECK_EQUAL(tadj, tbatch[i]);
+            dsm_time_t tuncorr = uncorrected.adjust(tt[i]);
+            if (isec >= 10) {
+                maxerr = std::max(maxerr,
+                    (double)::llabs(tadj - sampleTimes[i]) / USECS_PER_SEC);
+                maxerrUncorr = std::max(maxerrUncorr,
+                    (double)::llabs(tuncorr - sampleTimes[i]) / USECS_PER_SEC);
+            }
+        }
+    }
+
+    // the observations of unsynced samples are not used
+    BOOST_CHECK_EQUAL(model->getNumObservations(), 116u);
+    BOOST_CHECK_CLOSE(model->getDriftPPM(), DRIFT, 5.0);
+
+    BOOST_CHECK_LT(maxerr, 0.006);
+    BOOST_CHECK_GT(maxerrUncorr, 0.9 * OFFSET / USECS_PER_SEC);
+
+    ClockModel::deleteInstances();
+}
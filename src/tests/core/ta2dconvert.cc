@@ -0,0 +1,392 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/dynld/A2DSensor.h>
+#include <nidas/dynld/raf/DSMAnalogSensor.h>
+#include <nidas/core/Parameter.h>
+#include <nidas/core/A2DConverter.h>
+#include <nidas/core/SampleTag.h>
+#include <nidas/core/Variable.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include "../benchmark.h"
+
+using namespace nidas::core;
+using nidas::dynld::A2DSensor;
+using nidas::dynld::raf::DSMAnalogSensor;
+
+namespace {
+
+const int NCHAN = 8;
+
+/**
+ * An A2DSensor with a linear initial conversion and a polynomial
+ * final conversion, which exposes the conversion of samples.
+ * Channels 6 and 7 are not linear: channel 6 has a quadratic
+ * calibration and channel 7 is flagged by isLinearChannel().
+ */
+class TestA2D: public A2DSensor
+{
+public:
+    TestA2D():
+        A2DSensor(NCHAN), _initial(NCHAN), _final(NCHAN, 3),
+        _tag(), _info(NCHAN)
+    {
+        for (int i = 0; i < NCHAN; i++) {
+            float lin[2] = { -10.0f + i, 20.0f / 65536 };
+            _initial.set(i, lin, 2);
+            float cal[3] = { 0.5f * i, 1.0f + 0.01f * i, 0.0f };
+            if (i == 6) cal[2] = 0.002f;
+            _final.set(i, cal, 3);
+
+            Variable* var = new Variable();
+            _tag.addVariable(var);
+            _info.channels[i] = i;
+        }
+        _info.nvalues = NCHAN;
+        _info.stag = &_tag;
+    }
+
+    A2DConverter* getInitialConverter() const
+    {
+        return const_cast<LinearA2DConverter*>(&_initial);
+    }
+
+    A2DConverter* getFinalConverter() const
+    {
+        return const_cast<PolyA2DConverter*>(&_final);
+    }
+
+    void getDefaultConversion(int, float& intercept, float& slope) const
+    {
+        intercept = 0.0;
+        slope = 1.0;
+    }
+
+    IODevice* buildIODevice() { return 0; }
+
+    SampleScanner* buildSampleScanner() { return 0; }
+
+    bool isLinearChannel(int ichan) const { return ichan != 7; }
+
+    float convertValue(int ichan, short sval)
+    {
+        return A2DSensor::convertValue(ichan, sval) + (ichan == 7 ? 1.0 : 0.0);
+    }
+
+    /**
+     * Convert n counts as A2DSensor::process() did before the
+     * conversions were fused, one value at a time.
+     */
+    void convertEach(const short* sp, float* fp, int n)
+    {
+        for (int i = 0; i < n; i++) {
+            short sval = sp[i];
+            if (sval == -32768 || sval == 32767) fp[i] = floatNAN;
+            else fp[i] = convertValue(i % NCHAN, sval);
+        }
+    }
+
+    void convertFused(const short* sp, float* fp, int n)
+    {
+        updateConversions(_info);
+        convertSample(_info, sp, fp, n);
+    }
+
+    /**
+     * Add the sample of the NCHAN channels, as validate() would.
+     */
+    void addSampleInfo()
+    {
+        _tag.setSampleId(1);
+        _sampleInfos.push_back(_info);
+    }
+
+    LinearA2DConverter _initial;
+
+    PolyA2DConverter _final;
+
+private:
+    SampleTag _tag;
+
+    A2DSampleInfo _info;
+};
+
+/**
+ * A DSMAnalogSensor which exposes its conversion of one value.
+ */
+class TestAnalog: public DSMAnalogSensor
+{
+public:
+    TestAnalog()
+    {
+        setDSMId(1);
+        setSensorId(200);
+        setDeviceName("/dev/ncar_a2d0");
+    }
+
+    using DSMAnalogSensor::convertValue;
+};
+
+Variable*
+newA2DVariable(int ichan, int gain, int bipolar)
+{
+    Variable* var = new Variable();
+    ParameterT<int>* param = new ParameterT<int>();
+    param->setName("channel");
+    param->setValue(ichan);
+    var->addParameter(param);
+    param = new ParameterT<int>();
+    param->setName("gain");
+    param->setValue(gain);
+    var->addParameter(param);
+    param = new ParameterT<int>();
+    param->setName("bipolar");
+    param->setValue(bipolar);
+    var->addParameter(param);
+    return var;
+}
+
+/**
+ * Pass a raw sample of counts to a sensor's process(),
+ * returning the one sample it outputs.
+ */
+const Sample*
+processCounts(DSMSensor& sensor, const std::vector<short>& counts)
+{
+    SampleT<short>* raw = getSample<short>(counts.size());
+    std::copy(counts.begin(), counts.end(), raw->getDataPtr());
+    raw->setTimeTag(1000000);
+    std::list<const Sample*> results;
+    sensor.process(raw, results);
+    raw->freeReference();
+    BOOST_REQUIRE_EQUAL(results.size(), 1);
+    return results.front();
+}
+
+std::vector<short>
+makeCounts(int n)
+{
+    std::vector<short> counts(n);
+    ::srandom(n);
+    for (int i = 0; i < n; i++) counts[i] = (short)(::random() % 65536 - 32768);
+    counts[1] = -32768;
+    counts[2] = 32767;
+    return counts;
+}
+
+void
+checkClose(const float* fp1, const float* fp2, int n)
+{
+    for (int i = 0; i < n; i++) {
+        if (std::isnan(fp2[i])) BOOST_CHECK(std::isnan(fp1[i]));
+        // the fused conversion rounds differently, which is
+        // a large relative error for values near zero
+        else BOOST_CHECK_SMALL(fp1[i] - fp2[i],
+            1.e-5f * std::max(1.0f, std::fabs(fp2[i])));
+    }
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_a2d_linear)
+{
+    LinearA2DConverter lin(2);
+    float d[2] = { 1.5, 2.0 };
+    lin.set(0, d, 2);
+    float b, m;
+    BOOST_CHECK(lin.getLinear(0, b, m));
+    BOOST_CHECK_EQUAL(b, 1.5);
+    BOOST_CHECK_EQUAL(m, 2.0);
+
+    PolyA2DConverter poly(2, 3);
+    unsigned int changes = poly.getChangeCount();
+    float c[3] = { 1.0, 3.0, 0.0 };
+    poly.set(0, c, 3);
+    BOOST_CHECK(poly.getChangeCount() != changes);
+    BOOST_CHECK(poly.getLinear(0, b, m));
+    BOOST_CHECK_EQUAL(b, 1.0);
+    BOOST_CHECK_EQUAL(m, 3.0);
+    c[2] = 0.1;
+    poly.set(1, c, 3);
+    BOOST_CHECK(!poly.getLinear(1, b, m));
+}
+
+BOOST_AUTO_TEST_CASE(test_a2d_fused)
+{
+    TestA2D a2d;
+    const int n = NCHAN * 100;
+    std::vector<short> counts = makeCounts(n);
+    std::vector<float> fused(NCHAN), each(NCHAN);
+
+    for (int i = 0; i < n; i += NCHAN) {
+        a2d.convertFused(&counts[i], &fused[0], NCHAN);
+        a2d.convertEach(&counts[i], &each[0], NCHAN);
+        checkClose(&fused[0], &each[0], NCHAN);
+    }
+
+    // a new calibration must be picked up
+    float cal[3] = { 100.0, 2.0, 0.0 };
+    a2d._final.set(3, cal, 3);
+    a2d.convertFused(&counts[0], &fused[0], NCHAN);
+    a2d.convertEach(&counts[0], &each[0], NCHAN);
+    checkClose(&fused[0], &each[0], NCHAN);
+
+    // a short sample
+    a2d.convertFused(&counts[0], &fused[0], 3);
+    checkClose(&fused[0], &each[0], 3);
+}
+
+BOOST_AUTO_TEST_CASE(test_a2d_process)
+{
+    TestA2D a2d;
+    a2d.addSampleInfo();
+    std::vector<short> counts = makeCounts(NCHAN);
+    std::vector<float> each(NCHAN);
+    a2d.convertEach(&counts[0], &each[0], NCHAN);
+
+    const Sample* samp = processCounts(a2d, counts);
+    BOOST_REQUIRE_EQUAL(samp->getDataLength(), NCHAN);
+    checkClose((const float*)samp->getConstVoidDataPtr(), &each[0], NCHAN);
+    samp->freeReference();
+
+    // a sample index before the counts
+    std::vector<short> indexed(1, 0);
+    indexed.insert(indexed.end(), counts.begin(), counts.end());
+    samp = processCounts(a2d, indexed);
+    BOOST_REQUIRE_EQUAL(samp->getDataLength(), NCHAN);
+    checkClose((const float*)samp->getConstVoidDataPtr(), &each[0], NCHAN);
+    samp->freeReference();
+
+    // missing values at the end of a short sample are NAN
+    std::vector<short> part(counts.begin(), counts.begin() + 5);
+    samp = processCounts(a2d, part);
+    BOOST_REQUIRE_EQUAL(samp->getDataLength(), NCHAN);
+    const float* fp = (const float*)samp->getConstVoidDataPtr();
+    checkClose(fp, &each[0], 5);
+    for (int i = 5; i < NCHAN; i++) BOOST_CHECK(std::isnan(fp[i]));
+    samp->freeReference();
+}
+
+BOOST_AUTO_TEST_CASE(test_analog_process)
+{
+    // channels of each gain, where gain 4 is not linear, because of
+    // its temperature compensation
+    const int gains[] = { 1, 4, 2, 4, 1, 2, 4, 1 };
+    const int bipolars[] = { 1, 0, 1, 1, 1, 0, 0, 1 };
+    const int nvars = sizeof(gains) / sizeof(gains[0]);
+
+    TestAnalog analog;
+    SampleTag* tag = new SampleTag(&analog);
+    tag->setSampleId(1);
+    tag->setRate(100);
+    for (int i = 0; i < nvars; i++)
+        tag->addVariable(newA2DVariable(i, gains[i], bipolars[i]));
+    analog.addSampleTag(tag);
+    analog.validate();
+
+    std::vector<short> counts = makeCounts(nvars);
+    counts[5] = 12000;
+    const Sample* samp = processCounts(analog, counts);
+    BOOST_REQUIRE_EQUAL(samp->getDataLength(), nvars);
+    const float* fp = (const float*)samp->getConstVoidDataPtr();
+    for (int i = 0; i < nvars; i++) {
+        if (counts[i] == -32768 || counts[i] == 32767) {
+            BOOST_CHECK(std::isnan(fp[i]));
+            continue;
+        }
+        BOOST_CHECK_CLOSE(fp[i], analog.convertValue(i, counts[i]), 1.e-3);
+        float volts = counts[i] * 20.0 / 65536 / gains[i] +
+            (bipolars[i] ? 0.0 : 10.0 / gains[i]);
+        if (gains[i] != 4) BOOST_CHECK_CLOSE(fp[i], volts, 1.e-3);
+    }
+    // the compensation of a gain 4 channel is applied
+    counts[6] = 12000;
+    samp->freeReference();
+    samp = processCounts(analog, counts);
+    fp = (const float*)samp->getConstVoidDataPtr();
+    BOOST_CHECK(std::fabs(fp[6] - (12000 * 5.0 / 65536 + 2.5)) > 1.e-4);
+    BOOST_CHECK_CLOSE(fp[6], analog.convertValue(6, 12000), 1.e-3);
+    samp->freeReference();
+
+    // two sweeps in a raw sample
+    std::vector<short> sweeps(counts);
+    sweeps.insert(sweeps.end(), counts.begin(), counts.end());
+    SampleT<short>* raw = getSample<short>(sweeps.size());
+    std::copy(sweeps.begin(), sweeps.end(), raw->getDataPtr());
+    std::list<const Sample*> results;
+    analog.process(raw, results);
+    raw->freeReference();
+    BOOST_REQUIRE_EQUAL(results.size(), 2);
+    checkClose((const float*)results.back()->getConstVoidDataPtr(),
+        (const float*)results.front()->getConstVoidDataPtr(), nvars);
+    results.front()->freeReference();
+    results.back()->freeReference();
+}
+
+BOOST_AUTO_TEST_CASE(test_analog_process_values)
+{
+    // A variable with more than one value, so that the values of the
+    // sample are not one per variable, and are converted one at a time.
+    TestAnalog analog;
+    SampleTag* tag = new SampleTag(&analog);
+    tag->setSampleId(1);
+    tag->setRate(100);
+    tag->addVariable(newA2DVariable(0, 1, 1));
+    Variable* var = newA2DVariable(1, 4, 0);
+    var->setLength(2);
+    tag->addVariable(var);
+    tag->addVariable(newA2DVariable(2, 2, 1));
+    analog.addSampleTag(tag);
+    analog.validate();
+
+    const int nvars = 3;
+    std::vector<short> counts(nvars);
+    counts[0] = -20000;
+    counts[1] = 12000;
+    counts[2] = 32767;
+    const Sample* samp = processCounts(analog, counts);
+    BOOST_REQUIRE_EQUAL(samp->getDataLength(), nvars);
+    const float* fp = (const float*)samp->getConstVoidDataPtr();
+    BOOST_CHECK_CLOSE(fp[0], analog.convertValue(0, counts[0]), 1.e-3);
+    BOOST_CHECK_CLOSE(fp[0], -20000 * 20.0 / 65536, 1.e-3);
+    BOOST_CHECK_CLOSE(fp[1], analog.convertValue(1, counts[1]), 1.e-3);
+    BOOST_CHECK(std::isnan(fp[2]));
+    samp->freeReference();
+}
+
+/**
+ * Conversion of 10 seconds of an 8 channel A2D sampling at 5 kHz,
+ * fused and one value at a time.
+ */
+BOOST_AUTO_TEST_CASE(benchmark_a2d_convert)
+{
+    TestA2D a2d;
+    const int nsweeps = 50000;
+    std::vector<short> counts = makeCounts(nsweeps * NCHAN);
+    std::vector<float> out(NCHAN);
+
+    struct timespec t0;
+    ::clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < nsweeps; i++)
+        a2d.convertFused(&counts[i * NCHAN], &out[0], NCHAN);
+    double tfused = elapsed(t0);
+
+    ::clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < nsweeps; i++)
+        a2d.convertEach(&counts[i * NCHAN], &out[0], NCHAN);
+    double teach = elapsed(t0);
+
+    std::cout << NCHAN << " channels: fused " <<
+        nsweeps / tfused / 1.e6 << " Msweeps/s, per value " <<
+        nsweeps / teach / 1.e6 << " Msweeps/s" << std::endl;
+}
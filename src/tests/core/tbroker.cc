@@ -0,0 +1,373 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/core/ConnectionBroker.h>
+#include <nidas/util/Thread.h>
+#include <nidas/util/ThreadSupport.h>
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <list>
+#include <vector>
+
+using namespace nidas::core;
+namespace n_u = nidas::util;
+
+namespace {
+
+class Acceptor: public BrokerStreamRequester
+{
+public:
+  Acceptor(): _mutex(), _socks(), _name() {}
+
+  ~Acceptor()
+  {
+    std::list<n_u::Socket*>::iterator si = _socks.begin();
+    for ( ; si != _socks.end(); ++si) delete *si;
+  }
+
+  void streamOpened(n_u::Socket* sock, const ConnectionInfo&,
+                    const std::string& name)
+  {
+    n_u::Synchronized autosync(_mutex);
+    _socks.push_back(sock);
+    _name = name;
+  }
+
+  /**
+   * Wait up to 5 seconds for a stream.
+   */
+  n_u::Socket* waitStream()
+  {
+    for (int i = 0; i < 500; ++i)
+    {
+      {
+        n_u::Synchronized autosync(_mutex);
+        if (!_socks.empty())
+        {
+          n_u::Socket* sock = _socks.front();
+          _socks.pop_front();
+          return sock;
+        }
+      }
+      ::usleep(10000);
+    }
+    return 0;
+  }
+
+  std::string getName()
+  {
+    n_u::Synchronized autosync(_mutex);
+    return _name;
+  }
+
+private:
+  n_u::Mutex _mutex;
+  std::list<n_u::Socket*> _socks;
+  std::string _name;
+};
+
+/**
+ * Read with a 5 second timeout, returning -1 on a timeout.
+ */
+int
+readSock(n_u::Socket* sock, char* buf, size_t len)
+{
+  struct pollfd fds;
+  fds.fd = sock->getFd();
+  fds.events = POLLIN;
+  if (::poll(&fds, 1, 5000) <= 0) return -1;
+  return ::read(sock->getFd(), buf, len);
+}
+
+n_u::Inet4SocketAddress
+brokerAddress(int offset = 0)
+{
+  static int port = 31000 + ::getpid() % 1000;
+  return n_u::Inet4SocketAddress(
+    n_u::Inet4Address::getByName("127.0.0.1"), port + offset);
+}
+
+/**
+ * Accept a connection on a ServerSocket, waiting up to secs seconds.
+ */
+n_u::Socket*
+acceptWithin(n_u::ServerSocket& server, int secs)
+{
+  struct pollfd fds;
+  fds.fd = server.getFd();
+  fds.events = POLLIN;
+  if (::poll(&fds, 1, secs * 1000) <= 0) return 0;
+  return server.accept();
+}
+
+/**
+ * The far end of a broker connection, without a ConnectionBroker,
+ * which reads the frames, and sends a frame when asked.
+ */
+class FakePeer
+{
+public:
+  FakePeer(n_u::Socket* sock): _sock(sock), _inbuf(), types(), ndata(0) {}
+
+  ~FakePeer() { _sock->close(); delete _sock; }
+
+  void sendFrame(int type)
+  {
+    char hdr[8] = { (char)type, 0, 0, 0, 0, 0, 0, 0 };
+    std::string payload;
+    if (type == 1) payload = "NIDAS-BROKER 1";
+    uint32_t plen = htonl(payload.size());
+    ::memcpy(hdr + 4, &plen, 4);
+    _sock->sendall(hdr, 8);
+    if (!payload.empty()) _sock->sendall(payload.data(), payload.size());
+  }
+
+  /**
+   * Read for up to msecs milliseconds.
+   * @return false on EOF.
+   */
+  bool read(int msecs)
+  {
+    struct pollfd fds;
+    fds.fd = _sock->getFd();
+    fds.events = POLLIN;
+    if (::poll(&fds, 1, msecs) <= 0) return true;
+    char buf[65536];
+    ssize_t l = ::read(_sock->getFd(), buf, sizeof(buf));
+    if (l <= 0) return false;
+    _inbuf.insert(_inbuf.end(), buf, buf + l);
+    size_t off = 0;
+    while (_inbuf.size() - off >= 8)
+    {
+      uint32_t plen;
+      ::memcpy(&plen, &_inbuf[off + 4], 4);
+      plen = ntohl(plen);
+      if (_inbuf.size() - off < 8 + plen) break;
+      types.push_back(_inbuf[off]);
+      if (_inbuf[off] == 3) ndata += plen;
+      off += 8 + plen;
+    }
+    _inbuf.erase(_inbuf.begin(), _inbuf.begin() + off);
+    return true;
+  }
+
+private:
+  n_u::Socket* _sock;
+  std::vector<char> _inbuf;
+
+public:
+  /**
+   * Types of the frames received.
+   */
+  std::vector<int> types;
+
+  /**
+   * Bytes of data frames received.
+   */
+  size_t ndata;
+
+private:
+  FakePeer(const FakePeer&);
+  FakePeer& operator=(const FakePeer&);
+};
+
+/**
+ * Writes bytes to a socket, as a sample output would.
+ */
+class StreamWriter: public n_u::Thread
+{
+public:
+  StreamWriter(n_u::Socket* sock, size_t len):
+    n_u::Thread("StreamWriter"), _sock(sock), _len(len), nwritten(0) {}
+
+  int run()
+  {
+    std::vector<char> buf(65536, 'x');
+    while (nwritten < _len)
+    {
+      size_t l = std::min(buf.size(), _len - nwritten);
+      ssize_t n = ::send(_sock->getFd(), &buf[0], l, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      nwritten += n;
+    }
+    return RUN_OK;
+  }
+
+private:
+  n_u::Socket* _sock;
+  size_t _len;
+
+public:
+  size_t nwritten;
+
+private:
+  StreamWriter(const StreamWriter&);
+  StreamWriter& operator=(const StreamWriter&);
+};
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_broker_streams)
+{
+  ConnectionBroker* broker = ConnectionBroker::getInstance();
+  n_u::Inet4SocketAddress addr = brokerAddress();
+  broker->listen(addr.getPort());
+
+  Acceptor raw;
+  Acceptor xml;
+  broker->addAcceptor(RAW_SAMPLE, &raw);
+  broker->addAcceptor(XML_CONFIG, &xml);
+
+  // two streams over the same connection
+  n_u::Socket* rawc = broker->connect(addr, RAW_SAMPLE);
+  n_u::Socket* xmlc = broker->connect(addr, XML_CONFIG);
+  BOOST_REQUIRE(rawc);
+  BOOST_REQUIRE(xmlc);
+  n_u::Socket* raws = raw.waitStream();
+  n_u::Socket* xmls = xml.waitStream();
+  BOOST_REQUIRE(raws);
+  BOOST_REQUIRE(xmls);
+  BOOST_CHECK(!raw.getName().empty());
+
+  char buf[256];
+  rawc->sendall("raw data", 8);
+  xmls->sendall("<project/>", 10);
+  BOOST_CHECK_EQUAL(readSock(raws, buf, sizeof(buf)), 8);
+  BOOST_CHECK_EQUAL(std::string(buf, 8), "raw data");
+  BOOST_CHECK_EQUAL(readSock(xmlc, buf, sizeof(buf)), 10);
+  BOOST_CHECK_EQUAL(std::string(buf, 10), "<project/>");
+
+  // closing one end of a stream is an EOF at the other,
+  // without affecting the other stream
+  xmls->close();
+  BOOST_CHECK_EQUAL(readSock(xmlc, buf, sizeof(buf)), 0);
+  raws->sendall("more", 4);
+  BOOST_CHECK_EQUAL(readSock(rawc, buf, sizeof(buf)), 4);
+
+  delete xmls;
+  delete xmlc;
+  delete raws;
+  delete rawc;
+  broker->removeAcceptor(&raw);
+  broker->removeAcceptor(&xml);
+}
+
+BOOST_AUTO_TEST_CASE(test_broker_no_acceptor)
+{
+  ConnectionBroker* broker = ConnectionBroker::getInstance();
+  n_u::Inet4SocketAddress addr = brokerAddress();
+  broker->listen(addr.getPort());
+
+  // the server closes a stream of an unknown request type
+  n_u::Socket* sock = broker->connect(addr, UDP_PROCESSED_SAMPLE_FEED);
+  BOOST_REQUIRE(sock);
+  char buf[16];
+  BOOST_CHECK_EQUAL(readSock(sock, buf, sizeof(buf)), 0);
+  delete sock;
+
+  ConnectionBroker::destroyInstance();
+}
+
+BOOST_AUTO_TEST_CASE(test_broker_keepalive_reconnect)
+{
+  // A server which accepts the connection, but never sends anything.
+  n_u::Inet4SocketAddress addr = brokerAddress(1);
+  n_u::ServerSocket server(addr);
+  ConnectionBroker* broker = ConnectionBroker::getInstance();
+  broker->setKeepAliveSecs(1);
+
+  Acceptor rqstr;
+  broker->request(addr, RAW_SAMPLE, &rqstr);
+  n_u::Socket* conn = acceptWithin(server, 5);
+  BOOST_REQUIRE(conn);
+  FakePeer peer(conn);
+  n_u::Socket* stream = rqstr.waitStream();
+  BOOST_REQUIRE(stream);
+
+  // The broker sends keepalives, then gives up after three
+  // keepalive periods without hearing from the server.
+  time_t t0 = ::time(0);
+  bool open = true;
+  while (open && ::time(0) - t0 < 10) open = peer.read(500);
+  BOOST_CHECK(!open);
+  BOOST_CHECK(::time(0) - t0 >= 3);
+  BOOST_REQUIRE(!peer.types.empty());
+  BOOST_CHECK_EQUAL(peer.types.front(), 1);
+  BOOST_CHECK(std::count(peer.types.begin(), peer.types.end(), 5) >= 2);
+
+  // The local end of the stream sees the connection close.
+  char buf[16];
+  BOOST_CHECK_EQUAL(readSock(stream, buf, sizeof(buf)), 0);
+  delete stream;
+
+  // and the broker reconnects at once.
+  n_u::Socket* conn2 = acceptWithin(server, 3);
+  BOOST_CHECK(conn2);
+  if (conn2) {
+    conn2->close();
+    delete conn2;
+  }
+
+  broker->cancel(&rqstr);
+  ConnectionBroker::destroyInstance();
+  server.close();
+}
+
+BOOST_AUTO_TEST_CASE(test_broker_slow_send)
+{
+  // A server which stops reading for longer than three keepalive
+  // periods, but less than the send timeout, doesn't lose its connection.
+  n_u::Inet4SocketAddress addr = brokerAddress(2);
+  n_u::ServerSocket server(addr);
+  int rcvbuf = 4096;
+  ::setsockopt(server.getFd(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  ConnectionBroker* broker = ConnectionBroker::getInstance();
+  broker->setKeepAliveSecs(1);
+  broker->setSendTimeoutSecs(10);
+
+  Acceptor rqstr;
+  broker->request(addr, RAW_SAMPLE, &rqstr);
+  n_u::Socket* conn = acceptWithin(server, 5);
+  BOOST_REQUIRE(conn);
+  FakePeer peer(conn);
+  peer.sendFrame(1);
+  n_u::Socket* stream = rqstr.waitStream();
+  BOOST_REQUIRE(stream);
+
+  // more than the socket buffers hold
+  const size_t len = 32 * 1000 * 1000;
+  StreamWriter writer(stream, len);
+  writer.start();
+
+  // read for a second, stall for five, then read the rest
+  bool open = true;
+  time_t t0 = ::time(0);
+  while (open && ::time(0) - t0 < 1) open = peer.read(100);
+  ::sleep(5);
+  t0 = ::time(0);
+  while (open && peer.ndata < len && ::time(0) - t0 < 20)
+  {
+    open = peer.read(100);
+    peer.sendFrame(5);
+  }
+  writer.join();
+  BOOST_CHECK(open);
+  BOOST_CHECK_EQUAL(writer.nwritten, len);
+  BOOST_CHECK_EQUAL(peer.ndata, len);
+
+  delete stream;
+  broker->cancel(&rqstr);
+  ConnectionBroker::destroyInstance();
+  server.close();
+}
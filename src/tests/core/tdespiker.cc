@@ -0,0 +1,243 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/core/AdaptiveDespiker.h>
+#include <nidas/core/MultiChannelDespiker.h>
+
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../benchmark.h"
+
+using namespace nidas::core;
+
+namespace {
+
+const unsigned int NCHAN = 4;
+
+const long long MAX_GAP = 60 * USECS_PER_SEC;
+
+/**
+ * Correlated random series for each channel, 20 samples per second,
+ * with some spikes, missing values, and a data gap.
+ */
+void
+makeSeries(unsigned int n, std::vector<dsm_time_t>& tt,
+           std::vector<std::vector<float> >& data,
+           std::vector<std::vector<bool> >& injected)
+{
+    unsigned int seed = 1;
+    tt.resize(n);
+    data.assign(NCHAN, std::vector<float>(n));
+    injected.assign(NCHAN, std::vector<bool>(n, false));
+
+    dsm_time_t t = (dsm_time_t) 1700000000 * USECS_PER_SEC;
+    for (unsigned int j = 0; j < n; j++) {
+        tt[j] = t;
+        t += USECS_PER_SEC / 20;
+        if (j == n / 2) t += 2 * MAX_GAP;
+    }
+
+    for (unsigned int i = 0; i < NCHAN; i++) {
+        double x = 0.0;
+        for (unsigned int j = 0; j < n; j++) {
+            seed = seed * 1103515245 + 12345;
+            double r = ((seed / 65536) % 10000) / 10000.0 - 0.5;
+            x = 0.9 * x + r;
+            float val = 2.0 * i + x;
+            seed = seed * 1103515245 + 12345;
+            unsigned int k = (seed / 65536) % 1000;
+            if (j > 200 && k < 5) {
+                val += (k % 2 ? 20.0 : -20.0);
+                injected[i][j] = true;
+            }
+            else if (k > 995) val = NAN;
+            data[i][j] = val;
+        }
+    }
+}
+
+/**
+ * Despike with an AdaptiveDespiker per channel, with the data gap
+ * handling of Wind3D::despike().
+ */
+void
+despikeEach(const std::vector<dsm_time_t>& tt,
+            std::vector<std::vector<float> >& data,
+            std::vector<std::vector<bool> >& spikes)
+{
+    AdaptiveDespiker despikers[NCHAN];
+    dsm_time_t ttlast[NCHAN] = { 0, 0, 0, 0 };
+    spikes.assign(NCHAN, std::vector<bool>(tt.size()));
+
+    for (unsigned int j = 0; j < tt.size(); j++) {
+        for (unsigned int i = 0; i < NCHAN; i++) {
+            if (tt[j] - ttlast[i] > MAX_GAP) despikers[i].reset();
+            bool spike = std::isnan(data[i][j]);
+            data[i][j] = despikers[i].despike(data[i][j], &spike);
+            if (!spike) ttlast[i] = tt[j];
+            spikes[i][j] = spike;
+        }
+    }
+}
+
+void
+checkSame(const std::vector<std::vector<float> >& a,
+          const std::vector<std::vector<float> >& b)
+{
+    int ndiff = 0;
+    for (unsigned int i = 0; i < NCHAN; i++) {
+        for (unsigned int j = 0; j < a[i].size(); j++) {
+            float x = a[i][j];
+            float y = b[i][j];
+            if (!(x == y || (std::isnan(x) && std::isnan(y)))) ndiff++;
+        }
+    }
+    BOOST_CHECK_EQUAL(ndiff, 0);
+}
+
+}
+
+/*
+ * The multi-channel despiker gives the same values and spikes as
+ * an AdaptiveDespiker per channel, both a sample at a time and in
+ * batches.
+ */
+BOOST_AUTO_TEST_CASE(test_multichannel_despiker_equivalence)
+{
+    const unsigned int n = 20000;
+    std::vector<dsm_time_t> tt;
+    std::vector<std::vector<float> > data;
+    std::vector<std::vector<bool> > injected;
+    makeSeries(n, tt, data, injected);
+
+    std::vector<std::vector<float> > each(data);
+    std::vector<std::vector<bool> > eachSpikes;
+    despikeEach(tt, each, eachSpikes);
+
+    // a sample at a time
+    MultiChannelDespiker single(NCHAN);
+    single.setMaxGapUsecs(MAX_GAP);
+    std::vector<std::vector<float> > sdata(data);
+    int nspikeDiff = 0;
+    for (unsigned int j = 0; j < n; j++) {
+        float vals[NCHAN];
+        bool spikes[NCHAN];
+        for (unsigned int i = 0; i < NCHAN; i++) vals[i] = sdata[i][j];
+        single.despike(tt[j], vals, spikes);
+        for (unsigned int i = 0; i < NCHAN; i++) {
+            sdata[i][j] = vals[i];
+            if (spikes[i] != eachSpikes[i][j]) nspikeDiff++;
+        }
+    }
+    checkSame(each, sdata);
+    BOOST_CHECK_EQUAL(nspikeDiff, 0);
+
+    // in batches of various sizes
+    MultiChannelDespiker batch(NCHAN);
+    batch.setMaxGapUsecs(MAX_GAP);
+    std::vector<std::vector<float> > bdata(data);
+    nspikeDiff = 0;
+    for (unsigned int j = 0, nb = 1; j < n; j += nb, nb = nb * 3 % 1001) {
+        if (nb > n - j) nb = n - j;
+        float* dp[NCHAN];
+        bool* sp[NCHAN];
+        bool spikes[NCHAN][1001];
+        for (unsigned int i = 0; i < NCHAN; i++) {
+            dp[i] = &bdata[i][j];
+            sp[i] = spikes[i];
+        }
+        batch.despike(&tt[j], dp, sp, nb);
+        for (unsigned int i = 0; i < NCHAN; i++)
+            for (unsigned int k = 0; k < nb; k++)
+                if (spikes[i][k] != eachSpikes[i][j + k]) nspikeDiff++;
+    }
+    checkSame(each, bdata);
+    BOOST_CHECK_EQUAL(nspikeDiff, 0);
+
+    for (unsigned int i = 0; i < NCHAN; i++)
+        BOOST_CHECK_EQUAL(batch.getDiscLevel(i), single.getDiscLevel(i));
+
+    // Most of the injected spikes are found and replaced, and few
+    // good values are mistaken for spikes.
+    int ninjected = 0, nfound = 0, nfalse = 0, ngood = 0;
+    for (unsigned int i = 0; i < NCHAN; i++) {
+        for (unsigned int j = 0; j < n; j++) {
+            if (std::isnan(data[i][j])) continue;
+            if (injected[i][j]) {
+                ninjected++;
+                if (eachSpikes[i][j]) nfound++;
+            }
+            else {
+                ngood++;
+                if (eachSpikes[i][j]) nfalse++;
+            }
+        }
+    }
+    BOOST_CHECK_GT(ninjected, 100);
+    BOOST_CHECK_GT(nfound, 0.95 * ninjected);
+    BOOST_CHECK_LT(nfalse, 0.01 * ngood);
+}
+
+/**
+ * Despiking rates of the u,v,w,tc of the CSAT3 data in tests/sonic,
+ * repeated to make an hour at 20 Hz.
+ */
+BOOST_AUTO_TEST_CASE(benchmark_despikers)
+{
+    FILE* fp = ::popen("gzip -dc ../sonic/data/no_cors.txt.gz", "r");
+    BOOST_REQUIRE(fp);
+
+    // date time deltaT len u v w tc ...
+    std::vector<std::vector<float> > uvwt(NCHAN);
+    char line[1024];
+    while (::fgets(line, sizeof(line), fp)) {
+        std::istringstream ist(line);
+        std::string date, tod;
+        float dt, len, vals[NCHAN];
+        ist >> date >> date >> date >> tod >> dt >> len;
+        for (unsigned int i = 0; i < NCHAN; i++) ist >> vals[i];
+        if (ist.fail()) continue;
+        for (unsigned int i = 0; i < NCHAN; i++) uvwt[i].push_back(vals[i]);
+    }
+    ::pclose(fp);
+    BOOST_REQUIRE_GT(uvwt[0].size(), 100u);
+
+    const unsigned int n = 20 * 3600;
+    std::vector<std::vector<float> > data(NCHAN, std::vector<float>(n));
+    for (unsigned int i = 0; i < NCHAN; i++)
+        for (unsigned int j = 0; j < n; j++)
+            data[i][j] = uvwt[i][j % uvwt[i].size()];
+
+    std::vector<dsm_time_t> tt(n);
+    for (unsigned int j = 0; j < n; j++)
+        tt[j] = (dsm_time_t) 1338508800 * USECS_PER_SEC + j * USECS_PER_SEC / 20;
+
+    std::vector<std::vector<float> > each(data);
+    std::vector<std::vector<bool> > eachSpikes;
+    struct timespec t0;
+    ::clock_gettime(CLOCK_MONOTONIC, &t0);
+    despikeEach(tt, each, eachSpikes);
+    double teach = elapsed(t0);
+
+    MultiChannelDespiker batch(NCHAN);
+    batch.setMaxGapUsecs(MAX_GAP);
+    std::vector<std::vector<float> > bdata(data);
+    float* dp[NCHAN];
+    for (unsigned int i = 0; i < NCHAN; i++) dp[i] = &bdata[i].front();
+    ::clock_gettime(CLOCK_MONOTONIC, &t0);
+    batch.despike(&tt.front(), dp, 0, n);
+    double tbatch = elapsed(t0);
+
+    checkSame(each, bdata);
+
+    std::cout << "despike " << NCHAN << " channels: per value " <<
+        n / teach / 1.e6 << " Msamples/s, batch " <<
+        n / tbatch / 1.e6 << " Msamples/s" << std::endl;
+}
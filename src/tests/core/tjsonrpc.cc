@@ -0,0 +1,181 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/core/JsonRpcServer.h>
+#include <nidas/util/Socket.h>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <string>
+
+using namespace nidas::core;
+namespace n_u = nidas::util;
+
+namespace {
+
+class Echo: public XmlRpc::XmlRpcServerMethod
+{
+public:
+  Echo(): XmlRpc::XmlRpcServerMethod("Echo", 0) {}
+  void execute(XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result)
+  {
+    result = params;
+  }
+};
+
+/**
+ * Sleeps for params["msecs"] milliseconds.
+ */
+class Sleep: public XmlRpc::XmlRpcServerMethod
+{
+public:
+  Sleep(): XmlRpc::XmlRpcServerMethod("Sleep", 0) {}
+  void execute(XmlRpc::XmlRpcValue& params, XmlRpc::XmlRpcValue& result)
+  {
+    int msecs = atoi(static_cast<std::string&>(params["msecs"]).c_str());
+    ::usleep(msecs * 1000);
+    result = std::string("slept");
+  }
+};
+
+/**
+ * Send an HTTP request and return the response, waiting
+ * up to 5 seconds for the server to close the connection.
+ */
+std::string
+httpRequest(int port, const std::string& request)
+{
+  n_u::Socket sock(n_u::Inet4Address::getByName("127.0.0.1"), port);
+  sock.sendall(request.c_str(), request.length());
+  std::string response;
+  for (;;)
+  {
+    struct pollfd fds;
+    fds.fd = sock.getFd();
+    fds.events = POLLIN;
+    if (::poll(&fds, 1, 5000) <= 0) break;
+    char buf[1024];
+    ssize_t l = ::read(sock.getFd(), buf, sizeof(buf));
+    if (l <= 0) break;
+    response.append(buf, l);
+  }
+  sock.close();
+  return response;
+}
+
+std::string
+body(const std::string& response)
+{
+  std::string::size_type i = response.find("\r\n\r\n");
+  return i == std::string::npos ? "" : response.substr(i + 4);
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_json_conversion)
+{
+  XmlRpc::XmlRpcValue val;
+  JsonRpcServer::fromJSON(
+    "{\"a\": [1, 2.5, \"x\\\"y\"], \"b\": {\"c\": true}, \"d\": null}", val);
+  BOOST_CHECK_EQUAL(val.getType(), XmlRpc::XmlRpcValue::TypeStruct);
+  BOOST_CHECK_EQUAL(val["a"].size(), 3);
+  BOOST_CHECK_EQUAL(static_cast<int&>(val["a"][0]), 1);
+  BOOST_CHECK_EQUAL(static_cast<double&>(val["a"][1]), 2.5);
+  BOOST_CHECK_EQUAL(static_cast<std::string&>(val["a"][2]), "x\"y");
+  BOOST_CHECK(static_cast<bool&>(val["b"]["c"]));
+
+  XmlRpc::XmlRpcValue arr;
+  JsonRpcServer::fromJSON("[1,\"two\",[]]", arr);
+  BOOST_CHECK_EQUAL(JsonRpcServer::toJSON(arr), "[1,\"two\",[]]");
+
+  BOOST_CHECK_THROW(JsonRpcServer::fromJSON("{\"a\":", val),
+                    n_u::ParseException);
+  BOOST_CHECK_THROW(JsonRpcServer::fromJSON("[1] 2", val),
+                    n_u::ParseException);
+}
+
+BOOST_AUTO_TEST_CASE(test_dispatcher_timeout)
+{
+  Echo echo;
+  Sleep sleep;
+  RpcDispatcher dispatcher("test", 2);
+  dispatcher.addMethod(&echo, 1.0);
+  dispatcher.addMethod(&sleep, 0.2);
+  dispatcher.start();
+
+  XmlRpc::XmlRpcValue params;
+  XmlRpc::XmlRpcValue result;
+  params["msecs"] = "1000";
+  BOOST_CHECK(!dispatcher.execute("Sleep", params, result));
+  BOOST_CHECK_EQUAL(dispatcher.getNumTimeouts(), 1);
+
+  // the sleeping method does not hold up another
+  params["msecs"] = "echo";
+  BOOST_CHECK(dispatcher.execute("Echo", params, result));
+  BOOST_CHECK_EQUAL(static_cast<std::string&>(result["msecs"]), "echo");
+
+  // unknown methods are a fault
+  BOOST_CHECK(!dispatcher.execute("Nope", params, result));
+
+  dispatcher.stop();
+}
+
+BOOST_AUTO_TEST_CASE(test_json_http)
+{
+  Echo echo;
+  Sleep sleep;
+  RpcDispatcher dispatcher("test", 2);
+  dispatcher.addMethod(&echo, 1.0);
+  dispatcher.addMethod(&sleep, 1.0);
+  dispatcher.start();
+
+  JsonRpcServer server(&dispatcher, n_u::Inet4SocketAddress(
+    n_u::Inet4Address::getByName("127.0.0.1"), 0));
+  server.start();
+  int port = server.getLocalPort();
+
+  std::string resp = httpRequest(port,
+    "GET /rpc HTTP/1.1\r\nConnection: close\r\n\r\n");
+  BOOST_CHECK_EQUAL(resp.substr(0, 15), "HTTP/1.1 200 OK");
+  BOOST_CHECK_EQUAL(body(resp), "{\"methods\":[\"Echo\",\"Sleep\"]}\n");
+
+  resp = httpRequest(port,
+    "GET /rpc/Echo?name=a+b%21 HTTP/1.0\r\n\r\n");
+  BOOST_CHECK_EQUAL(body(resp), "{\"result\":{\"name\":\"a b!\"}}\n");
+
+  std::string post = "{\"method\":\"Echo\",\"params\":[1,2]}";
+  std::ostringstream req;
+  req << "POST /rpc HTTP/1.1\r\nContent-Length: " << post.length() <<
+    "\r\nConnection: close\r\n\r\n" << post;
+  resp = httpRequest(port, req.str());
+  BOOST_CHECK_EQUAL(body(resp), "{\"result\":[1,2]}\n");
+
+  resp = httpRequest(port, "GET /rpc/Nope HTTP/1.0\r\n\r\n");
+  BOOST_CHECK_EQUAL(resp.substr(0, 12), "HTTP/1.1 404");
+
+  // a request which outlasts its timeout is answered with a 504,
+  // while a concurrent request is answered promptly
+  n_u::Socket slow(n_u::Inet4Address::getByName("127.0.0.1"), port);
+  std::string sreq = "GET /rpc/Sleep?msecs=3000 HTTP/1.0\r\n\r\n";
+  slow.sendall(sreq.c_str(), sreq.length());
+  resp = httpRequest(port, "GET /rpc/Echo?x=1 HTTP/1.0\r\n\r\n");
+  BOOST_CHECK_EQUAL(body(resp), "{\"result\":{\"x\":\"1\"}}\n");
+
+  std::string sresp;
+  char buf[512];
+  struct pollfd fds;
+  fds.fd = slow.getFd();
+  fds.events = POLLIN;
+  BOOST_REQUIRE(::poll(&fds, 1, 5000) > 0);
+  ssize_t l = ::read(slow.getFd(), buf, sizeof(buf));
+  BOOST_REQUIRE(l > 0);
+  BOOST_CHECK_EQUAL(std::string(buf, 12), "HTTP/1.1 504");
+  slow.close();
+
+  server.interrupt();
+  server.join();
+  dispatcher.stop();
+}
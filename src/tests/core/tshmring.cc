@@ -0,0 +1,156 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/core/ShmSampleRing.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <vector>
+
+using namespace nidas::core;
+
+namespace {
+
+std::string
+ringName(const std::string& suffix)
+{
+  std::ostringstream ost;
+  ost << "/nidas_tshmring_" << ::getpid() << "_" << suffix;
+  return ost.str();
+}
+
+bool
+publishSample(ShmSampleRing* ring, dsm_time_t tt, const std::vector<float>& data)
+{
+  SampleHeader header(FLOAT_ST);
+  header.setTimeTag(tt);
+  header.setDataByteLength(data.size() * sizeof(float));
+  header.setId(42);
+  return ring->publish(&header, SampleHeader::getSizeOf(),
+                       &data[0], data.size() * sizeof(float));
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_shmring_publish_peek)
+{
+  std::string name = ringName("peek");
+  ShmSampleRing* writer = ShmSampleRing::create(name, 65536);
+  ShmSampleRing* reader = ShmSampleRing::attach(name);
+
+  size_t len;
+  BOOST_CHECK(reader->peek(len) == 0);
+
+  writer->setHeader("NIDAS (ncar.ucar.edu)\nend header\n");
+  BOOST_CHECK_EQUAL(reader->getHeader(), "NIDAS (ncar.ucar.edu)\nend header\n");
+
+  std::vector<float> data(5, 1.5);
+  for (int i = 0; i < 10; ++i)
+  {
+    BOOST_CHECK(publishSample(writer, 1000 + i, data));
+  }
+  BOOST_CHECK_EQUAL(writer->getNumSamples(), 10);
+
+  for (int i = 0; i < 10; ++i)
+  {
+    const SampleHeader* hdr = (const SampleHeader*) reader->peek(len);
+    BOOST_REQUIRE(hdr);
+    BOOST_CHECK_EQUAL(len, SampleHeader::getSizeOf() + 5 * sizeof(float));
+    BOOST_CHECK_EQUAL(hdr->getTimeTag(), 1000 + i);
+    BOOST_CHECK_EQUAL(hdr->getId(), 42u);
+    const float* fp = (const float*)((const char*)hdr + SampleHeader::getSizeOf());
+    BOOST_CHECK_EQUAL(fp[4], 1.5);
+    BOOST_CHECK(reader->consume());
+  }
+  BOOST_CHECK(reader->peek(len) == 0);
+  BOOST_CHECK_EQUAL(reader->getLagBytes(), 0u);
+  BOOST_CHECK_EQUAL(reader->getNumOverruns(), 0u);
+
+  delete reader;
+  delete writer;
+  ::shm_unlink(name.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(test_shmring_wrap_and_overrun)
+{
+  std::string name = ringName("overrun");
+  ShmSampleRing* writer = ShmSampleRing::create(name, 65536);
+  ShmSampleRing* reader = ShmSampleRing::attach(name);
+
+  // records which do not divide evenly into the ring, so that it wraps
+  std::vector<float> data(997, 2.0);
+  size_t reclen = SampleHeader::getSizeOf() + data.size() * sizeof(float);
+  std::vector<char> buf(reclen * 4);
+
+  dsm_time_t tt = 0;
+  for (int n = 0; n < 200; ++n)
+  {
+    BOOST_CHECK(publishSample(writer, ++tt, data));
+    size_t l = reader->read(&buf[0], buf.size());
+    BOOST_CHECK_EQUAL(l, reclen);
+    BOOST_CHECK_EQUAL(((SampleHeader*)&buf[0])->getTimeTag(), tt);
+  }
+  BOOST_CHECK_EQUAL(reader->getNumOverruns(), 0u);
+
+  // Lap the reader. It should be moved to the latest write position.
+  for (int n = 0; n < 100; ++n)
+    publishSample(writer, ++tt, data);
+  BOOST_CHECK_EQUAL(reader->read(&buf[0], buf.size()), 0u);
+  BOOST_CHECK_EQUAL(reader->getNumOverruns(), 1u);
+  BOOST_CHECK(reader->getNumBytesLost() > 0);
+
+  BOOST_CHECK(publishSample(writer, ++tt, data));
+  BOOST_CHECK_EQUAL(reader->read(&buf[0], buf.size()), reclen);
+  BOOST_CHECK_EQUAL(((SampleHeader*)&buf[0])->getTimeTag(), tt);
+
+  // too big for the ring
+  std::vector<float> big(65536 / sizeof(float), 0.0);
+  BOOST_CHECK(!publishSample(writer, ++tt, big));
+  BOOST_CHECK_EQUAL(writer->getNumDiscardedSamples(), 1u);
+
+  delete reader;
+  delete writer;
+  ::shm_unlink(name.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(test_shmring_reuse_and_stale)
+{
+  std::string name = ringName("reuse");
+  ShmSampleRing* writer = ShmSampleRing::create(name, 65536);
+  ShmSampleRing* reader = ShmSampleRing::attach(name);
+  std::vector<float> data(3, 0.0);
+
+  BOOST_CHECK(publishSample(writer, 1, data));
+  delete writer;
+  BOOST_CHECK(reader->isWriterClosed());
+
+  // A new writer of the same size carries on with the same ring.
+  writer = ShmSampleRing::create(name, 65536);
+  BOOST_CHECK(!reader->isWriterClosed());
+  BOOST_CHECK(publishSample(writer, 2, data));
+  size_t len;
+  const SampleHeader* hdr = (const SampleHeader*) reader->peek(len);
+  BOOST_REQUIRE(hdr);
+  BOOST_CHECK_EQUAL(hdr->getTimeTag(), 1);
+  BOOST_CHECK(reader->consume());
+  hdr = (const SampleHeader*) reader->peek(len);
+  BOOST_REQUIRE(hdr);
+  BOOST_CHECK_EQUAL(hdr->getTimeTag(), 2);
+  BOOST_CHECK(reader->consume());
+  delete writer;
+
+  // A writer of a different size replaces the segment.
+  writer = ShmSampleRing::create(name, 131072);
+  BOOST_CHECK(reader->isStale());
+  BOOST_CHECK(!reader->wait(10));
+
+  delete reader;
+  delete writer;
+  ::shm_unlink(name.c_str());
+}
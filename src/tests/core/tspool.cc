@@ -0,0 +1,525 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/core/SampleSpool.h>
+#include <nidas/core/IOChannel.h>
+#include <nidas/core/SampleTag.h>
+#include <nidas/core/SampleSourceSupport.h>
+#include <nidas/core/ConnectionRequester.h>
+#include <nidas/dynld/PriorityRawSampleOutputStream.h>
+#include <nidas/dynld/SpoolRawSampleOutputStream.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <set>
+#include <string>
+
+#include <ftw.h>
+#include <sys/uio.h>
+
+using namespace nidas::core;
+using namespace nidas::dynld;
+
+namespace {
+
+/**
+ * A temporary directory, removed with its contents at the end of a test.
+ */
+class TmpDir
+{
+public:
+  TmpDir(): _path()
+  {
+    char tmpl[] = "/tmp/nidas_tspool_XXXXXX";
+    _path = ::mkdtemp(tmpl);
+  }
+
+  ~TmpDir()
+  {
+    ::nftw(_path.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+  }
+
+  std::string path(const std::string& suffix) const
+  {
+    return _path + "/" + suffix;
+  }
+
+private:
+  static int
+  removeEntry(const char* path, const struct stat*, int, struct FTW*)
+  {
+    return ::remove(path);
+  }
+
+  std::string _path;
+};
+
+/**
+ * The far end of a test link: the bytes written to it, and whether
+ * it is accepting them.
+ */
+struct Link
+{
+  Link(): bytes(), blocked(false) {}
+
+  /**
+   * Time tags of the samples received with an id.
+   */
+  std::vector<dsm_time_t>
+  timeTags(dsm_sample_id_t id) const
+  {
+    std::vector<dsm_time_t> tags;
+    for (size_t off = 0; off + SampleHeader::getSizeOf() <= bytes.size(); )
+    {
+      SampleHeader header;
+      ::memcpy(&header, bytes.data() + off, SampleHeader::getSizeOf());
+      if (header.getId() == id)
+        tags.push_back(header.getTimeTag());
+      off += SampleHeader::getSizeOf() + header.getDataByteLength();
+    }
+    return tags;
+  }
+
+  std::string bytes;
+  bool blocked;
+};
+
+/**
+ * An IOChannel to a Link, which writes nothing while the link is blocked.
+ */
+class TestChannel: public IOChannel
+{
+public:
+  TestChannel(Link* link): IOChannel(), _link(link), _name("testlink") {}
+
+  TestChannel* clone() const { return new TestChannel(_link); }
+
+  void setName(const std::string& val) { _name = val; }
+
+  const std::string& getName() const { return _name; }
+
+  /**
+   * Connect immediately, on a new channel, like a socket.
+   */
+  void requestConnection(IOChannelRequester* rqstr)
+  {
+    rqstr->connected(clone());
+  }
+
+  IOChannel* connect() { return clone(); }
+
+  void setNonBlocking(bool) {}
+
+  bool isNonBlocking() const { return true; }
+
+  size_t getBufferSize() const { return 512; }
+
+  bool writeNidasHeader() const { return false; }
+
+  size_t read(void*, size_t) { return 0; }
+
+  size_t write(const void* buf, size_t len)
+  {
+    if (_link->blocked) return 0;
+    _link->bytes.append((const char*) buf, len);
+    return len;
+  }
+
+  size_t write(const struct iovec* iov, int iovcnt)
+  {
+    size_t l = 0;
+    for (int i = 0; i < iovcnt; ++i)
+      l += write(iov[i].iov_base, iov[i].iov_len);
+    return l;
+  }
+
+  void close() {}
+
+  int getFd() const { return -1; }
+
+  void fromDOMElement(const xercesc::DOMElement*) {}
+
+private:
+  Link* _link;
+  std::string _name;
+};
+
+/**
+ * A raw sample of 5 floats.
+ */
+void
+receiveSample(SampleClient& client, const SampleTag& tag, dsm_time_t tt)
+{
+  SampleT<float>* samp = getSample<float>(5);
+  samp->setTimeTag(tt);
+  samp->setId(tag.getId());
+  for (unsigned int i = 0; i < 5; ++i)
+    samp->getDataPtr()[i] = tt + i;
+  client.receive(samp);
+  samp->freeReference();
+}
+
+void
+initTag(SampleTag& tag, unsigned int sampleId, float rate)
+{
+  tag.setDSMId(1);
+  tag.setSensorId(10);
+  tag.setSampleId(sampleId);
+  tag.setRate(rate);
+}
+
+/**
+ * Connects and disconnects outputs of a raw sample source, handing
+ * over between a spooling original and its connected clone as
+ * DSMEngine does.
+ */
+class TestRequester: public SampleConnectionRequester
+{
+public:
+  TestRequester(): source(true), connected(0) {}
+
+  void connect(SampleOutput* output) throw()
+  {
+    connected = output;
+    source.addSampleClient(output);
+    SampleOutput* orig = output->getOriginal();
+    if (orig != output && orig->isSpooling())
+      source.removeSampleClient(orig);
+  }
+
+  void disconnect(SampleOutput* output) throw()
+  {
+    SampleOutput* orig = output->getOriginal();
+    if (output != orig || !orig->isSpooling())
+      source.removeSampleClient(output);
+    if (orig->isSpooling()) source.addSampleClient(orig);
+    output->flush();
+    output->close();
+    if (output != orig) delete output;
+    connected = 0;
+  }
+
+  SampleSourceSupport source;
+  SampleOutput* connected;
+};
+
+void
+distributeSample(SampleSourceSupport& source, const SampleTag& tag,
+                 dsm_time_t tt)
+{
+  SampleT<float>* samp = getSample<float>(5);
+  samp->setTimeTag(tt);
+  samp->setId(tag.getId());
+  source.distribute(samp);
+}
+
+void
+appendSample(SampleSpool& spool, dsm_time_t tt, unsigned int nfloat)
+{
+  SampleT<float>* samp = getSample<float>(nfloat);
+  samp->setTimeTag(tt);
+  samp->setId(42);
+  for (unsigned int i = 0; i < nfloat; ++i)
+    samp->getDataPtr()[i] = tt + i;
+  spool.append(samp);
+  samp->freeReference();
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_spool_fifo)
+{
+  TmpDir tmp;
+  SampleSpool spool(tmp.path("fifo"), 10000000, 1000);
+  spool.open();
+  BOOST_CHECK(spool.empty());
+  BOOST_CHECK(spool.front() == 0);
+
+  // small segments, so that reading crosses several of them
+  for (int i = 0; i < 100; ++i)
+    appendSample(spool, 1000 + i, 10);
+  BOOST_CHECK_EQUAL(spool.getPendingBytes(), 100 * (16 + 40));
+
+  for (int i = 0; i < 100; ++i)
+  {
+    const Sample* samp = spool.front();
+    BOOST_REQUIRE(samp);
+    BOOST_CHECK_EQUAL(samp->getTimeTag(), 1000 + i);
+    BOOST_CHECK_EQUAL(samp->getId(), 42u);
+    BOOST_CHECK_EQUAL(samp->getType(), FLOAT_ST);
+    BOOST_CHECK_EQUAL(samp->getDataValue(9), 1000 + i + 9);
+    spool.pop();
+    // interleave appending with reading
+    if (i == 50) appendSample(spool, 5000, 3);
+  }
+  const Sample* samp = spool.front();
+  BOOST_REQUIRE(samp);
+  BOOST_CHECK_EQUAL(samp->getTimeTag(), 5000);
+  spool.pop();
+  BOOST_CHECK(spool.empty());
+  BOOST_CHECK_EQUAL(spool.getNumSamplesPopped(), 101);
+}
+
+
+BOOST_AUTO_TEST_CASE(test_spool_resume)
+{
+  TmpDir tmp;
+  std::string dir = tmp.path("resume");
+  {
+    SampleSpool spool(dir, 10000000, 2000);
+    spool.open();
+    for (int i = 0; i < 200; ++i)
+      appendSample(spool, i, 4);
+    for (int i = 0; i < 120; ++i)
+    {
+      BOOST_REQUIRE(spool.front());
+      spool.pop();
+    }
+    spool.close();
+  }
+
+  SampleSpool spool(dir, 10000000, 2000);
+  spool.open();
+  BOOST_CHECK_EQUAL(spool.getPendingBytes(), 80 * (16 + 16));
+  for (int i = 120; i < 200; ++i)
+  {
+    const Sample* samp = spool.front();
+    BOOST_REQUIRE(samp);
+    BOOST_CHECK_EQUAL(samp->getTimeTag(), i);
+    spool.pop();
+  }
+  BOOST_CHECK(spool.front() == 0);
+  BOOST_CHECK(spool.empty());
+}
+
+
+BOOST_AUTO_TEST_CASE(test_spool_bounded)
+{
+  // 40 bytes per sample, at most 4000 bytes in the spool.
+  TmpDir tmp;
+  SampleSpool spool(tmp.path("bounded"), 4000, 1000);
+  spool.open();
+  for (int i = 0; i < 1000; ++i)
+    appendSample(spool, i, 6);
+
+  BOOST_CHECK(spool.getPendingBytes() <= 4000);
+  BOOST_CHECK(spool.getNumBytesDropped() > 0);
+  BOOST_CHECK_EQUAL(spool.getPendingBytes() + spool.getNumBytesDropped(),
+                    1000 * 40);
+
+  // The newest samples are kept.
+  dsm_time_t last = -1;
+  while (const Sample* samp = spool.front())
+  {
+    BOOST_CHECK(samp->getTimeTag() > last);
+    last = samp->getTimeTag();
+    spool.pop();
+  }
+  BOOST_CHECK_EQUAL(last, 999);
+}
+
+
+BOOST_AUTO_TEST_CASE(test_spool_drop_held_front)
+{
+  // A reader holds the oldest sample while appending drops its segment.
+  TmpDir tmp;
+  SampleSpool spool(tmp.path("held"), 4000, 1000);
+  spool.open();
+  for (int i = 0; i < 10; ++i)
+    appendSample(spool, i, 6);
+
+  const Sample* held = spool.front();
+  BOOST_REQUIRE(held);
+  for (int i = 10; i < 1000; ++i)
+    appendSample(spool, i, 6);
+  BOOST_CHECK(spool.getNumBytesDropped() > 0);
+
+  BOOST_CHECK_EQUAL(held->getTimeTag(), 0);
+  BOOST_CHECK_EQUAL(held->getDataValue(5), 5);
+  BOOST_CHECK(spool.front() == held);
+  spool.pop();
+
+  const Sample* samp = spool.front();
+  BOOST_REQUIRE(samp);
+  BOOST_CHECK(samp->getTimeTag() > 10);
+  BOOST_CHECK_EQUAL(spool.getPendingBytes() + spool.getNumBytesDropped(),
+                    999 * 40);
+}
+
+
+BOOST_AUTO_TEST_CASE(test_priority_decimation)
+{
+  Link link;
+  PriorityRawSampleOutputStream output(new TestChannel(&link));
+  output.setHighRate(5.0);
+  output.setDecimate(4);
+
+  // low rate, high rate, and high rate configured as essential
+  SampleTag slow, fast, fastEssential;
+  initTag(slow, 1, 1.0);
+  initTag(fast, 2, 20.0);
+  initTag(fastEssential, 3, 20.0);
+  ParameterT<std::string>* prio = new ParameterT<std::string>;
+  prio->setName("priority");
+  prio->setValue("essential");
+  fastEssential.addParameter(prio);
+  output.addSourceSampleTag(&slow);
+  output.addSourceSampleTag(&fast);
+  output.addSourceSampleTag(&fastEssential);
+
+  // Everything is written while the link keeps up.
+  dsm_time_t tt = 0;
+  for (int i = 0; i < 20; ++i, ++tt)
+  {
+    receiveSample(output, slow, tt);
+    receiveSample(output, fast, tt);
+  }
+  output.flush();
+  BOOST_CHECK(!output.isCongested());
+  BOOST_CHECK_EQUAL(link.timeTags(slow.getId()).size(), 20u);
+  BOOST_CHECK_EQUAL(link.timeTags(fast.getId()).size(), 20u);
+
+  // The link stalls, until the IOStream buffer fills.
+  link.blocked = true;
+  for (int i = 0; i < 100 && !output.isCongested(); ++i, ++tt)
+    receiveSample(output, slow, tt);
+  BOOST_REQUIRE(output.isCongested());
+
+  // While congested, 3 of every 4 bulk samples are not written.
+  for (int i = 0; i < 40; ++i, ++tt)
+  {
+    receiveSample(output, fast, tt);
+    receiveSample(output, fastEssential, tt);
+    if (i % 4 == 0) receiveSample(output, slow, tt);
+  }
+  BOOST_CHECK_EQUAL(output.getNumDecimatedSamples(), 30);
+
+  // Once a physical write empties the buffer, the link is no longer
+  // congested, and the current samples are written.
+  link.blocked = false;
+  for (int i = 0; i < 100 && output.isCongested(); ++i, ++tt)
+    receiveSample(output, slow, tt);
+  BOOST_CHECK(!output.isCongested());
+
+  dsm_time_t tfast = tt;
+  for (int i = 0; i < 8; ++i, ++tt)
+    receiveSample(output, fast, tt);
+  output.flush();
+  BOOST_CHECK_EQUAL(output.getNumDecimatedSamples(), 30);
+  std::vector<dsm_time_t> tags = link.timeTags(fast.getId());
+  BOOST_REQUIRE(tags.size() >= 8);
+  BOOST_CHECK_EQUAL(tags[tags.size() - 8], tfast);
+  BOOST_CHECK_EQUAL(tags.back(), tt - 1);
+}
+
+
+BOOST_AUTO_TEST_CASE(test_spool_output_handoff)
+{
+  TmpDir tmp;
+  Link link;
+  TestRequester rqstr;
+  SampleTag tag;
+  initTag(tag, 1, 1.0);
+
+  // As configured: not connected, spooling every sample.
+  SpoolRawSampleOutputStream orig;
+  orig.setIOChannel(new TestChannel(&link));
+  orig.setSpoolDirectory(tmp.path("spool"));
+  rqstr.source.addSampleClient(&orig);
+
+  dsm_time_t tt = 0;
+  for ( ; tt < 50; ++tt) distributeSample(rqstr.source, tag, tt);
+  BOOST_CHECK_EQUAL(orig.getNumDeferredSamples(), 50);
+  BOOST_CHECK(link.bytes.empty());
+
+  // Connected: the clone writes the current samples and replays the spool.
+  orig.requestConnection(&rqstr);
+  BOOST_REQUIRE(rqstr.connected);
+  BOOST_REQUIRE(rqstr.connected != &orig);
+  for ( ; tt < 100; ++tt) distributeSample(rqstr.source, tag, tt);
+  BOOST_CHECK_EQUAL(orig.getNumDeferredSamples(), 50);
+  BOOST_CHECK_EQUAL(orig.getSpoolPendingBytes(), 0);
+
+  // The link stalls, and the clone spools what it can't write.
+  link.blocked = true;
+  for ( ; tt < 150; ++tt) distributeSample(rqstr.source, tag, tt);
+  SpoolRawSampleOutputStream* clone =
+    dynamic_cast<SpoolRawSampleOutputStream*>(rqstr.connected);
+  BOOST_REQUIRE(clone);
+  BOOST_CHECK(clone->getNumDeferredSamples() > 0);
+
+  // Disconnected: the original spools again, and the clone is gone.
+  link.blocked = false;
+  rqstr.disconnect(rqstr.connected);
+  for ( ; tt < 200; ++tt) distributeSample(rqstr.source, tag, tt);
+  BOOST_CHECK_EQUAL(orig.getNumDeferredSamples(), 100);
+
+  // Reconnected: everything is replayed.
+  orig.requestConnection(&rqstr);
+  BOOST_REQUIRE(rqstr.connected);
+  for ( ; tt < 300; ++tt) distributeSample(rqstr.source, tag, tt);
+  BOOST_CHECK_EQUAL(orig.getSpoolPendingBytes(), 0);
+  rqstr.disconnect(rqstr.connected);
+  rqstr.source.removeSampleClient(&orig);
+  orig.close();
+
+  // Each sample was received once, the replayed ones out of order.
+  std::vector<dsm_time_t> tags = link.timeTags(tag.getId());
+  std::set<dsm_time_t> unique(tags.begin(), tags.end());
+  BOOST_CHECK_EQUAL(tags.size(), 300u);
+  BOOST_CHECK_EQUAL(unique.size(), 300u);
+  BOOST_CHECK_EQUAL(*unique.rbegin(), 299);
+}
+
+
+BOOST_AUTO_TEST_CASE(test_spool_output_replay_rate)
+{
+  TmpDir tmp;
+  Link link;
+  TestRequester rqstr;
+  SampleTag tag;
+  initTag(tag, 1, 1.0);
+
+  SpoolRawSampleOutputStream orig;
+  orig.setIOChannel(new TestChannel(&link));
+  orig.setSpoolDirectory(tmp.path("spool"));
+  // 36 byte samples, replayed at about 20 per second
+  orig.setReplayRate(720.0);
+  rqstr.source.addSampleClient(&orig);
+
+  dsm_time_t tt = 0;
+  for ( ; tt < 100; ++tt) distributeSample(rqstr.source, tag, tt);
+
+  orig.requestConnection(&rqstr);
+  BOOST_REQUIRE(rqstr.connected);
+  SpoolRawSampleOutputStream* clone =
+    dynamic_cast<SpoolRawSampleOutputStream*>(rqstr.connected);
+  BOOST_REQUIRE(clone);
+
+  // current samples every 10 msec for half a second
+  struct timespec t0, t1;
+  ::clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < 50; ++i, ++tt)
+  {
+    struct timespec ts = { 0, 10 * NSECS_PER_MSEC };
+    ::nanosleep(&ts, 0);
+    distributeSample(rqstr.source, tag, tt);
+  }
+  ::clock_gettime(CLOCK_MONOTONIC, &t1);
+  double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1.e-9;
+
+  // The credit may go one sample past the rate.
+  long long nreplay = clone->getNumBackfilledSamples();
+  BOOST_TEST_MESSAGE("replayed " << nreplay << " in " << secs << " sec");
+  BOOST_CHECK(nreplay > 0);
+  BOOST_CHECK(nreplay * 36 <= 720.0 * secs + 36);
+  BOOST_CHECK(orig.getSpoolPendingBytes() > 0);
+
+  rqstr.disconnect(rqstr.connected);
+  rqstr.source.removeSampleClient(&orig);
+  orig.close();
+}
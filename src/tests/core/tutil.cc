@@ -4,6 +4,15 @@
 using boost::unit_test_framework::test_suite;
 
 #include <nidas/util/MutexCount.h>
+#include <nidas/util/EndianConverter.h>
+#include <nidas/dynld/isff/CSI_IRGA_Sonic.h>
+
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "../benchmark.h"
 
 using namespace nidas::util;
 
@@ -23,3 +32,180 @@ BOOST_AUTO_TEST_CASE(test_mutex_count)
   BOOST_CHECK_EQUAL((int)--v, 0);
 }
 
+
+
+BOOST_AUTO_TEST_CASE(test_endian_inline)
+{
+  const EndianConverter* fromBig =
+    EndianConverter::getConverter(EndianConverter::EC_BIG_ENDIAN);
+  const EndianConverter* fromLittle =
+    EndianConverter::getConverter(EndianConverter::EC_LITTLE_ENDIAN);
+
+  // unaligned values
+  unsigned char buf[9] = { 0, 0x81, 0x02, 0xc3, 0x04, 0x3f, 0x9e, 0x06, 0x07 };
+  const unsigned char* p = buf + 1;
+
+  BOOST_CHECK_EQUAL(bigUint16In(p), fromBig->uint16Value(p));
+  BOOST_CHECK_EQUAL(bigUint16In(p), 0x8102);
+  BOOST_CHECK_EQUAL(bigInt16In(p), fromBig->int16Value(p));
+  BOOST_CHECK_EQUAL(bigUint32In(p), fromBig->uint32Value(p));
+  BOOST_CHECK_EQUAL(bigUint32In(p), 0x8102c304u);
+  BOOST_CHECK_EQUAL(bigInt32In(p), fromBig->int32Value(p));
+  BOOST_CHECK_EQUAL(bigFloatIn(p + 4), fromBig->floatValue(p + 4));
+
+  BOOST_CHECK_EQUAL(littleUint16In(p), fromLittle->uint16Value(p));
+  BOOST_CHECK_EQUAL(littleUint16In(p), 0x0281);
+  BOOST_CHECK_EQUAL(littleInt16In(p + 1), fromLittle->int16Value(p + 1));
+  BOOST_CHECK_EQUAL(littleUint32In(p), fromLittle->uint32Value(p));
+  BOOST_CHECK_EQUAL(littleUint32In(p), 0x04c30281u);
+  BOOST_CHECK_EQUAL(littleInt32In(p), fromLittle->int32Value(p));
+  BOOST_CHECK_EQUAL(littleFloatIn(p + 4), fromLittle->floatValue(p + 4));
+}
+
+namespace {
+
+template <EndianConverter::endianness E>
+void
+check_endian_bulk(const std::vector<unsigned char>& buf, unsigned int n)
+{
+  typedef EndianIn<E> In;
+  const EndianConverter* conv = EndianConverter::getConverter(E);
+
+  // unaligned input
+  const unsigned char* p = &buf[1];
+  std::vector<float> out(n);
+
+  In::int16ToFloat(p, &out[0], n, 0.01, -5.0);
+  for (unsigned int i = 0; i < n; i++)
+    BOOST_CHECK_EQUAL(out[i], conv->int16Value(p + i * 2) * 0.01f - 5.0f);
+
+  In::uint16ToFloat(p, &out[0], n);
+  for (unsigned int i = 0; i < n; i++)
+    BOOST_CHECK_EQUAL(out[i], (float)conv->uint16Value(p + i * 2));
+
+  In::int32ToFloat(p, &out[0], n, 2.0, 1.0);
+  for (unsigned int i = 0; i < n; i++)
+    BOOST_CHECK_EQUAL(out[i], conv->int32Value(p + i * 4) * 2.0f + 1.0f);
+
+  In::uint32ToFloat(p, &out[0], n);
+  for (unsigned int i = 0; i < n; i++)
+    BOOST_CHECK_EQUAL(out[i], (float)conv->uint32Value(p + i * 4));
+
+  In::floatToFloat(p, &out[0], n);
+  for (unsigned int i = 0; i < n; i++) {
+    float f = conv->floatValue(p + i * 4);
+    BOOST_CHECK_EQUAL(::memcmp(&out[i], &f, sizeof(f)), 0);
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(test_endian_bulk)
+{
+  std::vector<unsigned char> buf(1 + 37 * 4);
+  unsigned int seed = 1;
+  for (unsigned int i = 0; i < buf.size(); i++) {
+    seed = seed * 1103515245 + 12345;
+    buf[i] = seed >> 16;
+  }
+  // lengths with and without a remainder after the vectorized loops
+  for (unsigned int n = 0; n <= 37; n += 1) {
+    check_endian_bulk<EndianConverter::EC_BIG_ENDIAN>(buf, n);
+    check_endian_bulk<EndianConverter::EC_LITTLE_ENDIAN>(buf, n);
+  }
+}
+
+namespace {
+
+/**
+ * The byte by byte signature of the EC150 manual, which the unrolled
+ * CSI_IRGA_Sonic::signature() replaced.
+ */
+unsigned short
+referenceSignature(const unsigned char* buf, const unsigned char* eob)
+{
+  unsigned char msb, lsb;
+  unsigned char b;
+  unsigned short seed = 0xaaaa;
+  msb = seed >> 8;
+  lsb = seed;
+  for ( ; buf < eob; ) {
+    b = (lsb << 1) + msb + *buf++;
+    if (lsb & 0x80) b++;
+    msb = lsb;
+    lsb = b;
+  }
+  return (unsigned short)((msb << 8) + lsb);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(test_irga_signature)
+{
+  using nidas::dynld::isff::CSI_IRGA_Sonic;
+
+  // lengths with each remainder after the unrolled loop,
+  // of random buffers at an unaligned address
+  unsigned char buf[1 + 9];
+  unsigned int seed = 1;
+  for (unsigned int len = 0; len <= 9; len++) {
+    for (int n = 0; n < 1000; n++) {
+      for (unsigned int i = 0; i < sizeof(buf); i++) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = seed >> 16;
+      }
+      const unsigned char* p = buf + 1;
+      unsigned short sig = CSI_IRGA_Sonic::signature(p, p + len);
+      BOOST_CHECK_EQUAL(sig, referenceSignature(p, p + len));
+      if (sig != referenceSignature(p, p + len)) break;
+    }
+  }
+  BOOST_CHECK_EQUAL(CSI_IRGA_Sonic::signature(buf, buf), 0xaaaa);
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_endian_bulk)
+{
+  // big-endian int16 counts to scaled floats, 64 at a time,
+  // as virtual calls per value, inline per value, and in bulk.
+  // As in a sensor, the number of values isn't known at compile time.
+  volatile unsigned int nvol = 64;
+  const unsigned int n = nvol;
+  const int nloop = 200000;
+  std::vector<unsigned char> buf(n * 2 + 1);
+  for (unsigned int i = 0; i < buf.size(); i++) buf[i] = i * 7;
+  std::vector<float> out(n);
+  const unsigned char* p = &buf[1];
+
+  const EndianConverter* conv =
+    EndianConverter::getConverter(EndianConverter::EC_BIG_ENDIAN);
+
+  struct timespec t0;
+  ::clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int l = 0; l < nloop; l++) {
+    buf[1] = l;
+    for (unsigned int i = 0; i < n; i++)
+      out[i] = conv->int16Value(p + i * 2) * 0.01f + 1.0f;
+  }
+  double tvirt = elapsed(t0);
+
+  ::clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int l = 0; l < nloop; l++) {
+    buf[1] = l;
+    for (unsigned int i = 0; i < n; i++)
+      out[i] = BigEndianIn::int16Value(p + i * 2) * 0.01f + 1.0f;
+  }
+  double tinline = elapsed(t0);
+
+  ::clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int l = 0; l < nloop; l++) {
+    buf[1] = l;
+    BigEndianIn::int16ToFloat(p, &out[0], n, 0.01, 1.0);
+  }
+  double tbulk = elapsed(t0);
+
+  double nvals = (double) nloop * n;
+  std::cout << "big-endian int16 to float: virtual " <<
+    nvals / tvirt / 1.e6 << " Mvals/s, inline " <<
+    nvals / tinline / 1.e6 << " Mvals/s, bulk " <<
+    nvals / tbulk / 1.e6 << " Mvals/s" << std::endl;
+}
@@ -0,0 +1,339 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/core/DatagramSocket.h>
+#include <nidas/core/SampleSourceSupport.h>
+#include <nidas/core/SlidingAverager.h>
+#include <nidas/core/Variable.h>
+#include <nidas/dynld/raf/CVIOutput.h>
+#include <nidas/dynld/raf/CVI_LV_Input.h>
+#include <nidas/util/Socket.h>
+#include <nidas/util/UTime.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace nidas::core;
+using namespace nidas::dynld::raf;
+namespace n_u = nidas::util;
+
+namespace {
+
+/**
+ * Keep the samples sent by a SampleSource.
+ */
+class Collector: public SampleClient
+{
+public:
+    Collector(): samples() {}
+
+    ~Collector()
+    {
+        for (unsigned int i = 0; i < samples.size(); i++)
+            samples[i]->freeReference();
+    }
+
+    bool receive(const Sample* samp) throw()
+    {
+        samp->holdReference();
+        samples.push_back(samp);
+        return true;
+    }
+
+    void flush() throw() {}
+
+    std::vector<const Sample*> samples;
+
+private:
+    Collector(const Collector&);
+    Collector& operator=(const Collector&);
+};
+
+/**
+ * A client of a SlidingAverager which reads its latency statistics
+ * as each average arrives.
+ */
+class StatsReader: public SampleClient
+{
+public:
+    StatsReader(SlidingAverager& averager): _averager(averager), nout() {}
+
+    bool receive(const Sample*) throw()
+    {
+        nout.push_back(_averager.getLatencyStats().nout);
+        return true;
+    }
+
+    void flush() throw() {}
+
+private:
+    SlidingAverager& _averager;
+
+public:
+    std::vector<unsigned int> nout;
+
+private:
+    StatsReader(const StatsReader&);
+    StatsReader& operator=(const StatsReader&);
+};
+
+/**
+ * A CVI_LV_Input whose sample is the seconds of day echoed
+ * back from LabView, followed by CVCNC and CVFXO.
+ */
+class LVInput
+{
+public:
+    LVInput(): sensor(), tag(new SampleTag(&sensor))
+    {
+        sensor.setDSMId(1);
+        sensor.setSensorId(100);
+        tag->setSampleId(1);
+        tag->setRate(10.0);
+        tag->setScanfFormat("%f,%f,%f");
+        const char* names[] = { "CVTDIFF", "CVCNC", "CVFXO" };
+        for (int i = 0; i < 3; i++) {
+            Variable* var = new Variable();
+            var->setName(names[i]);
+            tag->addVariable(var);
+        }
+        sensor.addSampleTag(tag);
+        sensor.init();
+    }
+
+    /**
+     * Process a record from LabView, received at tt.
+     */
+    void
+    process(dsm_time_t tt, const std::string& rec,
+            std::list<const Sample*>& results)
+    {
+        SampleT<char>* samp = getSample<char>(rec.length() + 1);
+        ::strcpy(samp->getDataPtr(), rec.c_str());
+        samp->setTimeTag(tt);
+        samp->setId(sensor.getId());
+        sensor.process(samp, results);
+        samp->freeReference();
+    }
+
+    CVI_LV_Input sensor;
+
+    SampleTag* tag;
+
+private:
+    LVInput(const LVInput&);
+    LVInput& operator=(const LVInput&);
+};
+
+std::string
+lvRecord(double secOfDay, float cnc, float fxo)
+{
+    char buf[64];
+    ::snprintf(buf, sizeof(buf), "%.2f,%.2f,%.2f\r\n", secOfDay, cnc, fxo);
+    return buf;
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_lv_input_timetag)
+{
+    LVInput lv;
+    dsm_time_t day = n_u::UTime(true, 2024, 3, 1, 0, 0, 0).toUsecs();
+
+    // LabView echoes the time the raw data was sampled, 0.4 sec earlier.
+    std::list<const Sample*> results;
+    dsm_time_t tt = day + (dsm_time_t)43200 * USECS_PER_SEC;
+    lv.process(tt, lvRecord(43199.6, 5.0, 2.0), results);
+    BOOST_REQUIRE_EQUAL(results.size(), 1u);
+
+    const SampleT<float>* fsamp =
+        static_cast<const SampleT<float>*>(results.front());
+    // CVI_LV_Input converts the seconds of day as a float
+    dsm_time_t texp = day + (dsm_time_t)43199 * USECS_PER_SEC +
+        600 * USECS_PER_MSEC;
+    BOOST_CHECK(::llabs(fsamp->getTimeTag() - texp) < 5 * USECS_PER_MSEC);
+    BOOST_CHECK_CLOSE(fsamp->getConstDataPtr()[0], 0.4, 2.0);
+    BOOST_CHECK_EQUAL(fsamp->getConstDataPtr()[1], 5.0);
+    fsamp->freeReference();
+}
+
+BOOST_AUTO_TEST_CASE(test_sliding_average)
+{
+    LVInput lv;
+    SampleSourceSupport source(false);
+    source.addSampleTag(lv.tag);
+
+    SlidingAverager averager;
+    averager.setAveragePeriodSecs(1.0);
+    averager.setWindowSecs(2.0);
+    averager.setLatencyBudgetSecs(30.0);
+    averager.addVariable(&lv.tag->getVariable(1));
+    averager.addVariable(&lv.tag->getVariable(2));
+    averager.connect(&source);
+
+    Collector collector;
+    averager.addSampleClient(&collector);
+
+    // Replay 10 seconds of 10 Hz LabView records, which end a few
+    // seconds before now, with CVCNC equal to the tenth of the second.
+    // The records are sampled between the tenths of a second, so that
+    // their float seconds of day don't round across a second.
+    dsm_time_t now = n_u::getSystemTime();
+    dsm_time_t t0 = now - (now % USECS_PER_SEC) - 12 * USECS_PER_SEC;
+    dsm_time_t day = t0 - (t0 % USECS_PER_DAY);
+    for (int i = 0; i < 100; i++) {
+        dsm_time_t tsamp = t0 + i * USECS_PER_SEC / 10 + 50 * USECS_PER_MSEC;
+        double sod = (double)(tsamp - day) / USECS_PER_SEC;
+        std::list<const Sample*> results;
+        lv.process(tsamp + 200 * USECS_PER_MSEC,
+                   lvRecord(sod, i % 10, i < 50 ? 1.0 : 3.0), results);
+        std::list<const Sample*>::const_iterator si = results.begin();
+        for ( ; si != results.end(); ++si) {
+            source.distribute(*si);
+        }
+    }
+
+    // an output at the end of each second after the first
+    BOOST_REQUIRE_EQUAL(collector.samples.size(), 9u);
+    for (unsigned int i = 0; i < collector.samples.size(); i++) {
+        const SampleT<float>* fsamp =
+            static_cast<const SampleT<float>*>(collector.samples[i]);
+        // window of 2 seconds, centered 1 second before the end
+        dsm_time_t tend = t0 + (i + 1) * USECS_PER_SEC;
+        BOOST_CHECK_EQUAL(fsamp->getTimeTag(), tend - USECS_PER_SEC);
+        BOOST_REQUIRE_EQUAL(fsamp->getDataLength(), 2u);
+        BOOST_CHECK_CLOSE(fsamp->getConstDataPtr()[0], 4.5, 1.e-4);
+        float fxo = (tend <= t0 + 5 * USECS_PER_SEC) ? 1.0 :
+            (tend == t0 + 6 * USECS_PER_SEC ? 2.0 : 3.0);
+        BOOST_CHECK_CLOSE(fsamp->getConstDataPtr()[1], fxo, 1.e-4);
+    }
+
+    SlidingAverager::LatencyStats stats = averager.getLatencyStats();
+    BOOST_CHECK_EQUAL(stats.nout, 9u);
+    BOOST_CHECK_EQUAL(stats.nOverBudget, 0u);
+    BOOST_CHECK(stats.max > 0);
+    BOOST_CHECK(stats.max < 30 * USECS_PER_SEC);
+
+    // reading the stats doesn't reset them
+    stats = averager.getLatencyStats();
+    BOOST_CHECK_EQUAL(stats.nout, 9u);
+    averager.resetLatencyStats();
+    stats = averager.getLatencyStats();
+    BOOST_CHECK_EQUAL(stats.nout, 0u);
+
+    // latencies over a tight budget are counted
+    averager.setLatencyBudgetSecs(0.001);
+    averager.flush();
+    stats = averager.getLatencyStats();
+    BOOST_CHECK_EQUAL(stats.nout, 1u);
+    BOOST_CHECK_EQUAL(stats.nOverBudget, 1u);
+
+    averager.removeSampleClient(&collector);
+    averager.disconnect(&source);
+}
+
+BOOST_AUTO_TEST_CASE(test_sliding_average_unlocked)
+{
+    LVInput lv;
+    SampleSourceSupport source(false);
+    source.addSampleTag(lv.tag);
+
+    SlidingAverager averager;
+    averager.setAveragePeriodSecs(1.0);
+    averager.addVariable(&lv.tag->getVariable(1));
+    averager.connect(&source);
+
+    // The averages are sent without the lock of the averager,
+    // so its clients can call it.
+    StatsReader reader(averager);
+    averager.addSampleClient(&reader);
+
+    dsm_time_t now = n_u::getSystemTime();
+    dsm_time_t t0 = now - (now % USECS_PER_SEC) - 5 * USECS_PER_SEC;
+    dsm_time_t day = t0 - (t0 % USECS_PER_DAY);
+    for (int i = 0; i <= 30; i++) {
+        dsm_time_t tsamp = t0 + i * USECS_PER_SEC / 10 + 50 * USECS_PER_MSEC;
+        double sod = (double)(tsamp - day) / USECS_PER_SEC;
+        std::list<const Sample*> results;
+        lv.process(tsamp, lvRecord(sod, 1.0, 0.0), results);
+        std::list<const Sample*>::const_iterator si = results.begin();
+        for ( ; si != results.end(); ++si) {
+            source.distribute(*si);
+        }
+    }
+    averager.flush();
+
+    // the latency of an average is counted after it is sent
+    BOOST_REQUIRE_EQUAL(reader.nout.size(), 4u);
+    for (unsigned int i = 0; i < reader.nout.size(); i++)
+        BOOST_CHECK_EQUAL(reader.nout[i], i);
+
+    averager.removeSampleClient(&reader);
+    averager.disconnect(&source);
+}
+
+BOOST_AUTO_TEST_CASE(test_udp_loopback)
+{
+    LVInput lv;
+    SampleSourceSupport source(false);
+    source.addSampleTag(lv.tag);
+
+    SlidingAverager averager;
+    averager.setAveragePeriodSecs(1.0);
+    averager.addVariable(&lv.tag->getVariable(1));
+    averager.connect(&source);
+
+    // the CVI computer
+    n_u::DatagramSocket receiver(0);
+    receiver.setTimeout(5000);
+
+    DatagramSocket* sender = new DatagramSocket();
+    sender->setHostPort("127.0.0.1", receiver.getLocalPort());
+    sender->connect();
+    CVIOutput output(sender);
+    averager.addSampleClient(&output);
+
+    dsm_time_t now = n_u::getSystemTime();
+    dsm_time_t t0 = now - (now % USECS_PER_SEC) - 5 * USECS_PER_SEC;
+    dsm_time_t day = t0 - (t0 % USECS_PER_DAY);
+    for (int i = 0; i <= 30; i++) {
+        dsm_time_t tsamp = t0 + i * USECS_PER_SEC / 10 + 50 * USECS_PER_MSEC;
+        double sod = (double)(tsamp - day) / USECS_PER_SEC;
+        std::list<const Sample*> results;
+        lv.process(tsamp, lvRecord(sod, i / 10 + 1, 0.0), results);
+        std::list<const Sample*>::const_iterator si = results.begin();
+        for ( ; si != results.end(); ++si) {
+            source.distribute(*si);
+        }
+    }
+
+    // seconds of day, true airspeed, which is missing, CVCNC
+    for (int isec = 1; isec <= 3; isec++) {
+        char buf[512];
+        size_t len = receiver.recv(buf, sizeof(buf) - 1);
+        buf[len] = '\0';
+        std::istringstream ist(buf);
+        double sod, tas, cnc;
+        char comma;
+        ist >> sod >> comma >> tas >> comma >> cnc;
+        BOOST_REQUIRE(!ist.fail());
+        BOOST_CHECK_CLOSE(sod, (double)(t0 - day) / USECS_PER_SEC +
+                          isec - 0.5, 1.e-6);
+        BOOST_CHECK_EQUAL(tas, -99.99);
+        BOOST_CHECK_EQUAL(cnc, isec);
+        BOOST_CHECK(std::string(buf).find("\r\n") != std::string::npos);
+    }
+
+    averager.removeSampleClient(&output);
+    averager.disconnect(&source);
+    output.close();
+}
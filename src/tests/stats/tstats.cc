@@ -0,0 +1,840 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/dynld/StatisticsCruncher.h>
+#include <nidas/dynld/StatisticsFileOutput.h>
+#include <nidas/dynld/StatisticsProcessor.h>
+#include <nidas/core/FileSet.h>
+#include <nidas/core/SamplePool.h>
+#include <nidas/core/SampleSourceSupport.h>
+#include <nidas/core/Site.h>
+#include <nidas/core/Variable.h>
+#include <nidas/util/util.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "../benchmark.h"
+
+using namespace nidas::core;
+using namespace nidas::dynld;
+
+namespace {
+
+const dsm_time_t T0 = (dsm_time_t) 1700000000 * USECS_PER_SEC;
+
+// the start of a 60 second period
+const dsm_time_t T60 = T0 - T0 % (60 * USECS_PER_SEC);
+
+const char* VARNAMES[] = { "u.3m", "v.3m", "w.3m", "tc.3m", "h2o.3m" };
+const unsigned int NVARS = sizeof(VARNAMES) / sizeof(VARNAMES[0]);
+
+/**
+ * Keep the samples sent by the crunchers, by sample id.
+ */
+class Collector: public SampleClient
+{
+public:
+    Collector(): samples() {}
+
+    ~Collector()
+    {
+        std::map<dsm_sample_id_t, std::vector<const Sample*> >::iterator mi;
+        for (mi = samples.begin(); mi != samples.end(); ++mi)
+            for (unsigned int i = 0; i < mi->second.size(); i++)
+                mi->second[i]->freeReference();
+    }
+
+    bool receive(const Sample* samp) throw()
+    {
+        samp->holdReference();
+        samples[samp->getId()].push_back(samp);
+        return true;
+    }
+
+    void flush() throw() {}
+
+    std::map<dsm_sample_id_t, std::vector<const Sample*> > samples;
+};
+
+/**
+ * A source of 20 Hz samples of the variables in VARNAMES.
+ */
+class Source
+{
+public:
+    Source(): site(), tag(), source(false), seed(1), offset(0.0), values()
+    {
+        site.setName("test");
+        tag.setDSMId(1);
+        tag.setSensorId(10);
+        tag.setSampleId(1);
+        tag.setRate(20.0);
+        for (unsigned int i = 0; i < NVARS; i++) {
+            Variable* var = new Variable();
+            var->setName(VARNAMES[i]);
+            tag.addVariable(var);
+            var->setSite(&site);
+        }
+        source.addSampleTag(&tag);
+    }
+
+    /**
+     * Send the samples from t1 up to t2. Every 97th sample has
+     * a missing value. The values are added to offset, and kept
+     * in values.
+     */
+    void send(dsm_time_t t1, dsm_time_t t2)
+    {
+        for (dsm_time_t tt = t1; tt < t2; tt += USECS_PER_SEC / 20) {
+            SampleT<float>* samp = getSample<float>(NVARS);
+            samp->setTimeTag(tt);
+            samp->setId(tag.getId());
+            float* fp = samp->getDataPtr();
+            for (unsigned int i = 0; i < NVARS; i++) {
+                seed = seed * 1103515245 + 12345;
+                float x = ((seed / 65536) % 10000) / 1000.0 - 5.0;
+                fp[i] = offset + (i == 3 ? 20.0 : 2.0 * i) + x * (i + 1) / 4;
+            }
+            if (++nsamp % 97 == 0) fp[nsamp % NVARS] = floatNAN;
+            values.push_back(std::vector<double>(fp, fp + NVARS));
+            source.distribute(samp);
+        }
+    }
+
+    Site site;
+    SampleTag tag;
+    SampleSourceSupport source;
+    unsigned int seed;
+    float offset;
+    std::vector<std::vector<double> > values;
+    static unsigned int nsamp;
+};
+
+unsigned int Source::nsamp = 0;
+
+StatisticsCruncher*
+makeCruncher(StatisticsProcessor& proc, Source& source, unsigned int spsid,
+             float period, const std::string& type, bool himom)
+{
+    SampleTag req;
+    req.setDSMId(1);
+    req.setSampleId(spsid);
+    req.setRate(1.0 / period);
+    for (unsigned int i = 0; i < NVARS; i++) {
+        Variable* var = new Variable();
+        var->setName(VARNAMES[i]);
+        req.addVariable(var);
+        var->setSite(&source.site);
+    }
+    StatisticsCruncher* cruncher = new StatisticsCruncher(&proc, &req,
+        StatisticsCruncher::getStatisticsType(type), "", himom);
+    return cruncher;
+}
+
+void
+checkSamples(const std::vector<const Sample*>& s1,
+             const std::vector<const Sample*>& s2, bool exact)
+{
+    BOOST_REQUIRE_EQUAL(s1.size(), s2.size());
+    for (unsigned int i = 0; i < s1.size(); i++) {
+        BOOST_CHECK_EQUAL(s1[i]->getTimeTag(), s2[i]->getTimeTag());
+        BOOST_REQUIRE_EQUAL(s1[i]->getDataLength(), s2[i]->getDataLength());
+        const float* f1 = (const float*) s1[i]->getConstVoidDataPtr();
+        const float* f2 = (const float*) s2[i]->getConstVoidDataPtr();
+        for (unsigned int j = 0; j < s1[i]->getDataLength(); j++) {
+            BOOST_CHECK_EQUAL(std::isnan(f1[j]), std::isnan(f2[j]));
+            if (std::isnan(f1[j])) continue;
+            if (exact) BOOST_CHECK_EQUAL(f1[j], f2[j]);
+            else BOOST_CHECK_SMALL(f1[j] - f2[j],
+                                   1.e-5f * std::max(1.0f, std::fabs(f2[j])));
+        }
+    }
+}
+
+/**
+ * Compute statistics of 60 second periods, merged into 300 and
+ * 1800 second periods, and compare them to the statistics from
+ * separate crunchers of each period.
+ */
+void
+checkLongerPeriods(const std::string& type, bool himom, bool fillGaps,
+                   bool shifted = false)
+{
+    StatisticsProcessor proc;
+    Source source;
+    Collector collector;
+
+    const float periods[] = { 60.0, 300.0, 1800.0 };
+    std::vector<StatisticsCruncher*> crunchers;
+
+    StatisticsCruncher* merged = makeCruncher(proc, source, 1, periods[0],
+                                              type, himom);
+    merged->addLongerPeriod(periods[1], 11);
+    merged->addLongerPeriod(periods[2], 21);
+    crunchers.push_back(merged);
+    for (int i = 0; i < 3; i++)
+        crunchers.push_back(makeCruncher(proc, source, i + 2, periods[i],
+                                         type, himom));
+
+    for (unsigned int i = 0; i < crunchers.size(); i++) {
+        crunchers[i]->setFillGaps(fillGaps);
+        crunchers[i]->setShiftedSums(shifted);
+        crunchers[i]->connect(&source.source);
+        crunchers[i]->addSampleClient(&collector);
+    }
+    BOOST_CHECK_EQUAL(merged->getNumLongerPeriods(), 2u);
+    BOOST_CHECK_EQUAL(merged->getSampleTags().size(), 3u);
+
+    // 30 minutes of data, a gap of 40 minutes, then 33 minutes,
+    // ending in partial periods.
+    const dsm_time_t usecsPerMin = 60 * USECS_PER_SEC;
+    source.send(T0, T0 + 30 * usecsPerMin);
+    source.send(T0 + 70 * usecsPerMin, T0 + 103 * usecsPerMin);
+    for (unsigned int i = 0; i < crunchers.size(); i++)
+        crunchers[i]->flush();
+
+    // the merged sample ids, and those of the separate crunchers
+    const unsigned int ids[][2] = { { 1, 2 }, { 11, 3 }, { 21, 4 } };
+    for (int i = 0; i < 3; i++) {
+        dsm_sample_id_t id1 = SET_DSM_ID(SET_SPS_ID(0, ids[i][0]), 1);
+        dsm_sample_id_t id2 = SET_DSM_ID(SET_SPS_ID(0, ids[i][1]), 1);
+        BOOST_TEST_MESSAGE(type << ", period " << periods[i] << ": " <<
+            collector.samples[id1].size() << " samples");
+        BOOST_CHECK(collector.samples[id1].size() > 0);
+        checkSamples(collector.samples[id1], collector.samples[id2], i == 0);
+    }
+
+    for (unsigned int i = 0; i < crunchers.size(); i++) {
+        crunchers[i]->disconnect(&source.source);
+        crunchers[i]->removeSampleClient(&collector);
+        delete crunchers[i];
+    }
+}
+
+const char* TYPES[] = {
+    "mean", "sum", "variance", "minimum", "maximum", "covariance",
+    "flux", "reducedflux", "scalarflux", "trivar", "prunedtrivar"
+};
+const unsigned int NTYPES = sizeof(TYPES) / sizeof(TYPES[0]);
+
+}
+
+BOOST_AUTO_TEST_CASE(test_longer_periods)
+{
+    for (unsigned int i = 0; i < NTYPES; i++) {
+        checkLongerPeriods(TYPES[i], false, false);
+        checkLongerPeriods(TYPES[i], true, true);
+        checkLongerPeriods(TYPES[i], true, false, true);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_longer_period_multiple)
+{
+    StatisticsProcessor proc;
+    Source source;
+    StatisticsCruncher* cruncher = makeCruncher(proc, source, 1, 60.0,
+                                                "mean", false);
+    BOOST_CHECK_THROW(cruncher->addLongerPeriod(90.0, 11),
+                      nidas::util::InvalidParameterException);
+    BOOST_CHECK_THROW(cruncher->addLongerPeriod(60.0, 11),
+                      nidas::util::InvalidParameterException);
+    delete cruncher;
+}
+
+BOOST_AUTO_TEST_CASE(test_shifted_sums)
+{
+    // Variables with a mean which is large relative to their
+    // fluctuations. Compare their means and covariances to those
+    // computed in two passes.
+    StatisticsProcessor proc;
+    Source source;
+    source.offset = 1.e6;
+    Collector collector;
+
+    StatisticsCruncher* crunchers[2];
+    for (int i = 0; i < 2; i++) {
+        crunchers[i] = makeCruncher(proc, source, i + 1, 60.0,
+                                    "covariance", false);
+        crunchers[i]->setShiftedSums(i == 0);
+        crunchers[i]->connect(&source.source);
+        crunchers[i]->addSampleClient(&collector);
+    }
+    source.send(T60, T60 + 60 * USECS_PER_SEC);
+    for (int i = 0; i < 2; i++) crunchers[i]->flush();
+
+    // samples with a missing value are not used for covariances
+    std::vector<std::vector<double> > values;
+    for (unsigned int s = 0; s < source.values.size(); s++) {
+        const std::vector<double>& x = source.values[s];
+        if (std::find_if(x.begin(), x.end(),
+            static_cast<bool(*)(double)>(std::isnan)) == x.end())
+            values.push_back(x);
+    }
+    const unsigned int n = values.size();
+
+    std::vector<double> mean(NVARS, 0.0);
+    for (unsigned int s = 0; s < n; s++)
+        for (unsigned int i = 0; i < NVARS; i++) mean[i] += values[s][i];
+    for (unsigned int i = 0; i < NVARS; i++) mean[i] /= n;
+
+    std::vector<double> cov;
+    for (unsigned int i = 0; i < NVARS; i++) {
+        for (unsigned int j = i; j < NVARS; j++) {
+            double sum = 0.0;
+            for (unsigned int s = 0; s < n; s++)
+                sum += (values[s][i] - mean[i]) * (values[s][j] - mean[j]);
+            cov.push_back(sum / n);
+        }
+    }
+
+    const std::vector<const Sample*>& shifted =
+        collector.samples[SET_DSM_ID(SET_SPS_ID(0, 1), 1)];
+    const std::vector<const Sample*>& unshifted =
+        collector.samples[SET_DSM_ID(SET_SPS_ID(0, 2), 1)];
+    BOOST_REQUIRE_EQUAL(shifted.size(), 1u);
+    BOOST_REQUIRE_EQUAL(unshifted.size(), 1u);
+    BOOST_REQUIRE(shifted[0]->getDataLength() >= NVARS + cov.size());
+    const float* fs = (const float*) shifted[0]->getConstVoidDataPtr();
+    const float* fu = (const float*) unshifted[0]->getConstVoidDataPtr();
+
+    for (unsigned int i = 0; i < NVARS; i++)
+        BOOST_CHECK_CLOSE(fs[i], mean[i], 1.e-5);
+    double maxerr = 0.0;
+    for (unsigned int i = 0; i < cov.size(); i++) {
+        BOOST_CHECK_SMALL(fs[NVARS + i] - cov[i],
+                          1.e-4 * std::max(1.0, std::fabs(cov[i])));
+        maxerr = std::max(maxerr, std::fabs(fu[NVARS + i] - cov[i]));
+    }
+    BOOST_TEST_MESSAGE("maximum covariance error of unshifted sums: " <<
+                       maxerr);
+
+    for (int i = 0; i < 2; i++) {
+        crunchers[i]->disconnect(&source.source);
+        crunchers[i]->removeSampleClient(&collector);
+        delete crunchers[i];
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_merge_crunchers)
+{
+    // The samples of a period are split between two crunchers,
+    // which are merged and compared to a cruncher of all of them.
+    for (unsigned int it = 0; it < NTYPES; it++) {
+        StatisticsProcessor proc;
+        Source source;
+        Collector collector;
+
+        StatisticsCruncher* all = makeCruncher(proc, source, 1, 60.0,
+                                               TYPES[it], true);
+        StatisticsCruncher* first = makeCruncher(proc, source, 2, 60.0,
+                                                 TYPES[it], true);
+        StatisticsCruncher* second = makeCruncher(proc, source, 3, 60.0,
+                                                  TYPES[it], true);
+        first->setShiftedSums(true);
+        second->setShiftedSums(true);
+        StatisticsCruncher* crunchers[] = { all, first, second };
+        for (int i = 0; i < 3; i++) {
+            crunchers[i]->connect(&source.source);
+            crunchers[i]->addSampleClient(&collector);
+        }
+
+        source.source.removeSampleClient(second);
+        source.send(T60, T60 + 25 * USECS_PER_SEC);
+        source.source.removeSampleClient(first);
+        source.source.addSampleClient(second);
+        source.offset = 3.0;
+        source.send(T60 + 25 * USECS_PER_SEC, T60 + 60 * USECS_PER_SEC);
+
+        first->merge(*second);
+        all->flush();
+        first->flush();
+
+        checkSamples(collector.samples[SET_DSM_ID(SET_SPS_ID(0, 2), 1)],
+                     collector.samples[SET_DSM_ID(SET_SPS_ID(0, 1), 1)],
+                     false);
+
+        for (int i = 0; i < 3; i++) {
+            crunchers[i]->disconnect(&source.source);
+            crunchers[i]->removeSampleClient(&collector);
+            delete crunchers[i];
+        }
+    }
+
+    // crunchers of different statistics
+    StatisticsProcessor proc;
+    Source source;
+    StatisticsCruncher* mean = makeCruncher(proc, source, 1, 60.0,
+                                            "mean", false);
+    StatisticsCruncher* cov = makeCruncher(proc, source, 2, 60.0,
+                                           "covariance", false);
+    mean->connect(&source.source);
+    cov->connect(&source.source);
+    BOOST_CHECK_THROW(mean->merge(*cov),
+                      nidas::util::InvalidParameterException);
+    mean->disconnect(&source.source);
+    cov->disconnect(&source.source);
+    delete mean;
+    delete cov;
+}
+
+BOOST_AUTO_TEST_CASE(test_winddir_weights)
+{
+    // Samples with a weights variable, as from a NearestResampler,
+    // whose u or v is sometimes NAN, which the wind direction skips.
+    Site site;
+    site.setName("test");
+    SampleTag tag;
+    tag.setDSMId(1);
+    tag.setSensorId(10);
+    tag.setSampleId(1);
+    tag.setRate(20.0);
+    const char* names[] = { "u.3m", "v.3m", "weights" };
+    for (unsigned int i = 0; i < 3; i++) {
+        Variable* var = new Variable();
+        var->setName(names[i]);
+        if (i == 2) var->setType(Variable::WEIGHT);
+        tag.addVariable(var);
+        var->setSite(&site);
+    }
+    SampleSourceSupport source(false);
+    source.addSampleTag(&tag);
+
+    SampleTag req;
+    req.setDSMId(1);
+    req.setSampleId(1);
+    req.setRate(1.0 / 60.0);
+    for (unsigned int i = 0; i < 2; i++) {
+        Variable* var = new Variable();
+        var->setName(names[i]);
+        req.addVariable(var);
+        var->setSite(&site);
+    }
+
+    for (int shifted = 0; shifted < 2; shifted++) {
+        StatisticsProcessor proc;
+        StatisticsCruncher cruncher(&proc, &req,
+            StatisticsCruncher::getStatisticsType("winddir"), "", false);
+        cruncher.setShiftedSums(shifted);
+        cruncher.connect(&source);
+        Collector collector;
+        cruncher.addSampleClient(&collector);
+
+        double usum = 0.0, vsum = 0.0;
+        int n = 0;
+        for (int is = 0; is < 60 * 20; is++) {
+            SampleT<float>* samp = getSample<float>(3);
+            samp->setTimeTag(T60 + (dsm_time_t)is * USECS_PER_SEC / 20);
+            samp->setId(tag.getId());
+            float* fp = samp->getDataPtr();
+            fp[0] = 3.0 + (is % 7) * 0.1;
+            fp[1] = -2.0 + (is % 5) * 0.1;
+            // the weights value is the number of values in the sample
+            fp[2] = 2;
+            if (is % 50 == 0) fp[is % 100 == 0 ? 0 : 1] = floatNAN;
+            else {
+                usum += fp[0];
+                vsum += fp[1];
+                n++;
+            }
+            source.distribute(samp);
+        }
+        cruncher.flush();
+
+        BOOST_REQUIRE_EQUAL(collector.samples.size(), 1u);
+        const std::vector<const Sample*>& samps =
+            collector.samples.begin()->second;
+        BOOST_REQUIRE_EQUAL(samps.size(), 1u);
+        float dir = samps[0]->getDataValue(0);
+        BOOST_CHECK(!std::isnan(dir));
+        BOOST_CHECK_CLOSE(dir, nidas::util::dirFromUV(usum / n, vsum / n),
+                          1.e-3);
+
+        cruncher.disconnect(&source);
+        cruncher.removeSampleClient(&collector);
+    }
+}
+
+namespace {
+
+/**
+ * Read the blocks of a StatisticsFileOutput file from cp to ep,
+ * adding their records by sample id.
+ */
+void
+readStatisticsBlocks(const char* cp, const char* ep,
+    std::map<dsm_sample_id_t, unsigned int>& nvars,
+    std::map<dsm_sample_id_t, std::vector<dsm_time_t> >& times,
+    std::map<dsm_sample_id_t, std::vector<std::vector<float> > >& values)
+{
+    while (cp < ep) {
+        unsigned int hd[2];
+        BOOST_REQUIRE(cp + sizeof(hd) <= ep);
+        ::memcpy(hd, cp, sizeof(hd));
+        cp += sizeof(hd);
+        BOOST_REQUIRE(nvars.find(hd[0]) != nvars.end());
+        unsigned int nrec = hd[1];
+        unsigned int nv = nvars[hd[0]];
+        BOOST_REQUIRE(cp + nrec * (sizeof(dsm_time_t) +
+                                   nv * sizeof(float)) <= ep);
+        std::vector<dsm_time_t> tt(nrec);
+        ::memcpy(&tt[0], cp, nrec * sizeof(dsm_time_t));
+        cp += nrec * sizeof(dsm_time_t);
+        times[hd[0]].insert(times[hd[0]].end(), tt.begin(), tt.end());
+
+        std::vector<std::vector<float> > recs(nrec, std::vector<float>(nv));
+        for (unsigned int iv = 0; iv < nv; iv++)
+            for (unsigned int ir = 0; ir < nrec; ir++) {
+                ::memcpy(&recs[ir][iv], cp, sizeof(float));
+                cp += sizeof(float);
+            }
+        values[hd[0]].insert(values[hd[0]].end(), recs.begin(), recs.end());
+    }
+}
+
+/**
+ * Read and remove the files in dir, sorted by name.
+ */
+std::vector<std::string>
+readFiles(const std::string& dir)
+{
+    std::vector<std::string> files;
+    DIR* dp = ::opendir(dir.c_str());
+    BOOST_REQUIRE(dp);
+    struct dirent* de;
+    while ((de = ::readdir(dp)))
+        if (de->d_name[0] != '.') files.push_back(dir + "/" + de->d_name);
+    ::closedir(dp);
+    std::sort(files.begin(), files.end());
+
+    std::vector<std::string> contents;
+    for (unsigned int i = 0; i < files.size(); i++) {
+        std::ifstream in(files[i].c_str(), std::ios::binary);
+        contents.push_back(std::string((std::istreambuf_iterator<char>(in)),
+                                       std::istreambuf_iterator<char>()));
+        ::unlink(files[i].c_str());
+    }
+    return contents;
+}
+
+/**
+ * Read and remove the files of a StatisticsFileOutput in dir,
+ * returning their records by sample id, and the number of files.
+ */
+unsigned int
+readStatisticsFiles(const std::string& dir,
+    std::map<dsm_sample_id_t, std::vector<dsm_time_t> >& times,
+    std::map<dsm_sample_id_t, std::vector<std::vector<float> > >& values)
+{
+    std::vector<std::string> files = readFiles(dir);
+
+    for (unsigned int i = 0; i < files.size(); i++) {
+        const std::string& content = files[i];
+
+        const std::string eoh("end header\n");
+        size_t ie = content.find(eoh);
+        BOOST_REQUIRE(ie != std::string::npos);
+        BOOST_CHECK(content.find("little endian") != std::string::npos ||
+                    content.find("big endian") != std::string::npos);
+
+        std::map<dsm_sample_id_t, unsigned int> nvars;
+        std::istringstream hdr(content.substr(0, ie));
+        std::string line;
+        while (std::getline(hdr, line)) {
+            if (line.compare(0, 7, "sample:")) continue;
+            unsigned int id = 0, nv = 0;
+            size_t ii = line.find(" id=");
+            size_t in = line.find(" nvars=");
+            BOOST_REQUIRE(ii != std::string::npos && in != std::string::npos);
+            id = ::strtoul(line.c_str() + ii + 4, 0, 10);
+            nv = ::strtoul(line.c_str() + in + 7, 0, 10);
+            nvars[id] = nv;
+        }
+
+        readStatisticsBlocks(content.data() + ie + eoh.length(),
+                             content.data() + content.length(),
+                             nvars, times, values);
+    }
+    return files.size();
+}
+
+/**
+ * Check the records read from the files against the samples
+ * sent by the crunchers.
+ */
+void
+checkStatisticsRecords(Collector& collector,
+    std::map<dsm_sample_id_t, std::vector<dsm_time_t> >& times,
+    std::map<dsm_sample_id_t, std::vector<std::vector<float> > >& values)
+{
+    BOOST_CHECK_EQUAL(times.size(), collector.samples.size());
+    std::map<dsm_sample_id_t, std::vector<const Sample*> >::const_iterator mi;
+    for (mi = collector.samples.begin(); mi != collector.samples.end(); ++mi) {
+        dsm_sample_id_t id = mi->first;
+        const std::vector<const Sample*>& samps = mi->second;
+        BOOST_REQUIRE_EQUAL(times[id].size(), samps.size());
+        for (unsigned int is = 0; is < samps.size(); is++) {
+            BOOST_CHECK_EQUAL(times[id][is], samps[is]->getTimeTag());
+            BOOST_REQUIRE_EQUAL(values[id][is].size(),
+                                samps[is]->getDataLength());
+            const float* fp = (const float*) samps[is]->getConstVoidDataPtr();
+            for (unsigned int iv = 0; iv < samps[is]->getDataLength(); iv++) {
+                BOOST_CHECK_EQUAL(std::isnan(values[id][is][iv]),
+                                  std::isnan(fp[iv]));
+                if (!std::isnan(fp[iv]))
+                    BOOST_CHECK_EQUAL(values[id][is][iv], fp[iv]);
+            }
+        }
+    }
+}
+
+/**
+ * A FileSet which, like a DatagramSocket, doesn't write a header.
+ */
+class NoHeaderFileSet: public FileSet
+{
+public:
+    bool writeNidasHeader() const { return false; }
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(test_statistics_file_output)
+{
+    char tmpl[] = "/tmp/tstats_XXXXXX";
+    BOOST_REQUIRE(::mkdtemp(tmpl));
+    std::string dir(tmpl);
+
+    StatisticsProcessor proc;
+    Source source;
+    Collector collector;
+
+    StatisticsCruncher* crunchers[] = {
+        makeCruncher(proc, source, 1, 60.0, "mean", false),
+        makeCruncher(proc, source, 2, 60.0, "covariance", false)
+    };
+    // with the 5 minute periods, the samples ending at a time
+    // are from different crunchers, and periods
+    crunchers[0]->addLongerPeriod(300.0, 11);
+    crunchers[1]->addLongerPeriod(300.0, 12);
+
+    FileSet* fset = new FileSet();
+    fset->setDir(dir);
+    fset->setFileName("stats_%Y%m%d_%H%M%S.dat");
+    fset->setFileLengthSecs(300);
+    StatisticsFileOutput* output = new StatisticsFileOutput(fset);
+    output->setRecordsPerBlock(4);
+
+    for (int i = 0; i < 2; i++) {
+        crunchers[i]->connect(&source.source);
+        crunchers[i]->addSampleClient(&collector);
+        crunchers[i]->addSampleClient(output);
+        output->addSourceSampleTags(crunchers[i]->getSampleTags());
+    }
+
+    // 12 minutes, starting 2 minutes into a 5 minute file, so the
+    // statistics span three files
+    const dsm_time_t tstart = T60 - T60 % (300 * USECS_PER_SEC) +
+        120 * USECS_PER_SEC;
+    source.send(tstart, tstart + 12 * 60 * USECS_PER_SEC);
+    for (int i = 0; i < 2; i++) crunchers[i]->flush();
+    output->flush();
+    output->close();
+
+    // A period for each minute, the last one from the flush of the
+    // crunchers, which also sends the partial 5 minute periods ending
+    // after it.
+    BOOST_CHECK_EQUAL(output->getNumPeriods(), 13u);
+    BOOST_CHECK_EQUAL(output->getNumDiscardedSamples(), 0u);
+
+    std::map<dsm_sample_id_t, std::vector<dsm_time_t> > times;
+    std::map<dsm_sample_id_t, std::vector<std::vector<float> > > values;
+    BOOST_CHECK_EQUAL(readStatisticsFiles(dir, times, values), 3u);
+    ::rmdir(dir.c_str());
+
+    for (int i = 0; i < 2; i++) {
+        BOOST_CHECK_EQUAL(
+            collector.samples[SET_DSM_ID(SET_SPS_ID(0, i + 1), 1)].size(), 12u);
+        BOOST_CHECK_EQUAL(
+            collector.samples[SET_DSM_ID(SET_SPS_ID(0, i + 11), 1)].size(), 3u);
+    }
+    checkStatisticsRecords(collector, times, values);
+
+    for (int i = 0; i < 2; i++) {
+        crunchers[i]->disconnect(&source.source);
+        crunchers[i]->removeSampleClient(&collector);
+        crunchers[i]->removeSampleClient(output);
+        delete crunchers[i];
+    }
+    delete output;
+}
+
+BOOST_AUTO_TEST_CASE(test_statistics_file_no_header)
+{
+    char tmpl[] = "/tmp/tstats_XXXXXX";
+    BOOST_REQUIRE(::mkdtemp(tmpl));
+    std::string dir(tmpl);
+
+    StatisticsProcessor proc;
+    Source source;
+    Collector collector;
+
+    StatisticsCruncher* cruncher =
+        makeCruncher(proc, source, 1, 60.0, "mean", false);
+
+    FileSet* fset = new NoHeaderFileSet();
+    fset->setDir(dir);
+    fset->setFileName("stats_%Y%m%d_%H%M%S.dat");
+    fset->setFileLengthSecs(3600);
+    StatisticsFileOutput* output = new StatisticsFileOutput(fset);
+
+    cruncher->connect(&source.source);
+    cruncher->addSampleClient(&collector);
+    cruncher->addSampleClient(output);
+    output->addSourceSampleTags(cruncher->getSampleTags());
+
+    // Without a header, the columns are still taken from the source tags.
+    source.send(T60, T60 + 5 * 60 * USECS_PER_SEC);
+    cruncher->flush();
+    output->flush();
+    output->close();
+    BOOST_CHECK_EQUAL(output->getNumDiscardedSamples(), 0u);
+
+    std::map<dsm_sample_id_t, unsigned int> nvars;
+    dsm_sample_id_t id = SET_DSM_ID(SET_SPS_ID(0, 1), 1);
+    nvars[id] = NVARS;
+    std::map<dsm_sample_id_t, std::vector<dsm_time_t> > times;
+    std::map<dsm_sample_id_t, std::vector<std::vector<float> > > values;
+    std::vector<std::string> files = readFiles(dir);
+    ::rmdir(dir.c_str());
+    BOOST_REQUIRE_EQUAL(files.size(), 1u);
+    readStatisticsBlocks(files[0].data(), files[0].data() + files[0].length(),
+                         nvars, times, values);
+    BOOST_CHECK_EQUAL(collector.samples[id].size(), 5u);
+    checkStatisticsRecords(collector, times, values);
+
+    cruncher->disconnect(&source.source);
+    cruncher->removeSampleClient(&collector);
+    cruncher->removeSampleClient(output);
+    delete cruncher;
+    delete output;
+}
+
+/*
+ * The statistics of a sonic in the StatisticsProcessor of
+ * tests/ck_xml/xml/CHATS.xml: 5 minute prunedtrivar of u,v,w,tc and
+ * means of the diagnostic flags, and for comparison other statistics
+ * of the sonic.
+ */
+BOOST_AUTO_TEST_CASE(benchmark_statistics)
+{
+    const char* names[] = {
+        "u.1t.10.6m", "v.1t.10.6m", "w.1t.10.6m", "tc.1t.10.6m",
+        "uflag.1t.10.6m", "vflag.1t.10.6m", "wflag.1t.10.6m",
+        "tcflag.1t.10.6m", "diag.1t.10.6m"
+    };
+    const unsigned int nnames = sizeof(names) / sizeof(names[0]);
+    struct {
+        const char* type;
+        unsigned int var1;
+        unsigned int nvars;
+    } configs[] = {
+        { "prunedtrivar", 0, 4 },
+        { "mean", 4, 5 },
+        { "variance", 0, 4 },
+        { "covariance", 0, 4 },
+        { "flux", 0, 4 },
+        { "trivar", 0, 4 },
+    };
+
+    Site site;
+    site.setName("ha");
+    SampleTag tag;
+    tag.setDSMId(1);
+    tag.setSensorId(10);
+    tag.setSampleId(1);
+    tag.setRate(20.0);
+    for (unsigned int i = 0; i < nnames; i++) {
+        Variable* var = new Variable();
+        var->setName(names[i]);
+        tag.addVariable(var);
+        var->setSite(&site);
+    }
+    SampleSourceSupport source(false);
+    source.addSampleTag(&tag);
+
+    // two hours of 20 Hz samples, from the start of a period
+    const dsm_time_t tstart = T0 - T0 % (300 * USECS_PER_SEC);
+    const unsigned int nsamp = 2 * 3600 * 20;
+    std::vector<SampleT<float>*> samples;
+    unsigned int seed = 1;
+    for (unsigned int n = 0; n < nsamp; n++) {
+        SampleT<float>* samp = getSample<float>(nnames);
+        samp->setTimeTag(tstart + (dsm_time_t)n * USECS_PER_SEC / 20);
+        samp->setId(tag.getId());
+        float* fp = samp->getDataPtr();
+        for (unsigned int i = 0; i < nnames; i++) {
+            seed = seed * 1103515245 + 12345;
+            fp[i] = ((seed / 65536) % 10000) / 1000.0 - 5.0;
+        }
+        if (n % 1000 == 999) fp[n % 4] = floatNAN;
+        samples.push_back(samp);
+    }
+
+    Collector collector;
+    StatisticsProcessor proc;
+    for (unsigned int ic = 0; ic < sizeof(configs) / sizeof(configs[0]); ic++) {
+        SampleTag req;
+        req.setDSMId(1);
+        req.setSampleId(ic + 1);
+        req.setRate(1.0 / 300.0);
+        for (unsigned int i = 0; i < configs[ic].nvars; i++) {
+            Variable* var = new Variable();
+            var->setName(names[configs[ic].var1 + i]);
+            req.addVariable(var);
+            var->setSite(&site);
+        }
+
+        // the best of several passes
+        const int npass = 3;
+        double secs = 0.0;
+        for (int ipass = 0; ipass < npass; ipass++) {
+            StatisticsCruncher cruncher(&proc, &req,
+                StatisticsCruncher::getStatisticsType(configs[ic].type), "",
+                false);
+            cruncher.connect(&source);
+            cruncher.addSampleClient(&collector);
+
+            struct timespec t0;
+            ::clock_gettime(CLOCK_MONOTONIC, &t0);
+            for (unsigned int n = 0; n < nsamp; n++)
+                cruncher.receive(samples[n]);
+            cruncher.flush();
+            double s = elapsed(t0);
+            if (ipass == 0 || s < secs) secs = s;
+
+            cruncher.disconnect(&source);
+            cruncher.removeSampleClient(&collector);
+        }
+
+        BOOST_CHECK_EQUAL(collector.samples[req.getId()].size(), npass * 24u);
+        std::cout << configs[ic].type << ": " <<
+            nsamp / secs / 1.e6 << " Msamples/s" << std::endl;
+    }
+
+    for (unsigned int n = 0; n < nsamp; n++) samples[n]->freeReference();
+}
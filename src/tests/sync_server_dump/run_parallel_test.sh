@@ -0,0 +1,53 @@
+#!/bin/bash
+
+source ../nidas_tests.sh
+check_executable sync_server
+check_executable sync_dump
+
+# Compare the sync records of a parallel sync_server, with two chunks,
+# to those of a serial one.
+
+export PROJ_DIR=$PWD/config
+
+export FLIGHT=test123
+
+tmpdir=$(mktemp -d /tmp/sync_parallel_test_XXXXXX)
+
+trap '{ rm -rf $tmpdir; }' EXIT
+
+data=data/dsm_20060908_200303.ads
+
+sync_server --logconfig enable,level=info -o $tmpdir/serial.dat $data \
+    > $tmpdir/serial.log 2>&1 || {
+    cat $tmpdir/serial.log
+    echo "serial sync_server failed"
+    exit 1
+}
+
+sync_server --logconfig enable,level=info -j 2 -o $tmpdir/parallel.dat $data \
+    > $tmpdir/parallel.log 2>&1 || {
+    cat $tmpdir/parallel.log
+    echo "parallel sync_server failed"
+    exit 1
+}
+grep -q "in 2 chunks" $tmpdir/parallel.log || {
+    cat $tmpdir/parallel.log
+    echo "parallel sync_server did not use 2 chunks"
+    exit 1
+}
+
+sync_dump -j $tmpdir/serial.json $tmpdir/serial.dat > /dev/null
+sync_dump -j $tmpdir/parallel.json $tmpdir/parallel.dat > /dev/null
+
+if [ ! -s $tmpdir/serial.json ]; then
+    echo "no sync records from the serial sync_server"
+    exit 1
+fi
+
+if ! diff $tmpdir/serial.json $tmpdir/parallel.json > $tmpdir/diff.log; then
+    head -20 $tmpdir/diff.log
+    echo "parallel sync records differ from the serial ones"
+    exit 1
+fi
+echo "parallel sync records are the same as the serial ones"
+exit 0
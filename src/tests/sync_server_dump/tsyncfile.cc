@@ -0,0 +1,199 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/dynld/raf/SyncRecordFile.h>
+#include <nidas/core/SampleTag.h>
+#include <nidas/util/IOException.h>
+#include <nidas/util/InvalidParameterException.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace nidas::core;
+using namespace nidas::dynld::raf;
+namespace n_u = nidas::util;
+
+namespace {
+
+const dsm_time_t T0 = (dsm_time_t) 1700000000 * USECS_PER_SEC;
+
+/**
+ * Variables of a sync record of a 1 Hz sample of two variables
+ * and a 10 Hz sample of a vector of length 2, in the layout of
+ * SyncRecordReader::scanHeader(): a lag, then the values of
+ * each variable of a rate.
+ */
+class Layout
+{
+public:
+    Layout(): slow(), fast(), variables()
+    {
+        slow.setRate(1.0);
+        fast.setRate(10.0);
+        add(slow, "PSX", 1, 1, 0);
+        add(slow, "TTX", 1, 2, 0);
+        add(fast, "UVX", 2, 4, 3);
+    }
+
+    void
+    add(SampleTag& tag, const std::string& name, int len,
+        int offset, int lagoffset)
+    {
+        SyncRecordVariable* var = new SyncRecordVariable();
+        var->setName(name);
+        var->setLength(len);
+        var->setSyncRecOffset(offset);
+        var->setLagOffset(lagoffset);
+        tag.addVariable(var);
+        variables.push_back(var);
+    }
+
+    static const size_t NUMVALUES = 3 + 1 + 20;
+
+    SampleTag slow;
+    SampleTag fast;
+    std::list<const SyncRecordVariable*> variables;
+};
+
+/**
+ * Record of second isec: the values are 1000 * isec plus
+ * their index in the record, the lags are 100 and 200.
+ */
+std::vector<double>
+makeRecord(int isec)
+{
+    std::vector<double> rec(Layout::NUMVALUES);
+    for (unsigned int i = 0; i < rec.size(); i++)
+        rec[i] = 1000.0 * isec + i;
+    rec[0] = 100.0;
+    rec[3] = 200.0;
+    return rec;
+}
+
+std::string
+tempName()
+{
+    char name[] = "/tmp/tsyncfile_XXXXXX";
+    int fd = ::mkstemp(name);
+    ::close(fd);
+    return name;
+}
+
+/**
+ * Write records of seconds [0, nsecs), without second gap.
+ */
+void
+writeFile(const std::string& path, const Layout& layout, int nsecs,
+          int gap)
+{
+    SyncRecordFileWriter writer;
+    writer.open(path, "project \"TEST\"\n#\n", layout.variables,
+                Layout::NUMVALUES);
+    for (int isec = 0; isec < nsecs; isec++) {
+        if (isec == gap) continue;
+        std::vector<double> rec = makeRecord(isec);
+        BOOST_CHECK(writer.write(T0 + isec * USECS_PER_SEC, &rec.front()));
+    }
+    // out of order
+    std::vector<double> rec = makeRecord(0);
+    BOOST_CHECK(!writer.write(T0, &rec.front()));
+    writer.close();
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_sync_file_records)
+{
+    Layout layout;
+    std::string path = tempName();
+    const int nsecs = 100;
+    writeFile(path, layout, nsecs, 50);
+
+    SyncRecordFile file(path);
+    BOOST_CHECK_EQUAL(file.textHeader(), "project \"TEST\"\n#\n");
+    BOOST_CHECK_EQUAL(file.getNumValues(), Layout::NUMVALUES);
+    BOOST_REQUIRE_EQUAL(file.getNumRecords(), (size_t)nsecs - 1);
+
+    std::vector<std::string> names = file.getVariableNames();
+    BOOST_REQUIRE_EQUAL(names.size(), 3u);
+    BOOST_CHECK_EQUAL(names[0], "PSX");
+    BOOST_CHECK_EQUAL(names[2], "UVX");
+
+    BOOST_CHECK_EQUAL(file.findRecord(LONG_LONG_MIN), 0u);
+    BOOST_CHECK_EQUAL(file.findRecord(T0 + 10 * USECS_PER_SEC), 10u);
+    BOOST_CHECK_EQUAL(file.findRecord(T0 + 10 * USECS_PER_SEC + 1), 11u);
+    // second 50 is missing
+    BOOST_CHECK_EQUAL(file.findRecord(T0 + 50 * USECS_PER_SEC), 50u);
+    BOOST_CHECK_EQUAL(file.getTime(50), T0 + 51 * USECS_PER_SEC);
+    BOOST_CHECK_EQUAL(file.findRecord(LONG_LONG_MAX), file.getNumRecords());
+
+    const double* rec = file.getRecord(60);
+    BOOST_CHECK_EQUAL(rec[1], 61001.0);
+
+    ::unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_sync_file_columns)
+{
+    Layout layout;
+    std::string path = tempName();
+    writeFile(path, layout, 100, 50);
+    SyncRecordFile file(path);
+
+    SyncRecordColumn col = file.getColumn("UVX",
+        T0 + 45 * USECS_PER_SEC, T0 + 55 * USECS_PER_SEC);
+    BOOST_REQUIRE_EQUAL(col.numRecords, 9u);
+    BOOST_CHECK_EQUAL(col.stride, Layout::NUMVALUES);
+    BOOST_CHECK_EQUAL(col.valuesPerRecord, 20u);
+    BOOST_CHECK_EQUAL(col.length, 2u);
+    BOOST_CHECK_EQUAL(col.rate, 10.0);
+    for (size_t i = 0; i < col.numRecords; i++) {
+        int isec = (col.times[i] - T0) / USECS_PER_SEC;
+        BOOST_CHECK(isec != 50);
+        BOOST_CHECK_EQUAL(col.lags[i * col.stride], 200.0);
+        for (size_t j = 0; j < col.valuesPerRecord; j++)
+            BOOST_CHECK_EQUAL(col.value(i, j), 1000.0 * isec + 4 + j);
+    }
+    // the column points into the file, it is not a copy
+    BOOST_CHECK_EQUAL(col.values, file.getRecord(45) + 4);
+
+    col = file.getColumn("TTX", T0 + 200 * USECS_PER_SEC, LONG_LONG_MAX);
+    BOOST_CHECK_EQUAL(col.numRecords, 0u);
+    col = file.getColumn("TTX", T0 + 20 * USECS_PER_SEC, T0);
+    BOOST_CHECK_EQUAL(col.numRecords, 0u);
+
+    BOOST_CHECK_THROW(file.getColumn("NOPE", T0, LONG_LONG_MAX),
+                      n_u::InvalidParameterException);
+    ::unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_sync_file_errors)
+{
+    BOOST_CHECK_THROW(SyncRecordFile("/nonexistent/tsyncfile"),
+                      n_u::IOException);
+
+    std::string path = tempName();
+    {
+        std::ofstream out(path.c_str());
+        out << "not a sync record file, but long enough to have a header "
+            "of the size of SyncRecordFileHeader, which is 112 bytes long.";
+    }
+    BOOST_CHECK_THROW(SyncRecordFile(path.c_str()), n_u::IOException);
+
+    // truncated
+    Layout layout;
+    writeFile(path, layout, 10, -1);
+    BOOST_CHECK_EQUAL(::truncate(path.c_str(), 4096 + 5 * 8 * 24), 0);
+    BOOST_CHECK_THROW(SyncRecordFile(path.c_str()), n_u::IOException);
+    ::unlink(path.c_str());
+}
@@ -0,0 +1,323 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/dynld/raf/SyncRecordSource.h>
+#include <nidas/core/SampleTag.h>
+#include <nidas/core/Variable.h>
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <vector>
+
+#include "../benchmark.h"
+
+using namespace nidas::core;
+using nidas::dynld::raf::SyncRecordSource;
+
+namespace {
+
+/**
+ * Client of sync records which copies them, or holds them
+ * to check that records which clients hold are not reused.
+ */
+class RecordClient: public SampleClient
+{
+public:
+    RecordClient(bool hold): _hold(hold), _held(), times(), records(), nrecs(0) {}
+
+    ~RecordClient()
+    {
+        for (unsigned int i = 0; i < _held.size(); i++)
+            _held[i]->freeReference();
+    }
+
+    bool receive(const Sample* samp) throw()
+    {
+        if (samp->getId() != SYNC_RECORD_ID) return false;
+        nrecs++;
+        if (_hold) {
+            samp->holdReference();
+            _held.push_back(samp);
+        }
+        else {
+            const double* dp = (const double*) samp->getConstVoidDataPtr();
+            times.push_back(samp->getTimeTag());
+            records.push_back(std::vector<double>(dp, dp + samp->getDataLength()));
+        }
+        return true;
+    }
+
+    void flush() throw() {}
+
+    /**
+     * Copy the records which were held.
+     */
+    void copyHeld()
+    {
+        for (unsigned int i = 0; i < _held.size(); i++) {
+            const double* dp = (const double*) _held[i]->getConstVoidDataPtr();
+            times.push_back(_held[i]->getTimeTag());
+            records.push_back(std::vector<double>(dp,
+                dp + _held[i]->getDataLength()));
+        }
+    }
+
+private:
+    bool _hold;
+    std::vector<const Sample*> _held;
+
+public:
+    std::vector<dsm_time_t> times;
+    std::vector<std::vector<double> > records;
+    int nrecs;
+};
+
+/**
+ * Sample tags of a configuration, and the variables of the sync record.
+ */
+class Config
+{
+public:
+    Config(): tags(), variables() {}
+
+    ~Config()
+    {
+        for (unsigned int i = 0; i < tags.size(); i++) delete tags[i];
+    }
+
+    SampleTag* addTag(int dsm, int sps, double rate, int nvars, int varlen = 1)
+    {
+        SampleTag* tag = new SampleTag();
+        tag->setDSMId(dsm);
+        tag->setSampleId(sps);
+        tag->setRate(rate);
+        for (int i = 0; i < nvars; i++) {
+            Variable* var = new Variable();
+            std::ostringstream ost;
+            ost << "V" << dsm << "_" << sps << "_" << i;
+            var->setName(ost.str());
+            var->setLength(varlen);
+            tag->addVariable(var);
+            variables.push_back(var);
+        }
+        tags.push_back(tag);
+        return tag;
+    }
+
+    std::vector<SampleTag*> tags;
+    std::list<const Variable*> variables;
+};
+
+/**
+ * A sample of a tag, the count'th of the tag.
+ */
+struct Event
+{
+    Event(dsm_time_t u, unsigned int t, int c): usec(u), itag(t), count(c) {}
+    bool operator<(const Event& x) const { return usec < x.usec; }
+    dsm_time_t usec;
+    unsigned int itag;
+    int count;
+};
+
+/**
+ * The samples of the tags in nsecs seconds, in time order,
+ * offset a bit from the start of their slots, without the
+ * samples of tag skipTag in second skipSec.
+ */
+std::vector<Event>
+makeEvents(const std::vector<SampleTag*>& tags, int nsecs,
+           unsigned int skipTag = ~0u, int skipSec = -1)
+{
+    std::vector<Event> events;
+    for (unsigned int i = 0; i < tags.size(); i++) {
+        double dt = USECS_PER_SEC / tags[i]->getRate();
+        int off = 1000 + (i % 7) * 100;
+        for (int k = 0; ; k++) {
+            dsm_time_t usec = (dsm_time_t) rint(k * dt) + off;
+            if (usec >= (dsm_time_t) nsecs * USECS_PER_SEC) break;
+            if (i == skipTag && usec / USECS_PER_SEC == skipSec) continue;
+            events.push_back(Event(usec, i, k));
+        }
+    }
+    std::stable_sort(events.begin(), events.end());
+    return events;
+}
+
+/**
+ * Value of the first variable of the count'th sample of a tag.
+ */
+float
+value(unsigned int itag, int count)
+{
+    return itag * 100000 + count;
+}
+
+/**
+ * Send samples of the tags to a SyncRecordSource.
+ */
+void
+replay(SyncRecordSource& srs, const std::vector<SampleTag*>& tags,
+       const std::vector<Event>& events, dsm_time_t t0)
+{
+    for (unsigned int i = 0; i < events.size(); i++) {
+        const Event& ev = events[i];
+        const SampleTag* tag = tags[ev.itag];
+        int nvalues = 0;
+        for (unsigned int iv = 0; iv < tag->getVariables().size(); iv++)
+            nvalues += tag->getVariables()[iv]->getLength();
+        SampleT<float>* samp = getSample<float>(nvalues);
+        samp->setTimeTag(t0 + ev.usec);
+        samp->setId(tag->getId());
+        float* fp = samp->getDataPtr();
+        fp[0] = value(ev.itag, ev.count);
+        for (int j = 1; j < nvalues; j++) fp[j] = j;
+        srs.receive(samp);
+        samp->freeReference();
+    }
+    srs.flush();
+}
+
+/**
+ * Check the records of a small configuration, of a 1 Hz sample,
+ * a 10 Hz sample with a vector variable, and a 12.5 Hz sample
+ * on another DSM, where the 10 Hz sample is missing in second 5.
+ */
+void
+checkRecords(bool hold)
+{
+    Config cfg;
+    cfg.addTag(1, 100, 1.0, 2);
+    cfg.addTag(1, 102, 10.0, 2, 3);
+    cfg.addTag(5, 7, 12.5, 1);
+
+    SyncRecordSource srs;
+    srs.addVariables(cfg.variables);
+    srs.init();
+    RecordClient client(hold);
+    srs.addSampleClient(&client);
+
+    const int nsecs = 8;
+    const dsm_time_t t0 = (dsm_time_t) 1700000000 * USECS_PER_SEC;
+    replay(srs, cfg.tags, makeEvents(cfg.tags, nsecs, 1, 5), t0);
+    srs.removeSampleClient(&client);
+    if (hold) client.copyHeld();
+
+    // record layout: in order of sample id, time offset then
+    // the slots of each variable
+    const size_t i1 = 0;                // 1 Hz: 1 + 2 * 1
+    const size_t i10 = i1 + 3;          // 10 Hz: 1 + 2 * 10 * 3
+    const size_t i12 = i10 + 61;        // 12.5 Hz: 1 + 13
+    const size_t recsize = i12 + 14;
+
+    BOOST_REQUIRE_EQUAL((int)client.records.size(), nsecs);
+    for (int isec = 0; isec < nsecs; isec++) {
+        const std::vector<double>& rec = client.records[isec];
+        BOOST_REQUIRE_EQUAL(rec.size(), recsize);
+        BOOST_CHECK_EQUAL(client.times[isec],
+                          t0 + (dsm_time_t)isec * USECS_PER_SEC);
+        BOOST_CHECK_EQUAL(rec[i1 + 1], value(0, isec));
+        BOOST_CHECK_EQUAL(rec[i1 + 2], 1.0);
+        for (int k = 0; k < 10; k++) {
+            if (isec == 5) {
+                BOOST_CHECK(std::isnan(rec[i10 + 1 + k * 3]));
+                BOOST_CHECK(std::isnan(rec[i10 + 31 + k * 3 + 2]));
+            }
+            else {
+                BOOST_CHECK_EQUAL(rec[i10 + 1 + k * 3], value(1, isec * 10 + k));
+                BOOST_CHECK_EQUAL(rec[i10 + 1 + k * 3 + 1], 1.0);
+                BOOST_CHECK_EQUAL(rec[i10 + 31 + k * 3 + 2], 5.0);
+            }
+        }
+        // 12 or 13 of the 12.5 Hz samples in a second, in order
+        int n12 = 0;
+        double last = -1.0;
+        for (int k = 0; k < 13; k++) {
+            double v = rec[i12 + 1 + k];
+            if (std::isnan(v)) continue;
+            BOOST_CHECK(v > last);
+            last = v;
+            n12++;
+        }
+        BOOST_CHECK(n12 >= 12);
+    }
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_sync_records)
+{
+    checkRecords(false);
+}
+
+BOOST_AUTO_TEST_CASE(test_sync_records_held)
+{
+    // clients which hold all the records force new ones
+    // to be allocated in place of the ring records
+    checkRecords(true);
+}
+
+BOOST_AUTO_TEST_CASE(test_sync_unknown_samples)
+{
+    Config cfg;
+    cfg.addTag(3, 1000, 10.0, 1);
+    SyncRecordSource srs;
+    srs.addVariables(cfg.variables);
+    srs.init();
+
+    const dsm_sample_id_t ids[] = { 0, SET_DSM_ID(0, 3) | 999,
+        SET_DSM_ID(0, 3) | 1001, SET_DSM_ID(0, 2) | 1000,
+        SET_DSM_ID(0, 4) | 1000, SET_DSM_ID(0, 1000) | 1000 };
+    for (unsigned int i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+        SampleT<float>* samp = getSample<float>(1);
+        samp->setTimeTag((dsm_time_t)1700000000 * USECS_PER_SEC);
+        samp->setId(ids[i]);
+        BOOST_CHECK(!srs.receive(samp));
+        samp->freeReference();
+    }
+}
+
+/**
+ * Rate of sync record assembly for a configuration of the size
+ * of a research aircraft: 40 DSMs with 20 samples each, at the
+ * rates of analog, ARINC and serial sensors, about 4000 variables.
+ */
+BOOST_AUTO_TEST_CASE(benchmark_sync_records)
+{
+    const double rates[] = { 1, 5, 10, 12.5, 25, 50, 100, 6.25, 3.125, 500 };
+    Config cfg;
+    for (int dsm = 1; dsm <= 40; dsm++) {
+        for (int s = 0; s < 20; s++) {
+            double rate = rates[(dsm + s) % (sizeof(rates) / sizeof(rates[0]))];
+            cfg.addTag(dsm, 200 + s * 10, rate, 1 + (s % 9));
+        }
+    }
+
+    SyncRecordSource srs;
+    srs.addVariables(cfg.variables);
+    srs.init();
+    RecordClient client(false);
+    srs.addSampleClient(&client);
+
+    const int nsecs = 60;
+    std::vector<Event> events = makeEvents(cfg.tags, nsecs);
+    struct timespec t0;
+    ::clock_gettime(CLOCK_MONOTONIC, &t0);
+    replay(srs, cfg.tags, events, (dsm_time_t) 1700000000 * USECS_PER_SEC);
+    double secs = elapsed(t0);
+    long nsamp = events.size();
+    srs.removeSampleClient(&client);
+
+    // flush() sends the record of the second after the last
+    BOOST_CHECK(client.nrecs >= nsecs && client.nrecs <= nsecs + 1);
+    std::cout << cfg.variables.size() << " variables, " <<
+        nsamp / nsecs << " samples/s: " << nsamp / secs / 1.e6 <<
+        " Msamples/s, " << nsecs / secs << " flight seconds/s" << std::endl;
+}
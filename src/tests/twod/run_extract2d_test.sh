@@ -0,0 +1,68 @@
+#!/bin/bash
+
+source ../nidas_tests.sh
+check_executable extract2d
+
+# Check that the records extracted by the threads of extract2d are the
+# same as those extracted in one thread, from a file of Fast 2DC image
+# samples of random data.
+
+tmpdir=$(mktemp -d /tmp/extract2d_test_XXXXXX)
+
+trap '{ rm -rf $tmpdir; }' EXIT
+
+# little-endian integers, as printf escapes
+le32() {
+    printf '\\x%02x\\x%02x\\x%02x\\x%02x' $(($1 & 255)) $((($1 >> 8) & 255)) \
+        $((($1 >> 16) & 255)) $((($1 >> 24) & 255))
+}
+le64() {
+    le32 $(($1 & 0xffffffff))
+    le32 $(($1 >> 32))
+}
+
+input=$tmpdir/20260101_120000_tf01.ads
+{
+    printf "NIDAS (ncar.ucar.edu)\n"
+    printf "archive version: 1\n"
+    printf "software version: test\n"
+    printf "project name: TWOD\n"
+    printf "system name: GV_N677F\n"
+    printf "config name: $PWD/config/twod.xml\n"
+    printf "config version: 1\n"
+    printf "end header\n"
+
+    # 200 image samples of dsm 1, sensor 790, 10 per second:
+    # a big-endian TWOD_IMGv3_TYPE, the true airspeed and 4096 bytes of image
+    id=$(((1 << 16) + 790))
+    t0=1767268800000000
+    for (( i = 0; i < 200; i++ )); do
+        printf "$(le64 $((t0 + i * 100000)))$(le32 4104)$(le32 $id)"
+        printf '\x00\x00\x00\x03\xe8\x03\x00\x00'
+        head -c 4096 /dev/urandom
+    done
+} > $input
+
+extract2d -a $tmpdir/threads.2d $input > $tmpdir/threads.log 2>&1 || {
+    cat $tmpdir/threads.log
+    echo "extract2d failed"
+    exit 1
+}
+extract2d -a -t $tmpdir/single.2d $input > $tmpdir/single.log 2>&1 || {
+    cat $tmpdir/single.log
+    echo "extract2d -t failed"
+    exit 1
+}
+
+if [ ! -s $tmpdir/threads.2d ]; then
+    cat $tmpdir/threads.log
+    echo "extract2d wrote nothing"
+    exit 1
+fi
+
+if ! cmp $tmpdir/threads.2d $tmpdir/single.2d; then
+    echo "extract2d output with threads differs from that of one thread"
+    exit 1
+fi
+echo "extract2d output with threads is the same as that of one thread"
+exit 0
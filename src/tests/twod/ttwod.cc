@@ -0,0 +1,476 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/dynld/raf/TwoD_Processing.h>
+#include <nidas/dynld/raf/TwoD64_USB_v3.h>
+#include <nidas/core/Parameter.h>
+#include <nidas/core/Variable.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../benchmark.h"
+
+using namespace nidas::core;
+using namespace nidas::dynld::raf;
+
+namespace {
+
+/**
+ * Expose the slice processing of TwoD_Processing for a number of diodes.
+ */
+class TwoDTest: public TwoD_Processing
+{
+public:
+  TwoDTest(int ndiodes): _ndiodes(ndiodes) {}
+
+  int NumberOfDiodes() const { return _ndiodes; }
+
+  typedef TwoD_Processing::Particle Particle;
+
+  using TwoD_Processing::processParticleSlice;
+  using TwoD_Processing::wordHasByte;
+  using TwoD_Processing::word32HasByte;
+
+private:
+  int _ndiodes;
+};
+
+/**
+ * The byte by byte slice processing which the word-parallel
+ * TwoD_Processing::processParticleSlice() replaced.
+ */
+void
+referenceSlice(TwoDTest::Particle& p, const unsigned char* data, int ndiodes)
+{
+  int nBytes = ndiodes / 8;
+  unsigned char slice[16];
+  for (int i = 0; i < nBytes; ++i)
+    slice[i] = ~(data[i]);
+
+  p.width++;
+  if ((slice[0] & 0x80))
+    p.edgeTouch |= 0x0F;
+  if ((slice[nBytes-1] & 0x01))
+    p.edgeTouch |= 0xF0;
+
+  for (int i = 0; i < nBytes; ++i)
+  {
+    unsigned char c = slice[i];
+    for (; c; p.area++)
+      c &= c - 1;
+  }
+
+  int h = ndiodes;
+  for (int i = 0; i < nBytes; ++i)
+  {
+    if (slice[i] == 0)
+    {
+      h -= 8;
+      continue;
+    }
+    int r = 7;
+    unsigned char v = slice[i];
+    while (v >>= 1)
+      r--;
+    h -= r;
+    break;
+  }
+  for (int i = nBytes-1; i >= 0; --i)
+  {
+    if (slice[i] == 0)
+    {
+      h -= 8;
+      continue;
+    }
+    int r = 0;
+    unsigned char v = slice[i];
+    while ((v & 0x01) == 0)
+    {
+      r++;
+      v >>= 1;
+    }
+    h -= r;
+    break;
+  }
+  if (h > 0)
+    p.height = std::max((unsigned)h, p.height);
+}
+
+/**
+ * Image data of nslices slices, like that of a probe in cloud:
+ * mostly unshadowed slices, and particles of random position and size.
+ */
+std::vector<unsigned char>
+makeImage(int ndiodes, int nslices, unsigned int seed)
+{
+  int nBytes = ndiodes / 8;
+  std::vector<unsigned char> image(nslices * nBytes, 0xff);
+  ::srandom(seed);
+  for (int s = 0; s < nslices; ++s)
+  {
+    unsigned char* slice = &image[s * nBytes];
+    switch (::random() % 4)
+    {
+    case 0:   // unshadowed
+      break;
+    case 1:   // random diodes, including the edges
+      for (int i = 0; i < nBytes; ++i)
+        slice[i] = ::random();
+      break;
+    default:  // a run of shadowed diodes
+      {
+        int first = ::random() % ndiodes;
+        int last = std::min(ndiodes - 1, first + (int)(::random() % 12));
+        for (int d = first; d <= last; ++d)
+          slice[d / 8] &= ~(0x80 >> (d % 8));
+      }
+      break;
+    }
+  }
+  return image;
+}
+
+void
+checkSame(int ndiodes)
+{
+  TwoDTest twod(ndiodes);
+  int nBytes = ndiodes / 8;
+  const int nslices = 100000;
+  std::vector<unsigned char> image = makeImage(ndiodes, nslices, ndiodes);
+
+  // particles of 1 to 8 slices
+  TwoDTest::Particle p1, p2;
+  int nparticles = 0;
+  for (int s = 0; s < nslices; ++s)
+  {
+    twod.processParticleSlice(p1, &image[s * nBytes]);
+    referenceSlice(p2, &image[s * nBytes], ndiodes);
+    if (s % 8 == (s / 8) % 8)
+    {
+      BOOST_CHECK_EQUAL(p1.width, p2.width);
+      BOOST_CHECK_EQUAL(p1.height, p2.height);
+      BOOST_CHECK_EQUAL(p1.area, p2.area);
+      BOOST_CHECK_EQUAL((int)p1.edgeTouch, (int)p2.edgeTouch);
+      if (p1.height != p2.height || p1.area != p2.area ||
+          p1.edgeTouch != p2.edgeTouch)
+        break;
+      p1.zero();
+      p2.zero();
+      nparticles++;
+    }
+  }
+  BOOST_CHECK(nparticles > nslices / 10);
+}
+
+/**
+ * Expose the true airspeed encoding of TwoD_USB.
+ */
+class TASTest: public TwoD64_USB
+{
+public:
+  TASTest(unsigned int resolutionMicron)
+  {
+    _resolutionMicron = resolutionMicron;
+    _resolutionMeters = resolutionMicron * 1.0e-6;
+    buildTASTables();
+  }
+
+  using TwoD_USB::encodeTAS;
+  using TwoD_USB::DefaultTrueAirspeed;
+  using TwoD_USB::TASTableMax;
+};
+
+/**
+ * A Fast-2DC v3 with a housekeeping sample of 9 variables.
+ */
+class HskpTest: public TwoD64_USB_v3
+{
+public:
+  HskpTest(bool onChange)
+  {
+    setDSMId(1);
+    setSensorId(790);
+    setDeviceName("/dev/null");
+
+    SampleTag* stag = new SampleTag(this);
+    stag->setSampleId(1);
+    stag->setRate(1.0);
+    for (int i = 0; i < 9; ++i)
+    {
+      Variable* var = new Variable();
+      var->setName(i == 2 ? "SHDOR" : "H" + std::to_string(i));
+      stag->addVariable(var);
+    }
+    addSampleTag(stag);
+
+    addFloatParameter("RESOLUTION", 25);
+    addFloatParameter("TAS_RATE", 1);
+    ParameterT<bool>* param = new ParameterT<bool>();
+    param->setName("HSKP_ON_CHANGE");
+    param->setValue(onChange);
+    addParameter(param);
+
+    init_parameters();
+    validate();
+  }
+
+  /**
+   * Process a housekeeping record, returning the values of
+   * its sample, or an empty vector if there isn't one.
+   */
+  std::vector<float> hskp(const std::string& record)
+  {
+    SampleT<char>* samp = getSample<char>(record.length());
+    samp->setTimeTag(0);
+    ::memcpy(samp->getDataPtr(), record.data(), record.length());
+    std::list<const Sample*> results;
+    processSOR(samp, results);
+    samp->freeReference();
+
+    std::vector<float> values;
+    BOOST_CHECK(results.size() <= 1);
+    if (!results.empty())
+    {
+      const Sample* out = results.front();
+      for (unsigned int i = 0; i < out->getDataLength(); ++i)
+        values.push_back(out->getDataValue(i));
+      out->freeReference();
+    }
+    return values;
+  }
+
+  std::string status()
+  {
+    std::ostringstream ost;
+    printStatusFields(ost);
+    return ost.str();
+  }
+
+  using TwoD64_USB_v3::_hskpUnchanged;
+
+private:
+  void addFloatParameter(const std::string& name, float value)
+  {
+    ParameterT<float>* param = new ParameterT<float>();
+    param->setName(name);
+    param->setValue(value);
+    addParameter(param);
+  }
+};
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_slice_32)
+{
+  checkSame(32);
+}
+
+BOOST_AUTO_TEST_CASE(test_slice_64)
+{
+  checkSame(64);
+}
+
+BOOST_AUTO_TEST_CASE(test_slice_128)
+{
+  checkSame(128);
+}
+
+BOOST_AUTO_TEST_CASE(test_word_has_byte)
+{
+  std::vector<unsigned char> image = makeImage(64, 10000, 1);
+  // sprinkle in some sync and overload bytes
+  for (unsigned int i = 0; i < image.size(); i += 37)
+    image[i] = (i % 2) ? 0xaa : 0x55;
+
+  for (unsigned int i = 0; i + 8 <= image.size(); ++i)
+  {
+    const unsigned char* cp = &image[i];
+    BOOST_CHECK_EQUAL(TwoDTest::wordHasByte(cp, 0xaa),
+                      ::memchr(cp, 0xaa, 8) != 0);
+    BOOST_CHECK_EQUAL(TwoDTest::wordHasByte(cp, 0x55),
+                      ::memchr(cp, 0x55, 8) != 0);
+    BOOST_CHECK_EQUAL(TwoDTest::word32HasByte(cp, 0x55),
+                      ::memchr(cp, 0x55, 4) != 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_tas_tables)
+{
+  const unsigned int resolutions[] = { 10, 25, 150 };
+  for (unsigned int r = 0; r < 3; ++r)
+  {
+    TASTest twod(resolutions[r]);
+
+    // Airspeeds on a 0.1 m/s grid, random airspeeds between them,
+    // the airspeeds next to the changes of the encoding, and those
+    // outside of the table, encode as encodeTAS() does.
+    std::vector<float> speeds;
+    ::srandom(resolutions[r]);
+    for (float tas = TASTest::DefaultTrueAirspeed;
+         tas <= TASTest::TASTableMax; tas += 0.1) {
+      speeds.push_back(tas);
+      speeds.push_back(tas + (::random() % 1000) * 1.e-4);
+    }
+    Tap2D prev;
+    twod.encodeTAS(&prev, TASTest::DefaultTrueAirspeed);
+    for (float tas = TASTest::DefaultTrueAirspeed;
+         tas <= TASTest::TASTableMax; ) {
+      float next = ::nextafterf(tas, 1000.0);
+      Tap2D t2d;
+      twod.encodeTAS(&t2d, next);
+      if (t2d.ntap != prev.ntap || t2d.div10 != prev.div10) {
+        speeds.push_back(tas);
+        speeds.push_back(next);
+      }
+      prev = t2d;
+      tas = next;
+    }
+    BOOST_CHECK(speeds.size() > 6000);
+    speeds.push_back(TASTest::TASTableMax + 50.0);
+    speeds.push_back(1000.0);
+    for (unsigned int i = 0; i < speeds.size(); ++i)
+    {
+      Tap2D t1, t2;
+      int res1 = twod.TASToTap2D(&t1, speeds[i]);
+      int res2 = twod.encodeTAS(&t2, speeds[i]);
+      BOOST_CHECK_EQUAL(res1, res2);
+      BOOST_CHECK_EQUAL(t1.ntap, t2.ntap);
+      BOOST_CHECK_EQUAL((int)t1.div10, (int)t2.div10);
+      if (t1.ntap != t2.ntap) break;
+    }
+
+    // airspeeds below the default are sent as the default
+    Tap2D t1, t2;
+    BOOST_CHECK_EQUAL(twod.TASToTap2D(&t1, 0.0),
+                      twod.encodeTAS(&t2, TASTest::DefaultTrueAirspeed));
+    BOOST_CHECK_EQUAL(t1.ntap, t2.ntap);
+    BOOST_CHECK_EQUAL((int)t1.div10, (int)t2.div10);
+
+    // Decoding from the tables is the same as from the formulas,
+    // including the taps past the end of the tables.
+    float res = twod.getResolution();
+    for (unsigned int ntap = 0; ntap < 1100; ++ntap)
+    {
+      for (unsigned char div10 = 0; div10 < 2; ++div10)
+      {
+        Tap2D t2d = Tap2D();
+        t2d.ntap = ntap;
+        t2d.div10 = div10;
+        float tas = (1.0e11 / ((float)ntap * 2 * 25000 / 511)) * res;
+        if (div10) tas /= 10.0;
+        BOOST_CHECK_EQUAL(twod.Tap2DToTAS(&t2d), tas);
+      }
+    }
+    for (unsigned int ntap = 0; ntap < 256; ++ntap)
+    {
+      for (unsigned char div10 = 0; div10 < 2; ++div10)
+      {
+        Tap2Dv1 t2d = Tap2Dv1();
+        t2d.ntap = ntap;
+        t2d.div10 = div10;
+        float tas = (1.0e6 / (1.0 - ((float)ntap / 255))) * res;
+        if (div10) tas /= 10.0;
+        BOOST_CHECK_EQUAL(twod.Tap2DToTAS(&t2d), tas);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_hskp_cache)
+{
+  HskpTest twod(false);
+  const std::string r1 = "SOR,1,2,3,4,5,6,7,8,9";
+  const std::string r2 = "SOR,1,2,3,4,5,6,7,8,10";
+  // the same values as r2, in a different record
+  const std::string r3 = "SOR,1.0,2,3,4,5,6,7,8,10";
+
+  std::vector<float> v1 = twod.hskp(r1);
+  BOOST_REQUIRE_EQUAL(v1.size(), 9u);
+  for (unsigned int i = 0; i < 9; ++i)
+    BOOST_CHECK_EQUAL(v1[i], i + 1);
+  BOOST_CHECK_EQUAL(twod._hskpUnchanged, 0u);
+
+  // a repeated record reuses the converted values
+  std::vector<float> v = twod.hskp(r1);
+  BOOST_CHECK(v == v1);
+  BOOST_CHECK_EQUAL(twod._hskpUnchanged, 1u);
+
+  std::vector<float> v2 = twod.hskp(r2);
+  BOOST_REQUIRE_EQUAL(v2.size(), 9u);
+  BOOST_CHECK_EQUAL(v2[8], 10);
+  BOOST_CHECK_EQUAL(twod._hskpUnchanged, 1u);
+
+  v = twod.hskp(r3);
+  BOOST_CHECK(v == v2);
+  BOOST_CHECK_EQUAL(twod._hskpUnchanged, 2u);
+
+  // and the cache follows the latest record
+  v = twod.hskp(r1);
+  BOOST_CHECK(v == v1);
+  v = twod.hskp(r1);
+  BOOST_CHECK(v == v1);
+  BOOST_CHECK_EQUAL(twod._hskpUnchanged, 3u);
+
+  BOOST_CHECK_EQUAL(twod.status(), ",hskpUnchanged=3");
+}
+
+BOOST_AUTO_TEST_CASE(test_hskp_on_change)
+{
+  // only the housekeeping samples whose values change are output
+  HskpTest twod(true);
+  BOOST_CHECK_EQUAL(twod.hskp("SOR,1,2,3,4,5,6,7,8,9").size(), 9u);
+  BOOST_CHECK(twod.hskp("SOR,1,2,3,4,5,6,7,8,9").empty());
+  BOOST_CHECK(twod.hskp("SOR,1.0,2,3,4,5,6,7,8,9").empty());
+  BOOST_CHECK_EQUAL(twod.hskp("SOR,1,2,3,4,5,6,7,8,10").size(), 9u);
+  BOOST_CHECK_EQUAL(twod._hskpUnchanged, 2u);
+}
+
+/**
+ * Throughput of the slice processing, compared to the byte by byte
+ * version.
+ */
+BOOST_AUTO_TEST_CASE(benchmark_slices)
+{
+  const int ndiodes[] = { 32, 64, 128 };
+  const int nslices = 1000000;
+  for (unsigned int n = 0; n < sizeof(ndiodes) / sizeof(ndiodes[0]); ++n)
+  {
+    TwoDTest twod(ndiodes[n]);
+    int nBytes = ndiodes[n] / 8;
+    std::vector<unsigned char> image = makeImage(ndiodes[n], nslices, 2);
+
+    TwoDTest::Particle p;
+    struct timespec t0;
+    ::clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int s = 0; s < nslices; ++s)
+    {
+      twod.processParticleSlice(p, &image[s * nBytes]);
+      if ((s & 7) == 7) p.zero();
+    }
+    double tword = elapsed(t0);
+
+    ::clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int s = 0; s < nslices; ++s)
+    {
+      referenceSlice(p, &image[s * nBytes], ndiodes[n]);
+      if ((s & 7) == 7) p.zero();
+    }
+    double tbyte = elapsed(t0);
+
+    std::cout << ndiodes[n] << " diodes: " << nslices / tword / 1.e6 <<
+      " Mslices/s, byte by byte " << nslices / tbyte / 1.e6 <<
+      " Mslices/s" << std::endl;
+  }
+}
@@ -0,0 +1,262 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/dynld/isff/Wind3D.h>
+#include <nidas/core/CalFile.h>
+#include <nidas/core/Parameter.h>
+#include <nidas/core/SamplePool.h>
+#include <nidas/core/Variable.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <string>
+#include <vector>
+
+using namespace nidas::core;
+using namespace nidas::dynld::isff;
+
+namespace {
+
+/**
+ * Configure a Wind3D for ASCII records of u,v,w,tc,diag,
+ * plus a derived spd.
+ */
+void
+setup_wind3d(Wind3D& wind)
+{
+    wind.setDSMId(1);
+    wind.setSensorId(10);
+    wind.setDeviceName("/dev/ttyS9");
+
+    SampleTag* tag = new SampleTag(&wind);
+    tag->setSampleId(1);
+    tag->setRate(20.0);
+    tag->setScanfFormat("%f,%f,%f,%f,%f");
+    const char* names[] = { "u", "v", "w", "tc", "diag", "spd" };
+    for (unsigned int i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        Variable* var = new Variable();
+        var->setName(names[i]);
+        tag->addVariable(var);
+    }
+    wind.addSampleTag(tag);
+    wind.validate();
+    wind.init();
+}
+
+SampleT<char>*
+rawSample(const std::string& msg, bool nullTerminated)
+{
+    unsigned int len = msg.length() + (nullTerminated ? 1 : 0);
+    SampleT<char>* samp = getSample<char>(len);
+    ::memcpy(samp->getDataPtr(), msg.c_str(), len);
+    samp->setTimeTag((dsm_time_t) 1700000000 * USECS_PER_SEC);
+    samp->setId(SET_DSM_ID(SET_SPS_ID(0, 10), 1));
+    return samp;
+}
+
+int
+floatSamplesOut()
+{
+    return SamplePool<SampleT<float> >::getInstance()->getNSamplesOut();
+}
+
+void
+addStringParameter(Wind3D& wind, const std::string& name,
+                   const std::string& val)
+{
+    ParameterT<std::string>* param = new ParameterT<std::string>();
+    param->setName(name);
+    param->setValue(val);
+    wind.addParameter(param);
+}
+
+void
+addFloatParameter(Wind3D& wind, const std::string& name,
+                  const std::vector<float>& vals)
+{
+    ParameterT<float>* param = new ParameterT<float>();
+    param->setName(name);
+    param->setValues(vals);
+    wind.addParameter(param);
+}
+
+void
+addCalFile(Wind3D& wind)
+{
+    CalFile* cf = new CalFile();
+    cf->setName("offsets_angles");
+    cf->setPath(".");
+    cf->setFile("wind3d_oa.dat");
+    wind.addCalFile(cf);
+}
+
+/**
+ * Correct n samples of u,v,w,tc at 20 Hz from time t0, one at a
+ * time, as in Wind3D::process(), and in batches of nbatch with
+ * Wind3D::applyCorrections(), and check that the results agree.
+ */
+void
+check_corrections(Wind3D& single, Wind3D& batch, unsigned int n,
+                  unsigned int nbatch)
+{
+    const dsm_time_t t0 = (dsm_time_t) 1700000000 * USECS_PER_SEC;
+
+    std::vector<dsm_time_t> tt(n);
+    std::vector<float> u(n), v(n), w(n), tc(n);
+    unsigned int seed = 1;
+    for (unsigned int i = 0; i < n; i++) {
+        tt[i] = t0 + i * USECS_PER_SEC / 20;
+        float x[4];
+        for (int j = 0; j < 4; j++) {
+            seed = seed * 1103515245 + 12345;
+            x[j] = ((seed / 65536) % 10000) / 1000.0 - 5.0;
+        }
+        u[i] = x[0];
+        v[i] = x[1];
+        w[i] = (i % 50 == 7) ? floatNAN : x[2] / 4;
+        tc[i] = 20.0 + x[3];
+    }
+
+    std::vector<float> su(u), sv(v), sw(w), stc(tc);
+    for (unsigned int i = 0; i < n; i++) {
+        float uvwt[4] = { su[i], sv[i], sw[i], stc[i] };
+        single.applyOrientation(tt[i], uvwt);
+        single.offsetsTiltAndRotate(tt[i], uvwt);
+        su[i] = uvwt[0];
+        sv[i] = uvwt[1];
+        sw[i] = uvwt[2];
+        stc[i] = uvwt[3];
+    }
+
+    for (unsigned int i = 0; i < n; i += nbatch) {
+        unsigned int nb = std::min(nbatch, n - i);
+        batch.applyCorrections(&tt[i], &u[i], &v[i], &w[i], &tc[i], nb);
+    }
+
+    const std::vector<float>* sv4[4] = { &su, &sv, &sw, &stc };
+    const std::vector<float>* bv4[4] = { &u, &v, &w, &tc };
+    for (int j = 0; j < 4; j++) {
+        for (unsigned int i = 0; i < n; i++) {
+            float s = (*sv4[j])[i];
+            float b = (*bv4[j])[i];
+            BOOST_CHECK_EQUAL(std::isnan(s), std::isnan(b));
+            if (!std::isnan(s)) BOOST_CHECK_SMALL(s - b, 1.e-5f);
+        }
+    }
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(test_wind3d_parse_in_place)
+{
+    Wind3D wind;
+    setup_wind3d(wind);
+
+    for (int nt = 0; nt < 2; nt++) {
+        SampleT<char>* samp = rawSample("1.5,-2.0,0.25,21.5,0\r\n", nt == 0);
+        int nout = floatSamplesOut();
+
+        std::list<const Sample*> results;
+        BOOST_CHECK(wind.process(samp, results));
+        samp->freeReference();
+
+        // only the output sample is taken from the pool
+        BOOST_CHECK_EQUAL(floatSamplesOut(), nout + 1);
+        BOOST_REQUIRE_EQUAL(results.size(), 1u);
+
+        const SampleT<float>* wsamp =
+            static_cast<const SampleT<float>*>(results.front());
+        BOOST_CHECK_EQUAL(wsamp->getTimeTag(), samp->getTimeTag());
+        BOOST_REQUIRE_EQUAL(wsamp->getDataLength(), 6u);
+        const float* fp = wsamp->getConstDataPtr();
+        BOOST_CHECK_EQUAL(fp[0], 1.5);
+        BOOST_CHECK_EQUAL(fp[1], -2.0);
+        BOOST_CHECK_EQUAL(fp[2], 0.25);
+        BOOST_CHECK_EQUAL(fp[3], 21.5);
+        BOOST_CHECK_EQUAL(fp[4], 0.0);
+        BOOST_CHECK_CLOSE(fp[5], 2.5, 1.e-4);
+        wsamp->freeReference();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_wind3d_partial_and_bad)
+{
+    Wind3D wind;
+    setup_wind3d(wind);
+
+    int nout = floatSamplesOut();
+
+    // unparsed values are nan
+    std::list<const Sample*> results;
+    SampleT<char>* samp = rawSample("1.5,-2.0,0.25\r\n", true);
+    BOOST_CHECK(wind.process(samp, results));
+    samp->freeReference();
+    BOOST_REQUIRE_EQUAL(results.size(), 1u);
+    const SampleT<float>* wsamp =
+        static_cast<const SampleT<float>*>(results.front());
+    BOOST_REQUIRE_EQUAL(wsamp->getDataLength(), 6u);
+    BOOST_CHECK_EQUAL(wsamp->getConstDataPtr()[1], -2.0);
+    BOOST_CHECK(std::isnan(wsamp->getConstDataPtr()[3]));
+    BOOST_CHECK(std::isnan(wsamp->getConstDataPtr()[4]));
+    wsamp->freeReference();
+    results.clear();
+
+    // nothing parsed, and no sample is left out of the pool
+    samp = rawSample("garbage\r\n", false);
+    BOOST_CHECK(!wind.process(samp, results));
+    samp->freeReference();
+    BOOST_CHECK(results.empty());
+    BOOST_CHECK_EQUAL(floatSamplesOut(), nout);
+}
+
+BOOST_AUTO_TEST_CASE(test_wind3d_batch_corrections)
+{
+    // Offsets, tilts, rotations and orientations from a cal file,
+    // which change within the batches.
+    {
+        Wind3D single;
+        addCalFile(single);
+        setup_wind3d(single);
+        Wind3D batch;
+        addCalFile(batch);
+        setup_wind3d(batch);
+        check_corrections(single, batch, 800, 37);
+    }
+
+    // Without tilt correction, a missing w leaves u and v.
+    {
+        Wind3D single;
+        Wind3D batch;
+        Wind3D* winds[2] = { &single, &batch };
+        for (int i = 0; i < 2; i++) {
+            addStringParameter(*winds[i], "orientation", "down");
+            addFloatParameter(*winds[i], "Vazimuth", std::vector<float>(1, 90.0));
+            addFloatParameter(*winds[i], "biases", std::vector<float>(3, 0.1));
+            addFloatParameter(*winds[i], "lean", std::vector<float>(1, 5.0));
+            addFloatParameter(*winds[i], "wind3d_tilt_correction",
+                              std::vector<float>(1, 0.0));
+            setup_wind3d(*winds[i]);
+        }
+        check_corrections(single, batch, 200, 200);
+    }
+
+    // With a tilt, orientation and rotation combined into one matrix.
+    {
+        Wind3D single;
+        Wind3D batch;
+        Wind3D* winds[2] = { &single, &batch };
+        for (int i = 0; i < 2; i++) {
+            addStringParameter(*winds[i], "orientation", "horizontal");
+            addFloatParameter(*winds[i], "Vazimuth", std::vector<float>(1, 200.0));
+            addFloatParameter(*winds[i], "lean", std::vector<float>(1, 4.0));
+            addFloatParameter(*winds[i], "leanAzimuth", std::vector<float>(1, 250.0));
+            setup_wind3d(*winds[i]);
+        }
+        check_corrections(single, batch, 200, 64);
+    }
+}
@@ -0,0 +1,245 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+using boost::unit_test_framework::test_suite;
+
+#include <nidas/dynld/isff/WisardMote.h>
+#include <nidas/core/Parameter.h>
+#include <nidas/core/SamplePool.h>
+#include <nidas/core/Variable.h>
+
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../benchmark.h"
+
+using namespace nidas::core;
+using nidas::dynld::isff::WisardMote;
+
+namespace {
+
+const unsigned int SENSOR_ID = 0x8000;
+
+const dsm_time_t T0 = (dsm_time_t) 1700000000 * USECS_PER_SEC;
+
+/**
+ * Configure a WisardMote on a DSM for the given motes, with sample
+ * tags for TRH (sensor types 0x10-0x13), and for Int16 (0x04) with
+ * one more variable than the message contains.
+ */
+void
+setup_mote(WisardMote& mote, unsigned int dsmid, const std::vector<int>& motes)
+{
+    mote.setDSMId(dsmid);
+    mote.setSensorId(SENSOR_ID);
+    mote.setDeviceName("/dev/ttyS9");
+
+    ParameterT<int>* param = new ParameterT<int>();
+    param->setName("motes");
+    param->setValues(motes);
+    mote.addParameter(param);
+
+    const char* trhnames[] = { "T", "RH", "Ifan" };
+    const char* i16names[] = { "X", "Y" };
+    struct {
+        int stype1;
+        int stype2;
+        const char** names;
+        unsigned int nvars;
+    } tags[] = {
+        { 0x10, 0x13, trhnames, 3 },
+        { 0x04, 0x04, i16names, 2 },
+    };
+
+    for (unsigned int it = 0; it < sizeof(tags) / sizeof(tags[0]); it++) {
+        SampleTag* tag = new SampleTag(&mote);
+        tag->setDSMId(dsmid);
+        tag->setSensorId(SENSOR_ID);
+        tag->setSampleId(it + 1);
+        ParameterT<int>* stypes = new ParameterT<int>();
+        stypes->setName("stypes");
+        for (int st = tags[it].stype1; st <= tags[it].stype2; st++)
+            stypes->setValue(st - tags[it].stype1, st);
+        tag->addParameter(stypes);
+        for (unsigned int iv = 0; iv < tags[it].nvars; iv++) {
+            Variable* var = new Variable();
+            var->setName(tags[it].names[iv]);
+            var->setSuffix(".%c.m%m");
+            tag->addVariable(var);
+        }
+        mote.addSampleTag(tag);
+    }
+    mote.validate();
+}
+
+void
+putInt16(std::string& msg, int val)
+{
+    msg += (char)(val & 0xff);
+    msg += (char)((val >> 8) & 0xff);
+}
+
+/**
+ * A raw data message from a mote: the ID, version, message type
+ * and sequence number, the fields, and the checksum and EOM.
+ */
+SampleT<char>*
+rawMessage(int moteId, const std::string& fields, dsm_time_t tt)
+{
+    std::ostringstream ost;
+    ost << "ID" << moteId << ':';
+    std::string msg = ost.str();
+    msg += (char) 5;    // version
+    msg += (char) 1;    // data message
+    msg += (char) 17;   // sequence
+    msg += fields;
+
+    unsigned char cksum = (unsigned char) msg.length();
+    for (unsigned int i = 0; i < msg.length(); i++) cksum ^= msg[i];
+    msg += (char) cksum;
+    msg += "\x03\x04\r";
+
+    // NIDAS adds a trailing NULL
+    SampleT<char>* samp = getSample<char>(msg.length() + 1);
+    ::memcpy(samp->getDataPtr(), msg.c_str(), msg.length() + 1);
+    samp->setTimeTag(tt);
+    samp->setId(SET_DSM_ID(SET_SPS_ID(0, SENSOR_ID), 1));
+    return samp;
+}
+
+/**
+ * Fields of PicTime (ignored), ntrh TRH and an Int16 sensor type.
+ */
+std::string
+moteFields(int tc100, int rh100, int i16, int ntrh = 1)
+{
+    std::string fields;
+    fields += (char) 0x01;
+    putInt16(fields, 1234);
+    for (int i = 0; i < ntrh; i++) {
+        fields += (char) (0x10 + i);
+        putInt16(fields, tc100);
+        putInt16(fields, rh100);
+        putInt16(fields, 30);
+    }
+    fields += (char) 0x04;
+    putInt16(fields, i16);
+    return fields;
+}
+
+void
+freeResults(std::list<const Sample*>& results)
+{
+    std::list<const Sample*>::const_iterator ri = results.begin();
+    for ( ; ri != results.end(); ++ri) (*ri)->freeReference();
+    results.clear();
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(test_wisard_decode)
+{
+    WisardMote mote;
+    std::vector<int> motes;
+    motes.push_back(1);
+    motes.push_back(2);
+    setup_mote(mote, 1, motes);
+
+    dsm_sample_id_t sid0 = mote.getId();
+
+    // configured mote: PicTime is ignored, TRH and Int16 have tags
+    std::list<const Sample*> results;
+    SampleT<char>* samp = rawMessage(2, moteFields(2150, 5525, -321), T0);
+    BOOST_CHECK(mote.process(samp, results));
+    samp->freeReference();
+
+    BOOST_REQUIRE_EQUAL(results.size(), 2u);
+    const SampleT<float>* trh =
+        static_cast<const SampleT<float>*>(results.front());
+    BOOST_CHECK_EQUAL(trh->getId(), sid0 + (2 << 8) + 0x10);
+    BOOST_CHECK_EQUAL(trh->getTimeTag(), T0);
+    BOOST_REQUIRE_EQUAL(trh->getDataLength(), 3u);
+    BOOST_CHECK_CLOSE(trh->getConstDataPtr()[0], 21.5, 1.e-4);
+    BOOST_CHECK_CLOSE(trh->getConstDataPtr()[1], 55.25, 1.e-4);
+    BOOST_CHECK_CLOSE(trh->getConstDataPtr()[2], 0.3, 1.e-4);
+
+    const SampleT<float>* i16 =
+        static_cast<const SampleT<float>*>(results.back());
+    BOOST_CHECK_EQUAL(i16->getId(), sid0 + (2 << 8) + 0x04);
+    BOOST_REQUIRE_EQUAL(i16->getDataLength(), 2u);
+    BOOST_CHECK_EQUAL(i16->getConstDataPtr()[0], -321.0);
+    BOOST_CHECK(std::isnan(i16->getConstDataPtr()[1]));
+    freeResults(results);
+
+    // unconfigured mote: samples of the message length, without tags
+    samp = rawMessage(9, moteFields(-500, 9000, 7), T0);
+    BOOST_CHECK(mote.process(samp, results));
+    samp->freeReference();
+    BOOST_REQUIRE_EQUAL(results.size(), 2u);
+    trh = static_cast<const SampleT<float>*>(results.front());
+    BOOST_CHECK_EQUAL(trh->getId(), sid0 + (9 << 8) + 0x10);
+    BOOST_REQUIRE_EQUAL(trh->getDataLength(), 3u);
+    BOOST_CHECK_CLOSE(trh->getConstDataPtr()[0], -5.0, 1.e-4);
+    i16 = static_cast<const SampleT<float>*>(results.back());
+    BOOST_REQUIRE_EQUAL(i16->getDataLength(), 1u);
+    BOOST_CHECK_EQUAL(i16->getConstDataPtr()[0], 7.0);
+    freeResults(results);
+
+    // an unknown sensor type ends the parsing of the message
+    std::string fields = moteFields(2150, 5525, 1);
+    fields.insert(fields.begin() + 3, (char) 0xff);
+    samp = rawMessage(1, fields, T0);
+    BOOST_CHECK(mote.process(samp, results));
+    samp->freeReference();
+    BOOST_CHECK(results.empty());
+
+    // a bad checksum
+    samp = rawMessage(1, moteFields(2150, 5525, 1), T0);
+    samp->getDataPtr()[samp->getDataLength() - 5] ^= 0x55;
+    BOOST_CHECK(!mote.process(samp, results));
+    samp->freeReference();
+    BOOST_CHECK(results.empty());
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_wisard_decode)
+{
+    // A network of motes, all configured.
+    const int nmotes = 120;
+    const int ntrh = 4;
+    WisardMote mote;
+    std::vector<int> motes;
+    for (int i = 1; i <= nmotes; i++) motes.push_back(i);
+    setup_mote(mote, 2, motes);
+
+    std::vector<SampleT<char>*> msgs;
+    for (int i = 0; i < nmotes; i++)
+        msgs.push_back(rawMessage(i + 1, moteFields(2000 + i, 5000 - i, i, ntrh),
+                                  T0 + i * USECS_PER_MSEC));
+
+    const int nloop = 5000;
+    unsigned int nout = 0;
+    std::list<const Sample*> results;
+    struct timespec t0;
+    ::clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int n = 0; n < nloop; n++) {
+        for (unsigned int i = 0; i < msgs.size(); i++) {
+            mote.process(msgs[i], results);
+            nout += results.size();
+            freeResults(results);
+        }
+    }
+    double secs = elapsed(t0);
+    BOOST_CHECK_EQUAL(nout, (ntrh + 1u) * nloop * nmotes);
+
+    for (unsigned int i = 0; i < msgs.size(); i++) msgs[i]->freeReference();
+
+    std::cout << nmotes << " motes: " <<
+        nloop * msgs.size() / secs / 1.e6 << " Mmessages/s, " <<
+        nout / secs / 1.e6 << " Msamples/s" << std::endl;
+}